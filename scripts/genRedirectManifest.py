@@ -0,0 +1,92 @@
+import argparse
+import os
+import struct
+import sys
+
+# Generates the manifest SdFileIndex reads instead of walking the SD on boot.
+# The mod folder is the one copied to sd:/smo, the manifest is written into it as RedirectManifest.bin by default.
+# Regenerate it whenever files are added or removed, files missing from it are never redirected.
+
+MANIFEST_NAME = 'RedirectManifest.bin'
+
+# header: u32 magic, u32 version, u32 entry count, u32 reserved
+# entry: u64 path hash, u64 file size, sorted by hash
+HEADER = struct.Struct('<IIII')
+ENTRY = struct.Struct('<QQ')
+MANIFEST_MAGIC = 0x464D4452  # "RDMF"
+MANIFEST_VERSION = 1
+
+
+def hash_path(path):
+    # has to match SdFileIndex::hashPath: fnv-1a 64 over the path with ascii lowered,
+    # '\' turned into '/', and leading or repeated slashes skipped
+    value = 0xCBF29CE484222325
+    is_last_slash = True
+
+    for c in path.encode('utf-8'):
+        if c == ord('\\'):
+            c = ord('/')
+
+        if c == ord('/'):
+            if is_last_slash:
+                continue
+            is_last_slash = True
+        else:
+            is_last_slash = False
+            if ord('A') <= c <= ord('Z'):
+                c += ord('a') - ord('A')
+
+        value ^= c
+        value = (value * 0x100000001B3) & 0xFFFFFFFFFFFFFFFF
+
+    return value if value != 0 else 1
+
+
+def collect_files(mod_dir, output):
+    entries = {}
+    output = os.path.abspath(output)
+
+    for root, _, files in os.walk(mod_dir):
+        for name in files:
+            full_path = os.path.join(root, name)
+            if os.path.abspath(full_path) == output:
+                continue
+
+            rel_path = os.path.relpath(full_path, mod_dir).replace(os.sep, '/')
+            path_hash = hash_path(rel_path)
+            if path_hash in entries:
+                other_path = entries[path_hash][0]
+                sys.exit(f'"{rel_path}" and "{other_path}" have the same hash, they only differ by case or are a collision.')
+
+            entries[path_hash] = (rel_path, os.path.getsize(full_path))
+
+    return entries
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate the SD redirection manifest for a mod folder.')
+    parser.add_argument('mod_dir', help='folder that gets copied to sd:/smo')
+    parser.add_argument('-o', '--output', help=f'where to write the manifest, defaults to <mod_dir>/{MANIFEST_NAME}')
+    parser.add_argument('-v', '--verbose', action='store_true', help='list every file with its hash')
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.mod_dir):
+        sys.exit(f'{args.mod_dir} is not a folder.')
+
+    output = args.output or os.path.join(args.mod_dir, MANIFEST_NAME)
+    entries = collect_files(args.mod_dir, output)
+
+    with open(output, 'wb') as file:
+        file.write(HEADER.pack(MANIFEST_MAGIC, MANIFEST_VERSION, len(entries), 0))
+        for path_hash in sorted(entries):
+            rel_path, size = entries[path_hash]
+            file.write(ENTRY.pack(path_hash, size))
+            if args.verbose:
+                print(f'{path_hash:016x} {size:>10} {rel_path}')
+
+    total_size = sum(size for _, size in entries.values())
+    print(f'Wrote {len(entries)} files ({total_size / (1024 * 1024):.2f}MB) to {output}.')
+
+
+if __name__ == '__main__':
+    main()
@@ -1,10 +1,207 @@
 const net = require("net");
+const { StringDecoder } = require("string_decoder");
+
+// logs are sent in packets: u32 magic, u32 payload size, payload
+const PACKET_HEADER_SIZE = 8;
+const PACKET_MAGIC = 0x474c5845; // "EXLG"
+
+// deferred logs are sent as binary frames in between plain text logs, a null byte marks the start of a frame.
+// frame: u8 0, u8 type, u16 payload size, payload
+const FRAME_HEADER_SIZE = 4;
+const FRAME_FORMAT = 1; // u64 format id, format string
+const FRAME_RECORD = 2; // u8 severity, u64 format id, tagged arguments
+
+const SEVERITY_COLORS = { 1: "\x1b[33m", 2: "\x1b[31m" };
+
+const FORMAT_SPEC = /%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L|q)?([diouxXeEfFgGaAcspPn%])/g;
+const LENGTH_BITS = { hh: 8n, h: 16n, "": 32n };
+
+// format ids are the format's address on the Switch, which stays the same across reconnects
+const formats = new Map();
+
+function readArgs(data, pos) {
+    const args = [];
+    while (pos < data.length) {
+        const tag = String.fromCharCode(data[pos++]);
+        if (tag === "s") {
+            const length = data.readUInt16LE(pos);
+            pos += 2;
+            args.push(data.toString("utf-8", pos, pos + length));
+            pos += length + 1;
+        } else if (tag === "f") {
+            args.push(data.readDoubleLE(pos));
+            pos += 8;
+        } else if (tag === "i") {
+            args.push(data.readBigInt64LE(pos));
+            pos += 8;
+        } else { // 'u' and 'p'
+            args.push(data.readBigUInt64LE(pos));
+            pos += 8;
+        }
+    }
+    return args;
+}
+
+function pad(text, flags, width) {
+    if (text.length >= width) return text;
+    if (flags.includes("-")) return text.padEnd(width);
+    if (flags.includes("0") && /^[-+ ]?(0x)?[0-9a-fA-F]/.test(text)) {
+        const prefix = text.match(/^[-+ ]?(0x|0X)?/)[0];
+        return prefix + text.slice(prefix.length).padStart(width - prefix.length, "0");
+    }
+    return text.padStart(width);
+}
+
+function formatRecord(fmt, args) {
+    let argIdx = 0;
+    const nextArg = () => (argIdx < args.length ? args[argIdx++] : undefined);
+    const nextInt = () => {
+        const value = nextArg();
+        return typeof value === "string" || value === undefined ? 0 : Number(value);
+    };
+
+    return fmt.replace(FORMAT_SPEC, (match, flags, width, precision, length = "", conv) => {
+        if (conv === "%") return "%";
+        if (conv === "n") return "";
+
+        width = width === "*" ? nextInt() : Number(width || 0);
+        precision = precision === "*" ? nextInt() : precision === undefined ? undefined : Number(precision || 0);
+
+        const value = nextArg();
+        if (value === undefined) return match;
+
+        let text;
+        if (conv === "s") {
+            text = String(value);
+            if (precision !== undefined) text = text.slice(0, precision);
+        } else if (conv === "p" || conv === "P") {
+            text = "0x" + BigInt(value).toString(16);
+        } else if ("eEfFgGaA".includes(conv)) {
+            const num = Number(value);
+            const digits = precision === undefined ? 6 : precision;
+            if (conv === "e" || conv === "E") text = num.toExponential(digits).replace(/e([+-])(\d)$/, "e$10$2");
+            else if (conv === "g" || conv === "G") text = String(Number(num.toPrecision(digits || 1)));
+            else text = num.toFixed(digits);
+            if (conv === conv.toUpperCase()) text = text.toUpperCase();
+            if (num >= 0 && flags.includes("+")) text = "+" + text;
+        } else {
+            // arguments are sent as 64 bit, truncate them to what the original length would have passed
+            const bits = LENGTH_BITS[length] ?? 64n;
+            let num = typeof value === "string" ? 0n : BigInt.asUintN(Number(bits), BigInt(value));
+            if (conv === "c") {
+                text = String.fromCharCode(Number(num & 0xffn));
+            } else {
+                if (conv === "d" || conv === "i") num = BigInt.asIntN(Number(bits), num);
+                const radix = conv === "o" ? 8 : conv === "x" || conv === "X" ? 16 : 10;
+                text = (num < 0n ? -num : num).toString(radix);
+                if (precision !== undefined) text = text.padStart(precision, "0");
+                if (conv === "X") text = text.toUpperCase();
+                if (flags.includes("#") && num !== 0n && radix === 16) text = (conv === "X" ? "0X" : "0x") + text;
+                if (num < 0n) text = "-" + text;
+                else if (flags.includes("+") && radix === 10) text = "+" + text;
+            }
+        }
+
+        return pad(text, flags, width);
+    });
+}
+
+class LogDecoder {
+    constructor() {
+        this.buffer = Buffer.alloc(0);
+        this.textDecoder = new StringDecoder("utf-8");
+        this.logCount = 0;
+    }
+
+    feed(data) {
+        this.buffer = Buffer.concat([this.buffer, data]);
+        let output = "";
+
+        while (this.buffer.length >= PACKET_HEADER_SIZE) {
+            const magic = this.buffer.readUInt32LE(0);
+            const size = this.buffer.readUInt32LE(4);
+            if (magic !== PACKET_MAGIC)
+                throw new Error(`Bad packet magic 0x${magic.toString(16)}, is the Switch running an older build?`);
+            if (this.buffer.length < PACKET_HEADER_SIZE + size) break;
+
+            output += this.decodePayload(this.buffer.subarray(PACKET_HEADER_SIZE, PACKET_HEADER_SIZE + size));
+            this.buffer = this.buffer.subarray(PACKET_HEADER_SIZE + size);
+        }
+
+        return output;
+    }
+
+    decodePayload(payload) {
+        let output = "";
+        let pos = 0;
+
+        while (pos < payload.length) {
+            const frameStart = payload.indexOf(0, pos);
+            if (frameStart !== pos) {
+                const end = frameStart < 0 ? payload.length : frameStart;
+                const text = this.textDecoder.write(payload.subarray(pos, end));
+                this.logCount += text.split("\n").length - 1;
+                output += text;
+                pos = end;
+                continue;
+            }
+
+            const type = payload[pos + 1];
+            const size = payload.readUInt16LE(pos + 2);
+            pos += FRAME_HEADER_SIZE;
+            output += this.decodeFrame(type, payload.subarray(pos, pos + size));
+            pos += size;
+        }
+
+        return output;
+    }
+
+    decodeFrame(type, payload) {
+        if (type === FRAME_FORMAT) {
+            formats.set(payload.readBigUInt64LE(0), payload.toString("utf-8", 8));
+            return "";
+        }
+
+        if (type === FRAME_RECORD) {
+            this.logCount++;
+            const severity = payload[0];
+            const formatId = payload.readBigUInt64LE(1);
+            const fmt = formats.get(formatId);
+            if (fmt === undefined) return `[Unknown log format 0x${formatId.toString(16)}]\n`;
+
+            let text;
+            try {
+                text = formatRecord(fmt, readArgs(payload, 9));
+            } catch {
+                return `[Failed to decode log: ${JSON.stringify(fmt)}]\n`;
+            }
+
+            const color = SEVERITY_COLORS[severity];
+            return color ? `${color}${text}\x1b[0m` : text;
+        }
+
+        return `[Unknown frame type ${type}]\n`;
+    }
+}
+
 net.createServer((socket) => {
     console.log("new connection", socket.remoteAddress, socket.remotePort, socket.remoteFamily);
+    // a packet cut off by a disconnect is sent again in full over the next connection
+    const decoder = new LogDecoder();
+    const startTime = Date.now();
     socket
         .on("data", (data) => {
-            process.stdout.write(data.toString("utf-8"));
+            try {
+                process.stdout.write(decoder.feed(data));
+            } catch (error) {
+                console.log(error.message);
+                socket.destroy();
+            }
+        })
+        .on("close", (error) => {
+            const elapsed = Math.max((Date.now() - startTime) / 1000, 0.001);
+            console.log("new disconnect", error);
+            console.log(`received ${decoder.logCount} logs in ${elapsed.toFixed(1)}s (${(decoder.logCount / elapsed).toFixed(0)} logs/s)`);
         })
-        .on("close", (error) => console.log("new disconnect", error))
         .on("error", () => console.log("errorma"));
-}).listen(3080, () => { console.log("listening"); });
\ No newline at end of file
+}).listen(3080, () => { console.log("listening"); });
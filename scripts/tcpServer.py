@@ -1,8 +1,171 @@
+import codecs
+import re
 import socket
+import struct
 import sys
+import time
 
 # Super simple TCP server yoinked straight from google.com (http://pymotw.com/2/socket/tcp.html)
 
+# Logs are sent in packets: u32 magic, u32 payload size, payload
+PACKET_HEADER = struct.Struct('<II')
+PACKET_MAGIC = 0x474C5845  # "EXLG"
+
+# Deferred logs are sent as binary frames in between plain text logs, a null byte marks the start of a frame.
+# frame: u8 0, u8 type, u16 payload size, payload
+FRAME_HEADER = struct.Struct('<BBH')
+FRAME_FORMAT = 1  # u64 format id, format string
+FRAME_RECORD = 2  # u8 severity, u64 format id, tagged arguments
+
+SEVERITY_COLORS = {1: '\x1b[33m', 2: '\x1b[31m'}
+
+FORMAT_SPEC = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L|q)?([diouxXeEfFgGaAcspPn%])')
+LENGTH_BITS = {'hh': 8, 'h': 16, None: 32}
+
+
+def read_args(data, pos):
+    args = []
+    while pos < len(data):
+        tag = chr(data[pos])
+        pos += 1
+        if tag == 's':
+            (length,) = struct.unpack_from('<H', data, pos)
+            pos += 2
+            args.append(data[pos:pos + length].decode('utf-8', errors='replace'))
+            pos += length + 1
+        elif tag == 'f':
+            args.append(struct.unpack_from('<d', data, pos)[0])
+            pos += 8
+        elif tag == 'i':
+            args.append(struct.unpack_from('<q', data, pos)[0])
+            pos += 8
+        else:  # 'u' and 'p'
+            args.append(struct.unpack_from('<Q', data, pos)[0])
+            pos += 8
+    return args
+
+
+def format_record(fmt, args):
+    args = iter(args)
+
+    def next_int():
+        value = next(args, 0)
+        return int(value) if not isinstance(value, str) else 0
+
+    def replace(match):
+        flags, width, precision, length, conv = match.groups()
+        if conv == '%':
+            return '%'
+        if conv == 'n':
+            return ''
+
+        if width == '*':
+            width = str(next_int())
+        if precision == '*':
+            precision = str(next_int())
+        spec = '%' + flags + (width or '') + ('.' + precision if precision is not None else '')
+
+        value = next(args, None)
+        if value is None:
+            return match.group(0)
+
+        if conv == 's':
+            return (spec + 's') % value
+        if conv in 'pP':
+            return (spec + 's') % ('0x%x' % int(value))
+        if conv in 'eEfFgG':
+            return (spec + conv) % float(value)
+        if conv in 'aA':
+            text = float(value).hex()
+            return (spec.split('.')[0] + 's') % (text.upper() if conv == 'A' else text)
+
+        # arguments are sent as 64 bit, truncate them to what the original length would have passed
+        value = int(value) if not isinstance(value, str) else 0
+        bits = LENGTH_BITS.get(length, 64)
+        value &= (1 << bits) - 1
+        if conv == 'c':
+            return (spec + 'c') % chr(value & 0xFF)
+        if conv in 'di' and value >= 1 << (bits - 1):
+            value -= 1 << bits
+        return (spec + ('d' if conv in 'diu' else conv)) % value
+
+    return FORMAT_SPEC.sub(replace, fmt)
+
+
+class LogDecoder:
+    def __init__(self):
+        # format ids are the format's address on the Switch, which stays the same across reconnects
+        self.formats = {}
+        self.log_count = 0
+        self.reset()
+
+    def reset(self):
+        self.buffer = bytearray()
+        self.text_decoder = codecs.getincrementaldecoder('utf-8')(errors='replace')
+
+    def feed(self, data):
+        self.buffer += data
+        output = []
+
+        while len(self.buffer) >= PACKET_HEADER.size:
+            magic, size = PACKET_HEADER.unpack_from(self.buffer)
+            if magic != PACKET_MAGIC:
+                raise ValueError(f'Bad packet magic {magic:#x}, is the Switch running an older build?')
+            if len(self.buffer) < PACKET_HEADER.size + size:
+                break
+
+            payload = bytes(self.buffer[PACKET_HEADER.size:PACKET_HEADER.size + size])
+            del self.buffer[:PACKET_HEADER.size + size]
+            output.append(self.decode_payload(payload))
+
+        return ''.join(output)
+
+    def decode_payload(self, payload):
+        output = []
+        pos = 0
+
+        while pos < len(payload):
+            frame_start = payload.find(0, pos)
+            if frame_start != pos:
+                end = len(payload) if frame_start < 0 else frame_start
+                text = self.text_decoder.decode(payload[pos:end])
+                self.log_count += text.count('\n')
+                output.append(text)
+                pos = end
+                continue
+
+            _, frame_type, size = FRAME_HEADER.unpack_from(payload, pos)
+            pos += FRAME_HEADER.size
+            output.append(self.decode_frame(frame_type, payload[pos:pos + size]))
+            pos += size
+
+        return ''.join(output)
+
+    def decode_frame(self, frame_type, payload):
+        if frame_type == FRAME_FORMAT:
+            (format_id,) = struct.unpack_from('<Q', payload)
+            self.formats[format_id] = payload[8:].decode('utf-8', errors='replace')
+            return ''
+
+        if frame_type == FRAME_RECORD:
+            self.log_count += 1
+            severity = payload[0]
+            (format_id,) = struct.unpack_from('<Q', payload, 1)
+            fmt = self.formats.get(format_id)
+            if fmt is None:
+                return f'[Unknown log format {format_id:#x}]\n'
+
+            try:
+                text = format_record(fmt, read_args(payload, 9))
+            except (struct.error, ValueError, TypeError):
+                return f'[Failed to decode log: {fmt!r}]\n'
+
+            color = SEVERITY_COLORS.get(severity)
+            return f'{color}{text}\x1b[0m' if color else text
+
+        return f'[Unknown frame type {frame_type}]\n'
+
+
 # Create a TCP/IP socket
 sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
 
@@ -18,20 +181,23 @@ sock.bind(server_address)
 # Listen for incoming connections
 sock.listen(1)
 
+decoder = LogDecoder()
+
 while True:
     # Wait for a connection
     print('Waiting for Switch to Connect...')
     connection, client_address = sock.accept()
+    # a packet cut off by a disconnect is sent again in full over the next connection
+    decoder.reset()
+    start_time = time.monotonic()
+    start_count = decoder.log_count
     try:
         print(f'Switch Connected! IP: {client_address[0]} Port: {client_address[1]}')
         while True:
-            data = connection.recv(1024)
+            data = connection.recv(0x10000)
 
             if data:
-                try:
-                    print(data.decode("utf-8"), end='', flush=True)
-                except:
-                    print("Failed to decode data!\n")
+                print(decoder.feed(data), end='', flush=True)
             else:
                 print(f'Connection Terminated.')
                 break
@@ -39,6 +205,13 @@ while True:
     except ConnectionResetError:
         print("Connection reset")
 
+    except ValueError as error:
+        print(error)
+
     finally:
         # Clean up the connection
-        connection.close()
\ No newline at end of file
+        connection.close()
+
+        elapsed = time.monotonic() - start_time
+        count = decoder.log_count - start_count
+        print(f'Received {count} logs in {elapsed:.1f}s ({count / max(elapsed, 0.001):.0f} logs/s).')
@@ -65,8 +65,7 @@ void InputHelper::initKBM() {
 }
 
 void InputHelper::updatePadState() {
-    prevControllerState = curControllerState;
-    tryGetContState(&curControllerState, selectedPort);
+    updateControllerState();
 
     prevKeyboardState = curKeyboardState;
     nn::hid::GetKeyboardState(&curKeyboardState);
@@ -76,6 +75,11 @@ void InputHelper::updatePadState() {
 
     prevTouchState = curTouchState;
     nn::hid::GetTouchScreenState(&curTouchState);
+}
+
+void InputHelper::updateControllerState() {
+    prevControllerState = curControllerState;
+    tryGetContState(&curControllerState, selectedPort);
 
     //    if (isHoldZL() && isPressZR()) {
         if ((isHoldLeftStick() && isPressRightStick()) || (isHoldRightStick() && isPressLeftStick())) {
@@ -7,6 +7,9 @@ class InputHelper {
 public:
     static void updatePadState();
 
+    // only reads the controller, for when nothing needs keyboard, mouse or touch input
+    static void updateControllerState();
+
     static void setPort(ulong port) { selectedPort = port; }
 
     static void initKBM();
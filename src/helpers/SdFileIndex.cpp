@@ -0,0 +1,194 @@
+#include "SdFileIndex.h"
+#include "fsHelper.h"
+#include "init.h"
+#include "logger/Logger.hpp"
+#include "nn/fs.h"
+#include "os/os_tick.hpp"
+
+#include <filedevice/seadFileDevice.h>
+#include <cstring>
+
+namespace {
+    // entries read from a directory at a time, each one is 0x310 bytes
+    constexpr s64 cEntryChunkSize = 16;
+    constexpr size_t cMaxPathSize = 0x400;
+}
+
+SdFileIndex::SdFileIndex() {
+    nn::os::InitializeMutex(&mMutex, false, 0);
+}
+
+SdFileIndex& SdFileIndex::instance() {
+    static SdFileIndex instance;
+    return instance;
+}
+
+void SdFileIndex::insert(u64 hash) {
+    if(!mPaths.insert(hash)) {
+        // can't index every file, so the index can't be trusted to say a file doesn't exist
+        Logger::log("Out of memory while indexing SD files, falling back to SD lookups.\n");
+        mIsBuilt = false;
+        mIsIncomplete = true;
+    }
+}
+
+void SdFileIndex::clear() {
+    mPaths.clear();
+    mIsBuilt = false;
+    mIsIncomplete = false;
+}
+
+bool SdFileIndex::loadManifest() {
+    long fileSize = FsHelper::getFileSize(cManifestPath);
+    if(fileSize < (long)sizeof(SdPathSet::ManifestHeader))
+        return false;
+
+    void* buffer = nn::init::GetAllocator()->Allocate(fileSize);
+    if(buffer == nullptr) {
+        Logger::log("Not enough memory to load the SD manifest (%ld bytes), walking the SD instead.\n", fileSize);
+        return false;
+    }
+
+    if(FsHelper::readFileToBuffer(buffer, fileSize, cManifestPath).isFailure()) {
+        nn::init::GetAllocator()->Free(buffer);
+        return false;
+    }
+
+    lock();
+    bool isValid = mPaths.loadManifest(buffer, fileSize);
+    mIsBuilt = isValid;
+    unlock();
+
+    if(!isValid) {
+        Logger::log("SD manifest is invalid! Walking the SD instead.\n");
+        nn::init::GetAllocator()->Free(buffer);
+        return false;
+    }
+
+    return true;
+}
+
+void SdFileIndex::walkDirectory(char* path, size_t pathLen, size_t rootLen) {
+    nn::fs::DirectoryHandle handle{};
+    if(nn::fs::OpenDirectory(&handle, path, nn::fs::OpenDirectoryMode_All).isFailure())
+        return;
+
+    auto* entries = (nn::fs::DirectoryEntry*)nn::init::GetAllocator()->Allocate(sizeof(nn::fs::DirectoryEntry) * cEntryChunkSize);
+    if(entries == nullptr) {
+        nn::fs::CloseDirectory(handle);
+        return;
+    }
+
+    s64 entryCount = 0;
+    while (nn::fs::ReadDirectory(&entryCount, entries, handle, cEntryChunkSize).isSuccess() && entryCount > 0) {
+        for (s64 i = 0; i < entryCount; ++i) {
+            nn::fs::DirectoryEntry& entry = entries[i];
+
+            size_t nameLen = strlen(entry.m_Name);
+            if(pathLen + 1 + nameLen >= cMaxPathSize)
+                continue;
+
+            path[pathLen] = '/';
+            memcpy(path + pathLen + 1, entry.m_Name, nameLen + 1);
+            size_t entryPathLen = pathLen + 1 + nameLen;
+
+            if((nn::fs::DirectoryEntryType)entry.m_Type == nn::fs::DirectoryEntryType_Directory) {
+                walkDirectory(path, entryPathLen, rootLen);
+            } else {
+                u64 hash = SdPathSet::hashPath(path + rootLen, entryPathLen - rootLen);
+                lock();
+                insert(hash);
+                unlock();
+            }
+        }
+    }
+
+    path[pathLen] = '\0';
+    nn::init::GetAllocator()->Free(entries);
+    nn::fs::CloseDirectory(handle);
+}
+
+void SdFileIndex::build() {
+    SdFileIndex& index = instance();
+    nn::os::Tick startTick = nn::os::GetSystemTick();
+
+    // lookups made while walking go to the SD, the walk is too slow to hold the lock for
+    index.lock();
+    index.clear();
+    index.unlock();
+
+    if(!index.loadManifest()) {
+        char path[cMaxPathSize];
+        size_t rootLen = strlen(cRootPath);
+        memcpy(path, cRootPath, rootLen + 1);
+        index.walkDirectory(path, rootLen, rootLen);
+
+        index.lock();
+        index.mIsBuilt = !index.mIsIncomplete;
+        index.unlock();
+    }
+
+    index.mBuildTime = (nn::os::GetSystemTick() - startTick).ToTimeSpan().GetMicroSeconds();
+}
+
+void SdFileIndex::invalidate() {
+    SdFileIndex& index = instance();
+    index.lock();
+    index.clear();
+    index.unlock();
+}
+
+void SdFileIndex::invalidatePath(const char* path) {
+    SdFileIndex& index = instance();
+
+    char fullPath[cMaxPathSize];
+    snprintf(fullPath, sizeof(fullPath), "%s/%s", cRootPath, path);
+
+    nn::fs::DirectoryEntryType type;
+    bool isFile = nn::fs::GetEntryType(&type, fullPath).isSuccess() && type == nn::fs::DirectoryEntryType_File;
+    u64 hash = SdPathSet::hashPath(path, strlen(path));
+
+    index.lock();
+    if(index.mIsBuilt) {
+        if(isFile)
+            index.insert(hash);
+        else
+            index.mPaths.erase(hash);
+    }
+    index.unlock();
+}
+
+bool SdFileIndex::isExistFile(sead::FileDevice* sdDevice, const sead::SafeString& path) {
+    SdFileIndex& index = instance();
+    nn::os::Tick startTick = nn::os::GetSystemTick();
+
+    const char* str = path.cstr();
+    u64 hash = SdPathSet::hashPath(str, strlen(str));
+
+    index.lock();
+    bool isBuilt = index.mIsBuilt;
+    bool isExist = isBuilt && index.mPaths.contains(hash);
+    index.unlock();
+
+    if(isBuilt) {
+        (isExist ? index.mHitCount : index.mMissCount).fetch_add(1, std::memory_order_relaxed);
+    } else {
+        isExist = sdDevice != nullptr && sdDevice->isExistFile(path);
+        index.mFallbackCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    index.mLookupTicks.fetch_add((nn::os::GetSystemTick() - startTick).GetInt64Value(), std::memory_order_relaxed);
+    return isExist;
+}
+
+s64 SdFileIndex::getLookupTime() {
+    return nn::os::Tick(instance().mLookupTicks.load(std::memory_order_relaxed)).ToTimeSpan().GetMicroSeconds();
+}
+
+void SdFileIndex::resetStats() {
+    SdFileIndex& index = instance();
+    index.mHitCount = 0;
+    index.mMissCount = 0;
+    index.mFallbackCount = 0;
+    index.mLookupTicks = 0;
+}
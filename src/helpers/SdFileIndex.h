@@ -0,0 +1,76 @@
+#pragma once
+
+#include "SdPathSet.h"
+#include "types.h"
+#include "nn/os.h"
+#include <prim/seadSafeString.h>
+#include <atomic>
+
+namespace sead {
+    class FileDevice;
+}
+
+// in-memory index of every file on the SD under the sd file device's root (sd:/smo/), so the file redirection hooks
+// don't have to stat the SD card for every file the game looks up, when almost none of them are overridden.
+// paths are kept in an SdPathSet, relative to the root. until the index is built, lookups fall back to asking the
+// file device.
+// if the root holds a manifest (made with scripts/genRedirectManifest.py) it's read instead of walking the SD,
+// so building doesn't depend on how many files a mod has. changes made after that go into the set.
+class SdFileIndex {
+
+    static constexpr const char* cRootPath = "sd:/smo";
+    static constexpr const char* cManifestPath = "sd:/smo/RedirectManifest.bin";
+
+    SdPathSet mPaths;
+    bool mIsBuilt = false;
+    bool mIsIncomplete = false; // ran out of memory, some files may be missing
+
+    // lookups can come from any thread loading files
+    nn::os::MutexType mMutex = {};
+
+    s64 mBuildTime = 0; // us
+    std::atomic<u32> mHitCount = 0;
+    std::atomic<u32> mMissCount = 0;
+    std::atomic<u32> mFallbackCount = 0;
+    std::atomic<s64> mLookupTicks = 0; // spent on every lookup, including fallbacks
+
+    bool loadManifest();
+    void insert(u64 hash);
+    void walkDirectory(char* path, size_t pathLen, size_t rootLen);
+    void clear();
+
+    void lock() { nn::os::LockMutex(&mMutex); }
+    void unlock() { nn::os::UnlockMutex(&mMutex); }
+
+    SdFileIndex();
+
+public:
+
+    static SdFileIndex& instance();
+
+    /// Reads the manifest, or walks the SD if there is none, any previous index is replaced
+    static void build();
+
+    /// Drops the index, lookups go to the SD again until it's rebuilt
+    static void invalidate();
+
+    /// Updates a single path after it was added to or removed from the SD, path is relative to the root
+    static void invalidatePath(const char* path);
+
+    /// True if the path (relative to the root, as passed to the sd file device) exists on the SD
+    static bool isExistFile(sead::FileDevice* sdDevice, const sead::SafeString& path);
+
+    static bool isBuilt() { return instance().mIsBuilt; }
+    static bool isFromManifest() { return instance().mPaths.isFromManifest(); }
+    static u32 getFileCount() { return instance().mPaths.getCount(); }
+    static u64 getManifestDataSize() { return instance().mPaths.getManifestDataSize(); }
+    static s64 getBuildTime() { return instance().mBuildTime; }
+    static u32 getHitCount() { return instance().mHitCount.load(std::memory_order_relaxed); }
+    static u32 getMissCount() { return instance().mMissCount.load(std::memory_order_relaxed); }
+    static u32 getFallbackCount() { return instance().mFallbackCount.load(std::memory_order_relaxed); }
+
+    /// Total time spent on lookups in us, for comparing load times with and without the index
+    static s64 getLookupTime();
+
+    static void resetStats();
+};
@@ -0,0 +1,187 @@
+#include "SdPathSet.h"
+#include "init.h"
+
+#include <cstring>
+
+namespace {
+    u32 getHome(u64 hash, u32 mask) {
+        return (u32)(hash ^ (hash >> 29)) & mask;
+    }
+}
+
+SdPathSet::~SdPathSet() {
+    clear();
+    if(mHashes != nullptr)
+        nn::init::GetAllocator()->Free(mHashes);
+}
+
+u64 SdPathSet::hashPath(const char* path, size_t len) {
+    u64 hash = 0xCBF29CE484222325;
+    bool isLastSlash = true; // also skips leading slashes
+
+    for (size_t i = 0; i < len; ++i) {
+        char c = path[i];
+        if(c == '\\')
+            c = '/';
+
+        if(c == '/') {
+            if(isLastSlash)
+                continue;
+            isLastSlash = true;
+        } else {
+            isLastSlash = false;
+            if(c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+        }
+
+        hash ^= (u8)c;
+        hash *= 0x100000001B3;
+    }
+
+    return hash != 0 ? hash : 1;
+}
+
+bool SdPathSet::isInTable(u64 hash) const {
+    if(mCount == 0)
+        return false;
+
+    u32 mask = mCapacity - 1;
+    for (u32 i = getHome(hash, mask); mHashes[i] != 0; i = (i + 1) & mask) {
+        if(mHashes[i] == hash)
+            return true;
+    }
+    return false;
+}
+
+SdPathSet::ManifestEntry* SdPathSet::findManifestEntry(u64 hash) const {
+    u32 low = 0;
+    u32 high = mManifestCount;
+
+    while (low < high) {
+        u32 mid = low + (high - low) / 2;
+        if(mManifest[mid].mHash < hash)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low < mManifestCount && mManifest[low].mHash == hash ? &mManifest[low] : nullptr;
+}
+
+bool SdPathSet::grow() {
+    u32 newCapacity = mCapacity != 0 ? mCapacity * 2 : cMinCapacity;
+    auto* newHashes = (u64*)nn::init::GetAllocator()->Allocate(sizeof(u64) * newCapacity);
+    if(newHashes == nullptr)
+        return false;
+
+    memset(newHashes, 0, sizeof(u64) * newCapacity);
+
+    u32 mask = newCapacity - 1;
+    for (u32 i = 0; i < mCapacity; ++i) {
+        u64 hash = mHashes[i];
+        if(hash == 0)
+            continue;
+
+        u32 slot = getHome(hash, mask);
+        while (newHashes[slot] != 0)
+            slot = (slot + 1) & mask;
+        newHashes[slot] = hash;
+    }
+
+    if(mHashes != nullptr)
+        nn::init::GetAllocator()->Free(mHashes);
+
+    mHashes = newHashes;
+    mCapacity = newCapacity;
+    return true;
+}
+
+bool SdPathSet::insert(u64 hash) {
+    if(contains(hash))
+        return true;
+
+    // kept at most half full
+    if((mCount + 1) * 2 > mCapacity && !grow())
+        return false;
+
+    u32 mask = mCapacity - 1;
+    u32 slot = getHome(hash, mask);
+    while (mHashes[slot] != 0)
+        slot = (slot + 1) & mask;
+
+    mHashes[slot] = hash;
+    mCount++;
+    return true;
+}
+
+void SdPathSet::erase(u64 hash) {
+    if(ManifestEntry* entry = findManifestEntry(hash)) {
+        // keeps the rest sorted, only happens when a file is removed at runtime
+        mManifestDataSize -= entry->mSize;
+        memmove(entry, entry + 1, (mManifest + mManifestCount - (entry + 1)) * sizeof(ManifestEntry));
+        mManifestCount--;
+    }
+
+    if(mCount == 0)
+        return;
+
+    u32 mask = mCapacity - 1;
+    u32 slot = getHome(hash, mask);
+    while (mHashes[slot] != hash) {
+        if(mHashes[slot] == 0)
+            return;
+        slot = (slot + 1) & mask;
+    }
+
+    // shift later entries of the probe sequence back, so no lookup ever stops early at the freed slot
+    for (u32 next = (slot + 1) & mask; mHashes[next] != 0; next = (next + 1) & mask) {
+        u32 home = getHome(mHashes[next], mask);
+        bool isHomeBetween = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+        if(!isHomeBetween) {
+            mHashes[slot] = mHashes[next];
+            slot = next;
+        }
+    }
+
+    mHashes[slot] = 0;
+    mCount--;
+}
+
+void SdPathSet::clear() {
+    if(mHashes != nullptr)
+        memset(mHashes, 0, sizeof(u64) * mCapacity);
+    mCount = 0;
+
+    if(mManifestBuffer != nullptr)
+        nn::init::GetAllocator()->Free(mManifestBuffer);
+    mManifestBuffer = nullptr;
+    mManifest = nullptr;
+    mManifestCount = 0;
+    mManifestDataSize = 0;
+}
+
+bool SdPathSet::loadManifest(void* buffer, size_t size) {
+    if(size < sizeof(ManifestHeader))
+        return false;
+
+    auto* header = (ManifestHeader*)buffer;
+    auto* entries = (ManifestEntry*)(header + 1);
+    if(header->mMagic != cManifestMagic || header->mVersion != cManifestVersion ||
+       size != sizeof(ManifestHeader) + (size_t)header->mEntryCount * sizeof(ManifestEntry))
+        return false;
+
+    // binary search relies on the order, so check it once instead of trusting the file
+    u64 dataSize = 0;
+    for (u32 i = 0; i < header->mEntryCount; ++i) {
+        if(entries[i].mHash == 0 || (i != 0 && entries[i - 1].mHash >= entries[i].mHash))
+            return false;
+        dataSize += entries[i].mSize;
+    }
+
+    clear();
+    mManifestBuffer = buffer;
+    mManifest = entries;
+    mManifestCount = header->mEntryCount;
+    mManifestDataSize = dataSize;
+    return true;
+}
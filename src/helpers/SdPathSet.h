@@ -0,0 +1,72 @@
+#pragma once
+
+#include "types.h"
+
+// set of SD file paths, stored as hashes of their normalized (lower case, '/' separated) form in an open addressing
+// table. a manifest made with scripts/genRedirectManifest.py can be used as the starting contents, it's searched in
+// place and files added after that go into the table. not thread safe, SdFileIndex does the locking.
+class SdPathSet {
+
+    static constexpr u32 cMinCapacity = 0x400; // must be a power of two
+
+    // manifest layout, has to match scripts/genRedirectManifest.py
+    static constexpr u32 cManifestMagic = 0x464D4452; // "RDMF"
+    static constexpr u32 cManifestVersion = 1;
+
+public:
+    struct ManifestHeader {
+        u32 mMagic;
+        u32 mVersion;
+        u32 mEntryCount;
+        u32 mReserved;
+    };
+
+    struct ManifestEntry {
+        u64 mHash; // sorted ascending, no duplicates
+        u64 mSize;
+    };
+
+private:
+    u64* mHashes = nullptr; // 0 marks an empty slot
+    u32 mCapacity = 0;
+    u32 mCount = 0;
+    void* mManifestBuffer = nullptr; // the whole file, entries follow the header
+    ManifestEntry* mManifest = nullptr;
+    u32 mManifestCount = 0;
+    u64 mManifestDataSize = 0; // sum of the manifest's file sizes
+
+    bool isInTable(u64 hash) const;
+    ManifestEntry* findManifestEntry(u64 hash) const;
+    bool grow();
+
+public:
+    SdPathSet() = default;
+
+    ~SdPathSet();
+
+    SdPathSet(const SdPathSet&) = delete;
+    SdPathSet& operator=(const SdPathSet&) = delete;
+
+    // fnv-1a over the normalized path, so lookups match the SD's case insensitivity and don't care about slashes
+    static u64 hashPath(const char* path, size_t len);
+
+    bool contains(u64 hash) const { return isInTable(hash) || findManifestEntry(hash) != nullptr; }
+
+    // false if the table couldn't grow, the hash isn't added then
+    bool insert(u64 hash);
+
+    void erase(u64 hash);
+
+    // drops every path and frees the manifest, the table's memory is kept for the next build
+    void clear();
+
+    // checks the manifest file in buffer and uses it as the set's contents, taking ownership of the buffer
+    // (allocated from nn::init's allocator). false if it's invalid, the buffer is left to the caller then.
+    bool loadManifest(void* buffer, size_t size);
+
+    bool isFromManifest() const { return mManifest != nullptr; }
+
+    u32 getCount() const { return mCount + mManifestCount; }
+
+    u64 getManifestDataSize() const { return mManifestDataSize; }
+};
@@ -11,32 +11,51 @@ namespace FsHelper {
         nn::fs::FileHandle handle;
 
         if (isFileExist(path)) {
-            Logger::log("Removing Previous File.\n");
+            Logger::logDeferred("Removing Previous File.\n");
             nn::fs::DeleteFile(path); // remove previous file
         }
 
         if (nn::fs::CreateFile(path, size)) {
-            Logger::log("Failed to Create File.\n");
+            Logger::logDeferred("Failed to Create File.\n");
             return 1;
         }
 
         if (nn::fs::OpenFile(&handle, path, nn::fs::OpenMode_Write)) {
-            Logger::log("Failed to Open File.\n");
+            Logger::logDeferred("Failed to Open File.\n");
             return 1;
         }
 
         if (nn::fs::WriteFile(handle, 0, buf, size, nn::fs::WriteOption::CreateOption(nn::fs::WriteOptionFlag_Flush))) {
-            Logger::log("Failed to Write to File.\n");
+            Logger::logDeferred("Failed to Write to File.\n");
             return 1;
         }
 
-        Logger::log("Successfully wrote file to: %s!\n", path);
+        Logger::logDeferred("Successfully wrote file to: %s!\n", path);
 
         nn::fs::CloseFile(handle);
 
         return 0;
     }
 
+    nn::Result readFileToBuffer(void *buf, size_t size, const char *path) {
+        nn::fs::FileHandle handle;
+
+        if (nn::fs::OpenFile(&handle, path, nn::fs::OpenMode_Read)) {
+            Logger::logDeferred("Failed to Open File.\n");
+            return 1;
+        }
+
+        nn::Result result = nn::fs::ReadFile(handle, 0, buf, size);
+
+        nn::fs::CloseFile(handle);
+
+        if (result.isFailure()) {
+            Logger::logDeferred("Failed to Read File.\n");
+        }
+
+        return result;
+    }
+
     // make sure to free buffer after usage is done
     void loadFileFromPath(LoadData &loadData) {
 
@@ -133,7 +152,8 @@ namespace FsHelper {
         nn::init::GetAllocator()->Free(entries);
     }
 
-    DirFileEntry* loadFilesFromDirectory(const char* dir, s64 *outFileCount, const char *ext) {
+    // walks dir (and one level of sub directories) for files matching ext, optionally reading each file into memory
+    static DirFileEntry* collectFilesFromDirectory(const char* dir, s64 *outFileCount, const char *ext, bool isLoadFiles) {
         nn::fs::DirectoryEntryType type;
         nn::Result result = nn::fs::GetEntryType(&type, dir);
         *outFileCount = 0;
@@ -145,14 +165,14 @@ namespace FsHelper {
         nn::fs::DirectoryHandle handle{};
         result = nn::fs::OpenDirectory(&handle, dir, nn::fs::OpenDirectoryMode_All);
         if(result.isFailure()) {
-            Logger::log("Failed to open directory!\n");
+            Logger::logDeferred("Failed to open directory!\n");
             return nullptr;
         }
 
         s64 fileCount = 0;
         result = nn::fs::GetDirectoryEntryCount(&fileCount, handle);
         if(result.isFailure()) {
-            Logger::log("Failed to get entry count!\n");
+            Logger::logDeferred("Failed to get entry count!\n");
             return nullptr;
         }
 
@@ -162,7 +182,7 @@ namespace FsHelper {
         s64 entryCount = 0;
         result = nn::fs::ReadDirectory(&entryCount, entries, handle, fileCount);
         if(result.isFailure()) {
-            Logger::log("Failed to Read Directories!\n");
+            Logger::logDeferred("Failed to Read Directories!\n");
             return nullptr;
         }
 
@@ -172,7 +192,7 @@ namespace FsHelper {
             nn::fs::DirectoryEntry& entry = entries[i];
             DirFileEntry& fileEntry = fileEntries[loadedFileCount];
 
-            Logger::log("File Name: %s Size: %d Type: %x\n", entry.m_Name, entry.m_FileSize, entry.m_Type);
+            Logger::logDeferred("File Name: %s Size: %ld Type: %x\n", entry.m_Name, entry.m_FileSize, entry.m_Type);
 
             size_t pathBufSize = strlen(dir)+strlen(entry.m_Name)+2;
             char dirPathBuffer[pathBufSize];
@@ -182,7 +202,7 @@ namespace FsHelper {
             result = nn::fs::GetEntryType(&entryType, dirPathBuffer);
 
             if(result.isFailure()) {
-                Logger::log("Failed to get Entry Type.\n");
+                Logger::logDeferred("Failed to get Entry Type.\n");
                 continue;
             }
 
@@ -193,14 +213,14 @@ namespace FsHelper {
                 nn::fs::DirectoryHandle subdirHandle{};
                 subResult = nn::fs::OpenDirectory(&subdirHandle, dirPathBuffer, nn::fs::OpenDirectoryMode_File);
                 if(subResult.isFailure()) {
-                    Logger::log("Failed to open directory!\n");
+                    Logger::logDeferred("Failed to open directory!\n");
                     continue;
                 }
 
                 s64 subdirFileCount = 0;
                 subResult = nn::fs::GetDirectoryEntryCount(&subdirFileCount, subdirHandle);
                 if(subResult.isFailure()) {
-                    Logger::log("Failed to get entry count!\n");
+                    Logger::logDeferred("Failed to get entry count!\n");
                     continue;
                 }
 
@@ -209,25 +229,27 @@ namespace FsHelper {
                 s64 subdirEntryCount = 0;
                 subResult = nn::fs::ReadDirectory(&subdirEntryCount, subdirEntries, subdirHandle, subdirFileCount);
                 if(subResult.isFailure()) {
-                    Logger::log("Failed to Read Directories!\n");
+                    Logger::logDeferred("Failed to Read Directories!\n");
                     continue;
                 }
 
                 for (int j = 0; j < subdirFileCount; ++j) {
                     nn::fs::DirectoryEntry& subDirEntry = subdirEntries[j];
-                    Logger::log("Sub Directory File Name: %s Size: %d Type: %x\n", subDirEntry.m_Name, subDirEntry.m_FileSize, subDirEntry.m_Type);
+                    Logger::logDeferred("Sub Directory File Name: %s Size: %ld Type: %x\n", subDirEntry.m_Name, subDirEntry.m_FileSize, subDirEntry.m_Type);
 
                     if(ext && !StringHelper::isEndWithString(subDirEntry.m_Name, ext)) {
-                        Logger::log("File extension does not match! Ext: %s\n", ext);
+                        Logger::logDeferred("File extension does not match! Ext: %s\n", ext);
                         continue;
                     }
 
                     sprintf(fileEntry.fullPath, "%s/%s", dirPathBuffer, subDirEntry.m_Name);
                     fileEntry.bufSize = subDirEntry.m_FileSize;
 
-                    Logger::log("Full Path: %s\n", fileEntry.fullPath);
+                    Logger::logDeferred("Full Path: %s\n", fileEntry.fullPath);
 
-                    loadFileFromPath(fileEntry);
+                    fileEntry.fileBuffer = nullptr;
+                    if(isLoadFiles)
+                        loadFileFromPath(fileEntry);
                     loadedFileCount++;
                 }
 
@@ -236,19 +258,21 @@ namespace FsHelper {
             case nn::fs::DirectoryEntryType_File: {
 
                 if(ext && !StringHelper::isEndWithString(entry.m_Name, ext)) {
-                    Logger::log("File extension does not match! Ext: %s\n", ext);
+                    Logger::logDeferred("File extension does not match! Ext: %s\n", ext);
                     continue;
                 }
 
                 strncpy(fileEntry.fullPath, dirPathBuffer, sizeof(fileEntry.fullPath));
                 fileEntry.bufSize = entry.m_FileSize;
 
-                loadFileFromPath(fileEntry);
+                fileEntry.fileBuffer = nullptr;
+                if(isLoadFiles)
+                    loadFileFromPath(fileEntry);
                 loadedFileCount++;
                 break;
             }
             default:
-                Logger::log("Unknown Open Directory Mode!\n");
+                Logger::logDeferred("Unknown Open Directory Mode!\n");
                 break;
             }
 
@@ -261,4 +285,12 @@ namespace FsHelper {
         *outFileCount = loadedFileCount;
         return loadedEntries;
     }
+
+    DirFileEntry* loadFilesFromDirectory(const char* dir, s64 *outFileCount, const char *ext) {
+        return collectFilesFromDirectory(dir, outFileCount, ext, true);
+    }
+
+    DirFileEntry* getFilesFromDirectory(const char* dir, s64 *outFileCount, const char *ext) {
+        return collectFilesFromDirectory(dir, outFileCount, ext, false);
+    }
 }
\ No newline at end of file
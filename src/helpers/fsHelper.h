@@ -19,10 +19,16 @@ namespace FsHelper {
 
     nn::Result writeFileToPath(void *buf, size_t size, const char *path);
 
+    // reads size bytes of the file at path into a caller owned buffer
+    nn::Result readFileToBuffer(void *buf, size_t size, const char *path);
+
     void loadFileFromPath(LoadData &loadData);
 
     DirFileEntry* loadFilesFromDirectory(const char* dir, s64 *outFileCount, const char *ext = nullptr);
 
+    // same as loadFilesFromDirectory, but only gathers paths and sizes (fileBuffer is left null)
+    DirFileEntry* getFilesFromDirectory(const char* dir, s64 *outFileCount, const char *ext = nullptr);
+
     void freeFile(LoadData &data);
 
     void freeFile(DirFileEntry &entry);
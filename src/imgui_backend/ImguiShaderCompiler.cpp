@@ -6,9 +6,16 @@
 #include "logger/Logger.hpp"
 #include "glslc/glslc.h"
 #include "result.hpp"
+#include "os/os_tick.hpp"
 #include <cstring>
 #include <cstdio>
 
+// compiled binaries are cached here, named after a hash of their sources and the compiler version
+#define SHADER_CACHE_DIR "sd:/smo/shaders/cache"
+
+// bump whenever CreateShaderBinary changes its layout, so older cache entries stop matching
+constexpr u32 cShaderCacheVersion = 1;
+
 // list of every shader type nvn supports/glslc can compile (in the order of NVNshaderStage)
 
 const char *shaderNames[] = {
@@ -122,6 +129,70 @@ CompiledData NOINLINE CreateShaderBinary(GLSLCoutput *compileData, const char *s
 
 }
 
+u64 HashBytes(u64 hash, const void *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= ((const u8 *) data)[i];
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+u64 GetCacheKey(nn::gfx::detail::GlslcDll *glslcDll, const char **sources, int count) {
+    u64 hash = 0xCBF29CE484222325;
+
+    for (int i = 0; i < count; ++i) {
+        // includes the terminator, so moving text from one stage to the next changes the key
+        hash = HashBytes(hash, sources[i], strlen(sources[i]) + 1);
+    }
+
+    // a different compiler can produce different code for the same source
+    GLSLCversion versionInfo = glslcDll->GlslcGetVersion();
+    u32 versions[] = {versionInfo.apiMajor, versionInfo.apiMinor, versionInfo.gpuCodeVersionMajor,
+                      versionInfo.gpuCodeVersionMinor, versionInfo.package, cShaderCacheVersion};
+
+    return HashBytes(hash, versions, sizeof(versions));
+}
+
+CompiledData LoadCachedBinary(const char *path) {
+
+    long size = FsHelper::getFileSize(path);
+
+    // binaries are always padded to whole pages
+    if (size < 0x1000 || size % 0x1000 != 0)
+        return {};
+
+    u8 *binary = (u8 *) glslcAlloc(size, 0x1000);
+
+    if (FsHelper::readFileToBuffer(binary, size, path).isFailure()) {
+        glslcFree(binary);
+        return {};
+    }
+
+    // a write that got cut off leaves zeroes behind, which fails this too
+    BinaryHeader header = BinaryHeader((u32 *) binary);
+    u32 offsets[] = {header.mVertexControlOffset, header.mVertexDataOffset, header.mFragmentControlOffset,
+                     header.mFragmentDataOffset};
+
+    for (u32 offset : offsets) {
+        if (offset < 0x10 || offset >= size) {
+            Logger::log("Cached Shader is invalid! Recompiling.\n");
+            glslcFree(binary);
+            return {};
+        }
+    }
+
+    return {binary, (ulong) size};
+}
+
+void SaveCachedBinary(const CompiledData &binary, const char *path) {
+    // fails if they already exist, which is fine
+    nn::fs::CreateDirectory("sd:/smo/shaders");
+    nn::fs::CreateDirectory(SHADER_CACHE_DIR);
+
+    if (FsHelper::writeFileToPath(binary.ptr, binary.size, path).isFailure())
+        Logger::log("Failed to write Shader to cache.\n");
+}
+
 const char *GetShaderSource(const char *path) {
     nn::fs::FileHandle handle;
 
@@ -190,6 +261,11 @@ bool ImguiShaderCompiler::CheckIsValidVersion(nvn::Device *device) {
 
 void ImguiShaderCompiler::InitializeCompiler() {
 
+    static bool isInitialized = false;
+    if (isInitialized)
+        return;
+    isInitialized = true;
+
     nn::gfx::detail::GlslcDll *glslcDll = nn::gfx::detail::GlslcDll::GetInstance();
 
     Logger::log("Setting Glslc Alloc funcs.\n");
@@ -205,13 +281,7 @@ CompiledData ImguiShaderCompiler::CompileShader(const char *shaderName) {
 
     Logger::log("Running compiler for File(s): %s\n", shaderName);
 
-    GLSLCcompileObject initInfo{};
-    initInfo.options = glslcDll->GlslcGetDefaultOptions();
-
-    if (!glslcDll->GlslcInitialize(&initInfo)) {
-        Logger::log("Unable to Init with info.\n");
-        return {};
-    }
+    nn::os::Tick startTick = nn::os::GetSystemTick();
 
     const char *shaders[6];
     NVNshaderStage stages[6];
@@ -227,6 +297,32 @@ CompiledData ImguiShaderCompiler::CompileShader(const char *shaderName) {
     shaders[1] = GetShaderSource(fshPath);
     stages[1] = NVNshaderStage::NVN_SHADER_STAGE_FRAGMENT;
 
+    // if these exact sources were already compiled by this compiler, glslc doesn't need to be touched at all
+    char cachePath[0x60] = {};
+    sprintf(cachePath, "%s/%s_%016lx.bin", SHADER_CACHE_DIR, shaderName, GetCacheKey(glslcDll, shaders, 2));
+
+    CompiledData cachedBinary = LoadCachedBinary(cachePath);
+
+    if (cachedBinary.ptr) {
+        glslcFree((void*)shaders[0]);
+        glslcFree((void*)shaders[1]);
+
+        Logger::log("Loaded cached Shader in %ld us.\n", (nn::os::GetSystemTick() - startTick).ToTimeSpan().GetMicroSeconds());
+        return cachedBinary;
+    }
+
+    InitializeCompiler();
+
+    GLSLCcompileObject initInfo{};
+    initInfo.options = glslcDll->GlslcGetDefaultOptions();
+
+    if (!glslcDll->GlslcInitialize(&initInfo)) {
+        Logger::log("Unable to Init with info.\n");
+        glslcFree((void*)shaders[0]);
+        glslcFree((void*)shaders[1]);
+        return {};
+    }
+
     initInfo.input.sources = shaders;
     initInfo.input.stages = stages;
     initInfo.input.count = 2;
@@ -248,6 +344,12 @@ CompiledData ImguiShaderCompiler::CompileShader(const char *shaderName) {
     glslcFree((void*)shaders[0]);
     glslcFree((void*)shaders[1]);
 
-    return CreateShaderBinary(initInfo.lastCompiledResults->glslcOutput, shaderName, false);
+    CompiledData binary = CreateShaderBinary(initInfo.lastCompiledResults->glslcOutput, shaderName, false);
+
+    Logger::log("Compiled Shader in %ld us.\n", (nn::os::GetSystemTick() - startTick).ToTimeSpan().GetMicroSeconds());
+
+    SaveCachedBinary(binary, cachePath);
+
+    return binary;
 
 }
\ No newline at end of file
@@ -17,6 +17,9 @@
 
 #define UBOSIZE 0x1000
 
+// ns, only hit if the gpu hangs
+static constexpr u64 FrameSyncTimeout = 1000000000;
+
 namespace ImguiNvnBackend {
 
     void make_identity(Matrix44f &mtx) {
@@ -223,7 +226,7 @@ namespace ImguiNvnBackend {
 
         bd->cmdBuf->BindVertexBuffer(0, (*bd->vtxBuffer), bd->vtxBuffer->GetPoolSize());
 
-        setRenderStates();
+        setRenderStates(bd->cmdBuf);
 
 //        bd->cmdBuf->BindTexture(nvn::ShaderStage::FRAGMENT, 0, bd->fontTexHandle);
 
@@ -249,8 +252,7 @@ namespace ImguiNvnBackend {
         if (ImguiShaderCompiler::CheckIsValidVersion(bd->device)) {
             Logger::log("GLSLC compiler can be used!\n");
 
-            ImguiShaderCompiler::InitializeCompiler();
-
+            // only initializes the compiler if there's no cached binary for the current sources
             bd->imguiShaderBinary = ImguiShaderCompiler::CompileShader("imgui");
 
         } else {
@@ -468,6 +470,78 @@ namespace ImguiNvnBackend {
         return true;
     }
 
+    bool setupFrameBuffers() {
+
+        auto bd = getBackendData();
+
+        // buffers themselves are allocated on first use, once we know how much a frame needs
+        for (auto &frame: bd->frameBuffers) {
+            frame.buffer = nullptr;
+            frame.isSyncPending = false;
+
+            if (!frame.sync.Initialize(bd->device)) {
+                Logger::log("Failed to Initialize Frame Sync!\n");
+                return false;
+            }
+        }
+
+        bd->frameIndex = 0;
+        bd->renderStats = {};
+        bd->renderStats.minuteStart = nn::os::GetSystemTick().ToTimeSpan();
+
+        return true;
+    }
+
+    bool setupRenderStates() {
+
+        auto bd = getBackendData();
+
+        bd->polyState.SetDefaults();
+        bd->polyState.SetPolygonMode(nvn::PolygonMode::FILL);
+        bd->polyState.SetCullFace(nvn::Face::NONE);
+        bd->polyState.SetFrontFace(nvn::FrontFace::CCW);
+
+        bd->colorState.SetDefaults();
+        bd->colorState.SetLogicOp(nvn::LogicOp::COPY);
+        bd->colorState.SetAlphaTest(nvn::AlphaFunc::ALWAYS);
+        for (int i = 0; i < 8; ++i) {
+            bd->colorState.SetBlendEnable(i, true);
+        }
+
+        bd->blendState.SetDefaults();
+        bd->blendState.SetBlendFunc(nvn::BlendFunc::SRC_ALPHA, nvn::BlendFunc::ONE_MINUS_SRC_ALPHA, nvn::BlendFunc::ONE,
+                                    nvn::BlendFunc::ZERO);
+        bd->blendState.SetBlendEquation(nvn::BlendEquation::ADD, nvn::BlendEquation::ADD);
+
+        // record everything a frame binds before drawing into its own command buffer, each frame then only calls it
+        if (!bd->prologueCmdBuf.Initialize(bd->device)) {
+            Logger::log("Failed to Initialize Prologue Command Buffer!\n");
+            return false;
+        }
+
+        if (!MemoryPoolMaker::createPool(&bd->prologueMemPool, PrologueCommandSize)) {
+            Logger::log("Failed to Create Prologue Memory Pool!\n");
+            return false;
+        }
+
+        bd->prologueControlMemory = IM_ALLOC(PrologueControlSize);
+
+        bd->prologueCmdBuf.AddCommandMemory(&bd->prologueMemPool, 0, PrologueCommandSize);
+        bd->prologueCmdBuf.AddControlMemory(bd->prologueControlMemory, PrologueControlSize);
+
+        bd->prologueCmdBuf.BeginRecording();
+
+        bd->prologueCmdBuf.BindProgram(&bd->shaderProgram, nvn::ShaderStageBits::VERTEX |
+                                                           nvn::ShaderStageBits::FRAGMENT); // bind main imgui shader
+        bd->prologueCmdBuf.BindUniformBuffer(nvn::ShaderStage::VERTEX, 0, *bd->uniformMemory,
+                                             UBOSIZE); // bind uniform block ptr
+        setRenderStates(&bd->prologueCmdBuf);
+
+        bd->prologueHandle = bd->prologueCmdBuf.EndRecording();
+
+        return true;
+    }
+
     void InitBackend(const NvnBackendInitInfo &initInfo) {
         ImGuiIO &io = ImGui::GetIO();
         EXL_ASSERT(!io.BackendRendererUserData, "Already Initialized Imgui Backend!");
@@ -496,7 +570,8 @@ namespace ImguiNvnBackend {
             if (bd->isUseTestShader)
                 initTestShader();
 
-            if (setupShaders(bd->imguiShaderBinary.ptr, bd->imguiShaderBinary.size) && setupFont()) {
+            if (setupShaders(bd->imguiShaderBinary.ptr, bd->imguiShaderBinary.size) && setupFont() &&
+                setupFrameBuffers() && setupRenderStates()) {
                 Logger::log("Rendering Setup!\n");
 
                 bd->isInitialized = true;
@@ -601,7 +676,9 @@ namespace ImguiNvnBackend {
     }
 
     void updateProjection(ImVec2 dispSize) {
-        orthoRH_ZO(getBackendData()->mProjMatrix, 0.0f, dispSize.x, dispSize.y, 0.0f, -1.0f, 1.0f);
+        auto bd = getBackendData();
+        orthoRH_ZO(bd->mProjMatrix, 0.0f, dispSize.x, dispSize.y, 0.0f, -1.0f, 1.0f);
+        bd->isProjDirty = true;
     }
 
     void updateScale(bool isDocked) {
@@ -649,38 +726,68 @@ namespace ImguiNvnBackend {
         updateInput(); // update backend inputs
     }
 
-    void setRenderStates() {
+    void setRenderStates(nvn::CommandBuffer *cmdBuf) {
 
         auto bd = getBackendData();
 
-        nvn::PolygonState polyState;
-        polyState.SetDefaults();
-        polyState.SetPolygonMode(nvn::PolygonMode::FILL);
-        polyState.SetCullFace(nvn::Face::NONE);
-        polyState.SetFrontFace(nvn::FrontFace::CCW);
-        bd->cmdBuf->BindPolygonState(&polyState);
-
-        nvn::ColorState colorState;
-        colorState.SetDefaults();
-        colorState.SetLogicOp(nvn::LogicOp::COPY);
-        colorState.SetAlphaTest(nvn::AlphaFunc::ALWAYS);
-        for (int i = 0; i < 8; ++i) {
-            colorState.SetBlendEnable(i, true);
+        cmdBuf->BindPolygonState(&bd->polyState);
+        cmdBuf->BindColorState(&bd->colorState);
+        cmdBuf->BindBlendState(&bd->blendState);
+
+        cmdBuf->BindVertexAttribState(3, bd->attribStates);
+        cmdBuf->BindVertexStreamState(1, &bd->streamState);
+
+        cmdBuf->SetTexturePool(&bd->texPool);
+        cmdBuf->SetSamplerPool(&bd->samplerPool);
+    }
+
+    // grows the buffer geometrically, so a growing UI doesn't recreate it every few frames
+    bool reserveFrameBuffer(FrameBuffer &frame, size_t size) {
+
+        auto bd = getBackendData();
+
+        if (frame.buffer && frame.buffer->GetPoolSize() >= size)
+            return frame.buffer->IsBufferReady();
+
+        size_t newSize = MinFrameBufferSize;
+        if (frame.buffer) {
+            newSize = frame.buffer->GetPoolSize() * 2;
+            bd->renderStats.bufferBytes -= frame.buffer->GetPoolSize();
+
+            frame.buffer->Finalize();
+            IM_FREE(frame.buffer);
         }
-        bd->cmdBuf->BindColorState(&colorState);
 
-        nvn::BlendState blendState;
-        blendState.SetDefaults();
-        blendState.SetBlendFunc(nvn::BlendFunc::SRC_ALPHA, nvn::BlendFunc::ONE_MINUS_SRC_ALPHA, nvn::BlendFunc::ONE,
-                                nvn::BlendFunc::ZERO);
-        blendState.SetBlendEquation(nvn::BlendEquation::ADD, nvn::BlendEquation::ADD);
-        bd->cmdBuf->BindBlendState(&blendState);
+        while (newSize < size)
+            newSize *= 2;
+
+        Logger::log("Resizing Frame Buffer %d to Size: %zu\n", bd->frameIndex, newSize);
+
+        frame.buffer = IM_NEW(MemoryBuffer)(newSize);
+
+        bd->renderStats.bufferBytes += frame.buffer->GetPoolSize();
+        bd->renderStats.reallocCount++;
+        bd->renderStats.reallocsThisMinute++;
+
+        return frame.buffer->IsBufferReady();
+    }
+
+    void updateRenderStats(size_t uploadBytes) {
+
+        RenderStats &stats = getBackendData()->renderStats;
+
+        stats.uploadBytes = uploadBytes;
 
-        bd->cmdBuf->BindVertexAttribState(3, bd->attribStates);
-        bd->cmdBuf->BindVertexStreamState(1, &bd->streamState);
+        nn::TimeSpan curTick = nn::os::GetSystemTick().ToTimeSpan();
+        if ((curTick - nn::TimeSpan(stats.minuteStart)).GetSeconds() >= 60) {
+            stats.reallocsLastMinute = stats.reallocsThisMinute;
+            stats.reallocsThisMinute = 0;
+            stats.minuteStart = curTick;
+        }
+    }
 
-        bd->cmdBuf->SetTexturePool(&bd->texPool);
-        bd->cmdBuf->SetSamplerPool(&bd->samplerPool);
+    const RenderStats &getRenderStats() {
+        return getBackendData()->renderStats;
     }
 
     void renderDrawData(ImDrawData *drawData) {
@@ -712,57 +819,50 @@ namespace ImguiNvnBackend {
             return;
         }
 
-        // initializes/resizes buffer used for all vertex data created by ImGui
-        size_t totalVtxSize = drawData->TotalVtxCount * sizeof(ImDrawVert);
-        if (!bd->vtxBuffer || bd->vtxBuffer->GetPoolSize() < totalVtxSize) {
-            if (bd->vtxBuffer) {
-                bd->vtxBuffer->Finalize();
-                IM_FREE(bd->vtxBuffer);
-                Logger::log("Resizing Vertex Buffer to Size: %d\n", totalVtxSize);
-            } else {
-                Logger::log("Initializing Vertex Buffer to Size: %d\n", totalVtxSize);
-            }
+        nn::os::Tick startTick = nn::os::GetSystemTick();
 
-            bd->vtxBuffer = IM_NEW(MemoryBuffer)(totalVtxSize);
+        // the gpu may still be drawing from this buffer, it was last used FrameBufferCount frames ago
+        FrameBuffer &frame = bd->frameBuffers[bd->frameIndex];
+        if (frame.isSyncPending) {
+            if (frame.sync.Wait(FrameSyncTimeout) == nvn::SyncWaitResult::TIMEOUT_EXPIRED)
+                Logger::log("Timed out waiting for ImGui frame %d to finish drawing.\n", bd->frameIndex);
+            frame.isSyncPending = false;
         }
 
-        // initializes/resizes buffer used for all index data created by ImGui
+        // indices go right after the vertices, in the same buffer
+        size_t totalVtxSize = drawData->TotalVtxCount * sizeof(ImDrawVert);
         size_t totalIdxSize = drawData->TotalIdxCount * sizeof(ImDrawIdx);
-        if (!bd->idxBuffer || bd->idxBuffer->GetPoolSize() < totalIdxSize) {
-            if (bd->idxBuffer) {
-
-                bd->idxBuffer->Finalize();
-                IM_FREE(bd->idxBuffer);
-
-                Logger::log("Resizing Index Buffer to Size: %d\n", totalIdxSize);
-            } else {
-                Logger::log("Initializing Index Buffer to Size: %d\n", totalIdxSize);
-            }
-
-            bd->idxBuffer = IM_NEW(MemoryBuffer)(totalIdxSize);
+        size_t idxStart = ALIGN_UP(totalVtxSize, 0x10);
 
-        }
-
-        // if we fail to resize/init either buffers, end execution before we try to use said invalid buffer(s)
-        if (!(bd->vtxBuffer->IsBufferReady() && bd->idxBuffer->IsBufferReady())) {
+        if (!reserveFrameBuffer(frame, idxStart + totalIdxSize)) {
             Logger::log("Cannot Draw Data! Buffers are not Ready.\n");
             return;
         }
 
+        updateRenderStats(totalVtxSize + totalIdxSize);
+
+        u8 *memPtr = frame.buffer->GetMemPtr();
+        nvn::BufferAddress vtxAddress = *frame.buffer;
+        nvn::BufferAddress idxAddress = vtxAddress + idxStart;
+
         bd->cmdBuf->BeginRecording(); // start recording our commands to the cmd buffer
 
-        bd->cmdBuf->BindProgram(&bd->shaderProgram, nvn::ShaderStageBits::VERTEX |
-                                                    nvn::ShaderStageBits::FRAGMENT); // bind main imgui shader
+        // binds the shader, uniform block and the rest of the render state, required so that our shader properly gets drawn to the screen
+        bd->cmdBuf->CallCommands(1, &bd->prologueHandle);
 
-        bd->cmdBuf->BindUniformBuffer(nvn::ShaderStage::VERTEX, 0, *bd->uniformMemory,
-                                      UBOSIZE); // bind uniform block ptr
-        bd->cmdBuf->UpdateUniformBuffer(*bd->uniformMemory, UBOSIZE, 0, sizeof(bd->mProjMatrix),
-                                        &bd->mProjMatrix); // add projection matrix data to uniform data
+        // the uniform buffer keeps its contents across frames, so the matrix only needs uploading when it changes
+        if (bd->isProjDirty) {
+            bd->cmdBuf->UpdateUniformBuffer(*bd->uniformMemory, UBOSIZE, 0, sizeof(bd->mProjMatrix),
+                                            &bd->mProjMatrix); // add projection matrix data to uniform data
+            bd->isProjDirty = false;
+        }
 
-        setRenderStates(); // sets up the rest of the render state, required so that our shader properly gets drawn to the screen
+        // every command list draws from the same vertex buffer, offset by its base vertex
+        bd->cmdBuf->BindVertexBuffer(0, vtxAddress, totalVtxSize);
 
-        size_t vtxOffset = 0, idxOffset = 0;
+        size_t vtxCount = 0, idxOffset = 0;
         nvn::TextureHandle boundTextureHandle = 0;
+        int boundScissor[4] = {-1, -1, -1, -1};
 
         // load data into buffers, and process draw commands
         for (size_t i = 0; i < drawData->CmdListsCount; i++) {
@@ -773,12 +873,9 @@ namespace ImguiNvnBackend {
             size_t vtxSize = cmdList->VtxBuffer.Size * sizeof(ImDrawVert);
             size_t idxSize = cmdList->IdxBuffer.Size * sizeof(ImDrawIdx);
 
-            // bind vtx buffer at the current offset
-            bd->cmdBuf->BindVertexBuffer(0, (*bd->vtxBuffer) + vtxOffset, vtxSize);
-
-            // copy data from imgui command list into our gpu dedicated memory
-            memcpy(bd->vtxBuffer->GetMemPtr() + vtxOffset, cmdList->VtxBuffer.Data, vtxSize);
-            memcpy(bd->idxBuffer->GetMemPtr() + idxOffset, cmdList->IdxBuffer.Data, idxSize);
+            // copy data from imgui command list straight into the frame's gpu memory
+            memcpy(memPtr + vtxCount * sizeof(ImDrawVert), cmdList->VtxBuffer.Data, vtxSize);
+            memcpy(memPtr + idxStart + idxOffset, cmdList->IdxBuffer.Data, idxSize);
 
             for (auto cmd: cmdList->CmdBuffer) {
 
@@ -791,8 +888,12 @@ namespace ImguiNvnBackend {
                 if (clip_max.x <= clip_min.x || clip_max.y <= clip_min.y)
                     continue;
 
-                bd->cmdBuf->SetScissor((int) clip_min.x, (int) clip_min.y,
-                                       (int) clip_size.x, (int) clip_size.y);
+                // consecutive commands mostly share a clip rect, only set it when it changes
+                int scissor[4] = {(int) clip_min.x, (int) clip_min.y, (int) clip_size.x, (int) clip_size.y};
+                if (memcmp(scissor, boundScissor, sizeof(scissor)) != 0) {
+                    memcpy(boundScissor, scissor, sizeof(scissor));
+                    bd->cmdBuf->SetScissor(scissor[0], scissor[1], scissor[2], scissor[3]);
+                }
 
                 // get texture ID from the command
                 nvn::TextureHandle TexID = *(nvn::TextureHandle *) cmd.GetTexID();
@@ -805,17 +906,25 @@ namespace ImguiNvnBackend {
                 // as well as the current offset into our buffer.
                 bd->cmdBuf->DrawElementsBaseVertex(nvn::DrawPrimitive::TRIANGLES,
                                                    nvn::IndexType::UNSIGNED_SHORT, cmd.ElemCount,
-                                                   (*bd->idxBuffer) + (cmd.IdxOffset * sizeof(ImDrawIdx)) + idxOffset,
-                                                   cmd.VtxOffset);
+                                                   idxAddress + (cmd.IdxOffset * sizeof(ImDrawIdx)) + idxOffset,
+                                                   vtxCount + cmd.VtxOffset);
             }
 
-            vtxOffset += vtxSize;
+            vtxCount += cmdList->VtxBuffer.Size;
             idxOffset += idxSize;
         }
 
         // end the command recording and submit to queue.
         auto handle = bd->cmdBuf->EndRecording();
         bd->queue->SubmitCommands(1, &handle);
+
+        // lets the next use of this buffer know when it's safe to write to it again
+        bd->queue->FenceSync(&frame.sync, nvn::SyncCondition::ALL_GPU_COMMANDS_COMPLETE, nvn::SyncFlagBits(0));
+        frame.isSyncPending = true;
+
+        bd->frameIndex = (bd->frameIndex + 1) % FrameBufferCount;
+
+        bd->renderStats.recordTime = (nn::os::GetSystemTick() - startTick).ToTimeSpan().GetMicroSeconds();
     }
 
 }
\ No newline at end of file
@@ -20,12 +20,36 @@ namespace ImguiNvnBackend {
     static constexpr int MaxTexDescriptors = 256 + 100;
     static constexpr int MaxSampDescriptors = 256 + 100;
 
+    // frames the gpu can still be reading from while the next one is written
+    static constexpr int FrameBufferCount = 3;
+    static constexpr size_t MinFrameBufferSize = 0x10000;
+
+    static constexpr size_t PrologueCommandSize = 0x1000;
+    static constexpr size_t PrologueControlSize = 0x400;
+
     struct NvnBackendInitInfo {
         nvn::Device *device;
         nvn::Queue *queue;
         nvn::CommandBuffer *cmdBuf;
     };
 
+    // holds all the vertex data of a frame, followed by all of its indices
+    struct FrameBuffer {
+        MemoryBuffer *buffer;
+        nvn::Sync sync; // signaled once the gpu is done with the frame's draws
+        bool isSyncPending;
+    };
+
+    struct RenderStats {
+        size_t uploadBytes; // copied into the frame buffer last frame
+        size_t bufferBytes; // held by every frame buffer
+        u32 reallocCount;
+        u32 reallocsLastMinute;
+        u32 reallocsThisMinute;
+        nn::TimeSpanType minuteStart;
+        s64 recordTime; // us spent in renderDrawData last frame
+    };
+
     struct NvnBackendData {
 
         // general data
@@ -53,6 +77,19 @@ namespace ImguiNvnBackend {
         nvn::VertexStreamState streamState;
         nvn::VertexAttribState attribStates[3];
 
+        // render states never change, so they're built once
+
+        nvn::PolygonState polyState;
+        nvn::ColorState colorState;
+        nvn::BlendState blendState;
+
+        // binds everything above once per frame, recorded at init
+
+        nvn::CommandBuffer prologueCmdBuf;
+        nvn::MemoryPool prologueMemPool;
+        void *prologueControlMemory;
+        nvn::CommandHandle prologueHandle;
+
         // font data
 
         nvn::TexturePool texPool;
@@ -71,8 +108,12 @@ namespace ImguiNvnBackend {
 
         // render data
 
-        MemoryBuffer *vtxBuffer;
-        MemoryBuffer *idxBuffer;
+        FrameBuffer frameBuffers[FrameBufferCount];
+        int frameIndex;
+
+        RenderStats renderStats;
+
+        MemoryBuffer *vtxBuffer; // only used by the test shader
 
         // misc data
 
@@ -80,6 +121,7 @@ namespace ImguiNvnBackend {
         bool isInitialized;
 
         Matrix44f mProjMatrix = {};
+        bool isProjDirty = true; // the uniform buffer holds an outdated matrix
 
         CompiledData imguiShaderBinary;
 
@@ -98,6 +140,10 @@ namespace ImguiNvnBackend {
 
     bool setupFont();
 
+    bool setupFrameBuffers();
+
+    bool setupRenderStates();
+
     void InitBackend(const NvnBackendInitInfo &initInfo);
 
     void ShutdownBackend();
@@ -110,11 +156,13 @@ namespace ImguiNvnBackend {
 
     void newFrame();
 
-    void setRenderStates();
+    void setRenderStates(nvn::CommandBuffer *cmdBuf);
 
     void renderDrawData(ImDrawData *drawData);
 
     NvnBackendData *getBackendData();
+
+    const RenderStats &getRenderStats();
 }; // namespace ImguiNvnBackend
 
 #endif
@@ -22,6 +22,7 @@
 #include "lib/util/sys/soc.hpp"
 #include "lib/util/modules.hpp"
 #include "lib/util/ptr_path.hpp"
+#include "lib/util/symbols.hpp"
 #include "lib/util/typed_storage.hpp"
 
 #include "lib/hook/base.hpp"
@@ -44,6 +44,7 @@ namespace exl::diag {
             Logger::log("\n");
         }
         Logger::log("\x1b[0m");
+        Logger::flush();
 
         svcBreak(0x6942021, ctx.value, 0);
         UNREACHABLE;
@@ -50,6 +50,55 @@ namespace exl::hook {
         return ret;
     }
 
+    template<typename Trampoline>
+    bool Retarget(Trampoline trampoline, uintptr_t target) {
+        uintptr_t trampolinep;
+        std::memcpy(&trampolinep, &trampoline, sizeof(trampolinep));
+
+        return arch::Retarget(trampolinep, target);
+    }
+
+    template<typename InFunc>
+    bool Unhook(InFunc hook) {
+        uintptr_t hookp;
+        std::memcpy(&hookp, &hook, sizeof(hookp));
+
+        return arch::Unhook(hookp);
+    }
+
+    inline size_t UnhookInRange(uintptr_t start, uintptr_t end) {
+        return arch::UnhookInRange(start, end);
+    }
+
+    inline void ReclaimRemoved() {
+        arch::ReclaimRemoved();
+    }
+
+    using PoolStats = util::JitPool::Stats;
+
+    inline PoolStats GetTrampolinePoolStats() {
+        return arch::GetTrampolinePoolStats();
+    }
+
+    inline PoolStats GetLinkPoolStats() {
+        return arch::GetLinkPoolStats();
+    }
+
+    inline PoolStats GetInlinePoolStats() {
+        return arch::GetInlinePoolStats();
+    }
+
+    /* Installs every hook made during its lifetime through the main module's existing RW mapping, */
+    /* then flushes only the dirty cache lines once when it goes out of scope. */
+    class HookBatch {
+        NON_COPYABLE(HookBatch);
+        NON_MOVEABLE(HookBatch);
+
+        public:
+        HookBatch() { arch::BeginBatch(); }
+        ~HookBatch() { arch::EndBatch(); }
+    };
+
     using InlineCtx = arch::InlineCtx;
     using InlineCallback = void (*)(InlineCtx*);
 
@@ -31,7 +31,12 @@
 #include <stdlib.h>
 
 #include "util/sys/jit.hpp"
+#include "util/sys/jit_pool.hpp"
+#include "patch/patcher_impl.hpp"
 #include "inline_impl.hpp"
+#include "fix_instructions.hpp"
+#include <algorithm>
+#include <optional>
 
 
 #define __attribute __attribute__
@@ -53,509 +58,259 @@ namespace exl::hook::nx64 {
     namespace {
 
         // Hooking constants
-        constexpr size_t HookPoolSize = setting::JitSize;
-        constexpr s64 MaxInstructions = 5;
         constexpr size_t TrampolineSize = MaxInstructions * 10;
-        constexpr u64 HookMax = HookPoolSize / (TrampolineSize * sizeof(uint32_t));
-        constexpr u64 MaxReferences = MaxInstructions * 2;
-        constexpr u32 Aarch64Nop = 0xd503201f;
-
-        typedef uint32_t HookPool[HookMax][TrampolineSize];
-        static_assert(sizeof(HookPool) <= HookPoolSize, "");
-
-        // Inline hooking constants
-        extern const u64 InlineHandlerStart;
-        extern const u64 InlineHandlerEnd;
-        constexpr size_t InlineHookHandlerSize = 0x9C; // correct if handler size changes
-        struct PACKED InlineHookEntry {
-            char m_Handler[InlineHookHandlerSize];
-            void* m_Callback;
-            void* m_Trampoline;
+
+        constexpr size_t StubSize = 4;
+        constexpr size_t SiteTableSize = 0x100;
+
+        struct HookLink;
+
+        // One per hooked address, no matter how many hooks are chained onto it.
+        // The address is only ever patched and relocated once, to branch to the entry stub.
+        struct HookSite {
+            uint32_t m_Trampoline[TrampolineSize];  // relocated original instructions
+            uint32_t m_Entry[StubSize];             // jumps to the newest hook's callback
+            uintptr_t m_Site;
+            uintptr_t m_Rx;
+            HookSite* m_NextInBucket;
+            HookLink* m_Newest;
+            uint32_t m_Original[MaxInstructions];
+            uint32_t m_OriginalCount;
         };
-        constexpr size_t InlineHookSize = sizeof(InlineHookEntry);
-        constexpr size_t InlineHookMax = 1;
-        constexpr size_t InlineHookPoolSize = InlineHookSize * InlineHookMax;
-
-        typedef uint32_t* __restrict* __restrict instruction;
-        typedef struct {
-            struct fix_info {
-                uint32_t* bprx;
-                uint32_t* bprw;
-                uint32_t ls;  // left-shift counts
-                uint32_t ad;  // & operand
-            };
-            struct insns_info {
-                union {
-                    uint64_t insu;
-                    int64_t ins;
-                    void* insp;
-                };
-                fix_info fmap[MaxReferences];
-            };
-            int64_t basep;
-            int64_t endp;
-            insns_info dat[MaxInstructions];
-
-        public:
-            inline bool is_in_fixing_range(const int64_t absolute_addr) {
-                return absolute_addr >= this->basep && absolute_addr < this->endp;
-            }
-            inline intptr_t get_ref_ins_index(const int64_t absolute_addr) {
-                return static_cast<intptr_t>((absolute_addr - this->basep) / sizeof(uint32_t));
-            }
-            inline intptr_t get_and_set_current_index(uint32_t* __restrict inp, uint32_t* __restrict outp) {
-                intptr_t current_idx = this->get_ref_ins_index(reinterpret_cast<int64_t>(inp));
-                this->dat[current_idx].insp = outp;
-                return current_idx;
-            }
-            inline void reset_current_ins(const intptr_t idx, uint32_t* __restrict outp) { this->dat[idx].insp = outp; }
-            void insert_fix_map(const intptr_t idx, uint32_t* bprw, uint32_t* bprx, uint32_t ls = 0u, uint32_t ad = 0xffffffffu) {
-                for (auto& f : this->dat[idx].fmap) {
-                    if (f.bprw == NULL) {
-                        f.bprw = bprw;
-                        f.bprx = bprx;
-                        f.ls = ls;
-                        f.ad = ad;
-                        return;
-                    }  // if
-                }
-                // What? GGing..
-            }
-            void process_fix_map(const intptr_t idx) {
-                for (auto& f : this->dat[idx].fmap) {
-                    if (f.bprw == NULL) break;
-                    *(f.bprw) =
-                        *(f.bprx) | (((int32_t(this->dat[idx].ins - reinterpret_cast<int64_t>(f.bprx)) >> 2) << f.ls) & f.ad);
-                    f.bprw = NULL;
-                    f.bprx = NULL;
-                }
-            }
-        } context;
-
-        //-------------------------------------------------------------------------
-
-        bool __fix_branch_imm(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
-                                    context* ctxp) {
-            constexpr uint32_t mbits = 6u;
-            constexpr uint32_t mask = 0xfc000000u;   // 0b11111100000000000000000000000000
-            constexpr uint32_t rmask = 0x03ffffffu;  // 0b00000011111111111111111111111111
-            constexpr uint32_t op_b = 0x14000000u;   // "b"  ADDR_PCREL26
-            constexpr uint32_t op_bl = 0x94000000u;  // "bl" ADDR_PCREL26
-
-            const uint32_t ins = *(*inprwp);
-            const uint32_t opc = ins & mask;
-            switch (opc) {
-                case op_b:
-                case op_bl: {
-                    intptr_t current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
-                    int64_t absolute_addr = reinterpret_cast<int64_t>(*inprxp) +
-                                            (static_cast<int32_t>(ins << mbits) >> (mbits - 2u));  // sign-extended
-                    int64_t new_pc_offset =
-                        static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;  // shifted
-                    bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
-                    // whether the branch should be converted to absolute jump
-                    if (!special_fix_type && llabs(new_pc_offset) >= (rmask >> 1)) {
-                        bool b_aligned = (reinterpret_cast<uint64_t>(*outprx + 2) & 7u) == 0u;
-                        if (opc == op_b) {
-                            if (b_aligned != true) {
-                                (*outprw)[0] = Aarch64Nop;
-                                ctxp->reset_current_ins(current_idx, ++(*outprx));
-                                ++(*outprw);
-                            }                            // if
-                            (*outprw)[0] = 0x58000051u;  // LDR X17, #0x8
-                            (*outprw)[1] = 0xd61f0220u;  // BR X17
-                            memcpy(*outprw + 2, &absolute_addr, sizeof(absolute_addr));
-                            *outprx += 4;
-                            *outprw += 4;
-                        } else {
-                            if (b_aligned == true) {
-                                (*outprw)[0] = Aarch64Nop;
-                                ctxp->reset_current_ins(current_idx, ++(*outprx));
-                                (*outprw)++;
-                            }                            // if
-                            (*outprw)[0] = 0x58000071u;  // LDR X17, #12
-                            (*outprw)[1] = 0x1000009eu;  // ADR X30, #16
-                            (*outprw)[2] = 0xd61f0220u;  // BR X17
-                            memcpy(*outprw + 3, &absolute_addr, sizeof(absolute_addr));
-                            *outprw += 5;
-                            *outprx += 5;
-                        }  // if
-                    } else {
-                        if (special_fix_type) {
-                            intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr);
-                            if (ref_idx <= current_idx) {
-                                new_pc_offset =
-                                    static_cast<int64_t>(ctxp->dat[ref_idx].ins - reinterpret_cast<int64_t>(*outprx)) >> 2;
-                            } else {
-                                ctxp->insert_fix_map(ref_idx, *outprw, *outprx, 0u, rmask);
-                                new_pc_offset = 0;
-                            }  // if
-                        }      // if
-
-                        (*outprw)[0] = opc | (new_pc_offset & ~mask);
-                        ++(*outprw);
-                        ++(*outprx);
-                    }  // if
-
-                    ++(*inprxp);
-                    ++(*inprwp);
-                    return ctxp->process_fix_map(current_idx), true;
-                }
-            }
-            return false;
-        }
 
-        //-------------------------------------------------------------------------
-
-        bool __fix_cond_comp_test_branch(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
-                                                context* ctxp) {
-            constexpr uint32_t lsb = 5u;
-            constexpr uint32_t lmask01 = 0xff00001fu;  // 0b11111111000000000000000000011111
-            constexpr uint32_t mask0 = 0xff000010u;    // 0b11111111000000000000000000010000
-            constexpr uint32_t op_bc = 0x54000000u;    // "b.c"  ADDR_PCREL19
-            constexpr uint32_t mask1 = 0x7f000000u;    // 0b01111111000000000000000000000000
-            constexpr uint32_t op_cbz = 0x34000000u;   // "cbz"  Rt, ADDR_PCREL19
-            constexpr uint32_t op_cbnz = 0x35000000u;  // "cbnz" Rt, ADDR_PCREL19
-            constexpr uint32_t lmask2 = 0xfff8001fu;   // 0b11111111111110000000000000011111
-            constexpr uint32_t mask2 = 0x7f000000u;    // 0b01111111000000000000000000000000
-            constexpr uint32_t op_tbz =
-                0x36000000u;  // 0b00110110000000000000000000000000 "tbz"  Rt, BIT_NUM, ADDR_PCREL14
-            constexpr uint32_t op_tbnz =
-                0x37000000u;  // 0b00110111000000000000000000000000 "tbnz" Rt, BIT_NUM, ADDR_PCREL14
-
-            const uint32_t ins = *(*inprwp);
-            uint32_t lmask = lmask01;
-            if ((ins & mask0) != op_bc) {
-                uint32_t opc = ins & mask1;
-                if (opc != op_cbz && opc != op_cbnz) {
-                    opc = ins & mask2;
-                    if (opc != op_tbz && opc != op_tbnz) {
-                        return false;
-                    }  // if
-                    lmask = lmask2;
-                }  // if
-            }      // if
-
-            intptr_t current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
-            int64_t absolute_addr = reinterpret_cast<int64_t>(*inprxp) + ((ins & ~lmask) >> (lsb - 2u));
-            int64_t new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;  // shifted
-            bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
-            if (!special_fix_type && llabs(new_pc_offset) >= (~lmask >> (lsb + 1))) {
-                if ((reinterpret_cast<uint64_t>(*outprx + 4) & 7u) != 0u) {
-                    (*outprw)[0] = Aarch64Nop;
-                    ctxp->reset_current_ins(current_idx, *outprx);
-
-                    (*outprx)++;
-                    (*outprw)++;
-                }                                                               // if
-                (*outprw)[0] = (((8u >> 2u) << lsb) & ~lmask) | (ins & lmask);  // B.C #0x8
-                (*outprw)[1] = 0x14000005u;                                     // B #0x14
-                (*outprw)[2] = 0x58000051u;                                     // LDR X17, #0x8
-                (*outprw)[3] = 0xd61f0220u;                                     // BR X17
-                memcpy(*outprw + 4, &absolute_addr, sizeof(absolute_addr));
-                *outprw += 6;
-                *outprx += 6;
-            } else {
-                if (special_fix_type) {
-                    intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr);
-                    if (ref_idx <= current_idx) {
-                        new_pc_offset = static_cast<int64_t>(ctxp->dat[ref_idx].ins - reinterpret_cast<int64_t>(*outprx)) >> 2;
-                    } else {
-                        ctxp->insert_fix_map(ref_idx, *outprw, *outprx, lsb, ~lmask);
-                        new_pc_offset = 0;
-                    }  // if
-                }      // if
-
-                (*outprw)[0] = (static_cast<uint32_t>(new_pc_offset << lsb) & ~lmask) | (ins & lmask);
-                ++(*outprw);
-                ++(*outprx);
-            }  // if
+        // One per installed hook. Its stub is the trampoline handed out to the hook, which jumps to the next older
+        // hook's callback, or the site's trampoline for the oldest one. Hooks can be removed in any order,
+        // as removing one only has to retarget the single stub that jumps to it.
+        struct HookLink {
+            uint32_t m_Stub[StubSize];
+            uintptr_t m_Callback;
+            uintptr_t m_Owner;          // callback the hook was installed for
+            uintptr_t m_InlineEntry;    // inline pool entry to free alongside the hook, if any
+            uintptr_t m_Rx;
+            HookSite* m_Site;           // null while the slot is free
+            HookLink* m_Older;
+            HookLink* m_Newer;
+        };
 
-            ++(*inprxp);
-            ++(*inprwp);
-            return ctxp->process_fix_map(current_idx), true;
-        }
+        static_assert(offsetof(HookSite, m_Entry) % 8 == 0, "stub literal must be 8-byte aligned");
+
+    }
 
-        //-------------------------------------------------------------------------
+    //-------------------------------------------------------------------------
 
-        bool __fix_loadlit(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
-                                context* ctxp) {
-            const uint32_t ins = *(*inprwp);
+    //static nn::os::MutexType hookMutex;
 
-            // memory prefetch("prfm"), just skip it
-            // http://infocenter.arm.com/help/topic/com.arm.doc.100069_0608_00_en/pge1427897420050.html
-            if ((ins & 0xff000000u) == 0xd8000000u) {
-                ctxp->process_fix_map(ctxp->get_and_set_current_index(*inprxp, *outprx));
-                ++(*inprwp);
-                ++(*inprxp);
-                return true;
-            }  // if
+    //-------------------------------------------------------------------------
 
-            constexpr uint32_t msb = 8u;
-            constexpr uint32_t lsb = 5u;
-            constexpr uint32_t mask_30 = 0x40000000u;   // 0b01000000000000000000000000000000
-            constexpr uint32_t mask_31 = 0x80000000u;   // 0b10000000000000000000000000000000
-            constexpr uint32_t lmask = 0xff00001fu;     // 0b11111111000000000000000000011111
-            constexpr uint32_t mask_ldr = 0xbf000000u;  // 0b10111111000000000000000000000000
-            constexpr uint32_t op_ldr =
-                0x18000000u;  // 0b00011000000000000000000000000000 "LDR Wt/Xt, label" | ADDR_PCREL19
-            constexpr uint32_t mask_ldrv = 0x3f000000u;  // 0b00111111000000000000000000000000
-            constexpr uint32_t op_ldrv =
-                0x1c000000u;  // 0b00011100000000000000000000000000 "LDR St/Dt/Qt, label" | ADDR_PCREL19
-            constexpr uint32_t mask_ldrsw = 0xff000000u;  // 0b11111111000000000000000000000000
-            constexpr uint32_t op_ldrsw = 0x98000000u;  // "LDRSW Xt, label" | ADDR_PCREL19 | load register signed word
-            // LDR S0, #0 | 0b00011100000000000000000000000000 | 32-bit
-            // LDR D0, #0 | 0b01011100000000000000000000000000 | 64-bit
-            // LDR Q0, #0 | 0b10011100000000000000000000000000 | 128-bit
-            // INVALID    | 0b11011100000000000000000000000000 | may be 256-bit
-
-            uint32_t mask = mask_ldr;
-            uintptr_t faligned = (ins & mask_30) ? 7u : 3u;
-            if ((ins & mask_ldr) != op_ldr) {
-                mask = mask_ldrv;
-                if (faligned != 7u) faligned = (ins & mask_31) ? 15u : 3u;
-                if ((ins & mask_ldrv) != op_ldrv) {
-                    if ((ins & mask_ldrsw) != op_ldrsw) {
-                        return false;
-                    }  // if
-                    mask = mask_ldrsw;
-                    faligned = 7u;
-                }  // if
-            }      // if
-
-            intptr_t current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
-            int64_t absolute_addr =
-                reinterpret_cast<int64_t>(*inprxp) + ((static_cast<int32_t>(ins << msb) >> (msb + lsb - 2u)) & ~3u);
-            int64_t new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;  // shifted
-            bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
-            // special_fix_type may encounter issue when there are mixed data and code
-            if (special_fix_type ||
-                (llabs(new_pc_offset) + (faligned + 1u - 4u) / 4u) >= (~lmask >> (lsb + 1))) {  // inaccurate, but it works
-                while ((reinterpret_cast<uint64_t>(*outprx + 2) & faligned) != 0u) {
-                    *(*outprw)++ = Aarch64Nop;
-                    (*outprx)++;
-                }
-                ctxp->reset_current_ins(current_idx, *outprx);
-
-                // Note that if memory at absolute_addr is writeable (non-const), we will fail to fetch it.
-                // And what's worse, we may unexpectedly overwrite something if special_fix_type is true...
-                uint32_t ns = static_cast<uint32_t>((faligned + 1) / sizeof(uint32_t));
-                (*outprw)[0] = (((8u >> 2u) << lsb) & ~mask) | (ins & lmask);  // LDR #0x8
-                (*outprw)[1] = 0x14000001u + ns;                               // B #0xc
-                memcpy(*outprw + 2, reinterpret_cast<void*>(absolute_addr), faligned + 1);
-                *outprw += 2 + ns;
-                *outprx += 2 + ns;
-            } else {
-                faligned >>= 2;  // new_pc_offset is shifted and 4-byte aligned
-                while ((new_pc_offset & faligned) != 0) {
-                    *(*outprw)++ = Aarch64Nop;
-                    (*outprx)++;
-                    new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx)) >> 2;
+    JIT_CREATE(s_HookJit, setting::JitSize);
+    constinit util::JitPool s_HookPool(s_HookJit, sizeof(HookSite), setting::JitGrowSize);
+
+    JIT_CREATE(s_HookLinkJit, setting::HookLinkPoolSize);
+    constinit util::JitPool s_HookLinkPool(s_HookLinkJit, sizeof(HookLink), setting::JitGrowSize);
+
+    /* Sites keyed by the hooked address. */
+    constinit HookSite* s_SiteTable[SiteTableSize] = {};
+
+    //-------------------------------------------------------------------------
+
+    namespace {
+
+        /* Range of code that still needs cache maintenance once the current batch ends. */
+        struct DirtyRange {
+            uintptr_t m_Start = UINTPTR_MAX;
+            uintptr_t m_End = 0;
+
+            void Add(uintptr_t start, size_t size) {
+                m_Start = std::min(m_Start, start);
+                m_End = std::max(m_End, start + size);
+            }
+
+            bool IsEmpty() const { return m_Start >= m_End; }
+
+            size_t GetSize() const { return m_End - m_Start; }
+        };
+
+        constinit int s_BatchDepth = 0;
+        constinit DirtyRange s_DirtySites = {};
+        constinit DirtyRange s_DirtyTrampolines = {};
+        constinit DirtyRange s_DirtyLinks = {};
+
+        /* Slots of a removed hook, a thread can still be running its stub or the site's trampoline right after it's unlinked. */
+        struct RetiredHook {
+            uintptr_t m_LinkRx;
+            uintptr_t m_SiteRx;         // only set if the hook was the last one on its site
+            uintptr_t m_InlineEntry;
+            uint32_t m_Generation;
+        };
+
+        constinit RetiredHook s_RetiredHooks[setting::HookRetireQueueSize] = {};
+        constinit size_t s_RetiredCount = 0;
+        constinit uint32_t s_Generation = 0;
+
+        /* Gets a writable alias of a hook site. Sites in the main module reuse the mapping made for the patcher at init, */
+        /* anything else gets mapped for as long as the writer lives. */
+        class SiteWriter {
+            NON_COPYABLE(SiteWriter);
+            NON_MOVEABLE(SiteWriter);
+
+            std::optional<util::RwPages> m_Pages;
+            uint32_t* m_Rw;
+            bool m_IsMainModule;
+
+            public:
+            SiteWriter(uintptr_t ro, size_t size) {
+                const auto& main = patch::impl::GetRwPages();
+                m_IsMainModule = ro >= main.GetRo() && ro + size <= main.GetRo() + main.GetSize();
+
+                if (m_IsMainModule) {
+                    m_Rw = reinterpret_cast<uint32_t*>(main.GetRw() + (ro - main.GetRo()));
+                } else {
+                    m_Pages.emplace(ro, size);
+                    m_Rw = reinterpret_cast<uint32_t*>(m_Pages->GetRw());
                 }
-                ctxp->reset_current_ins(current_idx, *outprx);
+            }
 
-                (*outprw)[0] = (static_cast<uint32_t>(new_pc_offset << lsb) & ~mask) | (ins & lmask);
-                ++(*outprx);
-                ++(*outprw);
-            }  // if
+            uint32_t* Get() const { return m_Rw; }
+
+            /* Cache maintenance for main module sites is deferred while batching, other sites are flushed when unmapped anyways. */
+            void Flush(void* symbol, size_t size) const {
+                if (m_IsMainModule && s_BatchDepth > 0)
+                    s_DirtySites.Add(reinterpret_cast<uintptr_t>(symbol), size);
+                else
+                    __flush_cache(symbol, size);
+            }
+        };
 
-            ++(*inprxp);
-            ++(*inprwp);
-            return ctxp->process_fix_map(current_idx), true;
+        template<typename Jit>
+        bool IsInStaticArea(Jit& jit, uintptr_t rx, size_t size) {
+            return rx >= jit.GetRo() && rx + size <= jit.GetRo() + jit.GetSize();
         }
 
-        //-------------------------------------------------------------------------
-
-        bool __fix_pcreladdr(instruction inprwp, instruction inprxp, instruction outprw, instruction outprx,
-                                    context* ctxp) {
-            // Load a PC-relative address into a register
-            // http://infocenter.arm.com/help/topic/com.arm.doc.100069_0608_00_en/pge1427897645644.html
-            constexpr uint32_t msb = 8u;
-            constexpr uint32_t lsb = 5u;
-            constexpr uint32_t mask = 0x9f000000u;     // 0b10011111000000000000000000000000
-            constexpr uint32_t rmask = 0x0000001fu;    // 0b00000000000000000000000000011111
-            constexpr uint32_t lmask = 0xff00001fu;    // 0b11111111000000000000000000011111
-            constexpr uint32_t fmask = 0x00ffffffu;    // 0b00000000111111111111111111111111
-            constexpr uint32_t max_val = 0x001fffffu;  // 0b00000000000111111111111111111111
-            constexpr uint32_t op_adr = 0x10000000u;   // "adr"  Rd, ADDR_PCREL21
-            constexpr uint32_t op_adrp = 0x90000000u;  // "adrp" Rd, ADDR_ADRP
-
-            const uint32_t ins = *(*inprwp);
-            intptr_t current_idx;
-            switch (ins & mask) {
-                case op_adr: {
-                    current_idx = ctxp->get_and_set_current_index(*inprxp, *outprx);
-                    int64_t lsb_bytes = static_cast<uint32_t>(ins << 1u) >> 30u;
-                    int64_t absolute_addr = reinterpret_cast<int64_t>(*inprxp) +
-                                            (((static_cast<int32_t>(ins << msb) >> (msb + lsb - 2u)) & ~3u) | lsb_bytes);
-                    int64_t new_pc_offset = static_cast<int64_t>(absolute_addr - reinterpret_cast<int64_t>(*outprx));
-                    bool special_fix_type = ctxp->is_in_fixing_range(absolute_addr);
-                    if (!special_fix_type && llabs(new_pc_offset) >= (max_val >> 1)) {
-                        if ((reinterpret_cast<uint64_t>(*outprx + 2) & 7u) != 0u) {
-                            (*outprw)[0] = Aarch64Nop;
-                            ctxp->reset_current_ins(current_idx, ++(*outprx));
-                            ++*(outprw);
-                        }  // if
-
-                        (*outprw)[0] = 0x58000000u | (((8u >> 2u) << lsb) & ~mask) | (ins & rmask);  // LDR #0x8
-                        (*outprw)[1] = 0x14000003u;                                                  // B #0xc
-                        memcpy(*outprw + 2, &absolute_addr, sizeof(absolute_addr));
-                        *outprw += 4;
-                        *outprx += 4;
-                    } else {
-                        if (special_fix_type) {
-                            intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr & ~3ull);
-                            if (ref_idx <= current_idx) {
-                                new_pc_offset =
-                                    static_cast<int64_t>(ctxp->dat[ref_idx].ins - reinterpret_cast<int64_t>(*outprx));
-                            } else {
-                                ctxp->insert_fix_map(ref_idx, *outprw, *outprx, lsb, fmask);
-                                new_pc_offset = 0;
-                            }  // if
-                        }      // if
-
-                        // the lsb_bytes will never be changed, so we can use lmask to keep it
-                        (*outprw)[0] = (static_cast<uint32_t>(new_pc_offset << (lsb - 2u)) & fmask) | (ins & lmask);
-                        ++(*outprw);
-                        ++(*outprx);
-                    }  // if
-                } break;
-                case op_adrp: {
-                    current_idx = ctxp->get_and_set_current_index(*inprxp, *outprw);
-                    int32_t lsb_bytes = static_cast<uint32_t>(ins << 1u) >> 30u;
-                    int64_t absolute_addr =
-                        (reinterpret_cast<int64_t>(*inprxp) & ~0xfffll) +
-                        ((((static_cast<int32_t>(ins << msb) >> (msb + lsb - 2u)) & ~3u) | lsb_bytes) << 12);
-                    if (ctxp->is_in_fixing_range(absolute_addr)) {
-                        intptr_t ref_idx = ctxp->get_ref_ins_index(absolute_addr /* & ~3ull*/);
-                        if (ref_idx > current_idx) {
-                            // the bottom 12 bits of absolute_addr are masked out,
-                            // so ref_idx must be less than or equal to current_idx!
-                            /*skyline::logger::s_Instance->Log(
-                                "[And64InlineHook] ref_idx must be less than or equal to current_idx!\n");*/
-                        }  // if
-
-                        // *absolute_addr may be changed due to relocation fixing
-                        *(*outprw)++ = ins;  // 0x90000000u;
-                        (*outprx)++;
-                    } else {
-                        if ((reinterpret_cast<uint64_t>(*outprx + 2) & 7u) != 0u) {
-                            (*outprw)[0] = Aarch64Nop;
-                            ctxp->reset_current_ins(current_idx, ++(*outprx));
-                            ++*(outprw);
-                        }  // if
-
-                        (*outprw)[0] = 0x58000000u | (((8u >> 2u) << lsb) & ~mask) | (ins & rmask);  // LDR #0x8
-                        (*outprw)[1] = 0x14000003u;                                                  // B #0xc
-                        memcpy(*outprw + 2, &absolute_addr, sizeof(absolute_addr));                  // potential overflow?
-                        *outprw += 4;
-                        *outprx += 4;
-                    }  // if
-                } break;
-                default:
-                    return false;
-            }
+        template<typename Jit>
+        void FlushRange(Jit& jit, DirtyRange& dirty) {
+            if (dirty.IsEmpty())
+                return;
 
-            ctxp->process_fix_map(current_idx);
-            ++(*inprxp);
-            ++(*inprwp);
-            return true;
+            uintptr_t rw = jit.GetRw() + (dirty.m_Start - jit.GetRo());
+            armDCacheFlush(reinterpret_cast<void*>(rw), dirty.GetSize());
+            armICacheInvalidate(reinterpret_cast<void*>(dirty.m_Start), dirty.GetSize());
         }
 
-        #define __flush_cache(c, n) __builtin___clear_cache(reinterpret_cast<char*>(c), reinterpret_cast<char*>(c) + n)
-
-        //-------------------------------------------------------------------------
-
-        void __fix_instructions(uint32_t* __restrict inprw, uint32_t* __restrict inprx, int32_t count,
-                                    uint32_t* __restrict outrwp, uint32_t* __restrict outrxp) {
-            context ctx;
-            ctx.basep = reinterpret_cast<int64_t>(inprx);
-            ctx.endp = reinterpret_cast<int64_t>(inprx + count);
-            memset(ctx.dat, 0, sizeof(ctx.dat));
-            static_assert(sizeof(ctx.dat) / sizeof(ctx.dat[0]) == MaxInstructions, "please use MaxInstructions!");
-        #ifndef NDEBUG
-            if (count > MaxInstructions) {
-                EXL_ABORT(result::HookFixingTooManyInstructions);
-            }   // if
-        #endif  // NDEBUG
-
-            uint32_t* const outprx_base = outrxp;
-            uint32_t* const outprw_base = outrwp;
-
-            while (--count >= 0) {
-                if (__fix_branch_imm(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
-                if (__fix_cond_comp_test_branch(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
-                if (__fix_loadlit(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
-                if (__fix_pcreladdr(&inprw, &inprx, &outrwp, &outrxp, &ctx)) continue;
-
-                // without PC-relative offset
-                ctx.process_fix_map(ctx.get_and_set_current_index(inprx, outrxp));
-                *(outrwp++) = *(inprw++);
-                outrxp++;
-                inprx++;
-            }
+        /* Only sites in the static area are deferred, pages mapped at runtime can be anywhere in the address space. */
+        void FlushSite(HookSite* site) {
+            static constexpr size_t size = sizeof(HookSite);
 
-            constexpr uint_fast64_t mask = 0x03ffffffu;  // 0b00000011111111111111111111111111
-            auto callback = reinterpret_cast<int64_t>(inprx);
-            auto pc_offset = static_cast<int64_t>(callback - reinterpret_cast<int64_t>(outrxp)) >> 2;
-            if (llabs(pc_offset) >= (mask >> 1)) {
-                if ((reinterpret_cast<uint64_t>(outrxp + 2) & 7u) != 0u) {
-                    outrwp[0] = Aarch64Nop;
-                    ++outrxp;
-                    ++outrwp;
-                }                         // if
-                outrwp[0] = 0x58000051u;  // LDR X17, #0x8
-                outrwp[1] = 0xd61f0220u;  // BR X17
-                *reinterpret_cast<int64_t*>(outrwp + 2) = callback;
-                outrwp += 4;
-                outrxp += 4;
-            } else {
-                outrwp[0] = 0x14000000u | (pc_offset & mask);  // "B" ADDR_PCREL26
-                ++outrwp;
-                ++outrxp;
-            }  // if
+            if (s_BatchDepth > 0 && IsInStaticArea(s_HookJit, site->m_Rx, size)) {
+                s_DirtyTrampolines.Add(site->m_Rx, size);
+                return;
+            }
 
-            const uintptr_t total = (outrxp - outprx_base) * sizeof(uint32_t);
-            // __flush_cache(outprx_base, total);  // necessary
-            __flush_cache(outprw_base, total);
+            armDCacheFlush(site, size);
+            armICacheInvalidate(reinterpret_cast<void*>(site->m_Rx), size);
         }
     }
 
-    //-------------------------------------------------------------------------
+    void BeginBatch() {
+        s_BatchDepth++;
+    }
 
-    //static nn::os::MutexType hookMutex;
+    void EndBatch() {
+        EXL_ASSERT(s_BatchDepth > 0);
 
-    //-------------------------------------------------------------------------
+        if (--s_BatchDepth > 0)
+            return;
 
-    JIT_CREATE(s_HookJit, setting::JitSize);
+        /* Everything a site can branch to is made visible before the sites themselves. */
+        FlushRange(s_HookLinkJit, s_DirtyLinks);
+        FlushRange(s_HookJit, s_DirtyTrampolines);
+        FlushRange(patch::impl::GetRwPages(), s_DirtySites);
+
+        s_DirtySites = {};
+        s_DirtyTrampolines = {};
+        s_DirtyLinks = {};
+    }
 
     void Initialize() {
        s_HookJit.Initialize();
+       s_HookPool.Initialize();
+       s_HookLinkJit.Initialize();
+       s_HookLinkPool.Initialize();
        InitializeInline();
     }
 
     //-------------------------------------------------------------------------
 
-    static Result AllocForTrampoline(uint32_t** rx, uint32_t** rw) {
-        static_assert((TrampolineSize * sizeof(uint32_t)) % 8 == 0, "8-byte align");
-        static volatile s32 index = -1;
+    static size_t GetSiteBucket(uintptr_t hook) {
+        return (hook >> 2) % SiteTableSize;
+    }
+
+    static HookSite* FindSite(uintptr_t hook) {
+        for (HookSite* site = s_SiteTable[GetSiteBucket(hook)]; site != NULL; site = site->m_NextInBucket) {
+            if (site->m_Site == hook)
+                return site;
+        }
+        return NULL;
+    }
+
+    static void RemoveSite(HookSite* site) {
+        HookSite** next = &s_SiteTable[GetSiteBucket(site->m_Site)];
+        while (*next != site)
+            next = &(*next)->m_NextInBucket;
+        *next = site->m_NextInBucket;
+    }
 
-        uint32_t i = __atomic_increase(&index);
-        
-        if(i > HookMax)
-            return result::HookTrampolineAllocFail;
+    /* Both forms are always valid: the literal and BR are written first, then the first instruction picks one atomically. */
+    static void WriteStub(uint32_t* rw, uintptr_t rx, uintptr_t target) {
+        static constexpr uint_fast64_t mask = 0x03ffffffu;
 
-        HookPool* rwptr = (HookPool*)s_HookJit.GetRw();
-        HookPool* rxptr = (HookPool*)s_HookJit.GetRo();
-        *rw = (*rwptr)[i];
-        *rx = (*rxptr)[i];
+        __atomic_store_n(reinterpret_cast<int64_t*>(rw + 2), static_cast<int64_t>(target), __ATOMIC_RELAXED);
+        rw[1] = 0xd61f0220u;  // BR X17
 
-        return result::Success;
+        auto pc_offset = static_cast<int64_t>(target - rx) >> 2;
+        uint32_t first = llabs(pc_offset) < (mask >> 1) ? 0x14000000u | (pc_offset & mask)  // "B" ADDR_PCREL26
+                                                         : 0x58000051u;                      // LDR X17, #0x8
+        __atomic_store_n(rw, first, __ATOMIC_RELEASE);
+    }
+
+    /* Like sites, stubs in the static areas are flushed once the current batch ends. */
+    static void FlushStub(uint32_t* rw, uintptr_t rx) {
+        static constexpr size_t size = StubSize * sizeof(uint32_t);
+
+        if (s_BatchDepth > 0) {
+            if (IsInStaticArea(s_HookJit, rx, size)) {
+                s_DirtyTrampolines.Add(rx, size);
+                return;
+            }
+            if (IsInStaticArea(s_HookLinkJit, rx, size)) {
+                s_DirtyLinks.Add(rx, size);
+                return;
+            }
+        }
+
+        armDCacheFlush(rw, size);
+        armICacheInvalidate(reinterpret_cast<void*>(rx), size);
+    }
+
+    /* The stub that jumps to a hook's callback, the site's entry for the newest hook. */
+    static void RetargetIncoming(HookLink* link, uintptr_t target) {
+        if (link->m_Newer != NULL) {
+            WriteStub(link->m_Newer->m_Stub, link->m_Newer->m_Rx, target);
+            FlushStub(link->m_Newer->m_Stub, link->m_Newer->m_Rx);
+        } else {
+            HookSite* site = link->m_Site;
+            uintptr_t entryRx = site->m_Rx + offsetof(HookSite, m_Entry);
+            WriteStub(site->m_Entry, entryRx, target);
+            FlushStub(site->m_Entry, entryRx);
+        }
+    }
+
+    static uintptr_t GetOlderTarget(const HookLink* link) {
+        return link->m_Older != NULL ? link->m_Older->m_Callback : link->m_Site->m_Rx + offsetof(HookSite, m_Trampoline);
     }
 
     //-------------------------------------------------------------------------
 
-    static bool HookFuncImpl(void* const symbol, void* const replace, void* const rxtr, void* const rwtr) {
+    static bool HookFuncImpl(void* const symbol, void* const replace, void* const rxtr, void* const rwtr, HookSite* const site) {
         static constexpr uint_fast64_t mask = 0x03ffffffu;  // 0b00000011111111111111111111111111
 
         uint32_t *rxtrampoline = static_cast<uint32_t*>(rxtr), *rwtrampoline = static_cast<uint32_t*>(rwtr),
@@ -564,17 +319,21 @@ namespace exl::hook::nx64 {
         static_assert(MaxInstructions >= 5, "please fix MaxInstructions!");
         auto pc_offset = static_cast<int64_t>(__intval(replace) - __intval(symbol)) >> 2;
         if (llabs(pc_offset) >= (mask >> 1)) {
-            const util::RwPages ctrl((uintptr_t)original, 5 * sizeof(uint32_t));
+            const SiteWriter ctrl((uintptr_t)original, 5 * sizeof(uint32_t));
 
             int32_t count = (reinterpret_cast<uint64_t>(original + 2) & 7u) != 0u ? 5 : 4;
 
-            original = (u32*)ctrl.GetRw();
+            u32* rooriginal = original;
+            original = ctrl.Get();
+
+            memcpy(site->m_Original, rooriginal, count * sizeof(uint32_t));
+            site->m_OriginalCount = count;
 
             if (rxtrampoline) {
                 if (TrampolineSize < count * 10u) {
                     return false;
                 }  // if
-                __fix_instructions(original, (u32*)ctrl.GetRo(), count, rwtrampoline, rxtrampoline);
+                __fix_instructions(original, rooriginal, count, rwtrampoline, rxtrampoline);
             }  // if
 
             if (count == 5) {
@@ -584,44 +343,234 @@ namespace exl::hook::nx64 {
             original[0] = 0x58000051u;  // LDR X17, #0x8
             original[1] = 0xd61f0220u;  // BR X17
             *reinterpret_cast<int64_t*>(original + 2) = __intval(replace);
-            __flush_cache(symbol, 5 * sizeof(uint32_t));
+            ctrl.Flush(symbol, 5 * sizeof(uint32_t));
         } else {
-            const util::RwPages ctrl((uintptr_t)original, 1 * sizeof(uint32_t));
+            const SiteWriter ctrl((uintptr_t)original, 1 * sizeof(uint32_t));
+
+            u32* rooriginal = original;
+            original = ctrl.Get();
 
-            original = (u32*)ctrl.GetRw();
+            site->m_Original[0] = rooriginal[0];
+            site->m_OriginalCount = 1;
 
             if (rwtrampoline) {
                 if (TrampolineSize < 1u * 10u) {
                     return false;
                 }  // if
-                __fix_instructions(original, (u32*)ctrl.GetRo(), 1, rwtrampoline, rxtrampoline);
+                __fix_instructions(original, rooriginal, 1, rwtrampoline, rxtrampoline);
             }  // if
 
             __sync_cmpswap(original, *original, 0x14000000u | (pc_offset & mask));  // "B" ADDR_PCREL26
-            __flush_cache(symbol, 1 * sizeof(uint32_t));
+            ctrl.Flush(symbol, 1 * sizeof(uint32_t));
         }  // if
 
         return true;
     }
 
-    uintptr_t Hook(uintptr_t hook, uintptr_t callback, bool do_trampoline) {
-        
+    static HookSite* CreateSite(uintptr_t hook) {
+        util::JitPool::Slot slot;
+        if (!s_HookPool.Allocate(&slot))
+            return NULL;
+
+        auto* site = reinterpret_cast<HookSite*>(slot.m_Rw);
+        site->m_Site = hook;
+        site->m_Rx = slot.m_Rx;
+        site->m_Newest = NULL;
+
+        /* The entry has to be in place before anything can branch to it, it starts out going through the trampoline. */
+        uintptr_t entryRx = site->m_Rx + offsetof(HookSite, m_Entry);
+        uintptr_t trampolineRx = site->m_Rx + offsetof(HookSite, m_Trampoline);
+        WriteStub(site->m_Entry, entryRx, trampolineRx);
+        FlushStub(site->m_Entry, entryRx);
+
+        if (!HookFuncImpl(reinterpret_cast<void*>(hook), reinterpret_cast<void*>(entryRx),
+                          reinterpret_cast<void*>(trampolineRx), site->m_Trampoline, site))
+            EXL_ABORT(exl::result::HookFailed);
+
+        FlushSite(site);
+
+        size_t bucket = GetSiteBucket(hook);
+        site->m_NextInBucket = s_SiteTable[bucket];
+        s_SiteTable[bucket] = site;
+
+        return site;
+    }
+
+    static void RestoreSite(HookSite* site) {
+        const uintptr_t hook = site->m_Site;
+        const uint32_t count = site->m_OriginalCount;
+        const SiteWriter ctrl(hook, count * sizeof(uint32_t));
+        uint32_t* original = ctrl.Get();
+
+        /* Restoring can't be deferred by a batch, as the site is briefly parked on itself below. */
+        if (count > 1) {
+            /* Park anything newly entering the site on a "B ." while the rest of the instructions are put back. */
+            /* This only covers threads that haven't reached the site yet: one that already ran the first hooked instruction */
+            /* can still go on into restored ones, so sites should only be restored while nothing is calling the function. */
+            __atomic_store_n(original, 0x14000000u, __ATOMIC_RELEASE);
+            __flush_cache(hook, sizeof(uint32_t));
+
+            memcpy(original + 1, site->m_Original + 1, (count - 1) * sizeof(uint32_t));
+            __flush_cache(hook + sizeof(uint32_t), (count - 1) * sizeof(uint32_t));
+        }
+
+        __atomic_store_n(original, site->m_Original[0], __ATOMIC_RELEASE);
+        __flush_cache(hook, sizeof(uint32_t));
+    }
+
+    /* Freeing a slot reuses its first bytes for the free-list, so nothing may still be executing it by then. */
+    /* Slots are held back until ReclaimRemoved has been called twice, ex: until the next frame has fully gone by. */
+    static void RetireHook(uintptr_t link_rx, uintptr_t site_rx, uintptr_t inline_entry) {
+        /* Leaking is the only safe option once the queue is full. */
+        if (s_RetiredCount >= setting::HookRetireQueueSize)
+            return;
+
+        s_RetiredHooks[s_RetiredCount++] = {
+            .m_LinkRx = link_rx,
+            .m_SiteRx = site_rx,
+            .m_InlineEntry = inline_entry,
+            .m_Generation = s_Generation,
+        };
+    }
+
+    static void RemoveLink(HookLink* link) {
+        HookSite* site = link->m_Site;
+        uintptr_t site_rx = 0;
+
+        if (link->m_Newer == NULL && link->m_Older == NULL) {
+            /* Last hook on the site, put the function back the way it was. */
+            RestoreSite(site);
+            RemoveSite(site);
+            site->m_Site = 0;
+            site_rx = site->m_Rx;
+        } else {
+            RetargetIncoming(link, GetOlderTarget(link));
+
+            if (link->m_Newer != NULL)
+                link->m_Newer->m_Older = link->m_Older;
+            else
+                site->m_Newest = link->m_Older;
+
+            if (link->m_Older != NULL)
+                link->m_Older->m_Newer = link->m_Newer;
+        }
+
+        link->m_Site = NULL;
+        RetireHook(link->m_Rx, site_rx, link->m_InlineEntry);
+    }
+
+    void ReclaimRemoved() {
+        s_Generation++;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < s_RetiredCount; i++) {
+            const RetiredHook& retired = s_RetiredHooks[i];
+            if (s_Generation - retired.m_Generation < 2) {
+                s_RetiredHooks[kept++] = retired;
+                continue;
+            }
+
+            if (retired.m_SiteRx != 0)
+                s_HookPool.Free(retired.m_SiteRx);
+            if (retired.m_InlineEntry != 0)
+                FreeInlineEntry(retired.m_InlineEntry);
+            s_HookLinkPool.Free(retired.m_LinkRx);
+        }
+
+        s_RetiredCount = kept;
+    }
+
+    uintptr_t HookWithOwner(uintptr_t hook, uintptr_t callback, bool do_trampoline, uintptr_t owner, uintptr_t inline_entry) {
         EXL_ASSERT(hook != 0);
         EXL_ASSERT(callback != 0);
 
         /* TODO: thread safety */
 
-        u32* rxtrampoline = NULL;
-        u32* rwtrampoline = NULL;
-        if (do_trampoline) 
-            R_ABORT_UNLESS(AllocForTrampoline(&rxtrampoline, &rwtrampoline));
+        util::JitPool::Slot slot;
+        if (!s_HookLinkPool.Allocate(&slot))
+            EXL_ABORT(result::HookTrampolineAllocFail);
 
-        if (!HookFuncImpl(reinterpret_cast<void*>(hook), reinterpret_cast<void*>(callback), rxtrampoline, rwtrampoline))
-            EXL_ABORT(exl::result::HookFailed);
+        /* Only the first hook on an address patches and relocates it, the rest chain onto its entry. */
+        HookSite* site = FindSite(hook);
+        if (site == NULL) {
+            site = CreateSite(hook);
+            if (site == NULL)
+                EXL_ABORT(result::HookTrampolineAllocFail);
+        }
+
+        auto* link = reinterpret_cast<HookLink*>(slot.m_Rw);
+        link->m_Callback = callback;
+        link->m_Owner = owner;
+        link->m_InlineEntry = inline_entry;
+        link->m_Rx = slot.m_Rx;
+        link->m_Site = site;
+        link->m_Older = site->m_Newest;
+        link->m_Newer = NULL;
+
+        /* Set up where the new hook's trampoline goes before making it reachable. */
+        WriteStub(link->m_Stub, link->m_Rx, GetOlderTarget(link));
+        FlushStub(link->m_Stub, link->m_Rx);
+
+        if (link->m_Older != NULL)
+            link->m_Older->m_Newer = link;
+        site->m_Newest = link;
 
-        s_HookJit.Flush();
+        RetargetIncoming(link, callback);
 
-        return (uintptr_t) rxtrampoline;
+        return do_trampoline ? link->m_Rx : 0;
     }
 
-};
\ No newline at end of file
+    uintptr_t Hook(uintptr_t hook, uintptr_t callback, bool do_trampoline) {
+        return HookWithOwner(hook, callback, do_trampoline, callback, 0);
+    }
+
+    bool Unhook(uintptr_t hook) {
+        EXL_ASSERT(hook != 0);
+
+        HookSite* site = FindSite(hook);
+        if (site == NULL)
+            return false;
+
+        RemoveLink(site->m_Newest);
+        return true;
+    }
+
+    size_t UnhookInRange(uintptr_t start, uintptr_t end) {
+        size_t count = 0;
+
+        /* Removing a hook never touches anything but its neighbours, so order doesn't matter here. */
+        s_HookLinkPool.ForEachSlot([start, end, &count](const util::JitPool::Slot& slot) {
+            auto* link = reinterpret_cast<HookLink*>(slot.m_Rw);
+            if (link->m_Site != NULL && link->m_Owner >= start && link->m_Owner < end) {
+                RemoveLink(link);
+                count++;
+            }
+        });
+
+        return count;
+    }
+
+    bool Retarget(uintptr_t trampoline, uintptr_t target) {
+        EXL_ASSERT(trampoline != 0);
+        EXL_ASSERT(target != 0);
+
+        if (!s_HookLinkPool.Contains(trampoline))
+            return false;
+
+        auto* link = reinterpret_cast<HookLink*>(s_HookLinkPool.RxToRw(trampoline));
+        if (link->m_Site == NULL)
+            return false;
+
+        link->m_Callback = target;
+        RetargetIncoming(link, target);
+        return true;
+    }
+
+    util::JitPool::Stats GetTrampolinePoolStats() {
+        return s_HookPool.GetStats();
+    }
+
+    util::JitPool::Stats GetLinkPoolStats() {
+        return s_HookLinkPool.GetStats();
+    }
+}
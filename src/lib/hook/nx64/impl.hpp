@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.hpp"
+#include "lib/util/sys/jit_pool.hpp"
 #include "inline_impl.hpp"
 
 namespace exl::hook::nx64 {
@@ -8,5 +9,26 @@ namespace exl::hook::nx64 {
     void Initialize();
 
     uintptr_t Hook(uintptr_t hook, uintptr_t callback, bool do_trampoline = false);
+    /* Same as Hook, but records the hook as belonging to owner, which UnhookInRange looks at. */
+    uintptr_t HookWithOwner(uintptr_t hook, uintptr_t callback, bool do_trampoline, uintptr_t owner, uintptr_t inline_entry);
+    /* Removes the newest hook at a site, the site is restored once no hooks are left on it. */
+    /* Its trampoline stays valid for threads still running through it until ReclaimRemoved frees it. */
+    bool Unhook(uintptr_t hook);
+    /* Removes every hook whose callback lies in the range, returns how many were removed. */
+    size_t UnhookInRange(uintptr_t start, uintptr_t end);
+    /* Points the hook that handed out trampoline at a new target, ex: the trampoline itself to skip the callback. */
+    /* Other hooks chained onto the same address are unaffected. */
+    bool Retarget(uintptr_t trampoline, uintptr_t target);
+    /* Frees the slots of hooks removed before the previous call. Call this regularly from a point no hook */
+    /* is running on (ex: once per frame), removed hooks are only reused once a whole interval has gone by. */
+    void ReclaimRemoved();
     void HookInline(uintptr_t hook, uintptr_t callback);
+
+    /* Hooks installed between these defer their cache maintenance until the outermost batch ends. */
+    void BeginBatch();
+    void EndBatch();
+
+    util::JitPool::Stats GetTrampolinePoolStats();
+    util::JitPool::Stats GetLinkPoolStats();
+    util::JitPool::Stats GetInlinePoolStats();
 }
\ No newline at end of file
@@ -16,10 +16,8 @@ namespace exl::hook::nx64 {
         uintptr_t m_Callback;
     };
 
-    static constexpr size_t InlinePoolCount = setting::InlinePoolSize / sizeof(Entry);
-
     JIT_CREATE(s_InlineHookJit, setting::InlinePoolSize);
-    static size_t s_EntryIndex = 0;
+    constinit util::JitPool s_InlinePool(s_InlineHookJit, sizeof(Entry), setting::JitGrowSize);
 
     extern "C" {
         extern char exl_inline_hook_impl;
@@ -29,32 +27,33 @@ namespace exl::hook::nx64 {
         return reinterpret_cast<uintptr_t>(&exl_inline_hook_impl);
     }
 
-    static const Entry* GetEntryRx() {
-        return reinterpret_cast<const Entry*>(s_InlineHookJit.GetRo());
+    void InitializeInline() {
+        s_InlineHookJit.Initialize();
+        s_InlinePool.Initialize();
     }
 
-    static Entry* GetEntryRw() {
-        return reinterpret_cast<Entry*>(s_InlineHookJit.GetRw());
+    void FreeInlineEntry(uintptr_t entry) {
+        s_InlinePool.Free(entry);
     }
 
-    void InitializeInline() {
-        s_InlineHookJit.Initialize();
+    util::JitPool::Stats GetInlinePoolStats() {
+        return s_InlinePool.GetStats();
     }
 
     void HookInline(uintptr_t hook, uintptr_t callback) {
-        /* Ensure enough space in the pool. */
-        if(s_EntryIndex >= InlinePoolCount)
+        /* Grab entry from pool. */
+        util::JitPool::Slot slot;
+        if(!s_InlinePool.Allocate(&slot))
             EXL_ABORT(result::HookTrampolineAllocFail);
 
-        /* Grab entry from pool. */
-        auto entryRx = &GetEntryRx()[s_EntryIndex];
-        auto entryRw = &GetEntryRw()[s_EntryIndex];
-        s_EntryIndex++;
+        auto entryRx = reinterpret_cast<const Entry*>(slot.m_Rx);
+        auto entryRw = reinterpret_cast<Entry*>(slot.m_Rw);
 
         /* Get pointer to entry's entrypoint. */
         uintptr_t entryCb = reinterpret_cast<uintptr_t>(&entryRx->m_CbEntry);
         /* Hook to call into the entry's entrypoint. Assign trampoline to be used by impl. */
-        auto trampoline = Hook(hook, entryCb, true);
+        /* The hook is owned by the real callback, and frees the entry when it is removed. */
+        auto trampoline = HookWithOwner(hook, entryCb, true, callback, slot.m_Rx);
 
         /* Construct entrypoint instructions. */
         auto impl = GetImpl();
@@ -72,6 +71,7 @@ namespace exl::hook::nx64 {
         entryRw->m_Callback = callback;
 
         /* Finally, flush caches to have RX region to be consistent. */
-        s_InlineHookJit.Flush();
+        armDCacheFlush(entryRw, sizeof(Entry));
+        armICacheInvalidate(const_cast<Entry*>(entryRx), sizeof(Entry));
     }
 }
\ No newline at end of file
@@ -49,4 +49,5 @@ namespace exl::hook::nx64 {
     };
 
     void InitializeInline();
+    void FreeInlineEntry(uintptr_t entry);
 }
\ No newline at end of file
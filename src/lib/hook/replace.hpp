@@ -3,6 +3,7 @@
 #include "base.hpp"
 #include "ro.h"
 #include "util/func_ptrs.hpp"
+#include "util/symbols.hpp"
 
 #define HOOK_DEFINE_REPLACE(name)                        \
 struct name : public ::exl::hook::impl::ReplaceHook<name>
@@ -41,7 +42,7 @@ namespace exl::hook::impl {
             _HOOK_STATIC_CALLBACK_ASSERT();
 
             uintptr_t address = 0;
-            R_ABORT_UNLESS(nn::ro::LookupSymbol(&address, sym));
+            R_ABORT_UNLESS(util::symbols::LookupSymbol(&address, sym));
 
             hook::Hook(address, Derived::Callback);
         }
@@ -3,6 +3,7 @@
 #include "base.hpp"
 #include "ro.h"
 #include "util/func_ptrs.hpp"
+#include "util/symbols.hpp"
 #include <functional>
 
 #define HOOK_DEFINE_TRAMPOLINE(name)                        \
@@ -58,7 +59,7 @@ namespace exl::hook::impl {
             _HOOK_STATIC_CALLBACK_ASSERT();
 
             uintptr_t address = 0;
-            R_ABORT_UNLESS(nn::ro::LookupSymbol(&address, sym));
+            R_ABORT_UNLESS(util::symbols::LookupSymbol(&address, sym));
 
             OrigRef() = hook::Hook(address, Derived::Callback, true);
         }
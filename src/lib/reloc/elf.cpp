@@ -3,6 +3,22 @@
 #include "common.hpp"
 
 #include "rtld.hpp"
+#include "relative.hpp"
+
+namespace {
+    /* Written before the module is relocated, internal linkage keeps it from going through the GOT. */
+    exl::reloc::Stats s_Stats;
+
+    ALWAYS_INLINE uint64_t ReadTick() {
+        uint64_t tick;
+        asm volatile("mrs %0, cntpct_el0" : "=r"(tick));
+        return tick;
+    }
+}
+
+const exl::reloc::Stats& exl::reloc::GetStats() {
+    return s_Stats;
+}
 
 extern "C" {
     __attribute__((section(".bss")))
@@ -10,6 +26,8 @@ extern "C" {
 
     void exl_dynamic(uintptr_t aslr_base, const Elf_Dyn* dynamic)
     {
+        uint64_t start_tick = ReadTick();
+
         Elf_Addr rela = 0;
         Elf_Addr rel = 0;
 
@@ -22,6 +40,9 @@ extern "C" {
         Elf_Xword rela_size = 0;
         Elf_Xword rel_size = 0;
 
+        Elf_Addr relr = 0;
+        Elf_Xword relr_size = 0;
+
         for (; dynamic->d_tag != DT_NULL; dynamic++) {
             switch (dynamic->d_tag) {
                 case DT_RELA:
@@ -56,6 +77,14 @@ extern "C" {
                     rel_entry_count = dynamic->d_un.d_val;
                     continue;
 
+                case DT_RELR:
+                    relr = ((Elf_Addr)aslr_base + dynamic->d_un.d_ptr);
+                    continue;
+
+                case DT_RELRSZ:
+                    relr_size = dynamic->d_un.d_val;
+                    continue;
+
                 // those are nop on the real rtld
                 case DT_NEEDED:
                 case DT_PLTRELSZ:
@@ -82,36 +111,53 @@ extern "C" {
 
 
         if (rel_entry_count) {
-            Elf_Xword i = 0;
-
-            while (i < rel_entry_count) {
-                Elf_Rel *entry = (Elf_Rel *)(rel + (i * rel_entry_size));
-                switch (ELF_R_TYPE(entry->r_info)) {
-                    case ARCH_RELATIVE: {
-                        Elf_Addr *ptr = (Elf_Addr *)(aslr_base + entry->r_offset);
-                        *ptr += (Elf_Addr)aslr_base;
-                        break;
+            if (rel_entry_size == sizeof(Elf_Rel)) {
+                s_Stats.m_RelativeCount += rtld::apply_all_relative_rel(aslr_base, (Elf_Rel *)rel, rel_entry_count);
+            } else {
+                Elf_Xword i = 0;
+
+                while (i < rel_entry_count) {
+                    Elf_Rel *entry = (Elf_Rel *)(rel + (i * rel_entry_size));
+                    switch (ELF_R_TYPE(entry->r_info)) {
+                        case ARCH_RELATIVE: {
+                            Elf_Addr *ptr = (Elf_Addr *)(aslr_base + entry->r_offset);
+                            *ptr += (Elf_Addr)aslr_base;
+                            s_Stats.m_RelativeCount++;
+                            break;
+                        }
                     }
+                    i++;
                 }
-                i++;
             }
         }
 
         if (rela_entry_count) {
-            Elf_Xword i = 0;
-
-            while (i < rela_entry_count) {
-                Elf_Rela *entry = (Elf_Rela *)(rela + (i * rela_entry_size));
-
-                switch (ELF_R_TYPE(entry->r_info)) {
-                    case ARCH_RELATIVE: {
-                        Elf_Addr *ptr = (Elf_Addr *)(aslr_base + entry->r_offset);
-                        *ptr = (Elf_Addr)aslr_base + entry->r_addend;
-                        break;
+            if (rela_entry_size == sizeof(Elf_Rela)) {
+                s_Stats.m_RelativeCount += rtld::apply_all_relative_rela(aslr_base, (Elf_Rela *)rela, rela_entry_count);
+            } else {
+                Elf_Xword i = 0;
+
+                while (i < rela_entry_count) {
+                    Elf_Rela *entry = (Elf_Rela *)(rela + (i * rela_entry_size));
+
+                    switch (ELF_R_TYPE(entry->r_info)) {
+                        case ARCH_RELATIVE: {
+                            Elf_Addr *ptr = (Elf_Addr *)(aslr_base + entry->r_offset);
+                            *ptr = (Elf_Addr)aslr_base + entry->r_addend;
+                            s_Stats.m_RelativeCount++;
+                            break;
+                        }
                     }
+                    i++;
                 }
-                i++;
             }
         }
+
+        /* Linking with EXL_PACK_RELATIVE_RELOCS moves most relative relocations here. */
+        if (relr_size) {
+            s_Stats.m_RelrCount += rtld::apply_relr(aslr_base, (Elf_Relr *)relr, relr_size);
+        }
+
+        s_Stats.m_Ticks = ReadTick() - start_tick;
     }
 };
\ No newline at end of file
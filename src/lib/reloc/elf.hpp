@@ -1,6 +1,7 @@
 #pragma once
 
 #include <elf.h>
+#include <stddef.h>
 
 /* TODO: 32-bit support? */
 typedef Elf64_Addr Elf_Addr;
@@ -9,14 +10,37 @@ typedef Elf64_Rela Elf_Rela;
 typedef Elf64_Dyn Elf_Dyn;
 typedef Elf64_Sym Elf_Sym;
 typedef Elf64_Xword Elf_Xword;
+typedef Elf64_Xword Elf_Relr;
 
 #define ELF_R_SYM ELF64_R_SYM
 #define ELF_R_TYPE ELF64_R_TYPE
 #define ELF_ST_BIND ELF64_ST_BIND
 #define ELF_ST_VISIBILITY ELF64_ST_VISIBILITY
 
+#ifndef DT_GNU_HASH
+#define DT_GNU_HASH 0x6ffffef5
+#endif
+
+#ifndef DT_RELR
+#define DT_RELRSZ 35
+#define DT_RELR 36
+#define DT_RELRENT 37
+#endif
+
 #define ARCH_RELATIVE R_AARCH64_RELATIVE
 #define ARCH_JUMP_SLOT R_AARCH64_JUMP_SLOT
 #define ARCH_GLOB_DAT R_AARCH64_GLOB_DAT
 #define ARCH_IS_REL_ABSOLUTE(type) \
     type == R_AARCH64_ABS32 || type == R_AARCH64_ABS64
+
+namespace exl::reloc {
+    struct Stats {
+        uint64_t m_Ticks;
+        size_t m_RelativeCount;
+        /* Slots relocated through DT_RELR. */
+        size_t m_RelrCount;
+    };
+
+    /* What exl_dynamic did when relocating this module on startup. */
+    const Stats& GetStats();
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "elf.hpp"
+
+// Bulk application of relative relocations, shared by exl_dynamic and
+// ModuleObject::Relocate. exl_dynamic runs before this module is relocated,
+// so everything here has to be inlined and must not touch global data.
+//
+// The relocated slots are spread all over the module, so the stores can't
+// be vectorized. What is saved is the per entry switch: a RELATIVE entry has
+// no symbol, so its whole r_info equals the type, and four entries are
+// checked with a single branch.
+
+namespace rtld {
+
+// Applies the run of RELATIVE entries at the start of entries, returns how
+// many there were.
+static inline __attribute__((always_inline)) size_t
+apply_relative_rela(Elf_Addr base, const Elf_Rela *entries, size_t count) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const Elf_Rela *e = &entries[i];
+        if ((e[0].r_info ^ ARCH_RELATIVE) | (e[1].r_info ^ ARCH_RELATIVE) |
+            (e[2].r_info ^ ARCH_RELATIVE) | (e[3].r_info ^ ARCH_RELATIVE)) {
+            break;
+        }
+
+        *(Elf_Addr *)(base + e[0].r_offset) = base + e[0].r_addend;
+        *(Elf_Addr *)(base + e[1].r_offset) = base + e[1].r_addend;
+        *(Elf_Addr *)(base + e[2].r_offset) = base + e[2].r_addend;
+        *(Elf_Addr *)(base + e[3].r_offset) = base + e[3].r_addend;
+    }
+
+    for (; i < count && entries[i].r_info == ARCH_RELATIVE; i++) {
+        *(Elf_Addr *)(base + entries[i].r_offset) = base + entries[i].r_addend;
+    }
+
+    return i;
+}
+
+static inline __attribute__((always_inline)) size_t
+apply_relative_rel(Elf_Addr base, const Elf_Rel *entries, size_t count) {
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const Elf_Rel *e = &entries[i];
+        if ((e[0].r_info ^ ARCH_RELATIVE) | (e[1].r_info ^ ARCH_RELATIVE) |
+            (e[2].r_info ^ ARCH_RELATIVE) | (e[3].r_info ^ ARCH_RELATIVE)) {
+            break;
+        }
+
+        *(Elf_Addr *)(base + e[0].r_offset) += base;
+        *(Elf_Addr *)(base + e[1].r_offset) += base;
+        *(Elf_Addr *)(base + e[2].r_offset) += base;
+        *(Elf_Addr *)(base + e[3].r_offset) += base;
+    }
+
+    for (; i < count && entries[i].r_info == ARCH_RELATIVE; i++) {
+        *(Elf_Addr *)(base + entries[i].r_offset) += base;
+    }
+
+    return i;
+}
+
+// Applies every RELATIVE entry, other types are left to the caller. Returns
+// how many were applied.
+static inline __attribute__((always_inline)) size_t
+apply_all_relative_rela(Elf_Addr base, const Elf_Rela *entries,
+                        size_t count) {
+    size_t applied = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t run = apply_relative_rela(base, &entries[i], count - i);
+        applied += run;
+        i += run;
+    }
+    return applied;
+}
+
+static inline __attribute__((always_inline)) size_t
+apply_all_relative_rel(Elf_Addr base, const Elf_Rel *entries, size_t count) {
+    size_t applied = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t run = apply_relative_rel(base, &entries[i], count - i);
+        applied += run;
+        i += run;
+    }
+    return applied;
+}
+
+// DT_RELR: an even entry is the address of a slot to relocate, each odd entry
+// after it is a bitmap of which of the following 63 slots to relocate too.
+// Returns how many slots were relocated.
+static inline __attribute__((always_inline)) size_t
+apply_relr(Elf_Addr base, const Elf_Relr *entries, size_t size) {
+    constexpr size_t bitmap_slots = sizeof(Elf_Relr) * 8 - 1;
+
+    size_t applied = 0;
+    Elf_Addr *where = nullptr;
+
+    for (size_t i = 0; i < size / sizeof(Elf_Relr); i++) {
+        Elf_Relr entry = entries[i];
+
+        if ((entry & 1) == 0) {
+            where = (Elf_Addr *)(base + entry);
+            *where++ += base;
+            applied++;
+            continue;
+        }
+
+        for (size_t slot = 0; (entry >>= 1) != 0; slot++) {
+            if (entry & 1) {
+                where[slot] += base;
+                applied++;
+            }
+        }
+        where += bitmap_slots;
+    }
+
+    return applied;
+}
+
+}  // namespace rtld
@@ -16,6 +16,11 @@ extern "C" void __rtld_runtime_resolve(void);
 
 namespace rtld {
     Elf_Addr lookup_global_auto(const char *name);
+    Elf_Addr lookup_global_auto(const char *name, const SymbolNameHash &hash);
+
+    // drops anything cached about the module, has to be called before it's
+    // unloaded if symbols were ever looked up in it
+    void forget_module(const ModuleObject *module);
 }
 
 namespace nn::ro::detail {
@@ -2,12 +2,116 @@
 
 #include <string.h>
 
+#include <atomic>
+
+#include "lib/reloc/relative.hpp"
 #include "lib/reloc/rtld.hpp"
 #include "lib/diag/assert.hpp"
 #include "utils.hpp"
 
 namespace rtld {
 
+// ModuleObject has to keep the system rtld's layout, so the parsed DT_GNU_HASH
+// table of a module is kept here instead. Entries are only published once
+// fully written, lazy binding can look symbols up from any thread. A module
+// that is unloaded (a lazily bound plugin) has its entry cleared by
+// forget_module, and the next module to be added takes the freed slot, so hot
+// reloading plugins doesn't run out of slots. forget_module is only called once
+// nothing looks symbols up in the module anymore, so no lookup still uses the
+// slot when it's rewritten.
+struct GnuHashTable {
+    std::atomic<const ModuleObject *> module;
+    uint32_t nbucket;
+    uint32_t symoffset;
+    uint32_t bloom_size; // in words, always a power of two
+    uint32_t bloom_shift;
+    const Elf_Addr *bloom;
+    const uint32_t *buckets; // null if the module has no DT_GNU_HASH
+    const uint32_t *chain;
+};
+
+static constexpr int GNU_HASH_TABLE_COUNT = 32;
+static GnuHashTable g_gnu_hash_tables[GNU_HASH_TABLE_COUNT];
+// highest slot ever taken plus one, lookups don't look past it
+static std::atomic<int> g_gnu_hash_table_count;
+
+// marks a slot that is being filled in, no lookup ever matches it
+static const ModuleObject *const CLAIMED_GNU_HASH_TABLE =
+    reinterpret_cast<const ModuleObject *>(1);
+
+static const GnuHashTable *GetGnuHashTable(const ModuleObject *module) {
+    int count = g_gnu_hash_table_count.load(std::memory_order_acquire);
+
+    for (int i = 0; i < count; i++) {
+        if (g_gnu_hash_tables[i].module.load(std::memory_order_acquire) ==
+            module) {
+            return &g_gnu_hash_tables[i];
+        }
+    }
+
+    // racing threads may both add the same module, which is harmless
+    GnuHashTable *table = nullptr;
+    int index = 0;
+    for (; index < GNU_HASH_TABLE_COUNT; index++) {
+        const ModuleObject *expected = nullptr;
+        if (g_gnu_hash_tables[index].module.compare_exchange_strong(
+                expected, CLAIMED_GNU_HASH_TABLE, std::memory_order_acq_rel)) {
+            table = &g_gnu_hash_tables[index];
+            break;
+        }
+    }
+
+    // full, the caller falls back to walking the SysV hash table
+    if (table == nullptr) {
+        return nullptr;
+    }
+
+    // the count has to cover the slot before the module is published in it
+    int used = g_gnu_hash_table_count.load(std::memory_order_relaxed);
+    while (used <= index &&
+           !g_gnu_hash_table_count.compare_exchange_weak(
+               used, index + 1, std::memory_order_acq_rel)) {
+    }
+
+    uint32_t *hash_table = nullptr;
+    for (Elf_Dyn *dynamic = module->dynamic; dynamic->d_tag != DT_NULL;
+         dynamic++) {
+        if (dynamic->d_tag == DT_GNU_HASH) {
+            hash_table = (uint32_t *)(module->module_base + dynamic->d_un.d_val);
+            break;
+        }
+    }
+
+    table->buckets = nullptr;
+
+    if (hash_table) {
+        table->nbucket = hash_table[0];
+        table->symoffset = hash_table[1];
+        table->bloom_size = hash_table[2];
+        table->bloom_shift = hash_table[3];
+        table->bloom = (const Elf_Addr *)&hash_table[4];
+        table->buckets = (const uint32_t *)&table->bloom[table->bloom_size];
+        table->chain = &table->buckets[table->nbucket];
+    }
+
+    table->module.store(module, std::memory_order_release);
+    return table;
+}
+
+void forget_module(const ModuleObject *module) {
+    int count = g_gnu_hash_table_count.load(std::memory_order_acquire);
+
+    // racing adds can leave the module in more than one slot, free all of them
+    for (int i = 0; i < count; i++) {
+        const ModuleObject *expected = module;
+        g_gnu_hash_tables[i].module.compare_exchange_strong(
+            expected, nullptr, std::memory_order_acq_rel);
+    }
+}
+
+SymbolNameHash::SymbolNameHash(const char *name)
+    : elf_hash(__rtld_elf_hash(name)), gnu_hash(__rtld_gnu_hash(name)) {}
+
 void ModuleObject::Initialize(char *aslr_base, Elf_Dyn *dynamic) {
 #ifdef __RTLD_6XX__
     this->nro_size = 0;
@@ -162,45 +266,85 @@ void ModuleObject::Initialize(char *aslr_base, Elf_Dyn *dynamic) {
 }
 
 void ModuleObject::Relocate() {
+    Elf_Addr base = (Elf_Addr)this->module_base;
+
+    // DT_RELCOUNT/DT_RELACOUNT entries are all RELATIVE
     if (this->rel_count) {
-        for (auto i = 0u; i < this->rel_count; i++) {
-            Elf_Rel *entry = &this->rela_or_rel.rel[i];
-            switch (ELF_R_TYPE(entry->r_info)) {
-                case ARCH_RELATIVE: {
-                    Elf_Addr *ptr =
-                        (Elf_Addr *)(this->module_base + entry->r_offset);
-                    *ptr += (Elf_Addr)this->module_base;
-                    break;
-                }
-            }
-        }
+        apply_all_relative_rel(base, this->rela_or_rel.rel, this->rel_count);
     }
 
     if (this->rela_count) {
-        for (auto i = 0u; i < this->rela_count; i++) {
-            Elf_Rela *entry = &this->rela_or_rel.rela[i];
-            switch (ELF_R_TYPE(entry->r_info)) {
-                case ARCH_RELATIVE: {
-                    Elf_Addr *ptr =
-                        (Elf_Addr *)(this->module_base + entry->r_offset);
-                    *ptr = (Elf_Addr)this->module_base + entry->r_addend;
-                    break;
-                }
-            }
+        apply_all_relative_rela(base, this->rela_or_rel.rela,
+                                this->rela_count);
+    }
+
+    // there's no room in the struct for DT_RELR, it's only needed here
+    const Elf_Relr *relr = nullptr;
+    Elf_Xword relr_size = 0;
+    for (Elf_Dyn *dynamic = this->dynamic; dynamic->d_tag != DT_NULL;
+         dynamic++) {
+        if (dynamic->d_tag == DT_RELR) {
+            relr = (const Elf_Relr *)(this->module_base + dynamic->d_un.d_val);
+        } else if (dynamic->d_tag == DT_RELRSZ) {
+            relr_size = dynamic->d_un.d_val;
         }
     }
+
+    if (relr) {
+        apply_relr(base, relr, relr_size);
+    }
 }
 
-Elf_Sym *ModuleObject::GetSymbolByName(const char *name) {
-    unsigned long name_hash = __rtld_elf_hash(name);
-
-    for (uint32_t i = this->hash_bucket[name_hash % this->hash_nbucket_value];
-         i; i = this->hash_chain[i]) {
-        bool is_common = this->dynsym[i].st_shndx
-                             ? this->dynsym[i].st_shndx == SHN_COMMON
-                             : true;
-        if (!is_common &&
-            strcmp(name, this->dynstr + this->dynsym[i].st_name) == 0) {
+static inline bool IsSymbolMatch(const ModuleObject *module, uint32_t index,
+                                 const char *name) {
+    const Elf_Sym *symbol = &module->dynsym[index];
+    bool is_common =
+        symbol->st_shndx ? symbol->st_shndx == SHN_COMMON : true;
+    return !is_common && strcmp(name, module->dynstr + symbol->st_name) == 0;
+}
+
+Elf_Sym *ModuleObject::GetSymbolByGnuHash(const char *name, uint32_t hash,
+                                          const GnuHashTable *table) {
+    constexpr uint32_t word_bits = sizeof(Elf_Addr) * 8;
+
+    // most lookups are for symbols the module doesn't have, the bloom filter
+    // turns those away without touching the buckets or the string table
+    Elf_Addr word = table->bloom[(hash / word_bits) & (table->bloom_size - 1)];
+    Elf_Addr mask = ((Elf_Addr)1 << (hash % word_bits)) |
+                    ((Elf_Addr)1 << ((hash >> table->bloom_shift) % word_bits));
+    if ((word & mask) != mask) {
+        return nullptr;
+    }
+
+    uint32_t i = table->buckets[hash % table->nbucket];
+    if (i < table->symoffset) {
+        return nullptr;
+    }
+
+    // chains hold the hashes of their symbols with the lowest bit marking the
+    // end, so names are only compared when the full hash matches
+    for (;; i++) {
+        uint32_t chain_hash = table->chain[i - table->symoffset];
+        if ((chain_hash | 1) == (hash | 1) && IsSymbolMatch(this, i, name)) {
+            return &this->dynsym[i];
+        }
+        if (chain_hash & 1) {
+            break;
+        }
+    }
+
+    return nullptr;
+}
+
+Elf_Sym *ModuleObject::GetSymbolByElfHash(const char *name,
+                                          unsigned long hash) {
+    if (!this->hash_bucket) {
+        return nullptr;
+    }
+
+    for (uint32_t i = this->hash_bucket[hash % this->hash_nbucket_value]; i;
+         i = this->hash_chain[i]) {
+        if (IsSymbolMatch(this, i, name)) {
             return &this->dynsym[i];
         }
     }
@@ -208,12 +352,27 @@ Elf_Sym *ModuleObject::GetSymbolByName(const char *name) {
     return nullptr;
 }
 
+Elf_Sym *ModuleObject::GetSymbolByName(const char *name) {
+    return this->GetSymbolByName(name, SymbolNameHash(name));
+}
+
+Elf_Sym *ModuleObject::GetSymbolByName(const char *name,
+                                       const SymbolNameHash &hash) {
+    const GnuHashTable *table = GetGnuHashTable(this);
+    if (table && table->buckets) {
+        return this->GetSymbolByGnuHash(name, hash.gnu_hash, table);
+    }
+
+    return this->GetSymbolByElfHash(name, hash.elf_hash);
+}
+
 bool ModuleObject::TryResolveSymbol(Elf_Addr *target_symbol_address,
                                     Elf_Sym *symbol) {
     const char *name = &this->dynstr[symbol->st_name];
+    SymbolNameHash hash(name);
 
     if (ELF_ST_VISIBILITY(symbol->st_other)) {
-        Elf_Sym *target_symbol = this->GetSymbolByName(name);
+        Elf_Sym *target_symbol = this->GetSymbolByName(name, hash);
         if (target_symbol) {
             *target_symbol_address =
                 (Elf_Addr)this->module_base + target_symbol->st_value;
@@ -223,7 +382,7 @@ bool ModuleObject::TryResolveSymbol(Elf_Addr *target_symbol_address,
             return true;
         }
     } else {
-        Elf_Addr address = lookup_global_auto(name);
+        Elf_Addr address = lookup_global_auto(name, hash);
 
         if (address == 0 && ro::g_LookupGlobalManualFunctionPointer) {
             address = ro::g_LookupGlobalManualFunctionPointer(name);
@@ -373,6 +532,10 @@ void ModuleObject::ResolveSymbols(bool do_lazy_got_init) {
         }
     }
 
+    this->InstallLazyResolver();
+}
+
+void ModuleObject::InstallLazyResolver() {
     if (this->got) {
         this->got[1] = this;
         this->got[2] = (void *)__rtld_runtime_resolve;
@@ -9,9 +9,22 @@
 
 namespace rtld {
 
+// both hashes of a symbol name, so a lookup going through every module only
+// hashes the name once instead of once per module.
+struct SymbolNameHash {
+    unsigned long elf_hash;
+    uint32_t gnu_hash;
+
+    explicit SymbolNameHash(const char *name);
+};
+
 struct ModuleObject {
 
    private:
+    Elf_Sym *GetSymbolByGnuHash(const char *name, uint32_t hash,
+                                const struct GnuHashTable *table);
+    Elf_Sym *GetSymbolByElfHash(const char *name, unsigned long hash);
+
     // ResolveSymbols internals
     inline void ResolveSymbolRelAbsolute(Elf_Rel *entry);
     inline void ResolveSymbolRelaAbsolute(Elf_Rela *entry);
@@ -59,7 +72,11 @@ struct ModuleObject {
     void Initialize(char *aslr_base, Elf_Dyn *dynamic);
     void Relocate();
     Elf_Sym *GetSymbolByName(const char *name);
+    Elf_Sym *GetSymbolByName(const char *name, const SymbolNameHash &hash);
     void ResolveSymbols(bool do_lazy_got_init);
+    // points the PLT's resolver at __rtld_runtime_resolve, so pending jump
+    // slots are bound by us on their first call
+    void InstallLazyResolver();
     bool TryResolveSymbol(Elf_Addr *target_symbol_address, Elf_Sym *symbol);
 };
 
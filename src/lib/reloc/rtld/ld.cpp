@@ -1,15 +1,31 @@
 #include "lib/reloc/rtld.hpp"
+#include "lib/util/symbols.hpp"
 #include "utils.hpp"
 
 Elf_Addr rtld::lookup_global_auto(const char *name) {
+    return lookup_global_auto(name, SymbolNameHash(name));
+}
+
+Elf_Addr rtld::lookup_global_auto(const char *name,
+                                  const SymbolNameHash &hash) {
     if (ro::g_pAutoLoadList.back == (ModuleObject *)&ro::g_pAutoLoadList) {
         return 0;
     }
 
+    // auto load modules are never unloaded, so cached addresses never need
+    // to be invalidated
+    using exl::util::symbols::Scope;
+    Elf_Addr address = exl::util::symbols::Find(name, Scope::AutoLoad);
+    if (address) {
+        return address;
+    }
+
     for (ModuleObject *module : ro::g_pAutoLoadList) {
-        Elf_Sym *symbol = module->GetSymbolByName(name);
+        Elf_Sym *symbol = module->GetSymbolByName(name, hash);
         if (symbol && ELF_ST_BIND(symbol->st_info)) {
-            return (Elf_Addr)module->module_base + symbol->st_value;
+            address = (Elf_Addr)module->module_base + symbol->st_value;
+            exl::util::symbols::Insert(name, Scope::AutoLoad, address);
+            return address;
         }
     }
     return 0;
@@ -10,4 +10,12 @@ extern "C" unsigned long __rtld_elf_hash(const char *name) {
         h &= ~g;
     }
     return h;
-}
\ No newline at end of file
+}
+extern "C" uint32_t __rtld_gnu_hash(const char *name) {
+    uint32_t h = 5381;
+
+    while (*name) {
+        h = (h << 5) + h + (unsigned char)*name++;
+    }
+    return h;
+}
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <stdint.h>
+
 extern "C" unsigned long __rtld_elf_hash(const char *name);
+extern "C" uint32_t __rtld_gnu_hash(const char *name);
 
 inline void print_unresolved_symbol(const char *name) {
     /* TODO */
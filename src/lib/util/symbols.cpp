@@ -0,0 +1,158 @@
+#include "symbols.hpp"
+
+#include "program/setting.hpp"
+#include <atomic>
+#include <bit>
+#include <nn/ro.h>
+
+namespace exl::util::symbols {
+
+    /* Open addressed table of names to addresses. A name is identified by two independent hashes, so a */
+    /* collision has to hit both 64 bits of fnv-1a and a second 32 bit hash of a name of the same length. */
+    /* Slots are never handed to another name once taken, invalidating only clears the address. That keeps */
+    /* lookups lock-free, rtld binds lazily from any thread. Once every slot is taken the table is sealed and */
+    /* names that don't already have a slot are simply not cached. */
+    namespace {
+        struct Key {
+            u64 m_Hash;
+            /* Name length in the upper half, a polynomial hash in the lower one. Never 0. */
+            u64 m_Check;
+        };
+
+        struct Slot {
+            /* Claimed first to pick the slot, then the slot belongs to whoever sets the check. */
+            std::atomic<u64> m_Hash;
+            std::atomic<u64> m_Check;
+            /* 0 while the name isn't resolved, or after its module was invalidated. */
+            std::atomic<uintptr_t> m_Address;
+        };
+
+        static_assert(std::has_single_bit(setting::SymbolCacheSize), "");
+
+        constexpr size_t MaxProbeCount = 16;
+
+        Slot s_Slots[setting::SymbolCacheSize] {};
+        std::atomic<size_t> s_UsedSlots = 0;
+        std::atomic<size_t> s_Hits = 0;
+        std::atomic<size_t> s_Misses = 0;
+
+        Key HashName(const char* name, Scope scope) {
+            /* fnv-1a, seeded with the scope so every scope gets its own entries. */
+            u64 hash = 0xCBF29CE484222325 ^ static_cast<u64>(scope);
+            u32 check = 0x3C6EF372;
+            u32 length = 0;
+            for(const char* c = name; *c != '\0'; c++, length++) {
+                hash ^= static_cast<u8>(*c);
+                hash *= 0x100000001B3;
+                check = check * 31 + static_cast<u8>(*c);
+            }
+
+            return {
+                .m_Hash = hash != 0 ? hash : 1,
+                .m_Check = (static_cast<u64>(length) << 32) | (check != 0 ? check : 1),
+            };
+        }
+
+        /* Takes the slot for the key if nobody has yet, true if the slot is the key's. */
+        bool ClaimCheck(Slot& slot, u64 check) {
+            u64 slot_check = 0;
+            if(slot.m_Check.compare_exchange_strong(slot_check, check, std::memory_order_acq_rel)) {
+                s_UsedSlots.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            return slot_check == check;
+        }
+
+        Slot* FindSlot(const Key& key, bool is_insert) {
+            constexpr size_t mask = setting::SymbolCacheSize - 1;
+            size_t index = (key.m_Hash ^ (key.m_Hash >> 32)) & mask;
+
+            for(size_t i = 0; i < MaxProbeCount; i++, index = (index + 1) & mask) {
+                Slot& slot = s_Slots[index];
+                u64 slot_hash = slot.m_Hash.load(std::memory_order_acquire);
+
+                if(slot_hash == key.m_Hash) {
+                    u64 slot_check = slot.m_Check.load(std::memory_order_acquire);
+                    if(slot_check == key.m_Check)
+                        return &slot;
+                    /* Still being claimed, possibly for this very name. */
+                    if(slot_check == 0 && is_insert && ClaimCheck(slot, key.m_Check))
+                        return &slot;
+                    /* Otherwise another name with the same fnv hash owns it. */
+                    continue;
+                }
+
+                if(slot_hash == 0) {
+                    if(!is_insert)
+                        return nullptr;
+
+                    /* Another thread may take the slot first, in which case it might even be for the same name. */
+                    if((slot.m_Hash.compare_exchange_strong(slot_hash, key.m_Hash, std::memory_order_acq_rel) || slot_hash == key.m_Hash) &&
+                       ClaimCheck(slot, key.m_Check))
+                        return &slot;
+                }
+            }
+
+            return nullptr;
+        }
+    }
+
+    uintptr_t Find(const char* name, Scope scope) {
+        Slot* slot = FindSlot(HashName(name, scope), false);
+        uintptr_t address = slot != nullptr ? slot->m_Address.load(std::memory_order_acquire) : 0;
+
+        (address != 0 ? s_Hits : s_Misses).fetch_add(1, std::memory_order_relaxed);
+        return address;
+    }
+
+    void Insert(const char* name, Scope scope, uintptr_t address) {
+        if(address == 0)
+            return;
+
+        Slot* slot = FindSlot(HashName(name, scope), true);
+        if(slot != nullptr)
+            slot->m_Address.store(address, std::memory_order_release);
+    }
+
+    nn::Result LookupSymbol(uintptr_t* out, const char* name) {
+        uintptr_t address = Find(name, Scope::Ro);
+        if(address != 0) {
+            *out = address;
+            return nn::Result();
+        }
+
+        nn::Result result = nn::ro::LookupSymbol(&address, name);
+        if(result.isSuccess()) {
+            Insert(name, Scope::Ro, address);
+            *out = address;
+        }
+        return result;
+    }
+
+    void InvalidateRange(uintptr_t start, uintptr_t end) {
+        for(Slot& slot : s_Slots) {
+            uintptr_t address = slot.m_Address.load(std::memory_order_relaxed);
+            if(start <= address && address < end)
+                slot.m_Address.compare_exchange_strong(address, 0, std::memory_order_release, std::memory_order_relaxed);
+        }
+    }
+
+    void Invalidate() {
+        for(Slot& slot : s_Slots)
+            slot.m_Address.store(0, std::memory_order_release);
+    }
+
+    Stats GetStats() {
+        return {
+            .m_Hits = s_Hits.load(std::memory_order_relaxed),
+            .m_Misses = s_Misses.load(std::memory_order_relaxed),
+            .m_UsedSlots = s_UsedSlots.load(std::memory_order_relaxed),
+            .m_TotalSlots = setting::SymbolCacheSize,
+        };
+    }
+
+    void ResetStats() {
+        s_Hits = 0;
+        s_Misses = 0;
+    }
+}
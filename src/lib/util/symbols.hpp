@@ -0,0 +1,40 @@
+#pragma once
+
+#include <common.hpp>
+#include <nn/result.h>
+
+namespace exl::util::symbols {
+
+    /* Where a lookup searched, the same name can resolve differently depending on it. */
+    enum class Scope : u8 {
+        /* Every loaded module, as searched by nn::ro::LookupSymbol. */
+        Ro,
+        /* Only the auto load list, as searched by rtld when binding our own imports. */
+        AutoLoad,
+    };
+
+    struct Stats {
+        size_t m_Hits;
+        size_t m_Misses;
+        size_t m_UsedSlots;
+        size_t m_TotalSlots;
+    };
+
+    /* Looks up a cached address for the name, 0 if it isn't cached. */
+    uintptr_t Find(const char* name, Scope scope);
+
+    /* Remembers where the name resolved to. Unresolved names are never cached, a module loaded later may provide them. */
+    void Insert(const char* name, Scope scope, uintptr_t address);
+
+    /* nn::ro::LookupSymbol, served from the cache when possible. */
+    nn::Result LookupSymbol(uintptr_t* out, const char* name);
+
+    /* Forgets every address inside [start, end), has to be called before a module in that range is unloaded or replaced. */
+    void InvalidateRange(uintptr_t start, uintptr_t end);
+
+    /* Forgets every address. */
+    void Invalidate();
+
+    Stats GetStats();
+    void ResetStats();
+}
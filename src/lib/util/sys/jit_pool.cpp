@@ -0,0 +1,148 @@
+#include "jit_pool.hpp"
+
+#include "lib/util/sys/cur_proc_handle.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace exl::util {
+
+    void JitPool::Initialize() {
+        /* The static area is always the first page. */
+        Page& page = m_PageList[0];
+        page.m_Rx = m_Base.GetRo();
+        page.m_Rw = m_Base.GetRw();
+        page.m_Size = m_Base.GetSize();
+        page.m_Backing = nullptr;
+        page.m_RxReserve = nullptr;
+
+        m_PageCount = 1;
+        m_NextUnused = 0;
+        m_TotalSlots = page.m_Size / m_SlotSize;
+    }
+
+    const JitPool::Page* JitPool::FindPage(uintptr_t rx) const {
+        for(size_t i = 0; i < m_PageCount; i++) {
+            const Page& page = m_PageList[i];
+            if(page.m_Rx <= rx && rx < page.m_Rx + page.m_Size)
+                return &page;
+        }
+        return nullptr;
+    }
+
+    uintptr_t JitPool::RxToRw(uintptr_t rx) const {
+        const Page* page = FindPage(rx);
+        EXL_ASSERT(page != nullptr);
+        return page->m_Rw + (rx - page->m_Rx);
+    }
+
+    /* Pages have to stay within branch range of the module, as hooks jump between pools and into the module with a plain B/BL. */
+    static uintptr_t FindNearbyUnmapped(uintptr_t start, size_t size) {
+        const uintptr_t limit = start + setting::JitMaxDistance;
+
+        MemoryInfo meminfo {
+            .addr = start
+        };
+        u32 pageinfo;
+
+        while(meminfo.addr < limit) {
+            if(R_FAILED(svcQueryMemory(&meminfo, &pageinfo, meminfo.addr)))
+                return 0;
+
+            uintptr_t rangeStart = std::max<uintptr_t>(meminfo.addr, start);
+            uintptr_t rangeEnd = meminfo.addr + meminfo.size;
+            if(meminfo.type == MemType_Unmapped && rangeStart + size <= std::min(rangeEnd, limit))
+                return rangeStart;
+
+            meminfo.addr = rangeEnd;
+        }
+
+        return 0;
+    }
+
+    bool JitPool::Grow() {
+        if(m_PageCount >= setting::JitMaxPages)
+            return false;
+
+        /* Heap memory can't be made executable directly, so it gets mapped as code memory somewhere else. */
+        void* backing = aligned_alloc(PAGE_SIZE, m_GrowSize);
+        if(backing == nullptr)
+            return false;
+
+        auto procHandle = proc_handle::Get();
+
+        virtmemLock();
+        uintptr_t rx = FindNearbyUnmapped(m_Base.GetRo(), m_GrowSize);
+        VirtmemReservation* reserve = rx != 0 ? virtmemAddReservation((void*) rx, m_GrowSize) : nullptr;
+        virtmemUnlock();
+
+        if(reserve == nullptr) {
+            free(backing);
+            return false;
+        }
+
+        if(R_FAILED(svcMapProcessCodeMemory(procHandle, rx, (u64) backing, m_GrowSize))) {
+            virtmemLock();
+            virtmemRemoveReservation(reserve);
+            virtmemUnlock();
+            free(backing);
+            return false;
+        }
+
+        /* Once mapped, the backing memory is owned by the code mapping until the page is unmapped, which never happens. */
+        R_ABORT_UNLESS(svcSetProcessMemoryPermission(procHandle, rx, m_GrowSize, Perm_Rx));
+
+        Page& page = m_PageList[m_PageCount];
+        util::ConstructAt(page.m_Pages, rx, m_GrowSize);
+        page.m_Rx = rx;
+        page.m_Rw = util::GetReference(page.m_Pages).GetRw();
+        page.m_Size = m_GrowSize;
+        page.m_Backing = backing;
+        page.m_RxReserve = reserve;
+
+        m_PageCount++;
+        m_NextUnused = 0;
+        m_TotalSlots += page.m_Size / m_SlotSize;
+        return true;
+    }
+
+    bool JitPool::Allocate(Slot* out) {
+        /* Reuse freed slots first. */
+        if(m_FreeHead != 0) {
+            uintptr_t rx = m_FreeHead;
+            uintptr_t rw = RxToRw(rx);
+            m_FreeHead = *reinterpret_cast<uintptr_t*>(rw);
+
+            *out = { rx, rw };
+            m_UsedSlots++;
+            return true;
+        }
+
+        const Page* page = &m_PageList[m_PageCount - 1];
+        if(m_NextUnused + m_SlotSize > page->m_Size) {
+            if(!Grow())
+                return false;
+            page = &m_PageList[m_PageCount - 1];
+        }
+
+        *out = { page->m_Rx + m_NextUnused, page->m_Rw + m_NextUnused };
+        m_NextUnused += m_SlotSize;
+        m_UsedSlots++;
+        return true;
+    }
+
+    void JitPool::Free(uintptr_t rx) {
+        *reinterpret_cast<uintptr_t*>(RxToRw(rx)) = m_FreeHead;
+        m_FreeHead = rx;
+        m_UsedSlots--;
+    }
+
+    JitPool::Stats JitPool::GetStats() const {
+        return {
+            .m_SlotSize = m_SlotSize,
+            .m_UsedSlots = m_UsedSlots,
+            .m_TotalSlots = m_TotalSlots,
+            .m_PageCount = m_PageCount,
+            .m_MaxPages = setting::JitMaxPages,
+        };
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "common.hpp"
+#include "program/setting.hpp"
+#include "lib/util/typed_storage.hpp"
+#include "jit.hpp"
+#include "rw_pages.hpp"
+
+namespace exl::util {
+
+    /* Fixed size slot allocator over executable memory. */
+    /* Slots are first carved out of a static JIT area, once that is used up more code pages are mapped from the heap. */
+    /* Freed slots are kept in a free-list and handed out again before the pool grows. */
+    class JitPool {
+        NON_COPYABLE(JitPool);
+        NON_MOVEABLE(JitPool);
+
+        public:
+        struct Slot {
+            uintptr_t m_Rx;
+            uintptr_t m_Rw;
+        };
+
+        struct Stats {
+            size_t m_SlotSize;
+            size_t m_UsedSlots;
+            size_t m_TotalSlots;
+            size_t m_PageCount;
+            size_t m_MaxPages;
+        };
+
+        private:
+        struct Page {
+            uintptr_t m_Rx;
+            uintptr_t m_Rw;
+            size_t m_Size;
+            /* Only used by pages mapped at runtime, the static area is mapped by its Jit. */
+            util::TypedStorage<RwPages> m_Pages;
+            void* m_Backing;
+            VirtmemReservation* m_RxReserve;
+        };
+
+        Jit& m_Base;
+        size_t m_SlotSize;
+        size_t m_GrowSize;
+
+        Page m_PageList[setting::JitMaxPages] {};
+        size_t m_PageCount = 0;
+
+        /* Slots past this offset in the last page have never been handed out. */
+        size_t m_NextUnused = 0;
+        /* Rx address of the first free slot, the link to the next one is stored in the slot itself. */
+        uintptr_t m_FreeHead = 0;
+
+        size_t m_UsedSlots = 0;
+        size_t m_TotalSlots = 0;
+
+        const Page* FindPage(uintptr_t rx) const;
+        bool Grow();
+
+        public:
+        constexpr JitPool(Jit& base, size_t slot_size, size_t grow_size) : m_Base(base), m_SlotSize(ALIGN_UP(slot_size, 8)), m_GrowSize(ALIGN_UP(grow_size, PAGE_SIZE)) {}
+
+        /* The base Jit must already be initialized. */
+        void Initialize();
+
+        bool Allocate(Slot* out);
+        void Free(uintptr_t rx);
+
+        bool Contains(uintptr_t rx) const { return FindPage(rx) != nullptr; }
+        uintptr_t RxToRw(uintptr_t rx) const;
+        Stats GetStats() const;
+
+        /* Calls the callback with every slot that was ever handed out, including ones currently free. */
+        template<typename Callback>
+        void ForEachSlot(Callback callback) const {
+            for(size_t i = 0; i < m_PageCount; i++) {
+                const Page& page = m_PageList[i];
+                size_t end = i == m_PageCount - 1 ? m_NextUnused : page.m_Size - (page.m_Size % m_SlotSize);
+
+                for(size_t offset = 0; offset < end; offset += m_SlotSize)
+                    callback(Slot { page.m_Rx + offset, page.m_Rw + offset });
+            }
+        }
+    };
+}
@@ -0,0 +1,215 @@
+#include "DeferredLog.h"
+#include "util.h"
+
+#include <algorithm>
+
+namespace DeferredLog {
+
+    namespace {
+        struct Arg {
+            u8 mTag = 0;
+            u64 mBits = 0;
+            double mFloat = 0;
+            const char* mStr = nullptr;
+
+            s64 asInt() const { return mTag == cArgFloat ? (s64)mFloat : (s64)mBits; }
+            double asFloat() const { return mTag == cArgFloat ? mFloat : (double)(s64)mBits; }
+            const char* asString() const { return mTag == cArgString ? mStr : "(bad arg)"; }
+        };
+
+        class ArgReader {
+            const char* mRecord;
+            size_t mSize;
+            size_t mPos = sizeof(u64);
+
+        public:
+            ArgReader(const char* record, size_t size) : mRecord(record), mSize(size) {}
+
+            bool next(Arg* out) {
+                if(mPos >= mSize)
+                    return false;
+
+                out->mTag = mRecord[mPos++];
+
+                if(out->mTag == cArgString) {
+                    u16 len;
+                    if(mPos + sizeof(len) > mSize)
+                        return false;
+                    memcpy(&len, mRecord + mPos, sizeof(len));
+                    mPos += sizeof(len);
+
+                    if(mPos + len + 1 > mSize)
+                        return false;
+                    out->mStr = mRecord + mPos; // written with a null terminator
+                    mPos += len + 1;
+                    return true;
+                }
+
+                if(mPos + sizeof(u64) > mSize)
+                    return false;
+                if(out->mTag == cArgFloat)
+                    memcpy(&out->mFloat, mRecord + mPos, sizeof(double));
+                else
+                    memcpy(&out->mBits, mRecord + mPos, sizeof(u64));
+                mPos += sizeof(u64);
+                return true;
+            }
+        };
+
+        bool isFlag(char c) { return c == '-' || c == '+' || c == ' ' || c == '#' || c == '0'; }
+        bool isDigit(char c) { return c >= '0' && c <= '9'; }
+        bool isLength(char c) { return c == 'h' || c == 'l' || c == 'j' || c == 'z' || c == 't' || c == 'L' || c == 'q'; }
+    }
+
+    size_t format(const char* record, size_t recordSize, char* out, size_t outSize) {
+        if(outSize == 0)
+            return 0;
+
+        const char* fmt = reinterpret_cast<const char*>(getFormatId(record));
+        ArgReader reader(record, recordSize);
+        size_t len = 0;
+
+        auto append = [&](const char* str, size_t strLen) {
+            strLen = std::min(strLen, outSize - 1 - len);
+            memcpy(out + len, str, strLen);
+            len += strLen;
+        };
+
+        while (*fmt != '\0' && len < outSize - 1) {
+            const char* specStart = strchr(fmt, '%');
+            if(specStart == nullptr) {
+                append(fmt, strlen(fmt));
+                break;
+            }
+
+            append(fmt, specStart - fmt);
+
+            if(specStart[1] == '%') {
+                append("%", 1);
+                fmt = specStart + 2;
+                continue;
+            }
+
+            // rebuild the specifier with the length swapped out for the type the argument was stored as,
+            // '*' widths are resolved from the arguments here as well
+            char spec[0x20] = "%";
+            size_t specLen = 1;
+            const char* cur = specStart + 1;
+            bool isValid = true;
+
+            auto appendSpec = [&](const char* str, size_t strLen) {
+                strLen = std::min(strLen, sizeof(spec) - 4 - specLen); // room for the length, conversion and terminator
+                memcpy(spec + specLen, str, strLen);
+                specLen += strLen;
+            };
+
+            auto appendStar = [&]() {
+                Arg arg;
+                isValid &= reader.next(&arg);
+                char num[0x10];
+                appendSpec(num, nn::util::SNPrintf(num, sizeof(num), "%d", (s32)arg.asInt()));
+                cur++;
+            };
+
+            const char* flagStart = cur;
+            while (isFlag(*cur)) cur++;
+            appendSpec(flagStart, cur - flagStart);
+
+            if(*cur == '*') {
+                appendStar();
+            } else {
+                const char* widthStart = cur;
+                while (isDigit(*cur)) cur++;
+                appendSpec(widthStart, cur - widthStart);
+            }
+
+            if(*cur == '.') {
+                appendSpec(".", 1);
+                cur++;
+                if(*cur == '*') {
+                    appendStar();
+                } else {
+                    const char* precStart = cur;
+                    while (isDigit(*cur)) cur++;
+                    appendSpec(precStart, cur - precStart);
+                }
+            }
+
+            // arguments are stored as 64 bit, so they're truncated to what the original length would have passed
+            const char* lengthStart = cur;
+            while (isLength(*cur)) cur++;
+            u32 argBits = 32;
+            if(cur - lengthStart == 2 && lengthStart[0] == 'h')
+                argBits = 8;
+            else if(cur - lengthStart == 1 && lengthStart[0] == 'h')
+                argBits = 16;
+            else if(cur != lengthStart)
+                argBits = 64;
+
+            char conv = *cur;
+            if(conv == '\0' || !isValid) {
+                // malformed or out of arguments, output the rest of the format as is
+                append(specStart, strlen(specStart));
+                break;
+            }
+            fmt = cur + 1;
+
+            Arg arg;
+            if(conv != 'n' && !reader.next(&arg)) {
+                append(specStart, fmt - specStart);
+                continue;
+            }
+
+            char part[0x500];
+            s32 partLen = 0;
+
+            switch (conv) {
+            case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': {
+                u64 value = arg.asInt();
+                if(argBits < 64) {
+                    u32 shift = 64 - argBits;
+                    bool isSigned = conv == 'd' || conv == 'i';
+                    value = isSigned ? (u64)((s64)(value << shift) >> shift) : (value << shift) >> shift;
+                }
+                spec[specLen++] = 'l';
+                spec[specLen++] = 'l';
+                spec[specLen++] = conv;
+                spec[specLen] = '\0';
+                partLen = nn::util::SNPrintf(part, sizeof(part), spec, (long long)value);
+                break;
+            }
+            case 'c':
+                spec[specLen++] = conv;
+                spec[specLen] = '\0';
+                partLen = nn::util::SNPrintf(part, sizeof(part), spec, (int)arg.asInt());
+                break;
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                spec[specLen++] = conv;
+                spec[specLen] = '\0';
+                partLen = nn::util::SNPrintf(part, sizeof(part), spec, arg.asFloat());
+                break;
+            case 's':
+                spec[specLen++] = conv;
+                spec[specLen] = '\0';
+                partLen = nn::util::SNPrintf(part, sizeof(part), spec, arg.asString());
+                break;
+            case 'p': case 'P':
+                spec[specLen++] = conv;
+                spec[specLen] = '\0';
+                partLen = nn::util::SNPrintf(part, sizeof(part), spec, (void*)arg.mBits);
+                break;
+            case 'n':
+                break; // never written through
+            default:
+                append(specStart, fmt - specStart);
+                break;
+            }
+
+            if(partLen > 0)
+                append(part, std::min<size_t>(partLen, sizeof(part) - 1));
+        }
+
+        out[len] = '\0';
+        return len;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "types.h"
+#include <cstring>
+#include <type_traits>
+
+// deferred logs store the format string's address and the raw arguments instead of the formatted text.
+// formatting is left to the drain thread, or to the PC when logging over the network in binary mode.
+namespace DeferredLog {
+
+    // only accepts string literals, the format is referenced by address long after the log call returns
+    struct Format {
+        const char* mStr;
+
+        consteval Format(const char* str) : mStr(str) {}
+    };
+
+    enum ArgTag : u8 {
+        cArgInt = 'i',
+        cArgUInt = 'u',
+        cArgFloat = 'f',
+        cArgString = 's',
+        cArgPointer = 'p'
+    };
+
+    // record layout: u64 format address, then every argument as a tag followed by its value.
+    // numbers are 8 bytes, strings are a u16 length followed by the characters and a null terminator.
+    class ArgWriter {
+        char* mBuffer;
+        size_t mCapacity;
+        size_t mSize = 0;
+
+        void writeValue(u8 tag, const void* value, size_t size) {
+            if(mSize + 1 + size > mCapacity) {
+                mSize = mCapacity; // nothing after a truncated argument can be decoded
+                return;
+            }
+
+            mBuffer[mSize++] = tag;
+            memcpy(mBuffer + mSize, value, size);
+            mSize += size;
+        }
+
+        void writeString(const char* str) {
+            if(str == nullptr)
+                str = "(null)";
+
+            constexpr size_t headerSize = 1 + sizeof(u16);
+            if(mSize + headerSize + 1 > mCapacity) {
+                mSize = mCapacity;
+                return;
+            }
+
+            size_t len = strnlen(str, mCapacity - mSize - headerSize - 1);
+            u16 len16 = len;
+
+            mBuffer[mSize++] = cArgString;
+            memcpy(mBuffer + mSize, &len16, sizeof(len16));
+            mSize += sizeof(len16);
+            memcpy(mBuffer + mSize, str, len);
+            mSize += len;
+            mBuffer[mSize++] = '\0';
+        }
+
+    public:
+        ArgWriter(char* buffer, size_t capacity, const char* fmt) : mBuffer(buffer), mCapacity(capacity) {
+            u64 id = reinterpret_cast<uintptr_t>(fmt);
+            memcpy(mBuffer, &id, sizeof(id));
+            mSize = sizeof(id);
+        }
+
+        template <typename T>
+        void write(T value) {
+            if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+                writeString(value);
+            } else if constexpr (std::is_pointer_v<T>) {
+                u64 bits = reinterpret_cast<uintptr_t>(value);
+                writeValue(cArgPointer, &bits, sizeof(bits));
+            } else if constexpr (std::is_enum_v<T>) {
+                write(static_cast<std::underlying_type_t<T>>(value));
+            } else if constexpr (std::is_floating_point_v<T>) {
+                double bits = value;
+                writeValue(cArgFloat, &bits, sizeof(bits));
+            } else if constexpr (std::is_signed_v<T>) {
+                s64 bits = value;
+                writeValue(cArgInt, &bits, sizeof(bits));
+            } else {
+                static_assert(std::is_integral_v<T>, "Unsupported deferred log argument type.");
+                u64 bits = value;
+                writeValue(cArgUInt, &bits, sizeof(bits));
+            }
+        }
+
+        size_t getSize() const { return mSize; }
+    };
+
+    // formats a record written by ArgWriter, returns the length of the text written to out
+    size_t format(const char* record, size_t recordSize, char* out, size_t outSize);
+
+    // reads the format address a record was written with
+    inline u64 getFormatId(const char* record) {
+        u64 id;
+        memcpy(&id, record, sizeof(id));
+        return id;
+    }
+}
@@ -0,0 +1,84 @@
+#include "LogRing.h"
+
+#include <algorithm>
+#include <cstring>
+
+LogRing::LogRing() {
+    for (u32 i = 0; i < cSlotCount; ++i) {
+        mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool LogRing::push(const char* msg, size_t size, u8 severity) {
+    size = std::min(size, cMaxRecordSize);
+    u32 partCount = std::max<u32>((size + cSlotDataSize - 1) / cSlotDataSize, 1);
+
+    u32 pos = mHead.load(std::memory_order_relaxed);
+    while (true) {
+        bool isClaimable = true;
+        bool isFull = false;
+
+        for (u32 i = 0; i < partCount; ++i) {
+            u32 seq = mSlots[(pos + i) & cSlotMask].mSequence.load(std::memory_order_acquire);
+            s32 diff = (s32)(seq - (pos + i));
+            if(diff != 0) {
+                isClaimable = false;
+                // the consumer hasn't gotten to this slot yet, anything else means another producer got here first
+                isFull = diff < 0;
+                break;
+            }
+        }
+
+        if(isFull) {
+            mDropCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if(!isClaimable) {
+            pos = mHead.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if(mHead.compare_exchange_weak(pos, pos + partCount, std::memory_order_relaxed))
+            break;
+    }
+
+    for (u32 i = 0; i < partCount; ++i) {
+        Slot& slot = mSlots[(pos + i) & cSlotMask];
+        size_t offset = i * cSlotDataSize;
+        size_t partSize = std::min(size - offset, cSlotDataSize);
+
+        memcpy(slot.mData, msg + offset, partSize);
+        slot.mSize = partSize;
+        slot.mSeverity = severity;
+        slot.mPartCount = partCount;
+    }
+
+    // publish the tail first, so the consumer never sees a first slot whose other parts are still being written
+    for (u32 i = partCount; i > 0; --i) {
+        mSlots[(pos + i - 1) & cSlotMask].mSequence.store(pos + i, std::memory_order_release);
+    }
+
+    return true;
+}
+
+bool LogRing::pop(char* outBuffer, size_t* outSize, u8* outSeverity) {
+    Slot& first = mSlots[mTail & cSlotMask];
+    if(first.mSequence.load(std::memory_order_acquire) != mTail + 1)
+        return false;
+
+    u32 partCount = first.mPartCount;
+    size_t size = 0;
+
+    for (u32 i = 0; i < partCount; ++i) {
+        Slot& slot = mSlots[(mTail + i) & cSlotMask];
+        memcpy(outBuffer + size, slot.mData, slot.mSize);
+        size += slot.mSize;
+        slot.mSequence.store(mTail + i + cSlotCount, std::memory_order_release);
+    }
+
+    *outSize = size;
+    *outSeverity = first.mSeverity;
+    mTail += partCount;
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "types.h"
+#include <atomic>
+
+// multi-producer, single-consumer ring of log records. producers never block or take a lock,
+// a record that doesn't fit is dropped and counted instead.
+// records are split over fixed size slots, and a producer claims every slot its record needs with a single CAS,
+// so records from different threads are never interleaved.
+class LogRing {
+public:
+    static constexpr size_t cSlotCount = 0x200; // must be a power of two
+    static constexpr size_t cSlotDataSize = 0x78;
+    static constexpr size_t cMaxRecordSize = 0x500;
+
+private:
+    static constexpr u32 cSlotMask = cSlotCount - 1;
+
+    struct Slot {
+        // position the slot is waiting to be written at, position + 1 once written
+        std::atomic<u32> mSequence;
+        u16 mSize;
+        u8 mSeverity;
+        u8 mPartCount; // only set in the first slot of a record
+        char mData[cSlotDataSize];
+    };
+
+    static_assert(sizeof(Slot) == 0x80, "");
+    static_assert((cSlotCount & cSlotMask) == 0, "");
+
+    Slot mSlots[cSlotCount];
+    alignas(0x40) std::atomic<u32> mHead = 0;
+    alignas(0x40) u32 mTail = 0; // only touched by the consumer
+    std::atomic<u32> mDropCount = 0;
+
+public:
+    LogRing();
+
+    bool push(const char* msg, size_t size, u8 severity);
+
+    // copies the oldest record into outBuffer (which has to hold cMaxRecordSize bytes), false if there is none.
+    // only one thread may pop at a time.
+    bool pop(char* outBuffer, size_t* outSize, u8* outSeverity);
+
+    u32 getDropCount() const { return mDropCount.load(std::memory_order_relaxed); }
+};
@@ -5,50 +5,167 @@
 #include "util.h"
 #include <imgui_nvn.h>
 #include <sys/fcntl.h>
+#include <algorithm>
+
+alignas(nn::os::ThreadStackAlignment) static u8 sDrainThreadStack[0x4000];
 
 Logger &Logger::instance() {
     static Logger instance;
     return instance;
 }
 
-nn::Result Logger::initNetwork(const char *ip, u16 port) {
+void Logger::startDrainThread() {
+    if(mIsDrainStarted)
+        return;
+
+    nn::os::InitializeLightEvent(&mDrainEvent, false, true);
+
+    // lowest priority, so sending logs never gets in the way of the threads doing the logging
+    nn::Result result = nn::os::CreateThread(&mDrainThread, drainThreadMain, this, sDrainThreadStack, sizeof(sDrainThreadStack),
+                                             nn::os::LowestThreadPriority, (nn::os::GetCurrentCoreNumber() + 1) % 3);
+
+    if(result.isFailure()) {
+        nn::os::FinalizeLightEvent(&mDrainEvent);
+        return;
+    }
+
+    nn::os::SetThreadName(&mDrainThread, "LoggerDrainThread");
+    nn::os::StartThread(&mDrainThread);
+    mIsDrainStarted = true;
+}
+
+void Logger::drainThreadMain(void *arg) {
+    auto* logger = (Logger*)arg;
+
+    while (true) {
+        // while the transport has packets waiting on a timer or a connection, it's polled instead of waiting for new logs
+        if(logger->mType == LoggerType::Network && logger->mTransport.isBusy())
+            nn::os::SleepThread(nn::TimeSpan::FromMilliSeconds(cTransportPollMs));
+        else
+            nn::os::WaitLightEvent(&logger->mDrainEvent);
+
+        logger->drain();
+    }
+}
+
+bool Logger::drain(bool isForceSend) {
+    if(mIsDraining.exchange(true, std::memory_order_acquire))
+        return false;
 
-    if (mState != NetworkState::UNINITIALIZED)
-        return -1;
+    char buffer[LogRing::cMaxRecordSize + 1];
+    size_t size = 0;
+    u8 severity = 0;
 
-    if ((mSocketFd = nn::socket::Socket(2, 1, 6)) < 0) {
-        mState = NetworkState::UNAVAILABLE;
-        return -1;
+    // the console isn't thread safe, it's held for the whole drain so drawing never sees half of a batch
+    bool isConsoleLocked = mType == LoggerType::ImGui && mIsConsoleMutexInit;
+    if(isConsoleLocked)
+        nn::os::LockMutex(&mConsoleMutex);
+
+    while (mRing.pop(buffer, &size, &severity)) {
+        if(mType == LoggerType::None)
+            continue;
+
+        if(severity & cDeferredFlag) {
+            sendDeferred(buffer, size, (LogSeverity)(severity & ~cDeferredFlag));
+        } else {
+            buffer[size] = '\0';
+            mLogCallback(buffer, size, (LogSeverity)severity);
+        }
     }
 
-    nn::socket::Fcntl(mSocketFd, F_SETFL, O_NONBLOCK);
+    u32 dropCount = mRing.getDropCount();
+    if(dropCount != mReportedDropCount && mType != LoggerType::None) {
+        int len = snprintf(buffer, sizeof(buffer), "Logger dropped %u messages, the log ring was full.\n", dropCount - mReportedDropCount);
+        mLogCallback(buffer, len, LogSeverity::Warn);
+        mReportedDropCount = dropCount;
+    }
 
-    nn::socket::InetAton(ip, &hostAddress);
+    if(isConsoleLocked)
+        nn::os::UnlockMutex(&mConsoleMutex);
 
-    serverAddress.address = hostAddress;
-    serverAddress.port = nn::socket::InetHtons(port);
-    serverAddress.family = 2;
+    if(mType == LoggerType::Network)
+        mTransport.update(isForceSend);
 
-    nn::Result result = nn::socket::Connect(mSocketFd, &serverAddress, sizeof(serverAddress));
+    mIsDraining.store(false, std::memory_order_release);
+    return true;
+}
+
+void Logger::sendDeferred(const char* record, size_t size, LogSeverity severity) {
+    if(mType == LoggerType::Network && mIsBinaryNetwork) {
+        u64 id = DeferredLog::getFormatId(record);
 
-    if (!result.isSuccess() && nn::socket::GetLastErrno() != EINPROGRESS) {
-        return -1;
+        // the receiving end may have missed earlier formats, send them again
+        if(mTransport.getStreamId() != mSentFormatsStreamId) {
+            memset(mSentFormats, 0, sizeof(mSentFormats));
+            mSentFormatsStreamId = mTransport.getStreamId();
+        }
+
+        if(markFormatSent(id)) {
+            const char* fmt = reinterpret_cast<const char*>(id);
+            sendFrame(cFrameFormat, &id, sizeof(id), fmt, strlen(fmt), LogSeverity::Info);
+        }
+
+        u8 severityByte = (u8)severity;
+        sendFrame(cFrameRecord, &severityByte, sizeof(severityByte), record, size, severity);
+        return;
     }
 
-    fd_set wfds;
-    FD_ZERO(&wfds);
-    FD_SET(mSocketFd, &wfds);
-    struct timeval tv = {};
-    tv.tv_sec = 5;
-    s32 selRes = nn::socket::Select(1, nullptr, &wfds, nullptr, &tv);
-    if(selRes != 1)
-        return -1;
+    char text[LogRing::cMaxRecordSize + 1];
+    size_t len = DeferredLog::format(record, size, text, sizeof(text));
+    if(len > 0)
+        mLogCallback(text, len, severity);
+}
 
-    Logger::log("Connected!\n");
+void Logger::sendFrame(FrameType type, const void* prefix, size_t prefixSize, const void* data, size_t size, LogSeverity severity) {
+    char frame[cFrameHeaderSize + sizeof(u64) + LogRing::cMaxRecordSize];
+    size = std::min(size, sizeof(frame) - cFrameHeaderSize - prefixSize);
+    u16 payloadSize = prefixSize + size;
 
-    mState = NetworkState::CONNECTED;
+    frame[0] = '\0';
+    frame[1] = type;
+    memcpy(frame + 2, &payloadSize, sizeof(payloadSize));
+    memcpy(frame + cFrameHeaderSize, prefix, prefixSize);
+    memcpy(frame + cFrameHeaderSize + prefixSize, data, size);
 
-    return result;
+    mLogCallback(frame, cFrameHeaderSize + payloadSize, severity);
+}
+
+bool Logger::markFormatSent(u64 id) {
+    constexpr size_t mask = cSentFormatCount - 1;
+
+    for (size_t i = 0; i < cSentFormatCount; ++i) {
+        u64& entry = mSentFormats[((id >> 3) + i) & mask];
+        if(entry == id)
+            return false;
+        if(entry == 0) {
+            entry = id;
+            return true;
+        }
+    }
+
+    // table is full, keep sending the format along with every record using it
+    return true;
+}
+
+void Logger::setBinaryNetworkLogs(bool isEnabled) {
+    instance().mIsBinaryNetwork = isEnabled;
+}
+
+void Logger::flush() {
+    Logger &curInst = instance();
+
+    // the drain thread may be in the middle of sending, and the socket may not take everything at once,
+    // give both a moment to finish
+    for (int i = 0; i < 100; ++i) {
+        if(curInst.drain(true)) {
+            bool isSending = curInst.mType == LoggerType::Network &&
+                             curInst.mTransport.getState() == NetworkTransport::State::Connected && curInst.mTransport.hasUnsent();
+            if(!isSending)
+                break;
+        }
+
+        nn::os::SleepThread(nn::TimeSpan::FromMilliSeconds(1));
+    }
 }
 
 void Logger::log(const char *fmt, va_list args, LogSeverity severity) {
@@ -136,29 +253,22 @@ void Logger::setLogType(LoggerType type) {
 
     Logger &curInst = instance();
 
+    // set up before the type changes, the drain thread may already be running.
+    // recursive, as logging from inside the console's draw drains on the calling thread when there's no drain thread
+    if(type == LoggerType::ImGui && !curInst.mIsConsoleMutexInit) {
+        nn::os::InitializeMutex(&curInst.mConsoleMutex, true, 0);
+        curInst.mIsConsoleMutexInit = true;
+    }
+
     curInst.mType = type;
 
     SendLogCallback logEmu = [](const char* msg, size_t msgLen, LogSeverity severity) { svcOutputDebugString(msg, msgLen); };
     SendLogCallback logNetwork = [](const char* msg, size_t msgLen, LogSeverity severity) {
-
-        if (Logger::instance().mState != NetworkState::CONNECTED)
-            return;
-
-        nn::socket::Send(Logger::instance().mSocketFd, msg, msgLen, 0);
-
+        // batched and sent by the transport once drained, kept while disconnected
+        Logger::instance().mTransport.write(msg, msgLen);
     };
-    SendLogCallback logImGui = [](const char* msg, size_t, LogSeverity severity) {
-        switch (severity) {
-        case LogSeverity::Info:
-            Logger::instance().mDbgConsole.LogInfo(msg);
-            break;
-        case LogSeverity::Warn:
-            Logger::instance().mDbgConsole.LogWarn(msg);
-            break;
-        case LogSeverity::Error:
-            Logger::instance().mDbgConsole.LogError(msg);
-            break;
-        }
+    SendLogCallback logImGui = [](const char* msg, size_t msgLen, LogSeverity severity) {
+        Logger::instance().mDbgConsole.LogText((ImGuiUI::DebugConsole::Severity)severity, msg, msgLen);
     };
 
     switch (curInst.mType) {
@@ -166,8 +276,7 @@ void Logger::setLogType(LoggerType type) {
 
         curInst.mLogCallback = logNetwork;
 
-        if(curInst.mState == NetworkState::UNINITIALIZED)
-            curInst.initNetwork(LOGGER_IP, 3080);
+        curInst.mTransport.init(LOGGER_IP, 3080);
 
         break;
     case LoggerType::Emulator:
@@ -187,7 +296,10 @@ void Logger::setLogType(LoggerType type) {
                 ImGui::SetNextWindowPos(ImVec2(0, io.DisplaySize.y - windowSize.y), ImGuiCond_FirstUseEver);
                 ImGui::SetNextWindowSize(windowSize, ImGuiCond_FirstUseEver);
 
-                instance().mDbgConsole.Draw("Logger Console");
+                Logger& logger = instance();
+                nn::os::LockMutex(&logger.mConsoleMutex);
+                logger.mDbgConsole.Draw("Logger Console");
+                nn::os::UnlockMutex(&logger.mConsoleMutex);
             });
             isAddedDraw = true;
         }
@@ -197,12 +309,25 @@ void Logger::setLogType(LoggerType type) {
         break;
     }
 
+    if(curInst.mType != LoggerType::None)
+        curInst.startDrainThread();
+
     if(instance().mType != LoggerType::None)
         Logger::log("Logger Enabled.\n");
 }
 
-void Logger::sendLog(const char* msg, size_t msgLen, LogSeverity severity) {
+void Logger::sendLog(const char* msg, size_t msgLen, LogSeverity severity, bool isDeferred) {
 
-    if(instance().mType != LoggerType::None)
-        instance().mLogCallback(msg, msgLen, severity);
+    Logger &curInst = instance();
+
+    if(curInst.mType == LoggerType::None)
+        return;
+
+    // never blocks, if the ring is full the log is dropped and counted
+    curInst.mRing.push(msg, msgLen, (u8)severity | (isDeferred ? cDeferredFlag : 0));
+
+    if(curInst.mIsDrainStarted)
+        nn::os::SignalLightEvent(&curInst.mDrainEvent);
+    else
+        curInst.drain(); // no drain thread, fall back to sending on the calling thread
 }
\ No newline at end of file
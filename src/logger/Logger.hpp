@@ -1,8 +1,13 @@
 #pragma once
 
 #include "nn/result.h"
+#include "nn/os.h"
 #include <nn/socket.hpp>
+#include <atomic>
 
+#include "DeferredLog.h"
+#include "LogRing.h"
+#include "NetworkTransport.h"
 #include "ui/ImGuiDebugConsole.h"
 
 enum class LoggerType {
@@ -20,32 +25,66 @@ class Logger {
         Error
     };
 
-    enum class NetworkState {
-        UNINITIALIZED = 0,
-        CONNECTED = 1,
-        UNAVAILABLE = 2,
-        DISCONNECTED = 3
+    // set in the severity of ring records holding a deferred log instead of text
+    static constexpr u8 cDeferredFlag = 0x80;
+
+    // binary network frames are sent in between plain text logs, text never contains a null byte so one starts every frame.
+    // frame layout: u8 0, u8 frame type, u16 payload size, payload
+    enum FrameType : u8 {
+        cFrameFormat = 1, // u64 format id, format string
+        cFrameRecord = 2  // u8 severity, deferred log record
     };
 
+    static constexpr size_t cFrameHeaderSize = 4;
+    static constexpr size_t cSentFormatCount = 0x200; // must be a power of two
+
+    // how often the drain thread services the network transport while it has packets waiting
+    static constexpr s64 cTransportPollMs = 5;
+
     typedef void (*SendLogCallback)(const char *msg, size_t size, LogSeverity severity);
 
     // general info
-    NetworkState mState = NetworkState::UNINITIALIZED;
     LoggerType mType = LoggerType::None;
     SendLogCallback mLogCallback = nullptr;
 
     // network
-    int mSocketFd = -1;
-    in_addr hostAddress = {};
-    sockaddr serverAddress = {};
-    // imgui
+    NetworkTransport mTransport = {};
+    // imgui, filled by the drain thread and drawn on the render thread, both under mConsoleMutex
     ImGuiUI::DebugConsole mDbgConsole = ImGuiUI::DebugConsole();
+    nn::os::MutexType mConsoleMutex = {};
+    bool mIsConsoleMutexInit = false;
+
+    // async output, logging threads only ever copy into the ring, the drain thread does the actual sending
+    LogRing mRing = {};
+    nn::os::ThreadType mDrainThread = {};
+    nn::os::LightEventType mDrainEvent = {};
+    bool mIsDrainStarted = false;
+    std::atomic<bool> mIsDraining = false;
+    u32 mReportedDropCount = 0;
+
+    // deferred logs, formats already sent over the current connection are only referred to by id
+    bool mIsBinaryNetwork = true;
+    u64 mSentFormats[cSentFormatCount] = {};
+    u32 mSentFormatsStreamId = 0;
+
+    /// Queues log to be output to the currently set log type (Network, Emulator, ImGui)
+    static void sendLog(const char *msg, size_t msgLen, LogSeverity severity = LogSeverity::Info, bool isDeferred = false);
 
-    /// Outputs log to the currently set log type (Network, Emulator, ImGui)
-    static void sendLog(const char *msg, size_t msgLen, LogSeverity severity = LogSeverity::Info);
+    /// Outputs a deferred log record, either as binary frames or formatted into text
+    void sendDeferred(const char *record, size_t size, LogSeverity severity);
 
-    // network funcs
-    nn::Result initNetwork(const char *ip, u16 port);
+    void sendFrame(FrameType type, const void *prefix, size_t prefixSize, const void *data, size_t size, LogSeverity severity);
+
+    /// Marks a format as sent over the current connection, false if it already was
+    bool markFormatSent(u64 id);
+
+    static void drainThreadMain(void *arg);
+
+    void startDrainThread();
+
+    /// Outputs every queued log, false if another thread is already doing so.
+    /// If isForceSend is set, network output is sent right away instead of waiting for its packet to fill up.
+    bool drain(bool isForceSend = false);
 
 public:
 
@@ -65,4 +104,24 @@ public:
 
     static void logLine(const char *fmt, ...);
 
+    /// Logs without formatting on the calling thread, only the format's address and the raw arguments are queued.
+    /// The format has to be a string literal in a module that's never unloaded (so not a plugin), as its address is used as its id.
+    /// Only integers, floats, pointers and C strings can be passed.
+    template <typename... Args>
+    static void logDeferred(DeferredLog::Format fmt, Args... args) {
+        if(instance().mType == LoggerType::None)
+            return;
+
+        char record[LogRing::cMaxRecordSize];
+        DeferredLog::ArgWriter writer(record, sizeof(record), fmt.mStr);
+        (writer.write(args), ...);
+        sendLog(record, writer.getSize(), LogSeverity::Info, true);
+    }
+
+    /// Sends deferred logs over the network as binary frames to be formatted on the PC, on by default
+    static void setBinaryNetworkLogs(bool isEnabled);
+
+    /// Outputs every queued log on the calling thread, for when the drain thread may never get to run again (ex: crashes)
+    static void flush();
+
 };
\ No newline at end of file
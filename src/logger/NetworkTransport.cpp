@@ -0,0 +1,240 @@
+#include "NetworkTransport.h"
+#include "socket.hpp"
+#include <sys/fcntl.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    // bsd socket constants, not defined by the sdk headers
+    constexpr s16 cPollOut = 0x4;
+    constexpr s16 cPollErr = 0x8;
+    constexpr s16 cPollHup = 0x10;
+    constexpr s32 cSolSocket = 0xFFFF;
+    constexpr s32 cSoError = 0x1007;
+
+    s64 getElapsedMs(nn::os::Tick since) {
+        return (nn::os::GetSystemTick() - since).ToTimeSpan().GetMilliSeconds();
+    }
+}
+
+void NetworkTransport::init(const char* ip, u16 port) {
+    if(mState != State::Uninitialized)
+        return;
+
+    in_addr hostAddress = {};
+    nn::socket::InetAton(ip, &hostAddress);
+
+    mServerAddress.address = hostAddress;
+    mServerAddress.port = nn::socket::InetHtons(port);
+    mServerAddress.family = 2;
+
+    startConnect();
+}
+
+void NetworkTransport::startConnect() {
+    if((mSocketFd = nn::socket::Socket(2, 1, 6)) < 0) {
+        disconnect();
+        return;
+    }
+
+    nn::socket::Fcntl(mSocketFd, F_SETFL, O_NONBLOCK);
+
+    nn::Result result = nn::socket::Connect(mSocketFd, &mServerAddress, sizeof(mServerAddress));
+
+    if(result.isSuccess()) {
+        onConnected();
+        return;
+    }
+
+    if(nn::socket::GetLastErrno() != EINPROGRESS) {
+        disconnect();
+        return;
+    }
+
+    mState = State::Connecting;
+    mConnectStartTick = nn::os::GetSystemTick();
+}
+
+void NetworkTransport::pollConnect() {
+    pollfd pollFd = { mSocketFd, cPollOut, 0 };
+    s32 readyCount = nn::socket::Poll(&pollFd, 1, 0);
+
+    if(readyCount < 0 || (pollFd.revents & (cPollErr | cPollHup)) != 0) {
+        disconnect();
+        return;
+    }
+
+    if(readyCount == 0 || (pollFd.revents & cPollOut) == 0) {
+        if(getElapsedMs(mConnectStartTick) >= cConnectTimeoutMs)
+            disconnect();
+        return;
+    }
+
+    // writable only means the attempt finished, not that it succeeded
+    s32 error = 0;
+    u32 errorSize = sizeof(error);
+    if(nn::socket::GetSockOpt(mSocketFd, cSolSocket, cSoError, &error, &errorSize) < 0 || error != 0) {
+        disconnect();
+        return;
+    }
+
+    onConnected();
+}
+
+void NetworkTransport::onConnected() {
+    mState = State::Connected;
+    mBackoffMs = cMinBackoffMs;
+    mHeadSentSize = 0;
+    mStreamId++;
+
+    char msg[0x80];
+    int len;
+    if(mDroppedPackets != mReportedDroppedPackets) {
+        len = snprintf(msg, sizeof(msg), "Connected! %u log packets were dropped while disconnected.\n",
+                       mDroppedPackets - mReportedDroppedPackets);
+        mReportedDroppedPackets = mDroppedPackets;
+    } else {
+        len = snprintf(msg, sizeof(msg), "Connected!\n");
+    }
+
+    write(msg, len);
+}
+
+void NetworkTransport::disconnect() {
+    if(mSocketFd >= 0)
+        nn::socket::Close(mSocketFd);
+    mSocketFd = -1;
+
+    // a partly sent packet is sent again in full over the next connection
+    mHeadSentSize = 0;
+
+    mState = State::Disconnected;
+    mNextConnectTick = nn::os::GetSystemTick() + nn::os::Tick(nn::TimeSpan::FromMilliSeconds(mBackoffMs));
+    mBackoffMs = std::min(mBackoffMs * 2, cMaxBackoffMs);
+}
+
+size_t NetworkTransport::getPacketSize(size_t offset) const {
+    u32 payloadSize;
+    memcpy(&payloadSize, mQueue + offset + sizeof(u32), sizeof(payloadSize));
+    return cPacketHeaderSize + payloadSize;
+}
+
+bool NetworkTransport::dropOldestPacket() {
+    size_t offset = mQueueStart;
+
+    // dropping a packet that's partly sent would leave the receiving end with half a packet
+    if(mHeadSentSize > 0 && offset != mQueueEnd)
+        offset += getPacketSize(offset);
+
+    if(offset >= mQueueEnd)
+        return false;
+
+    size_t size = getPacketSize(offset);
+    memmove(mQueue + offset, mQueue + offset + size, mQueueEnd - offset - size);
+    mQueueEnd -= size;
+
+    mDroppedPackets++;
+    mStreamId++;
+    return true;
+}
+
+void NetworkTransport::enqueue(const char* packet, size_t size) {
+    if(mQueueEnd + size > cBacklogSize && mQueueStart > 0) {
+        memmove(mQueue, mQueue + mQueueStart, mQueueEnd - mQueueStart);
+        mQueueEnd -= mQueueStart;
+        mQueueStart = 0;
+    }
+
+    while (mQueueEnd + size > cBacklogSize) {
+        if(!dropOldestPacket()) {
+            mDroppedPackets++;
+            mStreamId++;
+            return;
+        }
+    }
+
+    memcpy(mQueue + mQueueEnd, packet, size);
+    mQueueEnd += size;
+}
+
+void NetworkTransport::sealBatch() {
+    if(mBatchSize == cPacketHeaderSize)
+        return;
+
+    u32 magic = cPacketMagic;
+    u32 payloadSize = mBatchSize - cPacketHeaderSize;
+    memcpy(mBatch, &magic, sizeof(magic));
+    memcpy(mBatch + sizeof(magic), &payloadSize, sizeof(payloadSize));
+
+    enqueue(mBatch, mBatchSize);
+    mBatchSize = cPacketHeaderSize;
+}
+
+void NetworkTransport::write(const char* data, size_t size) {
+    size = std::min(size, cMaxPacketSize - cPacketHeaderSize);
+
+    if(mBatchSize + size > cMaxPacketSize)
+        sealBatch();
+
+    if(mBatchSize == cPacketHeaderSize)
+        mBatchStartTick = nn::os::GetSystemTick();
+
+    memcpy(mBatch + mBatchSize, data, size);
+    mBatchSize += size;
+}
+
+void NetworkTransport::sendQueued() {
+    while (mQueueStart != mQueueEnd) {
+        const char* data = mQueue + mQueueStart + mHeadSentSize;
+        size_t size = mQueueEnd - mQueueStart - mHeadSentSize;
+
+        // every queued packet goes out in one call
+        s32 sentSize = nn::socket::Send(mSocketFd, data, size, 0);
+
+        if(sentSize < 0) {
+            s32 error = nn::socket::GetLastErrno();
+            if(error != EAGAIN && error != EWOULDBLOCK)
+                disconnect();
+            return;
+        }
+
+        if(sentSize == 0)
+            return;
+
+        mHeadSentSize += sentSize;
+        while (mQueueStart != mQueueEnd) {
+            size_t packetSize = getPacketSize(mQueueStart);
+            if(mHeadSentSize < packetSize)
+                break;
+
+            mHeadSentSize -= packetSize;
+            mQueueStart += packetSize;
+        }
+    }
+
+    mQueueStart = 0;
+    mQueueEnd = 0;
+}
+
+void NetworkTransport::update(bool isForceSend) {
+    if(mState == State::Uninitialized)
+        return;
+
+    if(mBatchSize > cPacketHeaderSize && (isForceSend || getElapsedMs(mBatchStartTick) >= cMaxBatchDelayMs))
+        sealBatch();
+
+    // only reconnect once there's something to send
+    if(mState == State::Disconnected && mQueueStart != mQueueEnd && nn::os::GetSystemTick() >= mNextConnectTick)
+        startConnect();
+    else if(mState == State::Connecting)
+        pollConnect();
+
+    if(mState == State::Connected)
+        sendQueued();
+}
+
+bool NetworkTransport::isBusy() const {
+    return mState == State::Connecting || (mState != State::Uninitialized && hasUnsent());
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "types.h"
+#include "nn/os.h"
+#include "os/os_tick.hpp"
+#include <nn/socket.hpp>
+
+// batches log output into framed packets, and holds on to them while the connection is down.
+// packet layout: u32 magic, u32 payload size, payload (plain text logs mixed with deferred log frames, see Logger).
+// the connection is made and re-made in the background with exponential backoff, nothing here ever blocks.
+// not thread safe, only the thread draining the log ring may use it.
+class NetworkTransport {
+public:
+    static constexpr u32 cPacketMagic = 0x474C5845; // "EXLG"
+    static constexpr size_t cPacketHeaderSize = 8;
+    static constexpr size_t cMaxPacketSize = 0x1000;
+    static constexpr s64 cMaxBatchDelayMs = 20; // a packet is sent once it's full, or this long after its first write
+    static constexpr size_t cBacklogSize = 0x20000; // sealed packets waiting to be sent, oldest are dropped once full
+
+    static constexpr s64 cConnectTimeoutMs = 5000;
+    static constexpr s64 cMinBackoffMs = 250;
+    static constexpr s64 cMaxBackoffMs = 8000;
+
+    enum class State {
+        Uninitialized,
+        Disconnected, // waiting for the backoff to run out before reconnecting
+        Connecting,
+        Connected
+    };
+
+private:
+    State mState = State::Uninitialized;
+    int mSocketFd = -1;
+    sockaddr mServerAddress = {};
+
+    // packet being filled, the header is written once it's sealed
+    char mBatch[cMaxPacketSize];
+    size_t mBatchSize = cPacketHeaderSize;
+    nn::os::Tick mBatchStartTick = nn::os::Tick(0);
+
+    // sealed packets, mQueueStart is the start of the oldest one
+    char mQueue[cBacklogSize];
+    size_t mQueueStart = 0;
+    size_t mQueueEnd = 0;
+    size_t mHeadSentSize = 0; // part of the oldest packet already sent over the current connection
+
+    nn::os::Tick mConnectStartTick = nn::os::Tick(0);
+    nn::os::Tick mNextConnectTick = nn::os::Tick(0);
+    s64 mBackoffMs = cMinBackoffMs;
+
+    u32 mStreamId = 0;
+    u32 mDroppedPackets = 0;
+    u32 mReportedDroppedPackets = 0;
+
+    void sealBatch();
+    void enqueue(const char *packet, size_t size);
+    bool dropOldestPacket();
+    size_t getPacketSize(size_t offset) const;
+
+    void startConnect();
+    void pollConnect();
+    void onConnected();
+    void disconnect();
+    void sendQueued();
+
+public:
+    void init(const char *ip, u16 port);
+
+    /// Adds a message to the current packet, messages are never split across packets
+    void write(const char *data, size_t size);
+
+    /// Seals and sends packets that are due, and handles connecting. If isForceSend is set the current packet is sealed right away.
+    void update(bool isForceSend = false);
+
+    /// True while there is something that needs update to keep being called, even without new writes
+    bool isBusy() const;
+
+    bool hasUnsent() const { return mBatchSize > cPacketHeaderSize || mQueueStart != mQueueEnd; }
+
+    State getState() const { return mState; }
+
+    /// Changes whenever the receiving end may have missed earlier output, on reconnects and dropped packets
+    u32 getStreamId() const { return mStreamId; }
+};
@@ -8,4 +8,8 @@ struct LoaderCtx {
     sead::Heap* mChildHeap = nullptr; // heap created by plugin
     char mLoadDir[0x40] = {};
     bool mIsReload = false;
-};
\ No newline at end of file
+};
+
+// put this in one of a plugin's source files to have its imports resolved on their first call instead of all at load
+// time, which speeds up loading plugins that import a lot but only use a few of those imports early on.
+#define PLUGIN_BIND_LAZY extern "C" __attribute__((visibility("default"), used)) const bool plugin_bind_lazy = true
@@ -0,0 +1,68 @@
+#include "NroHashThread.h"
+
+#include "nn/crypto.h"
+#include "os/os_tick.hpp"
+
+void NroHashThread::hash(const NroHashJob& job) {
+    nn::crypto::GenerateSha256Hash(job.mOutHash, 0x20, job.mData, job.mSize);
+}
+
+void NroHashThread::threadMain(void* arg) {
+    auto* inst = (NroHashThread*)arg;
+
+    // no logging is done on this thread, as the logger isn't safe to use off of the loader thread
+    while (true) {
+        u64 msg = cExitMsg;
+        nn::os::ReceiveMessageQueue(&msg, &inst->mQueue);
+
+        if(msg == cExitMsg)
+            break;
+
+        nn::os::Tick startTick = nn::os::GetSystemTick();
+        hash(*(NroHashJob*)msg);
+        inst->mHashTime += (nn::os::GetSystemTick() - startTick).ToTimeSpan().GetMicroSeconds();
+    }
+}
+
+bool NroHashThread::start(void* stack, size_t stackSize, s32 core) {
+    if(mIsRunning)
+        return true;
+
+    nn::os::InitializeMessageQueue(&mQueue, mQueueBuffer, cQueueSize);
+
+    nn::Result result = nn::os::CreateThread(&mThread, threadMain, this, stack, stackSize, nn::os::DefaultThreadPriority, core);
+
+    if(result.isFailure()) {
+        nn::os::FinalizeMessageQueue(&mQueue);
+        return false;
+    }
+
+    nn::os::SetThreadName(&mThread, "PluginHashThread");
+    nn::os::StartThread(&mThread);
+    mIsRunning = true;
+
+    return true;
+}
+
+void NroHashThread::push(NroHashJob& job) {
+    if(mIsRunning) {
+        nn::os::SendMessageQueue(&mQueue, (u64)&job);
+        return;
+    }
+
+    nn::os::Tick startTick = nn::os::GetSystemTick();
+    hash(job);
+    mHashTime += (nn::os::GetSystemTick() - startTick).ToTimeSpan().GetMicroSeconds();
+}
+
+void NroHashThread::stop() {
+    if(!mIsRunning)
+        return;
+
+    nn::os::SendMessageQueue(&mQueue, cExitMsg);
+    nn::os::WaitThread(&mThread);
+    nn::os::DestroyThread(&mThread);
+    nn::os::FinalizeMessageQueue(&mQueue);
+
+    mIsRunning = false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "types.h"
+
+#include "nn/os.h"
+
+// a single NRO to hash, owned by whoever pushes it. it has to stay alive until NroHashThread::stop returns
+struct NroHashJob {
+    const void* mData = nullptr;
+    size_t mSize = 0;
+    void* mOutHash = nullptr; // 0x20 bytes, written by the hash thread
+};
+
+// hashes NROs on their own thread, so hashing one plugin can overlap with reading the next one from the SD card.
+// when the thread isn't running, jobs are hashed on the thread pushing them instead.
+class NroHashThread {
+
+    static constexpr size_t cQueueSize = 0x10;
+    static constexpr u64 cExitMsg = 0; // jobs are sent as pointers, so this can't be one
+
+    nn::os::ThreadType mThread = {};
+    nn::os::MessageQueueType mQueue = {};
+    u64 mQueueBuffer[cQueueSize] = {};
+    bool mIsRunning = false;
+
+    s64 mHashTime = 0;
+
+    static void threadMain(void* arg);
+
+public:
+
+    // stack must be aligned to nn::os::ThreadStackAlignment, and not be used by anything else until stop returns
+    bool start(void* stack, size_t stackSize, s32 core);
+
+    // blocks while cQueueSize jobs are already waiting
+    void push(NroHashJob& job);
+
+    // the queue is FIFO, so every job pushed before this has been hashed once it returns
+    void stop();
+
+    bool isRunning() const { return mIsRunning; }
+
+    // microseconds spent hashing since the last resetHashTime, only read this while the thread is stopped
+    s64 getHashTime() const { return mHashTime; }
+
+    void resetHashTime() { mHashTime = 0; }
+
+    static void hash(const NroHashJob& job);
+};
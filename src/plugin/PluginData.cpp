@@ -7,3 +7,33 @@ bool PluginData::runPluginMain(LoaderCtx& ctx) {
     }
     return false;
 }
+
+void PluginData::runPluginExit(LoaderCtx& ctx) {
+    PluginExit func = nullptr;
+    if(getPluginFunc(func, "plugin_exit")) {
+        func(ctx);
+    }
+}
+
+void PluginData::getImportCounts(size_t* outBound, size_t* outPending) const {
+    *outBound = 0;
+    *outPending = 0;
+
+    if(!mModuleLoaded)
+        return;
+
+    // every jump slot starts out pointing at the PLT stub, binding it replaces that with the target
+    auto* module = mModule.ModuleObject;
+    if(!module->is_rela)
+        return;
+
+    auto* relocs = module->rela_or_rel_plt.rela;
+    size_t relocCount = module->rela_or_rel_plt_size / sizeof(Elf_Rela);
+    for (size_t i = 0; i < relocCount; ++i) {
+        if(ELF_R_TYPE(relocs[i].r_info) != ARCH_JUMP_SLOT)
+            continue;
+
+        void* value = *(void**)(module->module_base + relocs[i].r_offset);
+        (value == module->got_stub_ptr ? *outPending : *outBound) += 1;
+    }
+}
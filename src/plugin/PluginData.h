@@ -3,6 +3,7 @@
 #include "plugin/LoaderCtx.h"
 #include "sha256.h"
 
+#include <nn/fs.h>
 #include <nn/ro.h>
 
 class PluginData {
@@ -23,6 +24,7 @@ class PluginData {
 
     // plugin func signatures
     typedef bool (*PluginMain)(LoaderCtx& ctx);
+    typedef void (*PluginExit)(LoaderCtx& ctx);
 
 public:
     char mFilePath[0x40] = {};
@@ -32,14 +34,31 @@ public:
     u8* mFileData = nullptr;
     size_t mFileSize = 0;
 
+    nn::fs::FileTimeStamp mTimeStamp = {};
+    bool mHasTimeStamp = false;
+    bool mIsHashCached = false; // hash was taken from the PluginHashCache instead of being generated
+
     nn::ro::Module mModule = {};
     bool mModuleLoaded = false;
 
+    // address range the module was mapped to, used to find anything the plugin registered
+    uintptr_t mModuleStart = 0;
+    uintptr_t mModuleEnd = 0;
+
     u8* mBssData = nullptr;
     size_t mBssSize = 0;
 
+    // plugin exports plugin_bind_lazy (see PLUGIN_BIND_LAZY), imports are bound on their first call
+    bool mIsLazyBind = false;
+
     sead::Heap* mHeap = nullptr;
 
     bool runPluginMain(LoaderCtx& ctx);
 
+    // plugin_exit is optional, so this does nothing if the plugin doesn't export it
+    void runPluginExit(LoaderCtx& ctx);
+
+    // counts imported functions that were bound, and ones still going through the lazy resolver (or unresolved)
+    void getImportCounts(size_t* outBound, size_t* outPending) const;
+
 };
@@ -0,0 +1,131 @@
+#include "PluginHashCache.h"
+#include "PluginData.h"
+#include "helpers/fsHelper.h"
+#include "logger/Logger.hpp"
+
+#include "nn/init.h"
+#include <cstring>
+
+void PluginHashCache::load(const char* path) {
+    clear();
+
+    // the cache is only an optimization, so nothing in here may assert on a missing or broken file
+    long fileSize = FsHelper::getFileSize(path);
+    if(fileSize < 0) {
+        Logger::log("No Plugin hash cache found.\n");
+        return;
+    }
+
+    if(fileSize < (long)sizeof(Header)) {
+        Logger::log("Plugin hash cache is invalid! Ignoring.\n");
+        mIsDirty = true;
+        return;
+    }
+
+    u8* buffer = (u8*)nn::init::GetAllocator()->Allocate(fileSize);
+    if(!buffer) {
+        Logger::log("Not enough memory to read the Plugin hash cache! Ignoring.\n");
+        return;
+    }
+
+    auto* header = (Header*)buffer;
+
+    if(FsHelper::readFileToBuffer(buffer, fileSize, path).isFailure() || header->mMagic != cMagic ||
+       header->mVersion != cVersion || fileSize != (long)(sizeof(Header) + (size_t)header->mEntryCount * sizeof(Entry))) {
+        Logger::log("Plugin hash cache is invalid! Ignoring.\n");
+        nn::init::GetAllocator()->Free(buffer);
+        mIsDirty = true;
+        return;
+    }
+
+    mEntries = (Entry*)nn::init::GetAllocator()->Allocate(sizeof(Entry) * header->mEntryCount);
+    if(mEntries) {
+        mEntryCount = header->mEntryCount;
+        memcpy(mEntries, header + 1, sizeof(Entry) * mEntryCount);
+    }
+
+    nn::init::GetAllocator()->Free(buffer);
+
+    Logger::log("Loaded Plugin hash cache with %u entries.\n", mEntryCount);
+}
+
+void PluginHashCache::clear() {
+    if(mEntries)
+        nn::init::GetAllocator()->Free(mEntries);
+
+    mEntries = nullptr;
+    mEntryCount = 0;
+    mIsDirty = false;
+}
+
+const PluginHashCache::Entry* PluginHashCache::findEntry(const char* path) const {
+    for (int i = 0; i < mEntryCount; ++i) {
+        if(strncmp(mEntries[i].mPath, path, sizeof(Entry::mPath)) == 0)
+            return &mEntries[i];
+    }
+    return nullptr;
+}
+
+bool PluginHashCache::tryGetHash(Sha256Hash* outHash, const char* path, s64 fileSize, const nn::fs::FileTimeStamp& timeStamp) {
+    const Entry* entry = findEntry(path);
+
+    if(entry && entry->mFileSize == fileSize && entry->mTimeStamps[0] == timeStamp.mTime1 &&
+       entry->mTimeStamps[1] == timeStamp.mTime2 && entry->mTimeStamps[2] == timeStamp.mTime3) {
+        *outHash = entry->mHash;
+        mHitCount++;
+        return true;
+    }
+
+    mMissCount++;
+    mIsDirty = true;
+    return false;
+}
+
+void PluginHashCache::save(const char* path, const PluginData* plugins, size_t count) {
+    size_t bufSize = sizeof(Header) + count * sizeof(Entry);
+    u8* buffer = (u8*)nn::init::GetAllocator()->Allocate(bufSize);
+    memset(buffer, 0, bufSize);
+
+    auto* entries = (Entry*)(buffer + sizeof(Header));
+    u32 entryCount = 0;
+
+    for (int i = 0; i < count; ++i) {
+        const PluginData& plugin = plugins[i];
+
+        // plugins without a timestamp can't be validated later on, so never cache them
+        if(!plugin.mHasTimeStamp)
+            continue;
+
+        Entry& entry = entries[entryCount];
+
+        if(snprintf(entry.mPath, sizeof(entry.mPath), "%s/%s", plugin.mFilePath, plugin.mFileName) >= (int)sizeof(entry.mPath))
+            continue;
+
+        entry.mFileSize = plugin.mFileSize;
+        entry.mTimeStamps[0] = plugin.mTimeStamp.mTime1;
+        entry.mTimeStamps[1] = plugin.mTimeStamp.mTime2;
+        entry.mTimeStamps[2] = plugin.mTimeStamp.mTime3;
+        entry.mHash = plugin.mPluginHash;
+        entryCount++;
+    }
+
+    *(Header*)buffer = Header {
+        .mMagic = cMagic,
+        .mVersion = cVersion,
+        .mEntryCount = entryCount,
+        .mReserved = 0
+    };
+
+    if(FsHelper::writeFileToPath(buffer, sizeof(Header) + entryCount * sizeof(Entry), path).isFailure()) {
+        Logger::log("Failed to write Plugin hash cache!\n");
+    }
+
+    nn::init::GetAllocator()->Free(buffer);
+}
+
+void PluginHashCache::remove(const char* path) {
+    if(FsHelper::isFileExist(path)) {
+        Logger::log("Removing Plugin hash cache.\n");
+        nn::fs::DeleteFile(path);
+    }
+}
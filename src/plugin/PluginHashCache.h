@@ -0,0 +1,69 @@
+#pragma once
+
+#include "sha256.h"
+#include "types.h"
+
+#include "nn/fs.h"
+
+class PluginData;
+
+// on-SD cache of plugin NRO hashes, so unchanged plugins don't have to be rehashed every boot.
+// entries are keyed by the full path, file size and every timestamp the fs reports for the file,
+// if any of these differ (or the cache file looks off in any way) the plugin is rehashed.
+class PluginHashCache {
+
+    static constexpr u32 cMagic = 0x43485050; // PPHC
+    static constexpr u32 cVersion = 1;
+
+    struct Header {
+        u32 mMagic;
+        u32 mVersion;
+        u32 mEntryCount;
+        u32 mReserved;
+    };
+
+    struct Entry {
+        char mPath[0x40];
+        s64 mFileSize;
+        u64 mTimeStamps[3];
+        Sha256Hash mHash;
+    };
+
+    Entry* mEntries = nullptr;
+    u32 mEntryCount = 0;
+
+    u32 mHitCount = 0;
+    u32 mMissCount = 0;
+
+    bool mIsDirty = false;
+
+    const Entry* findEntry(const char* path) const;
+
+public:
+
+    // reads the cache file into memory, any failure just leaves the cache empty
+    void load(const char* path);
+
+    // frees the entries read by load
+    void clear();
+
+    bool tryGetHash(Sha256Hash* outHash, const char* path, s64 fileSize, const nn::fs::FileTimeStamp& timeStamp);
+
+    // marks the cache as needing to be rewritten, ex: after a miss or if a cached hash turned out to be bad
+    void markDirty() { mIsDirty = true; }
+
+    bool isDirty() const { return mIsDirty; }
+
+    void resetStats() { mHitCount = 0; mMissCount = 0; }
+
+    u32 getHitCount() const { return mHitCount; }
+
+    u32 getMissCount() const { return mMissCount; }
+
+    u32 getEntryCount() const { return mEntryCount; }
+
+    // writes a new cache file containing every plugin that has a valid timestamp
+    static void save(const char* path, const PluginData* plugins, size_t count);
+
+    static void remove(const char* path);
+};
@@ -2,8 +2,16 @@
 #include <heap/seadHeapMgr.h>
 #include <plugin/PluginLoader.h>
 #include <plugin/events/Events.h>
+#include <exception/ExceptionHandler.h>
 
+#include "lib/reloc/rtld/utils.hpp"
 #include "nn/init.h"
+#include <algorithm>
+#include <new>
+
+PluginLoader::PluginLoader() {
+    nn::os::InitializeMessageQueue(&mRequestQueue, mRequestQueueBuffer, cRequestQueueSize);
+}
 
 PluginLoader& PluginLoader::instance() {
     static PluginLoader sInstance;
@@ -25,19 +33,96 @@ EXPORT_SYM void* pluginRealloc(void* ptr, size_t size) {
     return PluginLoader::getHeap()->tryRealloc(ptr, size, 8);
 }
 
-bool PluginLoader::createPluginData(PluginData& data, const FsHelper::DirFileEntry& entry) {
+static s64 getElapsedMicros(nn::os::Tick startTick) {
+    return (nn::os::GetSystemTick() - startTick).ToTimeSpan().GetMicroSeconds();
+}
 
-    Logger::log("Size: %u\n", entry.bufSize);
+alignas(nn::os::ThreadStackAlignment) static u8 sHashThreadStack[0x4000];
 
-    data.mFileSize = entry.bufSize;
-    data.mFileData = (u8*)pluginAlloc(data.mFileSize, 0x1000); // must be aligned
-    memcpy(data.mFileData, entry.fileBuffer, data.mFileSize);
+// the bind flag has to be picked before the module is loaded, so plugin_bind_lazy is looked up in the NRO itself.
+// NRO segments are stored at their load offsets, so module relative offsets can be used on the file as is.
+static bool isLazyBindRequested(const u8* fileData, size_t fileSize) {
+    auto isInFile = [&](size_t offset, size_t size) { return offset <= fileSize && size <= fileSize - offset; };
+
+    size_t modOffset = ((const nn::ro::NroHeader*)fileData)->mod_offset;
+    if(!isInFile(modOffset, sizeof(rtld::ModuleHeader)))
+        return false;
+
+    auto* modHeader = (const rtld::ModuleHeader*)(fileData + modOffset);
+    if(modHeader->magic != MOD0_MAGIC)
+        return false;
+
+    const u32* hashTable = nullptr;
+    const Elf_Sym* dynsym = nullptr;
+    const char* dynstr = nullptr;
+
+    for (size_t offset = modOffset + modHeader->dynamic_offset; isInFile(offset, sizeof(Elf_Dyn)); offset += sizeof(Elf_Dyn)) {
+        auto* dynamic = (const Elf_Dyn*)(fileData + offset);
+        if(dynamic->d_tag == DT_NULL)
+            break;
+
+        if(!isInFile(dynamic->d_un.d_val, 0))
+            continue;
+
+        if(dynamic->d_tag == DT_HASH)
+            hashTable = (const u32*)(fileData + dynamic->d_un.d_val);
+        else if(dynamic->d_tag == DT_SYMTAB)
+            dynsym = (const Elf_Sym*)(fileData + dynamic->d_un.d_val);
+        else if(dynamic->d_tag == DT_STRTAB)
+            dynstr = (const char*)(fileData + dynamic->d_un.d_val);
+    }
+
+    // nn::ro needs DT_HASH for its own lookups, so every plugin has one
+    if(!hashTable || !dynsym || !dynstr || hashTable[0] == 0)
+        return false;
+
+    const char* name = "plugin_bind_lazy";
+    const u32* buckets = &hashTable[2];
+    const u32* chain = &buckets[hashTable[0]];
+    for (u32 i = buckets[__rtld_elf_hash(name) % hashTable[0]]; i != 0 && i < hashTable[1]; i = chain[i]) {
+        if(dynsym[i].st_shndx != SHN_UNDEF && strcmp(dynstr + dynsym[i].st_name, name) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+// reloading swaps the event subscriber tables out, which can't happen while one of them is still being dispatched.
+// so this wraps the Update event's own hook instead of subscribing to it: installed after every event, it runs first
+// and only reloads once the whole event (prefixes, sequence update and postfixes) has returned.
+HOOK_DEFINE_TRAMPOLINE(HakoniwaSequenceUpdateHook) {
+    static void Callback(HakoniwaSequence* thisPtr) {
+        Orig(thisPtr);
+        PluginLoader::runPendingRequests();
+        PluginLoader::reloadChangedPlugins();
+        // the only hook still running on this thread is this one, and other threads have had a frame to leave removed ones
+        exl::hook::ReclaimRemoved();
+    }
+};
+
+static NroHashJob makeHashJob(PluginData& data) {
+    // hash header for NRR registration later
+    auto* nroHeader = (nn::ro::NroHeader*)data.mFileData;
+    return { data.mFileData, nroHeader->size, &data.mPluginHash };
+}
+
+void PluginLoader::startHashThread() {
+    // run on a different core than the loader so hashing can actually overlap with reads
+    s32 hashCore = (nn::os::GetCurrentCoreNumber() + 1) % 3;
+
+    if(!mHashThread.start(sHashThreadStack, sizeof(sHashThreadStack), hashCore))
+        Logger::logDeferred("Failed to create hash thread! Hashing on loader thread instead.\n");
+}
+
+bool PluginLoader::createPluginData(PluginData& data, const FsHelper::DirFileEntry& entry) {
+
+    Logger::logDeferred("Size: %ld\n", entry.bufSize);
 
     const char* fileName = FsHelper::getFileName(entry.fullPath);
     if(strlen(fileName) < sizeof(data.mFileName)) {
         strcpy(data.mFileName, fileName);
     }else {
-        Logger::log("File name too long for buffer! Cannot copy.\n");
+        Logger::logDeferred("File name too long for buffer! Cannot copy.\n");
     }
 
     size_t filePathLen = strlen(entry.fullPath) - (strlen(data.mFileName) + 1);
@@ -45,35 +130,59 @@ bool PluginLoader::createPluginData(PluginData& data, const FsHelper::DirFileEnt
         strncpy(data.mFilePath, entry.fullPath, filePathLen);
         data.mFilePath[filePathLen] = '\0'; // strncpy doesn't null terminate if max length is less than full path length
     }else {
-        Logger::log("File path too long for buffer! Cannot copy.\n");
+        Logger::logDeferred("File path too long for buffer! Cannot copy.\n");
     }
 
-    if(nn::ro::GetBufferSize(&data.mBssSize, data.mFileData).isFailure()) {
-        Logger::log("Failed to get NRO Buffer Size! NRO may not be valid!\n");
+    if(entry.bufSize < (long)sizeof(nn::ro::NroHeader)) {
+        Logger::logDeferred("File is too small to be an NRO!\n");
+        return false;
+    }
+
+    // read straight into the final buffer used by ro, instead of copying from a temporary one
+    data.mFileSize = entry.bufSize;
+    data.mFileData = (u8*)pluginAlloc(data.mFileSize, 0x1000); // must be aligned
+
+    if(!data.mFileData) {
+        Logger::logDeferred("Failed to allocate NRO buffer! File Size: %ld\n", entry.bufSize);
+        return false;
+    }
+
+    nn::os::Tick readStart = nn::os::GetSystemTick();
+    nn::Result readResult = FsHelper::readFileToBuffer(data.mFileData, data.mFileSize, entry.fullPath);
+    mTimings.mReadTime += getElapsedMicros(readStart);
+
+    if(readResult.isFailure()) {
         pluginFree(data.mFileData);
+        data.mFileData = nullptr;
         return false;
     }
 
-    Logger::log("NRO Buffer size: %d\n", data.mBssSize);
+    mTimings.mBytesRead += data.mFileSize;
 
-    data.mBssData = (u8*)pluginAlloc(data.mBssSize, 0x1000);
+    data.mHasTimeStamp = nn::fs::GetFileTimeStampForDebug(&data.mTimeStamp, entry.fullPath).isSuccess();
 
-    // hash header for NRR registration later
     auto* nroHeader = (nn::ro::NroHeader*)data.mFileData;
-    nn::crypto::GenerateSha256Hash(&data.mPluginHash, sizeof(data.mPluginHash), nroHeader, nroHeader->size);
-    
-    Logger::log("NRO Hash: ");
-    data.mPluginHash.print();
-
-    // register hash to set
+    if(nroHeader->size > data.mFileSize) {
+        Logger::logDeferred("NRO header size is larger than the file! NRO may not be valid!\n");
+        pluginFree(data.mFileData);
+        data.mFileData = nullptr;
+        return false;
+    }
 
-    if(mSortedHashes.find(data.mPluginHash) != nullptr) {
-        Logger::log("Plugin has already been registered! Skipping.\n");
+    if(nn::ro::GetBufferSize(&data.mBssSize, data.mFileData).isFailure()) {
+        Logger::logDeferred("Failed to get NRO Buffer Size! NRO may not be valid!\n");
         pluginFree(data.mFileData);
+        data.mFileData = nullptr;
         return false;
     }
 
-    mSortedHashes.insert(data.mPluginHash);
+    Logger::logDeferred("NRO Buffer size: %zu\n", data.mBssSize);
+
+    data.mIsLazyBind = isLazyBindRequested(data.mFileData, data.mFileSize);
+    if(data.mIsLazyBind)
+        Logger::logDeferred("Plugin requested lazy binding.\n");
+
+    data.mBssData = (u8*)pluginAlloc(data.mBssSize, 0x1000);
 
     return true;
 }
@@ -85,76 +194,413 @@ void PluginLoader::preparePluginsForLoad(s32 nroCount, FsHelper::DirFileEntry* f
     mOrderedSetBuffer = pluginAlloc(sizeof(sead::OrderedSet<Sha256Hash>::Node) * nroCount);
     mSortedHashes.setBuffer(nroCount, mOrderedSetBuffer);
 
-    // create PluginData and register NRO hash to hash set
+    // the hash thread only gets pointers to these, so they have to outlive it
+    auto* hashJobs = (NroHashJob*)pluginAlloc(sizeof(NroHashJob) * nroCount);
+
+    mHashThread.resetHashTime();
+    startHashThread();
+
+    // create PluginData, then hand it off to the hash thread while the next file is read
     for (int i = 0; i < nroCount; ++i) {
         FsHelper::DirFileEntry &entry = fileData[i];
 
-        Logger::log("Loading Plugin at Path: %s\n", entry.fullPath);
+        Logger::logDeferred("Loading Plugin at Path: %s\n", entry.fullPath);
+
+        PluginData& data = *new (&mPlugins[mPluginCount]) PluginData();
+
+        if(!createPluginData(data, entry)) {
+            Logger::logDeferred("Unable to fully load Plugin.\n");
+            continue;
+        }
 
-        if(!createPluginData(mPlugins[mPluginCount], entry)) {
-            Logger::log("Unable to fully load Plugin.\n");
+        Logger::logDeferred("Loaded Plugin data!\n");
+
+        if(data.mHasTimeStamp && mHashCache.tryGetHash(&data.mPluginHash, entry.fullPath, data.mFileSize, data.mTimeStamp)) {
+            data.mIsHashCached = true;
         }else {
-            Logger::log("Loaded Plugin data!\n");
-            mPluginCount++;
+            hashJobs[mPluginCount] = makeHashJob(data);
+            mHashThread.push(hashJobs[mPluginCount]);
         }
 
-        FsHelper::freeFile(entry);
+        mPluginCount++;
     }
 
     FsHelper::freeEntries(fileData);
 
+    nn::os::Tick waitStart = nn::os::GetSystemTick();
+    mHashThread.stop();
+    mTimings.mHashWaitTime = getElapsedMicros(waitStart);
+    mTimings.mHashTime = mHashThread.getHashTime();
+
+    pluginFree(hashJobs);
+
+    registerPluginHashes();
 }
 
-void PluginLoader::generatePluginNrr() {
-    mNrrBufferSize = ALIGN_UP(sizeof(nn::ro::NrrHeader) + (mPluginCount * sizeof(Sha256Hash)), 0x1000);
-    mNrrBuffer = (u8*)pluginAlloc( mNrrBufferSize, 0x1000);
-    memset(mNrrBuffer, 0, mNrrBufferSize); // clear buffer out completely
+void PluginLoader::registerPluginHashes() {
+    size_t uniqueCount = 0;
+
+    for (int i = 0; i < mPluginCount; ++i) {
+        auto& data = mPlugins[i];
+
+        Logger::logDeferred("NRO Hash for %s: ", data.mFileName);
+        data.mPluginHash.print();
+
+        // register hash to set
+        if(mSortedHashes.find(data.mPluginHash) != nullptr) {
+            Logger::logDeferred("Plugin has already been registered! Skipping.\n");
+            pluginFree(data.mBssData);
+            pluginFree(data.mFileData);
+            continue;
+        }
+
+        mSortedHashes.insert(data.mPluginHash);
+
+        if(uniqueCount != i)
+            mPlugins[uniqueCount] = data;
+        uniqueCount++;
+    }
+
+    mPluginCount = uniqueCount;
+
+    // we won't need the sorted hash buffer after this point, so it can be freed
+    pluginFree(mOrderedSetBuffer);
+    mSortedHashes = sead::OrderedSet<Sha256Hash>(); // reset struct
+}
+
+u8* PluginLoader::createPluginNrr(size_t* outSize) {
+    // only plugins that still have their NRO in memory are waiting to be (or already are) loaded
+    size_t hashCount = 0;
+    for (int i = 0; i < mPluginCount; ++i) {
+        if(mPlugins[i].mFileData)
+            hashCount++;
+    }
+
+    size_t nrrSize = ALIGN_UP(sizeof(nn::ro::NrrHeader) + (hashCount * sizeof(Sha256Hash)), 0x1000);
+    u8* nrrBuffer = (u8*)pluginAlloc(nrrSize, 0x1000);
+    memset(nrrBuffer, 0, nrrSize); // clear buffer out completely
+
+    auto* hashes = reinterpret_cast<Sha256Hash*>(nrrBuffer + sizeof(nn::ro::NrrHeader));
+
+    size_t hashIndex = 0;
+    for (int i = 0; i < mPluginCount; ++i) {
+        if(mPlugins[i].mFileData)
+            hashes[hashIndex++] = mPlugins[i].mPluginHash;
+    }
 
-    auto* header = reinterpret_cast<nn::ro::NrrHeader*>(mNrrBuffer);
+    // ro requires the hash list to be sorted
+    std::sort(hashes, hashes + hashCount);
+    hashCount = std::unique(hashes, hashes + hashCount) - hashes;
+
+    auto* header = reinterpret_cast<nn::ro::NrrHeader*>(nrrBuffer);
 
     *header = nn::ro::NrrHeader {
         .magic = 0x3052524E,
         .program_id = {exl::setting::ProgramId},
-        .size = (u32)mNrrBufferSize,
+        .size = (u32)nrrSize,
         .type = 0,
         .hashes_offset = sizeof(nn::ro::NrrHeader),
-        .num_hashes = (u32)mPluginCount
+        .num_hashes = (u32)hashCount
     };
 
-    auto* hashes = reinterpret_cast<Sha256Hash*>(mNrrBuffer + sizeof(nn::ro::NrrHeader));
+    *outSize = nrrSize;
+    return nrrBuffer;
+}
 
-    size_t hashIndex = 0;
-    mSortedHashes.forEach([hashes, &hashIndex](const Sha256Hash &hash) {
-        hashes[hashIndex++] = hash;
-    });
+void PluginLoader::generatePluginNrr() {
+    mNrrBuffer = createPluginNrr(&mNrrBufferSize);
 
-    // we won't need the sorted hash buffer after this point, so it can be freed
-    pluginFree(mOrderedSetBuffer);
-    mSortedHashes = sead::OrderedSet<Sha256Hash>(); // reset struct
+    Logger::logDeferred("Created Plugin NRR.\n");
+}
+
+bool PluginLoader::rebuildPluginNrr() {
+    nn::ro::RegistrationInfo oldInfo = mRegistrationInfo;
+    u8* oldNrrBuffer = mNrrBuffer;
+
+    mNrrBuffer = nullptr;
+    mNrrBufferSize = 0;
+    mRegistrationInfo = {};
+
+    bool isHashesLeft = false;
+    for (int i = 0; i < mPluginCount; ++i) {
+        if(mPlugins[i].mFileData) {
+            isHashesLeft = true;
+            break;
+        }
+    }
+
+    bool result = true;
+
+    // the new NRR is registered before the old one is dropped, so loaded modules always stay covered
+    if(isHashesLeft) {
+        generatePluginNrr();
+
+        if(nn::ro::RegisterModuleInfo(&mRegistrationInfo, mNrrBuffer).isFailure() || mRegistrationInfo.state != nn::ro::RegistrationInfo::State_Registered) {
+            Logger::logDeferred("Failed to register rebuilt NRR!\n");
+            pluginFree(mNrrBuffer);
+            mNrrBuffer = nullptr;
+            mRegistrationInfo = {};
+            result = false;
+        }
+    }
+
+    if(oldNrrBuffer) {
+        nn::ro::UnregisterModuleInfo(&oldInfo, oldNrrBuffer);
+        pluginFree(oldNrrBuffer);
+    }
+
+    return result;
+}
+
+void PluginLoader::updateHashCache() {
+    Logger::logDeferred("Plugin hash cache hits: %u misses: %u\n", mHashCache.getHitCount(), mHashCache.getMissCount());
+
+    // a cached hash that ro refused means the cache can't be trusted, drop it so everything is rehashed next boot
+    for (int i = 0; i < mPluginCount; ++i) {
+        auto& plugin = mPlugins[i];
+        if(plugin.mIsHashCached && !plugin.mModuleLoaded) {
+            Logger::logDeferred("Cached hash for %s was rejected!\n", plugin.mFileName);
+            PluginHashCache::remove(mHashCachePath);
+            mHashCache.clear();
+            return;
+        }
+    }
+
+    // rewrite the cache if anything was rehashed, or if it holds entries for plugins that no longer exist
+    if(mHashCache.isDirty() || mHashCache.getHitCount() != mHashCache.getEntryCount()) {
+        Logger::logDeferred("Updating Plugin hash cache.\n");
+        PluginHashCache::save(mHashCachePath, mPlugins, mPluginCount);
+    }
 
-    Logger::log("Created Plugin NRR.\n");
+    mHashCache.clear();
 }
 
 bool PluginLoader::registerAndLoadModules() {
     if(nn::ro::RegisterModuleInfo(&mRegistrationInfo, mNrrBuffer).isFailure() || mRegistrationInfo.state != nn::ro::RegistrationInfo::State_Registered) {
-        Logger::log("Failed to register NRR!\n");
+        Logger::logDeferred("Failed to register NRR!\n");
         return false;
     }
 
-    Logger::log("NRR Registered. Loading Modules.\n");
+    Logger::logDeferred("NRR Registered. Loading Modules.\n");
 
     for (int i = 0; i < mPluginCount; ++i) {
-        auto& plugin = mPlugins[i];
+        loadPluginModule(mPlugins[i]);
+    }
 
-        if(nn::ro::LoadModule(&plugin.mModule, plugin.mFileData, plugin.mBssData, plugin.mBssSize, nn::ro::BindFlag_Now).isFailure()) {
-            Logger::log("Failed to Load Module for plugin at: %s/%s\n", plugin.mFilePath, plugin.mFileName);
-        }else {
-            Logger::log("Loaded Module: %s\n", plugin.mFileName);
-            plugin.mModuleLoaded = true;
+    Logger::logDeferred("Modules created and Loaded.\n");
+
+    return true;
+}
+
+bool PluginLoader::loadPluginModule(PluginData& plugin) {
+    int bindFlag = plugin.mIsLazyBind ? nn::ro::BindFlag_Lazy : nn::ro::BindFlag_Now;
+    if(nn::ro::LoadModule(&plugin.mModule, plugin.mFileData, plugin.mBssData, plugin.mBssSize, bindFlag).isFailure()) {
+        Logger::logDeferred("Failed to Load Module for plugin at: %s/%s\n", plugin.mFilePath, plugin.mFileName);
+        // a retry reads the plugin back into new buffers, so these would be leaked
+        pluginFree(plugin.mBssData);
+        pluginFree(plugin.mFileData);
+        plugin.mBssData = nullptr;
+        plugin.mFileData = nullptr;
+        return false;
+    }
+
+    Logger::logDeferred("Loaded Module: %s\n", plugin.mFileName);
+    plugin.mModuleLoaded = true;
+
+    // nn::ro has already pointed the jump slots at the PLT stub, only the resolver behind it is swapped,
+    // so lookups go through the symbol cache and GNU hash tables
+    if(plugin.mIsLazyBind)
+        plugin.mModule.ModuleObject->InstallLazyResolver();
+    handler::invalidateModuleTable();
+
+    uintptr_t moduleBase = (uintptr_t)plugin.mModule.ModuleObject->module_base;
+    if(!handler::getAddrModuleRange(&plugin.mModuleStart, &plugin.mModuleEnd, moduleBase)) {
+        Logger::logDeferred("Unable to find module range for %s! Plugin cannot be unloaded.\n", plugin.mFileName);
+        plugin.mModuleStart = plugin.mModuleEnd = 0;
+    }
+
+    return true;
+}
+
+bool PluginLoader::startPlugin(PluginData& plugin, bool isReload) {
+    Logger::logDeferred("Running plugin_main for %s.\n", plugin.mFileName);
+
+    LoaderCtx ctx = {
+        .mRootPluginHeap = mHeap,
+        .mIsReload = isReload
+    };
+    strcpy(ctx.mLoadDir, plugin.mFilePath + 8); // strlen("sd:/smo/") required for using sead's file device system
+
+    bool isStarted = plugin.runPluginMain(ctx);
+
+    plugin.mHeap = ctx.mChildHeap;
+
+    if(!isStarted) {
+        Logger::logDeferred("Plugin was not able to successfully start.\n");
+        // the plugin's buffers are gone, so its hash has to be dropped from the NRR too
+        if(unloadPluginModule(plugin, false))
+            rebuildPluginNrr();
+    }
+
+    return isStarted;
+}
+
+bool PluginLoader::unloadPluginModule(PluginData& plugin, bool isReload) {
+    if(!plugin.mModuleLoaded)
+        return true;
+
+    // without the range, events pointing into the plugin can't be found, so unloading it would leave them dangling
+    if(plugin.mModuleStart == plugin.mModuleEnd) {
+        Logger::logDeferred("Unable to unload %s, module range is unknown.\n", plugin.mFileName);
+        return false;
+    }
+
+    Logger::logDeferred("Unloading Plugin: %s\n", plugin.mFileName);
+
+    LoaderCtx ctx = {
+        .mRootPluginHeap = mHeap,
+        .mChildHeap = plugin.mHeap,
+        .mIsReload = isReload
+    };
+    strcpy(ctx.mLoadDir, plugin.mFilePath + 8);
+
+    plugin.runPluginExit(ctx);
+
+    char moduleName[0x100] = {};
+    if(!handler::getAddrModuleName(moduleName, plugin.mModuleStart)) {
+        Logger::logDeferred("Unable to find Plugin Module Info.\n");
+    }
+    EventSystem::removeFromEvents(moduleName, plugin.mModuleStart, plugin.mModuleEnd);
+
+    // hooks the plugin installed itself would otherwise keep jumping into the unloaded module
+    size_t unhookCount = exl::hook::UnhookInRange(plugin.mModuleStart, plugin.mModuleEnd);
+    if(unhookCount > 0)
+        Logger::logDeferred("Removed %zu hooks installed by %s.\n", unhookCount, plugin.mFileName);
+
+    // symbols resolved into the plugin would otherwise be handed out again after it's gone
+    exl::util::symbols::InvalidateRange(plugin.mModuleStart, plugin.mModuleEnd);
+    rtld::forget_module(plugin.mModule.ModuleObject);
+    nn::ro::UnloadModule(&plugin.mModule);
+    handler::invalidateModuleTable();
+    plugin.mModuleLoaded = false;
+    plugin.mModuleStart = plugin.mModuleEnd = 0;
+
+    if(plugin.mHeap) {
+        plugin.mHeap->destroy();
+        plugin.mHeap = nullptr;
+    }
+
+    // leave the slot itself in place, so plugin indices stay stable
+    pluginFree(plugin.mBssData);
+    pluginFree(plugin.mFileData);
+    plugin.mBssData = nullptr;
+    plugin.mFileData = nullptr;
+
+    return true;
+}
+
+bool PluginLoader::isPluginDependentOn(const PluginData& plugin, const PluginData& dependency) {
+    if(!plugin.mModuleLoaded || !dependency.mModuleLoaded || &plugin == &dependency)
+        return false;
+
+    // imports that were bound have been written to the module, any relocated slot pointing into the dependency
+    // means the plugin uses something from it.
+    auto* module = plugin.mModule.ModuleObject;
+    auto isSlotInDependency = [&](const Elf_Rela* relocs, size_t relocCount) {
+        for (size_t i = 0; i < relocCount; ++i) {
+            uintptr_t value = *(uintptr_t*)(module->module_base + relocs[i].r_offset);
+            if(value >= dependency.mModuleStart && value < dependency.mModuleEnd)
+                return true;
+        }
+        return false;
+    };
+
+    // aarch64 modules only ever use rela relocations
+    if(!module->is_rela)
+        return false;
+
+    if(isSlotInDependency(module->rela_or_rel_plt.rela, module->rela_or_rel_plt_size / sizeof(Elf_Rela)) ||
+       isSlotInDependency(module->rela_or_rel.rela, module->rela_dyn_size / sizeof(Elf_Rela)))
+        return true;
+
+    if(!plugin.mIsLazyBind)
+        return false;
+
+    // functions a lazily bound plugin hasn't called yet don't point anywhere, so check if the dependency would provide them
+    const Elf_Rela* relocs = module->rela_or_rel_plt.rela;
+    size_t relocCount = module->rela_or_rel_plt_size / sizeof(Elf_Rela);
+    for (size_t i = 0; i < relocCount; ++i) {
+        if(*(void**)(module->module_base + relocs[i].r_offset) != module->got_stub_ptr)
+            continue;
+
+        uintptr_t address = 0;
+        const char* name = module->dynstr + module->dynsym[ELF_R_SYM(relocs[i].r_info)].st_name;
+        if(nn::ro::LookupModuleSymbol(&address, &dependency.mModule, name).isSuccess())
+            return true;
+    }
+
+    return false;
+}
+
+void PluginLoader::collectDependents(int idx, bool* outIsMarked) {
+    outIsMarked[idx] = true;
+
+    for (int i = 0; i < mPluginCount; ++i) {
+        if(!outIsMarked[i] && isPluginDependentOn(mPlugins[i], mPlugins[idx]))
+            collectDependents(i, outIsMarked);
+    }
+}
+
+void PluginLoader::unloadMarkedPlugins(const bool* isMarked, bool isReload) {
+    bool isPending[mPluginCount];
+    for (int i = 0; i < mPluginCount; ++i) {
+        isPending[i] = isMarked[i] && mPlugins[i].mModuleLoaded;
+    }
+
+    // dependents go first, so a plugin's exit never runs after something it imports from is gone
+    bool isProgress = true;
+    while (isProgress) {
+        isProgress = false;
+
+        for (int i = 0; i < mPluginCount; ++i) {
+            if(!isPending[i])
+                continue;
+
+            bool isInUse = false;
+            for (int j = 0; j < mPluginCount && !isInUse; ++j) {
+                isInUse = isPending[j] && isPluginDependentOn(mPlugins[j], mPlugins[i]);
+            }
+
+            if(isInUse)
+                continue;
+
+            unloadPluginModule(mPlugins[i], isReload);
+            isPending[i] = false;
+            isProgress = true;
+        }
+    }
+
+    // anything left depends on itself in some way, so there is no correct order left to follow
+    for (int i = 0; i < mPluginCount; ++i) {
+        if(isPending[i]) {
+            Logger::logDeferred("%s has a circular dependency, unloading anyway.\n", mPlugins[i].mFileName);
+            unloadPluginModule(mPlugins[i], isReload);
         }
     }
+}
+
+bool PluginLoader::reloadPluginData(PluginData& plugin) {
+    FsHelper::DirFileEntry entry = {};
+    snprintf(entry.fullPath, sizeof(entry.fullPath), "%s/%s", plugin.mFilePath, plugin.mFileName);
+    entry.bufSize = FsHelper::getFileSize(entry.fullPath);
+
+    if(entry.bufSize < 0 || !createPluginData(plugin, entry)) {
+        Logger::logDeferred("Unable to read Plugin: %s\n", entry.fullPath);
+        return false;
+    }
 
-    Logger::log("Modules created and Loaded.\n");
+    plugin.mIsHashCached = false;
+    NroHashThread::hash(makeHashJob(plugin));
 
     return true;
 }
@@ -162,67 +608,106 @@ bool PluginLoader::registerAndLoadModules() {
 bool PluginLoader::loadPlugins(const char* rootDir, bool isReload) {
     auto& inst = instance();
 
+    inst.mTimings = {};
+    nn::os::Tick loadStart = nn::os::GetSystemTick();
+
     // init ro
     nn::ro::Initialize();
 
-    Logger::log("Loading nro files within %s.\n", rootDir);
+    Logger::logDeferred("Loading nro files within %s.\n", rootDir);
+
+    snprintf(inst.mHashCachePath, sizeof(inst.mHashCachePath), "%s/.nrrcache", rootDir);
+    inst.mHashCache.resetStats();
+    inst.mHashCache.load(inst.mHashCachePath);
 
-    // get root dir info
+    // get root dir info (files are read later on, directly into the plugin heap)
+    nn::os::Tick stageStart = nn::os::GetSystemTick();
     s64 nroCount = 0;
-    FsHelper::DirFileEntry *fileData = FsHelper::loadFilesFromDirectory(rootDir, &nroCount, ".nro");
+    FsHelper::DirFileEntry *fileData = FsHelper::getFilesFromDirectory(rootDir, &nroCount, ".nro");
+    inst.mTimings.mScanTime = getElapsedMicros(stageStart);
 
-    Logger::log("Found %d NRO(s) from Directory.\n", nroCount);
+    Logger::logDeferred("Found %ld NRO(s) from Directory.\n", nroCount);
     
     inst.preparePluginsForLoad(nroCount, fileData);
 
+    stageStart = nn::os::GetSystemTick();
     inst.generatePluginNrr();
+    inst.mTimings.mNrrTime = getElapsedMicros(stageStart);
 
+    stageStart = nn::os::GetSystemTick();
     if(!inst.registerAndLoadModules()) {
-        Logger::log("Failed to Register/Load Plugin modules. Unable to continue.\n");
+        Logger::logDeferred("Failed to Register/Load Plugin modules. Unable to continue.\n");
+        PluginHashCache::remove(inst.mHashCachePath);
+        inst.mHashCache.clear();
         return false;
     }
+    inst.mTimings.mLoadTime = getElapsedMicros(stageStart);
 
-    Logger::log("Finished Loading Plugins.\n");
+    inst.updateHashCache();
+
+    Logger::logDeferred("Finished Loading Plugins.\n");
 
     inst.mIsPluginsLoaded = true;
 
+    stageStart = nn::os::GetSystemTick();
+
     for (int i = 0; i < inst.mPluginCount; ++i) {
         auto& plugin = inst.mPlugins[i];
-        if(!plugin.mModuleLoaded)
-            continue;
-
-        Logger::log("Running plugin_main for %s.\n", plugin.mFileName);
-
-        LoaderCtx ctx = {
-            .mRootPluginHeap = inst.mHeap,
-            .mIsReload = isReload
-        };
-        strcpy(ctx.mLoadDir, plugin.mFilePath + 8); // strlen("sd:/smo/") required for using sead's file device system
+        if(plugin.mModuleLoaded)
+            inst.startPlugin(plugin, isReload);
+    }
 
-        if(!plugin.runPluginMain(ctx)) {
-            Logger::log("Plugin was not able to successfully start.\n");
-            // TODO: unload individual plugin
-            continue;
-        }
+    inst.mTimings.mMainTime = getElapsedMicros(stageStart);
+    inst.mTimings.mTotalTime = getElapsedMicros(loadStart);
 
-        plugin.mHeap = ctx.mChildHeap;
+    // plugin changes are picked up on the watcher thread, then reloaded after the next sequence update.
+    inst.mWatcher.start(inst.mPlugins, inst.mPluginCount);
+    // unlike events, this hook isn't owned by a plugin and survives unloadPlugins, so it only needs installing once
+    static bool sIsUpdateHookInstalled = false;
+    if (!sIsUpdateHookInstalled) {
+        HakoniwaSequenceUpdateHook::InstallAtSymbol("_ZN16HakoniwaSequence6updateEv");
+        sIsUpdateHookInstalled = true;
     }
 
+    auto& timings = inst.mTimings;
+    Logger::logDeferred("Plugin Load Timings (us): Scan: %ld Read: %ld (%zu bytes) Hash: %ld Hash Wait: %ld NRR: %ld Load: %ld Main: %ld Total: %ld\n",
+                        timings.mScanTime, timings.mReadTime, timings.mBytesRead, timings.mHashTime, timings.mHashWaitTime,
+                        timings.mNrrTime, timings.mLoadTime, timings.mMainTime, timings.mTotalTime);
+
     return true;
 }
 
 void PluginLoader::unloadPlugins() {
     auto& inst = instance();
 
+    inst.mWatcher.stop();
+
+    // run through the regular per-plugin teardown first, so every plugin gets its plugin_exit call
+    bool isMarked[inst.mPluginCount];
+    memset(isMarked, true, sizeof(isMarked));
+    inst.unloadMarkedPlugins(isMarked, false);
+
     for (int i = 0; i < inst.mPluginCount; ++i) {
         auto& plugin = inst.mPlugins[i];
-        nn::ro::UnloadModule(&plugin.mModule);
+        if(plugin.mModuleLoaded) {
+            rtld::forget_module(plugin.mModule.ModuleObject);
+            nn::ro::UnloadModule(&plugin.mModule);
+        }
     }
+    handler::invalidateModuleTable();
+    exl::util::symbols::Invalidate();
+
+    if(inst.mNrrBuffer)
+        nn::ro::UnregisterModuleInfo(&inst.mRegistrationInfo, inst.mNrrBuffer);
 
     // reset plugin heap
     inst.mHeap->freeAll();
 
+    inst.mPlugins = nullptr;
     inst.mPluginCount = 0;
+    inst.mNrrBuffer = nullptr;
+    inst.mNrrBufferSize = 0;
+    inst.mRegistrationInfo = {};
     inst.mIsPluginsLoaded = false;
 
     // remove all plugin events (the only one the loader uses doesn't ever run again after game init)
@@ -233,18 +718,114 @@ void PluginLoader::unloadPlugins() {
     nn::ro::Finalize();
 }
 
-void PluginLoader::unloadPluginByName(const char* name) {
-    Logger::log("Unloading Plugin: %s\n", name);
+void PluginLoader::reloadChangedPlugins() {
+    auto& inst = instance();
+
+    int pluginIdx = 0;
+    nn::os::Tick changeTick;
+    while (inst.mWatcher.tryGetChangedPlugin(&pluginIdx, &changeTick)) {
+        Logger::logDeferred("Plugin changed on SD: %s\n", inst.mPlugins[pluginIdx].mFileName);
+
+        nn::os::Tick reloadStart = nn::os::GetSystemTick();
+        reloadPluginByIdx(pluginIdx);
+        inst.mWatcher.setReloadStats(getElapsedMicros(reloadStart), getElapsedMicros(changeTick));
+    }
+}
+
+void PluginLoader::runPendingRequests() {
+    auto& inst = instance();
+
+    u64 request = 0;
+    while (nn::os::TryReceiveMessageQueue(&request, &inst.mRequestQueue)) {
+        int pluginIdx = (int)(request >> 1);
+        if(request & cUnloadRequestFlag)
+            unloadPluginByIdx(pluginIdx);
+        else
+            reloadPluginByIdx(pluginIdx);
+    }
+}
+
+void PluginLoader::requestReload(int index) {
+    if(!nn::os::TrySendMessageQueue(&instance().mRequestQueue, (u64)index << 1))
+        Logger::logDeferred("Too many pending plugin requests! Dropped reload of Plugin %d.\n", index);
+}
 
-    EventSystem::removeFromEvents(name); // removes all events registered to the plugins name (without .nro)
+void PluginLoader::requestUnload(int index) {
+    if(!nn::os::TrySendMessageQueue(&instance().mRequestQueue, ((u64)index << 1) | cUnloadRequestFlag))
+        Logger::logDeferred("Too many pending plugin requests! Dropped unload of Plugin %d.\n", index);
+}
 
+void PluginLoader::unloadPluginByName(const char* name) {
+    int idx = getPluginIdxByName(name);
 
+    if(idx < 0) {
+        Logger::logDeferred("Unable to find Plugin: %s\n", name);
+        return;
+    }
 
-    // TODO: actually unload
+    unloadPluginByIdx(idx);
 }
 
 void PluginLoader::unloadPluginByIdx(int index) {
+    auto& inst = instance();
     PluginData* data = getPluginData(index);
+
+    if(!data || !data->mModuleLoaded)
+        return;
+
+    // anything importing from the plugin has to go with it
+    bool isMarked[inst.mPluginCount];
+    memset(isMarked, false, sizeof(isMarked));
+    inst.collectDependents(index, isMarked);
+
+    inst.unloadMarkedPlugins(isMarked, false);
+    inst.rebuildPluginNrr();
+}
+
+bool PluginLoader::reloadPluginByIdx(int index) {
+    auto& inst = instance();
+    PluginData* data = getPluginData(index);
+
+    if(!data)
+        return false;
+
+    Logger::logDeferred("Reloading Plugin: %s\n", data->mFileName);
+
+    bool isMarked[inst.mPluginCount];
+    memset(isMarked, false, sizeof(isMarked));
+    inst.collectDependents(index, isMarked);
+
+    inst.unloadMarkedPlugins(isMarked, true);
+
+    // a plugin that failed to unload is still using its old buffers, so it can't be read back in
+    for (int i = 0; i < inst.mPluginCount; ++i) {
+        if(isMarked[i] && (inst.mPlugins[i].mModuleLoaded || !inst.reloadPluginData(inst.mPlugins[i])))
+            isMarked[i] = false;
+    }
+
+    // every reloaded plugin is covered by a single NRR
+    if(!inst.rebuildPluginNrr()) {
+        Logger::logDeferred("Failed to rebuild NRR! Unable to reload Plugins.\n");
+        for (int i = 0; i < inst.mPluginCount; ++i) {
+            auto& plugin = inst.mPlugins[i];
+            if(isMarked[i]) {
+                pluginFree(plugin.mBssData);
+                pluginFree(plugin.mFileData);
+                plugin.mBssData = nullptr;
+                plugin.mFileData = nullptr;
+            }
+        }
+        return false;
+    }
+
+    // reload in the original order, which has dependencies loaded before anything using them
+    for (int i = 0; i < inst.mPluginCount; ++i) {
+        auto& plugin = inst.mPlugins[i];
+        if(isMarked[i] && inst.loadPluginModule(plugin))
+            inst.startPlugin(plugin, true);
+    }
+
+    return data->mModuleLoaded;
 }
 
 void PluginLoader::getPluginNames(const char** outBuffer) {
@@ -1,13 +1,18 @@
 #pragma once
 
+#include "NroHashThread.h"
 #include "PluginData.h"
+#include "PluginHashCache.h"
+#include "PluginWatcher.h"
 #include "helpers.h"
 
 #include <set>
 #include <cstring>
 
 #include "nn/crypto.h"
+#include "nn/os.h"
 #include "nn/ro.h"
+#include "os/os_tick.hpp"
 #include "sha256.h"
 #include <container/seadOrderedSet.h>
 #include <heap/seadExpHeap.h>
@@ -15,8 +20,24 @@
 // A decent amount of this implementation references skyline
 // (https://github.com/skyline-dev/skyline/blob/master/source/skyline)
 
+// per-stage timings (in microseconds) of the last call to PluginLoader::loadPlugins
+struct PluginLoadTimings {
+    s64 mScanTime = 0;     // directory walk
+    s64 mReadTime = 0;     // reading NROs into the plugin heap
+    s64 mHashTime = 0;     // time spent hashing on the hash thread (overlaps with mReadTime)
+    s64 mHashWaitTime = 0; // time spent waiting on the hash thread after the last read finished
+    s64 mNrrTime = 0;      // NRR generation
+    s64 mLoadTime = 0;     // NRR registration and module loading
+    s64 mMainTime = 0;     // running plugin_main for every plugin
+    s64 mTotalTime = 0;
+    size_t mBytesRead = 0;
+};
+
 class PluginLoader {
 
+    static constexpr size_t cRequestQueueSize = 0x10;
+    static constexpr u64 cUnloadRequestFlag = 1; // requests are the plugin index shifted up by one, or'd with this
+
     PluginData* mPlugins = {};
     size_t mPluginCount = {};
 
@@ -32,14 +53,58 @@ class PluginLoader {
 
     bool mIsPluginsLoaded = false;
 
+    // NRO hashing is done on a separate thread so it can overlap with reading the next file from the SD card
+    NroHashThread mHashThread = {};
+
+    PluginLoadTimings mTimings = {};
+
+    PluginHashCache mHashCache = {};
+    char mHashCachePath[0x40] = {};
+
+    PluginWatcher mWatcher = {};
+
+    // reloads and unloads requested from the debug window, run at the same point as the watcher's reloads
+    nn::os::MessageQueueType mRequestQueue = {};
+    u64 mRequestQueueBuffer[cRequestQueueSize] = {};
+
+    PluginLoader();
+
     bool createPluginData(PluginData& data, const FsHelper::DirFileEntry& entry);
 
     void preparePluginsForLoad(s32 nroCount, FsHelper::DirFileEntry *fileData);
 
+    void registerPluginHashes();
+
+    void updateHashCache();
+
+    void startHashThread();
+
+    u8* createPluginNrr(size_t* outSize);
+
     void generatePluginNrr();
 
+    // swaps the registered NRR for one matching the plugins currently in memory
+    bool rebuildPluginNrr();
+
     bool registerAndLoadModules();
 
+    bool loadPluginModule(PluginData& plugin);
+
+    // runs plugin_main, unloading the plugin again if it fails to start
+    bool startPlugin(PluginData& plugin, bool isReload);
+
+    // runs plugin_exit, removes the plugins events and frees everything owned by it
+    bool unloadPluginModule(PluginData& plugin, bool isReload);
+
+    bool reloadPluginData(PluginData& plugin);
+
+    static bool isPluginDependentOn(const PluginData& plugin, const PluginData& dependency);
+
+    // marks the plugin at idx, along with every plugin that imports from it (directly or not)
+    void collectDependents(int idx, bool* outIsMarked);
+
+    void unloadMarkedPlugins(const bool* isMarked, bool isReload);
+
 public:
 
     static PluginLoader& instance();
@@ -48,10 +113,25 @@ public:
 
     static void unloadPlugins();
 
+    // reloads any plugins the watcher found changes for, must only be called between frames
+    static void reloadChangedPlugins();
+
+    // runs every queued reload and unload request, must only be called between frames
+    static void runPendingRequests();
+
+    // queues a reload of the plugin for the next time requests are run, safe to call from any thread
+    static void requestReload(int index);
+
+    // queues an unload of the plugin for the next time requests are run, safe to call from any thread
+    static void requestUnload(int index);
+
     static void unloadPluginByName(const char* name);
 
     static void unloadPluginByIdx(int index);
 
+    // unloads the plugin (and its dependents), then loads them all again from the SD card
+    static bool reloadPluginByIdx(int index);
+
     static sead::Heap* createHeap();
 
     static sead::Heap* getHeap();
@@ -66,4 +146,10 @@ public:
 
     static int getPluginIdxByName(const char *name);
 
+    static const PluginLoadTimings& getLoadTimings() { return instance().mTimings; }
+
+    static const PluginHashCache& getHashCache() { return instance().mHashCache; }
+
+    static const PluginWatcher& getWatcher() { return instance().mWatcher; }
+
 };
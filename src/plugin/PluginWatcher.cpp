@@ -0,0 +1,168 @@
+#include "PluginWatcher.h"
+#include "PluginData.h"
+#include "logger/Logger.hpp"
+
+#include "nn/init.h"
+#include <cstring>
+
+alignas(nn::os::ThreadStackAlignment) static u8 sWatcherThreadStack[0x4000];
+
+void PluginWatcher::start(const PluginData* plugins, size_t count) {
+    if(mIsRunning || count == 0)
+        return;
+
+    mEntries = (Entry*)nn::init::GetAllocator()->Allocate(sizeof(Entry) * count);
+    mEntryCount = count;
+
+    for (int i = 0; i < count; ++i) {
+        const PluginData& plugin = plugins[i];
+        Entry& entry = mEntries[i];
+
+        strcpy(entry.mDirPath, plugin.mFilePath);
+        strcpy(entry.mFileName, plugin.mFileName);
+        entry.mFileSize = plugin.mFileSize;
+        entry.mTimeStamp = plugin.mTimeStamp;
+        entry.mIsChanging = false;
+        entry.mChangeTick = nn::os::Tick(0);
+    }
+
+    mDirEntries = (nn::fs::DirectoryEntry*)nn::init::GetAllocator()->Allocate(sizeof(nn::fs::DirectoryEntry) * cDirEntryBufferCount);
+
+    nn::os::InitializeMessageQueue(&mChangeQueue, mChangeQueueBuffer, cChangeQueueSize);
+    mIsExitRequested = false;
+
+    // lowest priority, so polling never gets in the way of the game's own threads
+    nn::Result result = nn::os::CreateThread(&mThread, threadMain, this, sWatcherThreadStack, sizeof(sWatcherThreadStack),
+                                             nn::os::LowestThreadPriority, (nn::os::GetCurrentCoreNumber() + 1) % 3);
+
+    if(result.isFailure()) {
+        Logger::log("Failed to create Plugin watcher thread! Plugins will not be reloaded automatically.\n");
+        nn::os::FinalizeMessageQueue(&mChangeQueue);
+        nn::init::GetAllocator()->Free(mDirEntries);
+        nn::init::GetAllocator()->Free(mEntries);
+        mDirEntries = nullptr;
+        mEntries = nullptr;
+        mEntryCount = 0;
+        return;
+    }
+
+    nn::os::SetThreadName(&mThread, "PluginWatcherThread");
+    nn::os::StartThread(&mThread);
+    mIsRunning = true;
+}
+
+void PluginWatcher::stop() {
+    if(!mIsRunning)
+        return;
+
+    mIsExitRequested = true;
+    nn::os::WaitThread(&mThread);
+    nn::os::DestroyThread(&mThread);
+    nn::os::FinalizeMessageQueue(&mChangeQueue);
+
+    nn::init::GetAllocator()->Free(mDirEntries);
+    nn::init::GetAllocator()->Free(mEntries);
+    mDirEntries = nullptr;
+    mEntries = nullptr;
+    mEntryCount = 0;
+
+    mIsRunning = false;
+}
+
+bool PluginWatcher::tryGetChangedPlugin(int* outIdx, nn::os::Tick* outChangeTick) {
+    if(!mIsRunning)
+        return false;
+
+    u64 entryIdx = 0;
+    if(!nn::os::TryReceiveMessageQueue(&entryIdx, &mChangeQueue))
+        return false;
+
+    *outIdx = (int)entryIdx;
+    *outChangeTick = mEntries[entryIdx].mChangeTick;
+    return true;
+}
+
+void PluginWatcher::threadMain(void* arg) {
+    auto* watcher = (PluginWatcher*)arg;
+
+    // no logging is done on this thread, as the logger isn't safe to use off of the main thread
+    while (true) {
+        for (s64 slept = 0; slept < cPollIntervalMs; slept += cSleepSliceMs) {
+            if(watcher->mIsExitRequested)
+                return;
+            nn::os::SleepThread(nn::TimeSpan::FromMilliSeconds(cSleepSliceMs));
+        }
+
+        watcher->poll();
+    }
+}
+
+void PluginWatcher::poll() {
+    nn::os::Tick startTick = nn::os::GetSystemTick();
+
+    // plugins from the same directory are next to each other, so each directory only has to be read once
+    size_t startIdx = 0;
+    while (startIdx < mEntryCount) {
+        size_t endIdx = startIdx + 1;
+        while (endIdx < mEntryCount && strcmp(mEntries[endIdx].mDirPath, mEntries[startIdx].mDirPath) == 0)
+            endIdx++;
+
+        pollDirectory(startIdx, endIdx);
+        startIdx = endIdx;
+    }
+
+    mLastPollTime = (nn::os::GetSystemTick() - startTick).ToTimeSpan().GetMicroSeconds();
+    mPollCount++;
+}
+
+void PluginWatcher::pollDirectory(size_t startIdx, size_t endIdx) {
+    nn::fs::DirectoryHandle handle{};
+    if(nn::fs::OpenDirectory(&handle, mEntries[startIdx].mDirPath, nn::fs::OpenDirectoryMode_File).isFailure())
+        return;
+
+    // directories with more files than the buffer can hold are read in chunks
+    while (true) {
+        s64 readCount = 0;
+        if(nn::fs::ReadDirectory(&readCount, mDirEntries, handle, cDirEntryBufferCount).isFailure() || readCount == 0)
+            break;
+
+        for (int i = 0; i < readCount; ++i) {
+            for (size_t j = startIdx; j < endIdx; ++j) {
+                if(strcmp(mDirEntries[i].m_Name, mEntries[j].mFileName) == 0) {
+                    checkEntry(j, mDirEntries[i].m_FileSize);
+                    break;
+                }
+            }
+        }
+    }
+
+    nn::fs::CloseDirectory(handle);
+}
+
+void PluginWatcher::checkEntry(size_t idx, s64 fileSize) {
+    Entry& entry = mEntries[idx];
+
+    char fullPath[0x80] = {};
+    snprintf(fullPath, sizeof(fullPath), "%s/%s", entry.mDirPath, entry.mFileName);
+
+    nn::fs::FileTimeStamp timeStamp = {};
+    if(nn::fs::GetFileTimeStampForDebug(&timeStamp, fullPath).isFailure())
+        return;
+
+    bool isSame = entry.mFileSize == fileSize && entry.mTimeStamp.mTime1 == timeStamp.mTime1 &&
+                  entry.mTimeStamp.mTime2 == timeStamp.mTime2 && entry.mTimeStamp.mTime3 == timeStamp.mTime3;
+
+    if(!isSame) {
+        // the file may still be getting written, so wait for it to stay the same for a full poll
+        if(!entry.mIsChanging)
+            entry.mChangeTick = nn::os::GetSystemTick();
+
+        entry.mFileSize = fileSize;
+        entry.mTimeStamp = timeStamp;
+        entry.mIsChanging = true;
+        return;
+    }
+
+    if(entry.mIsChanging && nn::os::TrySendMessageQueue(&mChangeQueue, idx))
+        entry.mIsChanging = false;
+}
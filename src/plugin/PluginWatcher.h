@@ -0,0 +1,87 @@
+#pragma once
+
+#include "types.h"
+
+#include "nn/fs.h"
+#include "nn/os.h"
+#include "os/os_tick.hpp"
+#include <atomic>
+
+class PluginData;
+
+// polls the plugin directories on a background thread, looking for plugins that were changed on the SD card.
+// only directory entries (for file sizes) and file timestamps are checked, plugin files are never opened.
+// changes are handed to the main thread through a queue, as the reload itself has to happen between frames.
+class PluginWatcher {
+
+    static constexpr s64 cPollIntervalMs = 1000;
+    static constexpr s64 cSleepSliceMs = 100; // how long the thread sleeps between checking if it should exit
+    static constexpr size_t cChangeQueueSize = 0x10;
+    static constexpr size_t cDirEntryBufferCount = 0x10;
+
+    struct Entry {
+        char mDirPath[0x40];
+        char mFileName[0x30];
+        s64 mFileSize;
+        nn::fs::FileTimeStamp mTimeStamp;
+        bool mIsChanging; // changed during the last poll, waiting for the file to settle before reporting it
+        nn::os::Tick mChangeTick;
+    };
+
+    Entry* mEntries = nullptr;
+    size_t mEntryCount = 0;
+
+    nn::fs::DirectoryEntry* mDirEntries = nullptr;
+
+    nn::os::ThreadType mThread = {};
+    nn::os::MessageQueueType mChangeQueue = {};
+    u64 mChangeQueueBuffer[cChangeQueueSize] = {};
+    bool mIsRunning = false;
+    std::atomic<bool> mIsExitRequested = false;
+
+    std::atomic<s64> mLastPollTime = 0;
+    std::atomic<u32> mPollCount = 0;
+
+    // only touched by the main thread
+    s64 mLastReloadTime = 0;
+    s64 mLastReloadLatency = 0;
+    u32 mReloadCount = 0;
+
+    static void threadMain(void* arg);
+
+    void poll();
+
+    void pollDirectory(size_t startIdx, size_t endIdx);
+
+    void checkEntry(size_t idx, s64 fileSize);
+
+public:
+
+    // starts watching every plugin in the list, indices reported by tryGetChangedPlugin match the list
+    void start(const PluginData* plugins, size_t count);
+
+    void stop();
+
+    bool isRunning() const { return mIsRunning; }
+
+    bool tryGetChangedPlugin(int* outIdx, nn::os::Tick* outChangeTick);
+
+    void setReloadStats(s64 reloadTime, s64 reloadLatency) {
+        mLastReloadTime = reloadTime;
+        mLastReloadLatency = reloadLatency;
+        mReloadCount++;
+    }
+
+    // time (in microseconds) the last poll took on the watcher thread
+    s64 getLastPollTime() const { return mLastPollTime; }
+
+    u32 getPollCount() const { return mPollCount; }
+
+    // time (in microseconds) the last reload took
+    s64 getLastReloadTime() const { return mLastReloadTime; }
+
+    // time (in microseconds) between the last change being seen and the reload finishing
+    s64 getLastReloadLatency() const { return mLastReloadLatency; }
+
+    u32 getReloadCount() const { return mReloadCount; }
+};
@@ -1,20 +1,197 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
+#include <cstring>
 
 #include "types.h"
 #include "lib.hpp"
+#include "EventProfiler.h"
+
+// subscriber storage for hook events, keeping the exact prefix/postfix signatures of the event.
+// prefixes and postfixes are stored in separate dense arrays, so an event that only has one of the two
+// never leaves empty slots for the hook callback to skip over.
+// both arrays are kept sorted by priority (highest runs first), subscribers with equal priority run in registration order.
+//
+// hooks run on any game thread while plugins add or remove subscribers, so like ModEventTable readers only ever see
+// a table through an atomic pointer, and every change is built into the other table and swapped in.
+// each table counts the readers currently running it. a table is only rewritten once it has none left, and removals
+// wait for the old table's readers before returning, so nothing still calls into a module once it's been removed.
+// adding or removing subscribers must not happen from inside a subscriber of the same event, as it would wait on itself.
+template <typename PrefixFunc, typename PostfixFunc>
+struct HookEventStorage {
+    static constexpr size_t cMaxEvents = 100;
+
+private:
+    struct Table {
+        PrefixFunc* mPrefixes[cMaxEvents];
+        s32 mPrefixPriorities[cMaxEvents];
+        size_t mPrefixCount;
+
+        PostfixFunc* mPostfixes[cMaxEvents];
+        s32 mPostfixPriorities[cMaxEvents];
+        size_t mPostfixCount;
+
+        std::atomic<u32> mReaderCount;
+    };
+
+    Table mTables[2] = {};
+    std::atomic<Table*> mActive = &mTables[0];
 
-// this system sucks, casting a function pointer to void ptr means we lose whatever the signature is, so the event isn't guaranteed to match
-class EventData {
 public:
-    template<typename Prefix, typename Postfix>
-    EventData(Prefix* prefix, Postfix* postfix) : mPrefixPtr(reinterpret_cast<void*>(prefix)), mPostfixPtr(reinterpret_cast<void*>(postfix)) {}
+    EventProfile mProfile = {};
+
+    bool add(PrefixFunc* prefix, PostfixFunc* postfix, s32 priority) {
+        Table* active = mActive.load(std::memory_order_relaxed);
+        if((prefix && active->mPrefixCount >= cMaxEvents) || (postfix && active->mPostfixCount >= cMaxEvents))
+            return false;
+
+        Table* next = beginWrite();
+        if(prefix)
+            insert(next->mPrefixes, next->mPrefixPriorities, next->mPrefixCount, prefix, priority);
+        if(postfix)
+            insert(next->mPostfixes, next->mPostfixPriorities, next->mPostfixCount, postfix, priority);
+        publish(next);
+
+        return true;
+    }
+
+    void clear() {
+        Table* next = beginWrite();
+        next->mPrefixCount = 0;
+        next->mPostfixCount = 0;
+        publishAndWait(next);
+    }
+
+    // used to remove events owned by a module that is being unloaded, once this returns none of them are running
+    void removeInRange(uintptr_t start, uintptr_t end) {
+        Table* next = beginWrite();
+        next->mPrefixCount = compact(next->mPrefixes, next->mPrefixPriorities, next->mPrefixCount, start, end);
+        next->mPostfixCount = compact(next->mPostfixes, next->mPostfixPriorities, next->mPostfixCount, start, end);
+        publishAndWait(next);
+    }
+
+    bool isEmpty() const {
+        const Table* active = mActive.load(std::memory_order_acquire);
+        return active->mPrefixCount == 0 && active->mPostfixCount == 0;
+    }
+
+    // invoke is given each prefix in order, returns false if a prefix cancelled the original function
+    template <typename Invoke>
+    ALWAYS_INLINE bool runPrefixes(Invoke invoke) {
+        Table* table = acquireTable();
+        bool isContinue = true;
+
+        if(!EventProfiler::isEnabled()) {
+            for (size_t i = 0; i < table->mPrefixCount && isContinue; ++i) {
+                isContinue = invoke(table->mPrefixes[i]);
+            }
+        } else {
+            for (size_t i = 0; i < table->mPrefixCount && isContinue; ++i) {
+                PrefixFunc* prefix = table->mPrefixes[i];
+                nn::os::Tick startTick = nn::os::GetSystemTick();
+                isContinue = invoke(prefix);
+                mProfile.addSample(reinterpret_cast<uintptr_t>(prefix), nn::os::GetSystemTick() - startTick, false);
+            }
+        }
+
+        releaseTable(table);
+        return isContinue;
+    }
+
+    template <typename Invoke>
+    ALWAYS_INLINE void runPostfixes(Invoke invoke) {
+        Table* table = acquireTable();
+
+        if(!EventProfiler::isEnabled()) {
+            for (size_t i = 0; i < table->mPostfixCount; ++i) {
+                invoke(table->mPostfixes[i]);
+            }
+        } else {
+            for (size_t i = 0; i < table->mPostfixCount; ++i) {
+                PostfixFunc* postfix = table->mPostfixes[i];
+                nn::os::Tick startTick = nn::os::GetSystemTick();
+                invoke(postfix);
+                mProfile.addSample(reinterpret_cast<uintptr_t>(postfix), nn::os::GetSystemTick() - startTick, true);
+            }
+        }
+
+        releaseTable(table);
+    }
+
+private:
+    // the reader count is taken before checking the table is still active, a writer that swapped it out in between
+    // either sees the count and waits, or the reader sees the swap and moves on to the new table
+    ALWAYS_INLINE Table* acquireTable() {
+        while (true) {
+            Table* table = mActive.load(std::memory_order_seq_cst);
+            table->mReaderCount.fetch_add(1, std::memory_order_seq_cst);
+            if(mActive.load(std::memory_order_seq_cst) == table)
+                return table;
+            table->mReaderCount.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    ALWAYS_INLINE void releaseTable(Table* table) {
+        table->mReaderCount.fetch_sub(1, std::memory_order_release);
+    }
+
+    static void waitForReaders(Table* table) {
+        while (table->mReaderCount.load(std::memory_order_seq_cst) != 0) {
+            nn::os::SleepThread(nn::TimeSpan::FromMicroSeconds(100));
+        }
+    }
+
+    // only one thread ever adds or removes events, so writers don't need to be ordered among themselves
+    Table* beginWrite() {
+        Table* active = mActive.load(std::memory_order_relaxed);
+        Table* next = active == &mTables[0] ? &mTables[1] : &mTables[0];
+
+        waitForReaders(next);
+
+        memcpy(next->mPrefixes, active->mPrefixes, sizeof(next->mPrefixes));
+        memcpy(next->mPrefixPriorities, active->mPrefixPriorities, sizeof(next->mPrefixPriorities));
+        next->mPrefixCount = active->mPrefixCount;
+        memcpy(next->mPostfixes, active->mPostfixes, sizeof(next->mPostfixes));
+        memcpy(next->mPostfixPriorities, active->mPostfixPriorities, sizeof(next->mPostfixPriorities));
+        next->mPostfixCount = active->mPostfixCount;
+
+        return next;
+    }
+
+    Table* publish(Table* next) {
+        return mActive.exchange(next, std::memory_order_seq_cst);
+    }
+
+    void publishAndWait(Table* next) {
+        waitForReaders(publish(next));
+    }
 
-    template<typename Prefix>
-    explicit EventData(Prefix* prefix) : mPrefixPtr(reinterpret_cast<void*>(prefix)) {}
+    template <typename Func>
+    static void insert(Func** funcs, s32* priorities, size_t& count, Func* func, s32 priority) {
+        // insert after every subscriber of equal or higher priority, keeping the order stable
+        size_t idx = count;
+        while (idx > 0 && priorities[idx - 1] < priority) {
+            funcs[idx] = funcs[idx - 1];
+            priorities[idx] = priorities[idx - 1];
+            idx--;
+        }
 
-    EventData() = default;
+        funcs[idx] = func;
+        priorities[idx] = priority;
+        count++;
+    }
 
-    void* mPrefixPtr = nullptr;
-    void* mPostfixPtr = nullptr;
-};
\ No newline at end of file
+    template <typename Func>
+    static size_t compact(Func** funcs, s32* priorities, size_t count, uintptr_t start, uintptr_t end) {
+        size_t newCount = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto addr = reinterpret_cast<uintptr_t>(funcs[i]);
+            if(addr < start || addr >= end) {
+                funcs[newCount] = funcs[i];
+                priorities[newCount] = priorities[i];
+                newCount++;
+            }
+        }
+        return newCount;
+    }
+};
@@ -9,34 +9,50 @@
 #define CREATE_HOOK_EVENT(Name, HookVal)                                                                                                     \
 struct Name : public EventHolderHook<Name> {                                                                                                 \
     static constexpr auto InstallVal = HookVal;                                                                                              \
+    static constexpr auto EventName = #Name;                                                                                                 \
     static COMPILE_RULES bool addEvent(EventHolderHook<Name>::PrefixFuncType prefixFunc, EventHolderHook<Name>::PostfixFuncType postfixFunc) \
         { return EventHolderHook<Name>::AddEvent(prefixFunc, postfixFunc); }                                                                 \
+    static COMPILE_RULES bool addEvent(EventHolderHook<Name>::PrefixFuncType prefixFunc, EventHolderHook<Name>::PostfixFuncType postfixFunc, s32 priority) \
+        { return EventHolderHook<Name>::AddEvent(prefixFunc, postfixFunc, priority); }                                                       \
     static void clearEvents() { EventHolderHook<Name>::RemoveEvents(); }                                                                     \
+    static void removeEvents(uintptr_t moduleStart, uintptr_t moduleEnd) { EventHolderHook<Name>::RemoveEvents(moduleStart, moduleEnd); }    \
 };
 
 #define CREATE_HOOK_EVENT_ARGSR(Name, HookVal, ReturnType, ...)                                                              \
 struct Name : public EventHolderHookArgsR<Name, ReturnType, __VA_ARGS__> {                                                   \
     static constexpr auto InstallVal = HookVal;                                                                              \
+    static constexpr auto EventName = #Name;                                                                                 \
     static COMPILE_RULES bool addEvent(EventHolderHookArgsR<Name, ReturnType, __VA_ARGS__>::PrefixFuncType prefixFunc,       \
                                            EventHolderHookArgsR<Name, ReturnType, __VA_ARGS__>::PostfixFuncType postfixFunc) \
         { return EventHolderHookArgsR<Name, ReturnType, __VA_ARGS__>::AddEvent(prefixFunc, postfixFunc); }                   \
+    static COMPILE_RULES bool addEvent(EventHolderHookArgsR<Name, ReturnType, __VA_ARGS__>::PrefixFuncType prefixFunc, EventHolderHookArgsR<Name, ReturnType, __VA_ARGS__>::PostfixFuncType postfixFunc, s32 priority) \
+        { return EventHolderHookArgsR<Name, ReturnType, __VA_ARGS__>::AddEvent(prefixFunc, postfixFunc, priority); }         \
     static void clearEvents() { EventHolderHookArgsR<Name, ReturnType, __VA_ARGS__>::RemoveEvents(); }                       \
+    static void removeEvents(uintptr_t moduleStart, uintptr_t moduleEnd) { EventHolderHookArgsR<Name, ReturnType, __VA_ARGS__>::RemoveEvents(moduleStart, moduleEnd); } \
 };
 
 #define CREATE_HOOK_EVENT_ARGS(Name, HookVal, ...)                                                                                                                              \
 struct Name : public EventHolderHookArgs<Name, __VA_ARGS__> {                                                                                                                   \
     static constexpr auto InstallVal = HookVal;                                                                                                                                 \
+    static constexpr auto EventName = #Name;                                                                                                                                    \
     static COMPILE_RULES bool addEvent(EventHolderHookArgs<Name, __VA_ARGS__>::PrefixFuncType prefixFunc, EventHolderHookArgs<Name, __VA_ARGS__>::PostfixFuncType postfixFunc)  \
         { return EventHolderHookArgs<Name, __VA_ARGS__>::AddEvent(prefixFunc, postfixFunc); }                                                                                   \
+    static COMPILE_RULES bool addEvent(EventHolderHookArgs<Name, __VA_ARGS__>::PrefixFuncType prefixFunc, EventHolderHookArgs<Name, __VA_ARGS__>::PostfixFuncType postfixFunc, s32 priority) \
+        { return EventHolderHookArgs<Name, __VA_ARGS__>::AddEvent(prefixFunc, postfixFunc, priority); }                                                                         \
     static void clearEvents() { EventHolderHookArgs<Name, __VA_ARGS__>::RemoveEvents(); }                                                                                       \
+    static void removeEvents(uintptr_t moduleStart, uintptr_t moduleEnd) { EventHolderHookArgs<Name, __VA_ARGS__>::RemoveEvents(moduleStart, moduleEnd); }                      \
 };
 
 #define CREATE_HOOK_EVENT_R(Name, HookVal, ReturnType) \
 struct Name : public EventHolderHookR<Name, ReturnType> { \
     static constexpr auto InstallVal = HookVal;                                             \
+    static constexpr auto EventName = #Name;                                                \
     static COMPILE_RULES bool addEvent(EventHolderHookR<Name, ReturnType>::PrefixFuncType prefixFunc, EventHolderHookR<Name, ReturnType>::PostfixFuncType postfixFunc) \
         { return EventHolderHookR<Name, ReturnType>::AddEvent(prefixFunc, postfixFunc); }          \
+    static COMPILE_RULES bool addEvent(EventHolderHookR<Name, ReturnType>::PrefixFuncType prefixFunc, EventHolderHookR<Name, ReturnType>::PostfixFuncType postfixFunc, s32 priority) \
+        { return EventHolderHookR<Name, ReturnType>::AddEvent(prefixFunc, postfixFunc, priority); } \
     static void clearEvents() { EventHolderHookR<Name, ReturnType>::RemoveEvents(); }                                                       \
+    static void removeEvents(uintptr_t moduleStart, uintptr_t moduleEnd) { EventHolderHookR<Name, ReturnType>::RemoveEvents(moduleStart, moduleEnd); } \
 };
 
 #define CREATE_MOD_EVENT(Name) \
@@ -0,0 +1,209 @@
+#include "EventProfiler.h"
+#include "plugin/PluginLoader.h"
+
+#include <imgui.h>
+#include <algorithm>
+#include <cstring>
+
+namespace EventProfiler {
+
+    static constexpr size_t cMaxProfiles = 0x40;
+    static constexpr size_t cMaxRows = 0x200;
+
+    struct ProfileEntry {
+        EventProfile* mProfile;
+        const char* mName;
+        const char* mSymbol;
+    };
+
+    // a single subscriber of a single event, built from the sample rings every time the window is drawn
+    struct Row {
+        const ProfileEntry* mEntry;
+        uintptr_t mFunc;
+        bool mIsPostfix;
+        u32 mCallCount;
+        u64 mTotalTicks;
+        u64 mMaxTicks;
+    };
+
+    enum Column {
+        Column_Event,
+        Column_Owner,
+        Column_Type,
+        Column_Calls,
+        Column_Avg,
+        Column_Max,
+        Column_Total
+    };
+
+    static ProfileEntry sProfiles[cMaxProfiles] = {};
+    static size_t sProfileCount = 0;
+
+    static Row sRows[cMaxRows] = {};
+
+    static float ticksToMicros(u64 ticks) {
+        return nn::os::Tick(ticks).ToTimeSpan().GetNanoSeconds() / 1000.f;
+    }
+
+    static const char* getOwnerName(uintptr_t func) {
+        for (size_t i = 0; i < PluginLoader::getPluginCount(); ++i) {
+            PluginData* plugin = PluginLoader::getPluginData(i);
+            if(plugin->mModuleLoaded && func >= plugin->mModuleStart && func < plugin->mModuleEnd)
+                return plugin->mFileName;
+        }
+        return "Loader";
+    }
+
+    static size_t buildRows() {
+        size_t rowCount = 0;
+
+        for (size_t i = 0; i < sProfileCount; ++i) {
+            const ProfileEntry& entry = sProfiles[i];
+            const EventProfile& profile = *entry.mProfile;
+            size_t firstRow = rowCount;
+
+            for (size_t j = 0; j < profile.mSampleCount; ++j) {
+                const EventProfile::Sample& sample = profile.mSamples[j];
+
+                Row* row = nullptr;
+                for (size_t k = firstRow; k < rowCount; ++k) {
+                    if(sRows[k].mFunc == sample.mFunc && sRows[k].mIsPostfix == sample.mIsPostfix) {
+                        row = &sRows[k];
+                        break;
+                    }
+                }
+
+                if(!row) {
+                    if(rowCount >= cMaxRows)
+                        continue;
+                    row = &sRows[rowCount++];
+                    *row = { &entry, sample.mFunc, sample.mIsPostfix, 0, 0, 0 };
+                }
+
+                row->mCallCount++;
+                row->mTotalTicks += sample.mTicks;
+                row->mMaxTicks = std::max<u64>(row->mMaxTicks, sample.mTicks);
+            }
+        }
+
+        return rowCount;
+    }
+
+    static s64 getColumnValue(const Row& row, int column) {
+        switch (column) {
+            case Column_Type: return row.mIsPostfix;
+            case Column_Calls: return row.mCallCount;
+            case Column_Avg: return row.mTotalTicks / row.mCallCount;
+            case Column_Max: return row.mMaxTicks;
+            case Column_Total: return row.mTotalTicks;
+            default: return 0;
+        }
+    }
+
+    static void sortRows(size_t rowCount, const ImGuiTableSortSpecs* sortSpecs) {
+        if(!sortSpecs || sortSpecs->SpecsCount == 0)
+            return;
+
+        const ImGuiTableColumnSortSpecs& spec = sortSpecs->Specs[0];
+        bool isAscending = spec.SortDirection == ImGuiSortDirection_Ascending;
+        int column = spec.ColumnIndex;
+
+        std::stable_sort(sRows, sRows + rowCount, [column, isAscending](const Row& a, const Row& b) {
+            int compare;
+            if(column == Column_Event)
+                compare = strcmp(a.mEntry->mName, b.mEntry->mName);
+            else if(column == Column_Owner)
+                compare = strcmp(getOwnerName(a.mFunc), getOwnerName(b.mFunc));
+            else {
+                s64 valA = getColumnValue(a, column);
+                s64 valB = getColumnValue(b, column);
+                compare = valA < valB ? -1 : valA > valB ? 1 : 0;
+            }
+            return isAscending ? compare < 0 : compare > 0;
+        });
+    }
+
+    void setEnabled(bool isEnabled) {
+        sIsEnabled = isEnabled;
+    }
+
+    void registerEvent(EventProfile* profile, const char* name, const char* symbol) {
+        if(sProfileCount >= cMaxProfiles)
+            return;
+
+        profile->mName = name;
+        profile->mSymbol = symbol;
+        sProfiles[sProfileCount++] = { profile, name, symbol };
+    }
+
+    void clearAll() {
+        for (size_t i = 0; i < sProfileCount; ++i) {
+            sProfiles[i].mProfile->clear();
+        }
+    }
+
+    void drawWindow() {
+        ImGui::SetNextWindowSize(ImVec2(600, 300), ImGuiCond_FirstUseEver);
+
+        ImGui::Begin("Event Profiler");
+
+        bool isEnabled = sIsEnabled;
+        if(ImGui::Checkbox("Enable Profiling", &isEnabled)) {
+            setEnabled(isEnabled);
+        }
+        ImGui::SameLine();
+        if(ImGui::Button("Clear")) {
+            clearAll();
+        }
+
+        ImGui::Text("Last %zu calls per event. Times in microseconds.", EventProfile::cRingSize);
+
+        size_t rowCount = buildRows();
+
+        ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                                ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+
+        if(ImGui::BeginTable("EventProfilerTable", 7, flags)) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Event");
+            ImGui::TableSetupColumn("Owner");
+            ImGui::TableSetupColumn("Type");
+            ImGui::TableSetupColumn("Calls");
+            ImGui::TableSetupColumn("Avg");
+            ImGui::TableSetupColumn("Max");
+            ImGui::TableSetupColumn("Total", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+            ImGui::TableHeadersRow();
+
+            // rows are rebuilt every frame, so they always need sorting again
+            sortRows(rowCount, ImGui::TableGetSortSpecs());
+
+            for (size_t i = 0; i < rowCount; ++i) {
+                const Row& row = sRows[i];
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", row.mEntry->mName);
+                if(ImGui::IsItemHovered() && row.mEntry->mSymbol)
+                    ImGui::SetTooltip("%s", row.mEntry->mSymbol);
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", getOwnerName(row.mFunc));
+                if(ImGui::IsItemHovered())
+                    ImGui::SetTooltip("0x%lx", row.mFunc);
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", row.mIsPostfix ? "Postfix" : "Prefix");
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", row.mCallCount);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", ticksToMicros(row.mTotalTicks / row.mCallCount));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", ticksToMicros(row.mMaxTicks));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", ticksToMicros(row.mTotalTicks));
+            }
+
+            ImGui::EndTable();
+        }
+
+        ImGui::End();
+    }
+}
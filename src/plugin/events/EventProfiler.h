@@ -0,0 +1,53 @@
+#pragma once
+
+#include "types.h"
+#include "lib.hpp"
+
+#include "nn/os.h"
+#include "os/os_tick.hpp"
+
+// per-event timing data for hook event subscribers, only recorded while profiling is enabled.
+// every call of a subscriber is pushed into a fixed size ring, which the Event Profiler window aggregates when drawn.
+struct EventProfile {
+    static constexpr size_t cRingSize = 256;
+
+    struct Sample {
+        uintptr_t mFunc;
+        u32 mTicks;
+        bool mIsPostfix;
+    };
+
+    const char* mName = nullptr;
+    const char* mSymbol = nullptr;
+
+    Sample mSamples[cRingSize] = {};
+    size_t mNextSample = 0;
+    size_t mSampleCount = 0;
+
+    void addSample(uintptr_t func, nn::os::Tick ticks, bool isPostfix) {
+        mSamples[mNextSample] = { func, (u32)ticks.GetInt64Value(), isPostfix };
+        mNextSample = (mNextSample + 1) % cRingSize;
+        if(mSampleCount < cRingSize)
+            mSampleCount++;
+    }
+
+    void clear() {
+        mNextSample = 0;
+        mSampleCount = 0;
+    }
+};
+
+namespace EventProfiler {
+    inline bool sIsEnabled = false;
+
+    ALWAYS_INLINE bool isEnabled() { return sIsEnabled; }
+
+    void setEnabled(bool isEnabled);
+
+    // events register themselves when installed, name and symbol are expected to be string literals
+    void registerEvent(EventProfile* profile, const char* name, const char* symbol);
+
+    void clearAll();
+
+    void drawWindow();
+}
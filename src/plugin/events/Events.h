@@ -11,8 +11,8 @@ namespace GameSystemEvent {
     void ALWAYS_INLINE installEvents() {
         INSTALL_EVENT(Init, Symbol);
     }
-    void ALWAYS_INLINE removeFromEvents(const char* key) {
-
+    void ALWAYS_INLINE removeFromEvents(uintptr_t moduleStart, uintptr_t moduleEnd) {
+        Init::removeEvents(moduleStart, moduleEnd);
     }
     void ALWAYS_INLINE clearEvents() {
         Init::clearEvents();
@@ -32,8 +32,10 @@ namespace HakoniwaSequenceEvent {
         INSTALL_EVENT(Destroy, Symbol);
     }
 
-    void ALWAYS_INLINE removeFromEvents(const char* key) {
-
+    void ALWAYS_INLINE removeFromEvents(uintptr_t moduleStart, uintptr_t moduleEnd) {
+        Init::removeEvents(moduleStart, moduleEnd);
+        Update::removeEvents(moduleStart, moduleEnd);
+        Destroy::removeEvents(moduleStart, moduleEnd);
     }
     void ALWAYS_INLINE clearEvents() {
         Update::clearEvents();
@@ -56,8 +58,11 @@ namespace StageSceneEvent {
         INSTALL_EVENT(UpdatePlay, Symbol);
     }
 
-    void ALWAYS_INLINE removeFromEvents(const char* key) {
-
+    void ALWAYS_INLINE removeFromEvents(uintptr_t moduleStart, uintptr_t moduleEnd) {
+        Init::removeEvents(moduleStart, moduleEnd);
+        Control::removeEvents(moduleStart, moduleEnd);
+        Kill::removeEvents(moduleStart, moduleEnd);
+        UpdatePlay::removeEvents(moduleStart, moduleEnd);
     }
     void ALWAYS_INLINE clearEvents() {
         Init::clearEvents();
@@ -79,8 +84,10 @@ namespace PlayerEvent {
         INSTALL_EVENT(Init, Symbol);
     }
 
-    void ALWAYS_INLINE removeFromEvents(const char* key) {
-
+    void ALWAYS_INLINE removeFromEvents(uintptr_t moduleStart, uintptr_t moduleEnd) {
+        Movement::removeEvents(moduleStart, moduleEnd);
+        ReceiveMsg::removeEvents(moduleStart, moduleEnd);
+        Init::removeEvents(moduleStart, moduleEnd);
     }
 
     void ALWAYS_INLINE clearEvents() {
@@ -123,13 +130,14 @@ namespace EventSystem {
         PlayerEvent::clearEvents();
     }
 
-    void ALWAYS_INLINE removeFromEvents(const char* key) {
+    // mod events are keyed by module name, while hook events are found by the address range of the module
+    void ALWAYS_INLINE removeFromEvents(const char* key, uintptr_t moduleStart, uintptr_t moduleEnd) {
         Logger::log("Clearing Events for: %s\n", key);
 
         ModEvent::removeFromEvents(key);
-        HakoniwaSequenceEvent::removeFromEvents(key);
-        GameSystemEvent::removeFromEvents(key);
-        StageSceneEvent::removeFromEvents(key);
-        PlayerEvent::removeFromEvents(key);
+        HakoniwaSequenceEvent::removeFromEvents(moduleStart, moduleEnd);
+        GameSystemEvent::removeFromEvents(moduleStart, moduleEnd);
+        StageSceneEvent::removeFromEvents(moduleStart, moduleEnd);
+        PlayerEvent::removeFromEvents(moduleStart, moduleEnd);
     }
 }
\ No newline at end of file
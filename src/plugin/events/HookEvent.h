@@ -4,47 +4,45 @@
 #include "lib.hpp"
 #include "types.h"
 
+// Every hook event starts out patched out (its hook goes straight to its trampoline) and only routes through
+// Callback while it has at least one subscriber, so unused events cost nothing over the original function.
+
 template <typename Derived>
 struct EventHolderHook {
 protected:
     using PrefixFuncType = bool(void);
     using PostfixFuncType = void(void);
-    using Events = std::array<EventData, 100>;
+    using Events = HookEventStorage<PrefixFuncType, PostfixFuncType>;
 
     static void Callback() {
-        auto [events, eventCount] = GetEvents();
+        auto& events = GetEvents();
 
-        for (int i = 0; i < eventCount; ++i) {
-            auto prefixFunc = reinterpret_cast<PrefixFuncType*>(events.at(i).mPrefixPtr);
-            if (!prefixFunc) continue;
-            if (!prefixFunc()) return;
-        }
+        if (!events.runPrefixes([](PrefixFuncType* prefix) { return prefix(); })) return;
 
         Orig();
 
-        for (int i = 0; i < eventCount; ++i) {
-            auto postfixFunc = reinterpret_cast<PostfixFuncType*>(events.at(i).mPostfixPtr);
-            if (postfixFunc)
-                postfixFunc();
-        }
+        events.runPostfixes([](PostfixFuncType* postfix) { postfix(); });
     }
 
-    static ALWAYS_INLINE bool AddEvent(PrefixFuncType prefixFunc, PostfixFuncType postfixFunc) {
-        auto [events, eventCount] = GetEvents();
-        if (eventCount >= events.max_size()) return false;
-        events[eventCount++] = EventData(prefixFunc, postfixFunc);
+    static ALWAYS_INLINE bool AddEvent(PrefixFuncType prefixFunc, PostfixFuncType postfixFunc, s32 priority = 0) {
+        if (!GetEvents().add(prefixFunc, postfixFunc, priority)) return false;
+        UpdateHookTarget();
         return true;
     }
 
-    static ALWAYS_INLINE std::tuple<Events&, size_t&> GetEvents() {
+    static ALWAYS_INLINE Events& GetEvents() {
         static Events events = {};
-        static size_t eventCount = 0;
-        return { events, eventCount };
+        return events;
     }
 
     static ALWAYS_INLINE void RemoveEvents() {
-        auto [events, eventCount] = GetEvents();
-        eventCount = 0;
+        GetEvents().clear();
+        UpdateHookTarget();
+    }
+
+    static ALWAYS_INLINE void RemoveEvents(uintptr_t moduleStart, uintptr_t moduleEnd) {
+        GetEvents().removeInRange(moduleStart, moduleEnd);
+        UpdateHookTarget();
     }
 
     // exlaunch hook code
@@ -59,20 +57,37 @@ protected:
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
         OrigRef()();
     }
+
+    static ALWAYS_INLINE void UpdateHookTarget() {
+        static constinit bool s_IsPatchedOut = false;
+        uintptr_t trampoline = reinterpret_cast<uintptr_t>(OrigRef());
+        bool isEmpty = GetEvents().isEmpty();
+        if (!trampoline || isEmpty == s_IsPatchedOut) return;
+
+        uintptr_t target = isEmpty ? trampoline : reinterpret_cast<uintptr_t>(&Callback);
+        if (exl::hook::Retarget(trampoline, target))
+            s_IsPatchedOut = isEmpty;
+    }
+
+    static ALWAYS_INLINE void Install(uintptr_t address, const char* symbol = nullptr) {
+        OrigRef() = exl::hook::Hook(address, Callback, true);
+        UpdateHookTarget();
+        EventProfiler::registerEvent(&GetEvents().mProfile, Derived::EventName, symbol);
+    }
 public:
     static ALWAYS_INLINE void InstallAtOffset(ptrdiff_t address) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
-        OrigRef() = exl::hook::Hook(exl::util::modules::GetTargetStart() + address, Callback, true);
+        Install(exl::util::modules::GetTargetStart() + address);
     }
     static ALWAYS_INLINE void InstallAtPtr(uintptr_t ptr) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
-        OrigRef() = exl::hook::Hook(ptr, Callback, true);
+        Install(ptr);
     }
     static ALWAYS_INLINE void InstallAtSymbol(const char *sym) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
         uintptr_t address = 0;
-        EXL_ASSERT(nn::ro::LookupSymbol(&address, sym).isSuccess(), "Unable to find Address for Symbol: %s", sym);
-        OrigRef() = exl::hook::Hook(address, Callback, true);
+        EXL_ASSERT(exl::util::symbols::LookupSymbol(&address, sym).isSuccess(), "Unable to find Address for Symbol: %s", sym);
+        Install(address, sym);
     }
 };
 
@@ -81,45 +96,40 @@ struct EventHolderHookArgsR {
 protected:
     using PrefixFuncType = bool(T& returnValue, Args... args);
     using PostfixFuncType = void(T& returnValue, Args... args);
-    using Events = std::array<EventData, 100>;
+    using Events = HookEventStorage<PrefixFuncType, PostfixFuncType>;
 
     static T Callback(Args... args) {
         T result = {};
-        auto [events, eventCount] = GetEvents();
+        auto& events = GetEvents();
 
-        for (int i = 0; i < eventCount; ++i) {
-            auto prefixFunc = reinterpret_cast<PrefixFuncType*>(events.at(i).mPrefixPtr);
-            if (!prefixFunc) continue;
-            if (!prefixFunc(result, args...)) return result;
-        }
+        if (!events.runPrefixes([&](PrefixFuncType* prefix) { return prefix(result, args...); })) return result;
 
         result = Orig(std::forward<Args>(args)...);
 
-        for (int i = 0; i < eventCount; ++i) {
-            auto postfixFunc = reinterpret_cast<PostfixFuncType*>(events.at(i).mPostfixPtr);
-            if (postfixFunc)
-                postfixFunc(result, args...);
-        }
+        events.runPostfixes([&](PostfixFuncType* postfix) { postfix(result, args...); });
 
         return result;
     }
 
-    static ALWAYS_INLINE bool AddEvent(PrefixFuncType prefixFunc, PostfixFuncType postfixFunc) {
-        auto [events, eventCount] = GetEvents();
-        if (eventCount >= events.max_size()) return false;
-        events[eventCount++] = EventData(prefixFunc, postfixFunc);
+    static ALWAYS_INLINE bool AddEvent(PrefixFuncType prefixFunc, PostfixFuncType postfixFunc, s32 priority = 0) {
+        if (!GetEvents().add(prefixFunc, postfixFunc, priority)) return false;
+        UpdateHookTarget();
         return true;
     }
 
-    static ALWAYS_INLINE std::tuple<Events&, size_t&> GetEvents() {
+    static ALWAYS_INLINE Events& GetEvents() {
         static Events events = {};
-        static size_t eventCount = 0;
-        return { events, eventCount };
+        return events;
     }
 
     static ALWAYS_INLINE void RemoveEvents() {
-        auto [events, eventCount] = GetEvents();
-        eventCount = 0;
+        GetEvents().clear();
+        UpdateHookTarget();
+    }
+
+    static ALWAYS_INLINE void RemoveEvents(uintptr_t moduleStart, uintptr_t moduleEnd) {
+        GetEvents().removeInRange(moduleStart, moduleEnd);
+        UpdateHookTarget();
     }
 
     // exlaunch hook code
@@ -134,20 +144,37 @@ protected:
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
         return OrigRef()(std::forward<Args>(args)...);
     }
+
+    static ALWAYS_INLINE void UpdateHookTarget() {
+        static constinit bool s_IsPatchedOut = false;
+        uintptr_t trampoline = reinterpret_cast<uintptr_t>(OrigRef());
+        bool isEmpty = GetEvents().isEmpty();
+        if (!trampoline || isEmpty == s_IsPatchedOut) return;
+
+        uintptr_t target = isEmpty ? trampoline : reinterpret_cast<uintptr_t>(&Callback);
+        if (exl::hook::Retarget(trampoline, target))
+            s_IsPatchedOut = isEmpty;
+    }
+
+    static ALWAYS_INLINE void Install(uintptr_t address, const char* symbol = nullptr) {
+        OrigRef() = exl::hook::Hook(address, Callback, true);
+        UpdateHookTarget();
+        EventProfiler::registerEvent(&GetEvents().mProfile, Derived::EventName, symbol);
+    }
 public:
     static ALWAYS_INLINE void InstallAtOffset(ptrdiff_t address) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
-        OrigRef() = exl::hook::Hook(exl::util::modules::GetTargetStart() + address, Callback, true);
+        Install(exl::util::modules::GetTargetStart() + address);
     }
     static ALWAYS_INLINE void InstallAtPtr(uintptr_t ptr) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
-        OrigRef() = exl::hook::Hook(ptr, Callback, true);
+        Install(ptr);
     }
     static ALWAYS_INLINE void InstallAtSymbol(const char *sym) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
         uintptr_t address = 0;
-        EXL_ASSERT(nn::ro::LookupSymbol(&address, sym).isSuccess(), "Unable to find Address for Symbol: %s", sym);
-        OrigRef() = exl::hook::Hook(address, Callback, true);
+        EXL_ASSERT(exl::util::symbols::LookupSymbol(&address, sym).isSuccess(), "Unable to find Address for Symbol: %s", sym);
+        Install(address, sym);
     }
 };
 
@@ -156,42 +183,37 @@ struct EventHolderHookArgs {
 protected:
     using PrefixFuncType = bool(Args... args);
     using PostfixFuncType = void(Args... args);
-    using Events = std::array<EventData, 100>;
+    using Events = HookEventStorage<PrefixFuncType, PostfixFuncType>;
 
     static void Callback(Args... args) {
-        auto [events, eventCount] = GetEvents();
+        auto& events = GetEvents();
 
-        for (int i = 0; i < eventCount; ++i) {
-            auto prefixFunc = reinterpret_cast<PrefixFuncType*>(events.at(i).mPrefixPtr);
-            if (!prefixFunc) continue;
-            if (!prefixFunc(args...)) return;
-        }
+        if (!events.runPrefixes([&](PrefixFuncType* prefix) { return prefix(args...); })) return;
 
         Orig(std::forward<Args>(args)...);
 
-        for (int i = 0; i < eventCount; ++i) {
-            auto postfixFunc = reinterpret_cast<PostfixFuncType*>(events.at(i).mPostfixPtr);
-            if (postfixFunc)
-                postfixFunc(args...);
-        }
+        events.runPostfixes([&](PostfixFuncType* postfix) { postfix(args...); });
     }
 
-    static ALWAYS_INLINE bool AddEvent(PrefixFuncType prefixFunc, PostfixFuncType postfixFunc) {
-        auto [events, eventCount] = GetEvents();
-        if (eventCount >= events.max_size()) return false;
-        events[eventCount++] = EventData(prefixFunc, postfixFunc);
+    static ALWAYS_INLINE bool AddEvent(PrefixFuncType prefixFunc, PostfixFuncType postfixFunc, s32 priority = 0) {
+        if (!GetEvents().add(prefixFunc, postfixFunc, priority)) return false;
+        UpdateHookTarget();
         return true;
     }
 
-    static ALWAYS_INLINE std::tuple<Events&, size_t&> GetEvents() {
+    static ALWAYS_INLINE Events& GetEvents() {
         static Events events = {};
-        static size_t eventCount = 0;
-        return { events, eventCount };
+        return events;
     }
 
     static ALWAYS_INLINE void RemoveEvents() {
-        auto [events, eventCount] = GetEvents();
-        eventCount = 0;
+        GetEvents().clear();
+        UpdateHookTarget();
+    }
+
+    static ALWAYS_INLINE void RemoveEvents(uintptr_t moduleStart, uintptr_t moduleEnd) {
+        GetEvents().removeInRange(moduleStart, moduleEnd);
+        UpdateHookTarget();
     }
 
     // exlaunch hook code
@@ -206,20 +228,37 @@ protected:
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
         OrigRef()(std::forward<Args>(args)...);
     }
+
+    static ALWAYS_INLINE void UpdateHookTarget() {
+        static constinit bool s_IsPatchedOut = false;
+        uintptr_t trampoline = reinterpret_cast<uintptr_t>(OrigRef());
+        bool isEmpty = GetEvents().isEmpty();
+        if (!trampoline || isEmpty == s_IsPatchedOut) return;
+
+        uintptr_t target = isEmpty ? trampoline : reinterpret_cast<uintptr_t>(&Callback);
+        if (exl::hook::Retarget(trampoline, target))
+            s_IsPatchedOut = isEmpty;
+    }
+
+    static ALWAYS_INLINE void Install(uintptr_t address, const char* symbol = nullptr) {
+        OrigRef() = exl::hook::Hook(address, Callback, true);
+        UpdateHookTarget();
+        EventProfiler::registerEvent(&GetEvents().mProfile, Derived::EventName, symbol);
+    }
 public:
     static ALWAYS_INLINE void InstallAtOffset(ptrdiff_t address) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
-        OrigRef() = exl::hook::Hook(exl::util::modules::GetTargetStart() + address, Callback, true);
+        Install(exl::util::modules::GetTargetStart() + address);
     }
     static ALWAYS_INLINE void InstallAtPtr(uintptr_t ptr) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
-        OrigRef() = exl::hook::Hook(ptr, Callback, true);
+        Install(ptr);
     }
     static ALWAYS_INLINE void InstallAtSymbol(const char *sym) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
         uintptr_t address = 0;
-        EXL_ASSERT(nn::ro::LookupSymbol(&address, sym).isSuccess(), "Unable to find Address for Symbol: %s", sym);
-        OrigRef() = exl::hook::Hook(address, Callback, true);
+        EXL_ASSERT(exl::util::symbols::LookupSymbol(&address, sym).isSuccess(), "Unable to find Address for Symbol: %s", sym);
+        Install(address, sym);
     }
 };
 
@@ -228,45 +267,40 @@ struct EventHolderHookR {
 protected:
     using PrefixFuncType = bool(T& returnValue);
     using PostfixFuncType = void(T& returnValue);
-    using Events = std::array<EventData, 100>;
+    using Events = HookEventStorage<PrefixFuncType, PostfixFuncType>;
 
     static T Callback() {
         T result = {};
-        auto [events, eventCount] = GetEvents();
+        auto& events = GetEvents();
 
-        for (int i = 0; i < eventCount; ++i) {
-            auto prefixFunc = reinterpret_cast<PrefixFuncType*>(events.at(i).mPrefixPtr);
-            if (!prefixFunc) continue;
-            if (!prefixFunc(result)) return result;
-        }
+        if (!events.runPrefixes([&](PrefixFuncType* prefix) { return prefix(result); })) return result;
 
         result = Orig();
 
-        for (int i = 0; i < eventCount; ++i) {
-            auto postfixFunc = reinterpret_cast<PostfixFuncType*>(events.at(i).mPostfixPtr);
-            if (postfixFunc)
-                postfixFunc(result);
-        }
+        events.runPostfixes([&](PostfixFuncType* postfix) { postfix(result); });
 
         return result;
     }
 
-    static ALWAYS_INLINE bool AddEvent(PrefixFuncType prefixFunc, PostfixFuncType postfixFunc) {
-        auto [events, eventCount] = GetEvents();
-        if (eventCount >= events.max_size()) return false;
-        events[eventCount++] = EventData(prefixFunc, postfixFunc);
+    static ALWAYS_INLINE bool AddEvent(PrefixFuncType prefixFunc, PostfixFuncType postfixFunc, s32 priority = 0) {
+        if (!GetEvents().add(prefixFunc, postfixFunc, priority)) return false;
+        UpdateHookTarget();
         return true;
     }
 
-    static ALWAYS_INLINE std::tuple<Events&, size_t&> GetEvents() {
+    static ALWAYS_INLINE Events& GetEvents() {
         static Events events = {};
-        static size_t eventCount = 0;
-        return { events, eventCount };
+        return events;
     }
 
     static ALWAYS_INLINE void RemoveEvents() {
-        auto [events, eventCount] = GetEvents();
-        eventCount = 0;
+        GetEvents().clear();
+        UpdateHookTarget();
+    }
+
+    static ALWAYS_INLINE void RemoveEvents(uintptr_t moduleStart, uintptr_t moduleEnd) {
+        GetEvents().removeInRange(moduleStart, moduleEnd);
+        UpdateHookTarget();
     }
 
     // exlaunch hook code
@@ -281,19 +315,36 @@ protected:
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
         return OrigRef()();
     }
+
+    static ALWAYS_INLINE void UpdateHookTarget() {
+        static constinit bool s_IsPatchedOut = false;
+        uintptr_t trampoline = reinterpret_cast<uintptr_t>(OrigRef());
+        bool isEmpty = GetEvents().isEmpty();
+        if (!trampoline || isEmpty == s_IsPatchedOut) return;
+
+        uintptr_t target = isEmpty ? trampoline : reinterpret_cast<uintptr_t>(&Callback);
+        if (exl::hook::Retarget(trampoline, target))
+            s_IsPatchedOut = isEmpty;
+    }
+
+    static ALWAYS_INLINE void Install(uintptr_t address, const char* symbol = nullptr) {
+        OrigRef() = exl::hook::Hook(address, Callback, true);
+        UpdateHookTarget();
+        EventProfiler::registerEvent(&GetEvents().mProfile, Derived::EventName, symbol);
+    }
 public:
     static ALWAYS_INLINE void InstallAtOffset(ptrdiff_t address) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
-        OrigRef() = exl::hook::Hook(exl::util::modules::GetTargetStart() + address, Callback, true);
+        Install(exl::util::modules::GetTargetStart() + address);
     }
     static ALWAYS_INLINE void InstallAtPtr(uintptr_t ptr) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
-        OrigRef() = exl::hook::Hook(ptr, Callback, true);
+        Install(ptr);
     }
     static ALWAYS_INLINE void InstallAtSymbol(const char *sym) {
         static_assert(!std::is_member_function_pointer_v<CallbackFuncPtr>, "Callback method must be static!");
         uintptr_t address = 0;
-        EXL_ASSERT(nn::ro::LookupSymbol(&address, sym).isSuccess(), "Unable to find Address for Symbol: %s", sym);
-        OrigRef() = exl::hook::Hook(address, Callback, true);
+        EXL_ASSERT(exl::util::symbols::LookupSymbol(&address, sym).isSuccess(), "Unable to find Address for Symbol: %s", sym);
+        Install(address, sym);
     }
-};
\ No newline at end of file
+};
@@ -1,13 +1,10 @@
 #pragma once
 
 #include "EventData.h"
+#include "ModEventTable.h"
 #include "lib.hpp"
 #include "types.h"
-#include <container/seadStrTreeMap.h>
-#include <container/seadTreeMap.h>
-#include <heap/seadHeapMgr.h>
 #include <exception/ExceptionHandler.h>
-#include <map>
 #include <os/os_thread_api.hpp>
 #include <plugin/PluginLoader.h>
 
@@ -27,59 +24,80 @@ static ALWAYS_INLINE size_t getEventAddress(std::function<T(U...)> f) {
     return (size_t) *fnPointer;
 }
 
+// shared add/remove logic for every mod event holder, these only run when plugins are loaded or unloaded
+
+template<typename FuncType>
+static ALWAYS_INLINE bool addModEvent(ModEventTable<FuncType>& table, FuncType* eventFunc) {
+    char moduleName[0x100] = {};
+    if(handler::getAddrModuleName(moduleName, reinterpret_cast<uintptr_t>(eventFunc))) {
+        Logger::log("Got event from Plugin: %s\n", moduleName);
+    }else {
+        Logger::log("Unable to find Plugin Module Info.\n");
+        return false;
+    }
+
+    u32 ownerId = EventOwners::getOrCreateId(moduleName);
+    if(ownerId == EventOwners::cInvalidId) {
+        Logger::log("Unable to register event owner: %s\n", moduleName);
+        return false;
+    }
+
+    if(!table.add(eventFunc, ownerId)) {
+        Logger::log("Event table is full!\n");
+        return false;
+    }
+
+    return true;
+}
+
+template<typename FuncType>
+static ALWAYS_INLINE void removeModEvents(ModEventTable<FuncType>& table, const char* key) {
+    u32 ownerId = EventOwners::findId(key);
+
+    if(ownerId == EventOwners::cInvalidId || table.removeOwner(ownerId) == 0) {
+        Logger::log("Unable to find events. Key: %s\n", key);
+    }
+}
+
+template<typename FuncType>
+static ALWAYS_INLINE bool removeModEvent(ModEventTable<FuncType>& table, const char* key, int idx) {
+    u32 ownerId = EventOwners::findId(key);
+
+    if(ownerId == EventOwners::cInvalidId) {
+        Logger::log("Unable to find events. Key: %s\n", key);
+        return false;
+    }
+
+    if(idx < 0 || !table.removeOwnerAt(ownerId, idx)) {
+        Logger::log("Attempting to remove event out of bounds!\n");
+        return false;
+    }
+
+    Logger::log("Removed event at Index: %d\n", idx);
+    return true;
+}
+
 // FIXME: ALl events that inherit from this will use the same static method, instead of a unique one
 template <typename Derived>
 struct EventHolderMod {
 protected:
     using BaseEventFunc = void();
-    using EventContainer = std::vector<std::function<BaseEventFunc>>;
-    using Events = sead::StrTreeMap<64, EventContainer>;
+    using Events = ModEventTable<BaseEventFunc>;
 
     static ALWAYS_INLINE bool AddEvent(BaseEventFunc eventFunc) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        uintptr_t addr = *(reinterpret_cast<uintptr_t*>(&eventFunc));
-
-        char moduleName[0x100] = {};
-        if(handler::getAddrModuleName(moduleName, addr)) {
-            Logger::log("Got event from Plugin: %s\n", moduleName);
-        }else {
-            Logger::log("Unable to find Plugin Module Info.\n");
-            return false;
-        }
-
-        if(!eventMap.find(moduleName)) {
-            eventMap.insert(moduleName, EventContainer());
-        }
-
-        eventMap.find(moduleName)->value().emplace_back(eventFunc);
-
-        return true;
+        return addModEvent(GetEvents(), eventFunc);
     }
 
     static ALWAYS_INLINE Events& GetEvents() {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
         static Events events = {};
-        static bool isAlloc = false;
-
-        if(!isAlloc) {
-            events.allocBuffer(100, nullptr); // uses current scope heap
-            isAlloc = true;
-        }
-
         return events;
     }
 
 public:
     static void RunEvents() {
-        auto& eventMap = GetEvents();
-        eventMap.forEach([](auto& key, auto& value) {
-            for (auto& eventFunc : value) {
-                if (!eventFunc)
-                    continue;
-                eventFunc();
-            }
+        GetEvents().run([](BaseEventFunc* eventFunc) {
+            eventFunc();
+            return true;
         });
 
         // TODO: return from exception once proper plugin unloading works
@@ -106,45 +124,15 @@ public:
     }
 
     static void RemoveAllEvents() {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& events = GetEvents();
-        events.clear();
-
-        // reset buffer
-        events.freeBuffer();
-        events.allocBuffer(100, nullptr);
+        GetEvents().clear();
     }
 
     static void RemoveEvents(const char* key) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        if(!eventMap.find(key)) {
-            Logger::log("Unable to find events. Key: %s\n", key);
-            return;
-        }
-
-        eventMap.erase(key); // remove whole node
+        removeModEvents(GetEvents(), key);
     }
 
     static bool RemoveEvent(const char* key, int idx) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        if(!eventMap.find(key)) {
-            Logger::log("Unable to find events. Key: %s\n", key);
-            return false;
-        }
-        EventContainer &events = eventMap.find(key)->value();
-
-        if(events.size() > idx) {
-            events.erase(events.begin() + idx);
-            Logger::log("Removed event at Index: %d\n", idx);
-            return true;
-        }else {
-            Logger::log("Attempting to remove event out of bounds!\n");
-            return false;
-        }
+        return removeModEvent(GetEvents(), key, idx);
     }
 };
 
@@ -152,101 +140,37 @@ template<typename Derived, typename T, typename ...Args>
 struct EventHolderModArgsR {
 protected:
     using BaseEventFunc = bool(T& returnValue, Args... args);
-    using EventContainer = std::vector<std::function<BaseEventFunc>>;
-    using Events = sead::StrTreeMap<64, EventContainer>;
+    using Events = ModEventTable<BaseEventFunc>;
 
     static ALWAYS_INLINE bool AddEvent(BaseEventFunc eventFunc) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        uintptr_t addr = *(reinterpret_cast<uintptr_t*>(&eventFunc));
-
-        char moduleName[0x100] = {};
-        if(handler::getAddrModuleName(moduleName, addr)) {
-            Logger::log("Got event from Plugin: %s\n", moduleName);
-        }else {
-            Logger::log("Unable to find Plugin Module Info.\n");
-            return false;
-        }
-
-        if(!eventMap.find(moduleName)) {
-            eventMap.insert(moduleName, EventContainer());
-        }
-
-        eventMap.find(moduleName)->value().emplace_back(eventFunc);
-
-        return true;
+        return addModEvent(GetEvents(), eventFunc);
     }
 
     static ALWAYS_INLINE Events& GetEvents() {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
         static Events events = {};
-        static bool isAlloc = false;
-
-        if(!isAlloc) {
-            events.allocBuffer(100, nullptr); // uses current scope heap
-            isAlloc = true;
-        }
-
         return events;
     }
 public:
     // TODO: add exception catching (wont work here until exception handler supports variable capturing in lambdas
     static T RunEvents(Args... args) {
         T result = {};
-        auto& eventMap = GetEvents();
-        eventMap.forEach([result, args...](auto& key, auto& value) {
-            for (auto& eventFunc : value) {
-                if (!eventFunc)
-                    continue;
-                if(!eventFunc(result, args...))
-                    return result;
-            }
+        GetEvents().run([&](BaseEventFunc* eventFunc) {
+            return eventFunc(result, args...);
         });
 
         return result;
     }
 
     static void RemoveAllEvents() {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& events = GetEvents();
-        events.clear();
-
-        // reset buffer
-        events.freeBuffer();
-        events.allocBuffer(100, nullptr);
+        GetEvents().clear();
     }
 
     static void RemoveEvents(const char* key) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        if(!eventMap.find(key)) {
-            Logger::log("Unable to find events. Key: %s\n", key);
-            return;
-        }
-
-        eventMap.erase(key); // remove whole node
+        removeModEvents(GetEvents(), key);
     }
 
     static bool RemoveEvent(const char* key, int idx) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        if(!eventMap.find(key)) {
-            Logger::log("Unable to find events. Key: %s\n", key);
-            return false;
-        }
-        EventContainer &events = eventMap.find(key)->value();
-
-        if(events.size() > idx) {
-            events.erase(events.begin() + idx);
-            Logger::log("Removed event at Index: %d\n", idx);
-            return true;
-        }else {
-            Logger::log("Attempting to remove event out of bounds!\n");
-            return false;
-        }
+        return removeModEvent(GetEvents(), key, idx);
     }
 };
 
@@ -254,97 +178,35 @@ template<typename Derived, typename ...Args>
 struct EventHolderModArgs {
 protected:
     using BaseEventFunc = void(Args... args);
-    using EventContainer = std::vector<std::function<BaseEventFunc>>;
-    using Events = sead::StrTreeMap<64, EventContainer>;
+    using Events = ModEventTable<BaseEventFunc>;
 
     static ALWAYS_INLINE bool AddEvent(BaseEventFunc eventFunc) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        uintptr_t addr = *(reinterpret_cast<uintptr_t*>(&eventFunc));
-
-        char moduleName[0x100] = {};
-        if(handler::getAddrModuleName(moduleName, addr)) {
-            Logger::log("Got event from Plugin: %s\n", moduleName);
-        }else {
-            Logger::log("Unable to find Plugin Module Info.\n");
-            return false;
-        }
-
-        if(!eventMap.find(moduleName)) {
-            eventMap.insert(moduleName, EventContainer());
-        }
-
-        eventMap.find(moduleName)->value().emplace_back(eventFunc);
-
-        return true;
+        return addModEvent(GetEvents(), eventFunc);
     }
 
     static ALWAYS_INLINE Events& GetEvents() {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
         static Events events = {};
-        static bool isAlloc = false;
-
-        if(!isAlloc) {
-            events.allocBuffer(100, nullptr); // uses current scope heap
-            isAlloc = true;
-        }
-
         return events;
     }
 
 public:
     static void RunEvents(Args... args) {
-        auto& eventMap = GetEvents();
-        eventMap.forEach([args...](auto& key, auto& value) {
-            for (auto& eventFunc : value) {
-                if (!eventFunc)
-                    continue;
-                eventFunc(args...);
-            }
+        GetEvents().run([&](BaseEventFunc* eventFunc) {
+            eventFunc(args...);
+            return true;
         });
     }
 
     static void RemoveAllEvents() {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& events = GetEvents();
-        events.clear();
-
-        // reset buffer
-        events.freeBuffer();
-        events.allocBuffer(100, nullptr);
+        GetEvents().clear();
     }
 
     static void RemoveEvents(const char* key) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        if(!eventMap.find(key)) {
-            Logger::log("Unable to find events. Key: %s\n", key);
-            return;
-        }
-
-        eventMap.erase(key); // remove whole node
+        removeModEvents(GetEvents(), key);
     }
 
     static bool RemoveEvent(const char* key, int idx) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        if(!eventMap.find(key)) {
-            Logger::log("Unable to find events. Key: %s\n", key);
-            return false;
-        }
-        EventContainer &events = eventMap.find(key)->value();
-
-        if(events.size() > idx) {
-            events.erase(events.begin() + idx);
-            Logger::log("Removed event at Index: %d\n", idx);
-            return true;
-        }else {
-            Logger::log("Attempting to remove event out of bounds!\n");
-            return false;
-        }
+        return removeModEvent(GetEvents(), key, idx);
     }
 
 };
@@ -353,42 +215,14 @@ template<typename Derived, typename R>
 struct EventHolderModR {
 protected:
     using BaseEventFunc = void(R& returnValue);
-    using EventContainer = std::vector<std::function<BaseEventFunc>>;
-    using Events = sead::StrTreeMap<64, EventContainer>;
+    using Events = ModEventTable<BaseEventFunc>;
 
     static ALWAYS_INLINE bool AddEvent(BaseEventFunc eventFunc) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        uintptr_t addr = *(reinterpret_cast<uintptr_t*>(&eventFunc));
-
-        char moduleName[0x100] = {};
-        if(handler::getAddrModuleName(moduleName, addr)) {
-            Logger::log("Got event from Plugin: %s\n", moduleName);
-        }else {
-            Logger::log("Unable to find Plugin Module Info.\n");
-            return false;
-        }
-
-        if(!eventMap.find(moduleName)) {
-            eventMap.insert(moduleName, EventContainer());
-        }
-
-        eventMap.find(moduleName)->value().emplace_back(eventFunc);
-
-        return true;
+        return addModEvent(GetEvents(), eventFunc);
     }
 
     static ALWAYS_INLINE Events& GetEvents() {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
         static Events events = {};
-        static bool isAlloc = false;
-
-        if(!isAlloc) {
-            events.allocBuffer(100, nullptr); // uses current scope heap
-            isAlloc = true;
-        }
-
         return events;
     }
 
@@ -397,58 +231,24 @@ public:
     // TODO: add exception catching (wont work here until exception handler supports variable capturing in lambdas
     static R RunEvents() {
         R result = {};
-        auto& eventMap = GetEvents();
-        eventMap.forEach([result](auto& key, auto& value) {
-            for (auto& eventFunc : value) {
-                if (!eventFunc)
-                    continue;
-                if(!eventFunc(result))
-                    return result;
-            }
+        GetEvents().run([&](BaseEventFunc* eventFunc) {
+            eventFunc(result);
+            return true;
         });
+
         return result;
     }
 
     static void RemoveAllEvents() {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& events = GetEvents();
-        events.clear();
-
-        // reset buffer
-        events.freeBuffer();
-        events.allocBuffer(100, nullptr);
+        GetEvents().clear();
     }
 
     static void RemoveEvents(const char* key) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        if(!eventMap.find(key)) {
-            Logger::log("Unable to find events. Key: %s\n", key);
-            return;
-        }
-
-        eventMap.erase(key); // remove whole node
+        removeModEvents(GetEvents(), key);
     }
 
     static bool RemoveEvent(const char* key, int idx) {
-        sead::ScopedCurrentHeapSetter setter(PluginLoader::getHeap());
-        auto& eventMap = GetEvents();
-
-        if(!eventMap.find(key)) {
-            Logger::log("Unable to find events. Key: %s\n", key);
-            return false;
-        }
-        EventContainer &events = eventMap.find(key)->value();
-
-        if(events.size() > idx) {
-            events.erase(events.begin() + idx);
-            Logger::log("Removed event at Index: %d\n", idx);
-            return true;
-        }else {
-            Logger::log("Attempting to remove event out of bounds!\n");
-            return false;
-        }
+        return removeModEvent(GetEvents(), key, idx);
     }
 
 
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "types.h"
+#include "nn/os.h"
+#include <atomic>
+#include <cstring>
+
+// ids for the modules that own mod events, so dispatch tables only need to store an integer per subscriber.
+// names are only ever compared when events are added or removed, never while events are running.
+namespace EventOwners {
+    static constexpr u32 cInvalidId = 0;
+    static constexpr size_t cMaxOwners = 64;
+
+    struct OwnerName {
+        char mName[0x100];
+    };
+
+    inline OwnerName sOwners[cMaxOwners] = {};
+    inline size_t sOwnerCount = 0;
+
+    inline u32 findId(const char* name) {
+        for (size_t i = 0; i < sOwnerCount; ++i) {
+            if(strcmp(sOwners[i].mName, name) == 0)
+                return i + 1;
+        }
+        return cInvalidId;
+    }
+
+    // ids stay valid for the lifetime of the process, so a reloaded plugin gets the same id back
+    inline u32 getOrCreateId(const char* name) {
+        u32 id = findId(name);
+        if(id != cInvalidId || sOwnerCount >= cMaxOwners || strlen(name) >= sizeof(OwnerName::mName))
+            return id;
+
+        strcpy(sOwners[sOwnerCount].mName, name);
+        return ++sOwnerCount;
+    }
+}
+
+// flattened list of raw function pointers (plus owner ids) for a single mod event.
+// the list readers see is published through an atomic pointer, so running events never touches a heap or a tree.
+// new subscribers are appended in place (the count is published after the entry is written),
+// while removals build the remaining subscribers into the second table and swap it in.
+// like HookEventStorage, each table counts the readers currently running it. removals only rewrite a table once it
+// has none left, and wait for the old table's readers before returning, so a removed module is never still running.
+// removing subscribers must not happen from inside a subscriber of the same event, as it would wait on itself.
+template <typename FuncType>
+class ModEventTable {
+public:
+    static constexpr size_t cMaxSubscribers = 100;
+
+    struct Subscriber {
+        FuncType* mFunc;
+        u32 mOwnerId;
+    };
+
+private:
+    struct Table {
+        Subscriber mSubscribers[cMaxSubscribers];
+        std::atomic<size_t> mCount;
+        std::atomic<u32> mReaderCount;
+    };
+
+    Table mTables[2] = {};
+    std::atomic<Table*> mActive = &mTables[0];
+
+    // only one thread ever adds or removes events, so the writer side doesn't need any ordering of its own
+    Table* getInactive() const {
+        Table* active = mActive.load(std::memory_order_relaxed);
+        return active == &mTables[0] ? const_cast<Table*>(&mTables[1]) : const_cast<Table*>(&mTables[0]);
+    }
+
+    // same handshake as HookEventStorage::acquireTable, the count is taken before checking the table is still active
+    ALWAYS_INLINE Table* acquireTable() {
+        while (true) {
+            Table* table = mActive.load(std::memory_order_seq_cst);
+            table->mReaderCount.fetch_add(1, std::memory_order_seq_cst);
+            if(mActive.load(std::memory_order_seq_cst) == table)
+                return table;
+            table->mReaderCount.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    ALWAYS_INLINE void releaseTable(Table* table) {
+        table->mReaderCount.fetch_sub(1, std::memory_order_release);
+    }
+
+    static void waitForReaders(Table* table) {
+        while (table->mReaderCount.load(std::memory_order_seq_cst) != 0) {
+            nn::os::SleepThread(nn::TimeSpan::FromMicroSeconds(100));
+        }
+    }
+
+    template <typename Pred>
+    size_t rebuildWithout(Pred isRemoved) {
+        Table* active = mActive.load(std::memory_order_relaxed);
+        Table* next = getInactive();
+
+        waitForReaders(next);
+
+        size_t activeCount = active->mCount.load(std::memory_order_relaxed);
+        size_t nextCount = 0;
+
+        for (size_t i = 0; i < activeCount; ++i) {
+            if(!isRemoved(active->mSubscribers[i]))
+                next->mSubscribers[nextCount++] = active->mSubscribers[i];
+        }
+
+        next->mCount.store(nextCount, std::memory_order_relaxed);
+        mActive.store(next, std::memory_order_seq_cst);
+        waitForReaders(active);
+
+        return activeCount - nextCount;
+    }
+
+public:
+    bool add(FuncType* func, u32 ownerId) {
+        Table* active = mActive.load(std::memory_order_relaxed);
+        size_t count = active->mCount.load(std::memory_order_relaxed);
+
+        if(count >= cMaxSubscribers)
+            return false;
+
+        active->mSubscribers[count] = { func, ownerId };
+        active->mCount.store(count + 1, std::memory_order_release);
+        return true;
+    }
+
+    // used to remove events owned by a module that is being unloaded, once this returns none of them are running
+    size_t removeOwner(u32 ownerId) {
+        return rebuildWithout([ownerId](const Subscriber& sub) { return sub.mOwnerId == ownerId; });
+    }
+
+    // removes the idx'th subscriber registered by the owner
+    bool removeOwnerAt(u32 ownerId, size_t idx) {
+        size_t ownerIdx = 0;
+        return rebuildWithout([ownerId, idx, &ownerIdx](const Subscriber& sub) {
+            return sub.mOwnerId == ownerId && ownerIdx++ == idx;
+        }) != 0;
+    }
+
+    void clear() {
+        rebuildWithout([](const Subscriber&) { return true; });
+    }
+
+    // invoke is given each subscriber's function in order, and returns false to skip the rest
+    template <typename Invoke>
+    ALWAYS_INLINE void run(Invoke invoke) {
+        Table* table = acquireTable();
+
+        size_t count = table->mCount.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i) {
+            if(!invoke(table->mSubscribers[i].mFunc))
+                break;
+        }
+
+        releaseTable(table);
+    }
+};
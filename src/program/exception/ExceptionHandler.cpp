@@ -1,7 +1,7 @@
 #include "logger/Logger.hpp"
 #include <cstdio>
-#include <cxxabi.h>
 #include <exception/ExceptionHandler.h>
+#include <exception/ModuleTable.h>
 #include <lib.hpp>
 #include <thread/seadThread.h>
 #include <thread/seadThreadLocalStorage.h>
@@ -71,12 +71,12 @@ namespace handler {
 
         } // namespace local
 
-        static char* getFileNameFromPath(char* path) {
+        static const char* getFileNameFromPath(const char* path) {
             if (path == nullptr)
                 return nullptr;
 
-            char* pFileName = path;
-            for (char* pCur = path; *pCur != '\0'; pCur++) {
+            const char* pFileName = path;
+            for (const char* pCur = path; *pCur != '\0'; pCur++) {
                 if (*pCur == '/' || *pCur == '\\')
                     pFileName = pCur + 1;
             }
@@ -84,69 +84,73 @@ namespace handler {
             return pFileName;
         }
 
-        static bool isIllegalSymbolAddress(ulong sym, ulong addr) {
-            return sym == 0 || (addr - sym) > nn::diag::GetSymbolSize(sym);
+        // shared by everything outside the crash handler, rebuilt on first use after invalidateModuleTable
+        struct ModuleCache {
+            nn::os::MutexType mMutex = {};
+            ModuleTable mModules;
+            SymbolCache mSymbols;
+            bool mIsValid = false;
+
+            ModuleCache() { nn::os::InitializeMutex(&mMutex, false, 0); }
+        };
+
+        static ModuleCache& getModuleCache() {
+            static ModuleCache cache;
+            return cache;
         }
 
-        static bool findContainModule(nn::diag::ModuleInfo& result, nn::diag::ModuleInfo* moduleInfos, int moduleCount,
-                                      uintptr_t addr) {
-            for (int i = 0; i < moduleCount; ++i) {
-                nn::diag::ModuleInfo& info = moduleInfos[i];
+        // the crash handler can't wait on the shared cache, the crashing thread might be holding it
+        static ModuleTable crashModules;
+        static SymbolCache crashSymbols;
 
-                uintptr_t moduleStart = info.mBaseAddr;
-                uintptr_t moduleEnd = info.mBaseAddr + info.mSize;
+        static void ensureModuleCache(ModuleCache& cache) {
+            if (cache.mIsValid)
+                return;
 
-                if (addr >= moduleStart && addr <= moduleEnd) {
-                    result = moduleInfos[i];
-                    return true;
-                }
-            }
-            return false;
+            cache.mModules.build();
+            cache.mSymbols.clear();
+            cache.mIsValid = true;
         }
 
-        static const char* demangle(const char* symbol) {
-            int status = 0;
-            return abi::__cxa_demangle(symbol, nullptr, nullptr, &status);
+        static ModuleCache& lockModuleCache() {
+            ModuleCache& cache = getModuleCache();
+            nn::os::LockMutex(&cache.mMutex);
+            ensureModuleCache(cache);
+            return cache;
         }
 
-        static void printTraceEntry(const char* traceName, ulong addr, nn::diag::ModuleInfo* moduleInfos,
-                                    int moduleCount) {
-            nn::diag::ModuleInfo containInfo = {};
+        static void unlockModuleCache(ModuleCache& cache) { nn::os::UnlockMutex(&cache.mMutex); }
 
-            char symbol[0x100] = {};
-            uintptr_t symAddr;
-            if (addr != 0)
-                symAddr = nn::diag::GetSymbolName(symbol, 0x100, addr);
-            else
-                symAddr = 0;
+        static void printTraceEntry(const char* traceName, ulong addr, const ModuleTable& modules, SymbolCache& symbols) {
+            const ModuleTable::Module* module = modules.find(addr);
+            const SymbolCache::Symbol& symbol = symbols.resolve(addr);
 
-            if (isIllegalSymbolAddress(symAddr, addr)) {
+            if (symbol.mSymAddr == 0) {
 
-                if (findContainModule(containInfo, moduleInfos, moduleCount, addr)) {
+                if (module) {
                     Logger::log("  %s: 0x%p (%s + 0x%zx)\n", traceName, addr,
-                                getFileNameFromPath(containInfo.mPath), addr - containInfo.mBaseAddr);
+                                getFileNameFromPath(module->mPath), addr - module->mStart);
                 } else {
                     Logger::log("  %s: 0x%p\n", traceName, addr);
                 }
             } else {
-                findContainModule(containInfo, moduleInfos, moduleCount, addr);
+                const char* moduleName = module ? getFileNameFromPath(module->mPath) : nullptr;
+                uintptr_t moduleOffset = module ? addr - module->mStart : addr;
 
-                const char* demangledName = demangle(symbol);
-                if (demangledName) {
-                    Logger::log("  %s: 0x%p (%s + 0x%zx)\n    - %s + 0x%zx\n    - %s\n", traceName, addr, getFileNameFromPath(containInfo.mPath), addr - containInfo.mBaseAddr,
-                                symbol, addr - symAddr, demangledName);
-                    std::free((void*)demangledName);
+                if (symbol.mDemangled) {
+                    Logger::log("  %s: 0x%p (%s + 0x%zx)\n    - %s + 0x%zx\n    - %s\n", traceName, addr, moduleName, moduleOffset,
+                                symbol.mName, addr - symbol.mSymAddr, symbol.mDemangled);
                 } else
-                    Logger::log("  %s: 0x%p (%s + 0x%zx)\n    - %s + 0x%zx\n", traceName, addr, getFileNameFromPath(containInfo.mPath), addr - containInfo.mBaseAddr,
-                                symbol, addr - symAddr);
+                    Logger::log("  %s: 0x%p (%s + 0x%zx)\n    - %s + 0x%zx\n", traceName, addr, moduleName, moduleOffset,
+                                symbol.mName, addr - symbol.mSymAddr);
             }
         }
 
-        static void printStackTrace(const ExceptionInfo* info, nn::diag::ModuleInfo* moduleInfos,
-                                    int moduleCount, bool printPCLR = true, int traceLength = -1) {
+        static void printStackTrace(const ExceptionInfo* info, const ModuleTable& modules, SymbolCache& symbols,
+                                    bool printPCLR = true, int traceLength = -1) {
             if(printPCLR && info) {
-                printTraceEntry("PC", info->pc, moduleInfos, moduleCount);
-                printTraceEntry("LR", info->lr, moduleInfos, moduleCount);
+                printTraceEntry("PC", info->pc, modules, symbols);
+                printTraceEntry("LR", info->lr, modules, symbols);
             }
 
             stack_frame* frame;
@@ -171,7 +175,7 @@ namespace handler {
                     char traceName[0x20] = {};
                     sprintf(traceName, "ReturnAddress[%d]", index);
 
-                    printTraceEntry(traceName, frame->lr, moduleInfos, moduleCount);
+                    printTraceEntry(traceName, frame->lr, modules, symbols);
                 }
                 index++;
 
@@ -179,33 +183,27 @@ namespace handler {
             }
         }
 
-        static void printRegister(uintptr_t addr, nn::diag::ModuleInfo* moduleInfos, int moduleCount) {
-            nn::diag::ModuleInfo containInfo = {};
+        static void printRegister(uintptr_t addr, const ModuleTable& modules, SymbolCache& symbols) {
+            const ModuleTable::Module* module = modules.find(addr);
+            const SymbolCache::Symbol& symbol = symbols.resolve(addr);
 
-            char symbol[0x200] = {};
-            uintptr_t symAddr;
-            if (addr != 0)
-                symAddr = nn::diag::GetSymbolName(symbol, 0x200, addr);
-            else
-                symAddr = 0;
-
-            if (isIllegalSymbolAddress(symAddr, addr)) {
-                if (findContainModule(containInfo, moduleInfos, moduleCount, addr)) {
-                    Logger::log(" (unknown) (%s + 0x%zx)\n", getFileNameFromPath(containInfo.mPath),
-                                addr - containInfo.mBaseAddr);
+            if (symbol.mSymAddr == 0) {
+                if (module) {
+                    Logger::log(" (unknown) (%s + 0x%zx)\n", getFileNameFromPath(module->mPath),
+                                addr - module->mStart);
                 } else {
                     Logger::log("\n");
                 }
             } else {
-                findContainModule(containInfo, moduleInfos, moduleCount, addr);
-                const char* demangledName = demangle(symbol);
-                if (demangledName) {
-                    Logger::log(" (%s + 0x%zx) (%s + 0x%zx) - %s\n", getFileNameFromPath(containInfo.mPath), addr - symAddr,
-                                symbol, addr - containInfo.mBaseAddr, demangledName);
-                    std::free((void*)demangledName);
+                const char* moduleName = module ? getFileNameFromPath(module->mPath) : nullptr;
+                uintptr_t moduleOffset = module ? addr - module->mStart : addr;
+
+                if (symbol.mDemangled) {
+                    Logger::log(" (%s + 0x%zx) (%s + 0x%zx) - %s\n", moduleName, addr - symbol.mSymAddr,
+                                symbol.mName, moduleOffset, symbol.mDemangled);
                 } else
-                    Logger::log(" (%s + 0x%zx) (%s + 0x%zx)\n", getFileNameFromPath(containInfo.mPath), addr - symAddr,
-                                symbol, addr - containInfo.mBaseAddr);
+                    Logger::log(" (%s + 0x%zx) (%s + 0x%zx)\n", moduleName, addr - symbol.mSymAddr,
+                                symbol.mName, moduleOffset);
             }
         }
 
@@ -266,46 +264,58 @@ namespace handler {
 
             // Module Data (used for module dump and stack trace offsets)
 
-            nn::diag::ModuleInfo* moduleInfos;
-            uintptr_t bufSize = nn::diag::GetRequiredBufferSizeForGetAllModuleInfo();
-            void* moduleBuffer = alloca(bufSize);
+            // the crashing thread may be the one holding the shared cache, in which case it can't be trusted either
+            ModuleCache& cache = getModuleCache();
+            bool isCacheLocked = nn::os::TryLockMutex(&cache.mMutex);
 
-            int moduleCount = nn::diag::GetAllModuleInfo(&moduleInfos, moduleBuffer, bufSize);
+            ModuleTable* modules = &crashModules;
+            SymbolCache* symbols = &crashSymbols;
+            if (isCacheLocked) {
+                ensureModuleCache(cache);
+                modules = &cache.mModules;
+                symbols = &cache.mSymbols;
+            } else {
+                crashModules.build();
+                crashSymbols.clear();
+            }
 
             Logger::log("FAR     = 0x%016llX (%21lld)", info->far, info->far);
-            printRegister(info->far, moduleInfos, moduleCount);
+            printRegister(info->far, *modules, *symbols);
 
             // Register Dump
 
             for (int i = 0; i < ACNT(info->r); ++i) {
                 Logger::log("r%-2d     = 0x%016llX (%21lld)", i, info->r[i], info->r[i]);
-                printRegister(info->r[i], moduleInfos, moduleCount);
+                printRegister(info->r[i], *modules, *symbols);
             }
 
             Logger::log("FP      = 0x%016llX (%21lld)\n", info->fp, info->fp);
             Logger::log("LR      = 0x%016llX (%21lld)", info->lr, info->lr);
-            printRegister(info->lr, moduleInfos, moduleCount);
+            printRegister(info->lr, *modules, *symbols);
             Logger::log("SP      = 0x%016llX (%21lld)\n", info->sp, info->sp);
             Logger::log("PC      = 0x%016llX (%21lld)", info->pc, info->pc);
-            printRegister(info->pc, moduleInfos, moduleCount);
+            printRegister(info->pc, *modules, *symbols);
             Logger::log("\n");
 
             // Stack Trace
 
             Logger::log("Stack trace:\n");
 
-            printStackTrace(info, moduleInfos, moduleCount);
+            printStackTrace(info, *modules, *symbols);
 
             // Modules
 
             Logger::log("Module Info:\n");
-            Logger::log("Number of Modules: %d\n", moduleCount);
+            Logger::log("Number of Modules: %d\n", modules->getCount());
             Logger::log("  %-*s   %-*s   path\n", 16, "base", 16, "size");
 
-            for (int i = 0; i < moduleCount; ++i) {
-                nn::diag::ModuleInfo& curInfo = moduleInfos[i];
-                Logger::log("  0x%P 0x%P %s\n", curInfo.mBaseAddr, curInfo.mSize, getFileNameFromPath(curInfo.mPath));
+            for (int i = 0; i < modules->getCount(); ++i) {
+                const ModuleTable::Module& curInfo = modules->get(i);
+                Logger::log("  0x%P 0x%P %s\n", curInfo.mStart, curInfo.mEnd - curInfo.mStart, getFileNameFromPath(curInfo.mPath));
             }
+
+            if (isCacheLocked)
+                unlockModuleCache(cache);
         }
 
         // Implemented in assembly
@@ -324,6 +334,9 @@ namespace handler {
                     printCrashReport(info);
 
                 info->exceptionState = continueRunning ? ExceptionState::Continue : ExceptionState::Exit;
+
+                // the crash report has only been queued so far, get it out before the process is gone
+                Logger::flush();
             }
             phaseFourHandler(info);
         }
@@ -387,40 +400,48 @@ namespace handler {
     void printCrashReport(const ExceptionInfo& info) { detail::printCrashReport(&info); }
 
     void printStackTrace(const ExceptionInfo& info, int traceLength, bool printPCLR) {
-        nn::diag::ModuleInfo* moduleInfos;
-        uintptr_t bufSize = nn::diag::GetRequiredBufferSizeForGetAllModuleInfo();
-        void* moduleBuffer = alloca(bufSize);
-
-        int moduleCount = nn::diag::GetAllModuleInfo(&moduleInfos, moduleBuffer, bufSize);
-
-        detail::printStackTrace(&info, moduleInfos, moduleCount, printPCLR, traceLength);
+        detail::ModuleCache& cache = detail::lockModuleCache();
+        detail::printStackTrace(&info, cache.mModules, cache.mSymbols, printPCLR, traceLength);
+        detail::unlockModuleCache(cache);
     }
 
     void printStackTraceNoInfo(int traceLength, bool printPCLR) {
-        nn::diag::ModuleInfo* moduleInfos;
-        uintptr_t bufSize = nn::diag::GetRequiredBufferSizeForGetAllModuleInfo();
-        void* moduleBuffer = alloca(bufSize);
-
-        int moduleCount = nn::diag::GetAllModuleInfo(&moduleInfos, moduleBuffer, bufSize);
-
-        detail::printStackTrace(nullptr, moduleInfos, moduleCount, printPCLR, traceLength);
+        detail::ModuleCache& cache = detail::lockModuleCache();
+        detail::printStackTrace(nullptr, cache.mModules, cache.mSymbols, printPCLR, traceLength);
+        detail::unlockModuleCache(cache);
     }
 
     bool getAddrModuleName(char* outName, uintptr_t addr) {
-        nn::diag::ModuleInfo* moduleInfos;
-        uintptr_t bufSize = nn::diag::GetRequiredBufferSizeForGetAllModuleInfo();
-        void* moduleBuffer = alloca(bufSize);
-        int moduleCount = nn::diag::GetAllModuleInfo(&moduleInfos, moduleBuffer, bufSize);
+        detail::ModuleCache& cache = detail::lockModuleCache();
 
-        nn::diag::ModuleInfo containModule = {};
-        bool result = detail::findContainModule(containModule, moduleInfos, moduleCount, addr);
+        const ModuleTable::Module* module = cache.mModules.find(addr);
+        if(module) {
+            Logger::log("Module Name: %s\n", module->mPath);
+            strcpy(outName, module->mPath);
+        }
 
-        if(result) {
-            Logger::log("Module Name: %s\n", containModule.mPath);
-            strcpy(outName, containModule.mPath);
+        detail::unlockModuleCache(cache);
+        return module != nullptr;
+    }
+
+    bool getAddrModuleRange(uintptr_t* outStart, uintptr_t* outEnd, uintptr_t addr) {
+        detail::ModuleCache& cache = detail::lockModuleCache();
+
+        const ModuleTable::Module* module = cache.mModules.find(addr);
+        if(module) {
+            *outStart = module->mStart;
+            *outEnd = module->mEnd;
         }
 
-        return result;
+        detail::unlockModuleCache(cache);
+        return module != nullptr;
+    }
+
+    void invalidateModuleTable() {
+        detail::ModuleCache& cache = detail::getModuleCache();
+        nn::os::LockMutex(&cache.mMutex);
+        cache.mIsValid = false;
+        nn::os::UnlockMutex(&cache.mMutex);
     }
 
     void installExceptionHandler(const CatchFunc& handler) {
@@ -55,4 +55,7 @@ namespace handler {
     void printStackTrace(const ExceptionInfo& info, int traceLength = -1, bool printPCLR = true);
     void printStackTraceNoInfo(int traceLength = -1, bool printPCLR = true);
     bool getAddrModuleName(char* outName, uintptr_t addr);
+    bool getAddrModuleRange(uintptr_t* outStart, uintptr_t* outEnd, uintptr_t addr);
+    // module lookups are served from a cached table, call this after loading or unloading a module
+    void invalidateModuleTable();
 } // namespace handler
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "ModuleTable.h"
+
+#include <alloca.h>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <nn/diag.h>
+
+namespace handler {
+
+    void ModuleTable::build() {
+        nn::diag::ModuleInfo* moduleInfos;
+        uintptr_t bufSize = nn::diag::GetRequiredBufferSizeForGetAllModuleInfo();
+        void* moduleBuffer = alloca(bufSize);
+        int moduleCount = nn::diag::GetAllModuleInfo(&moduleInfos, moduleBuffer, bufSize);
+
+        mCount = 0;
+
+        for (int i = 0; i < moduleCount && mCount < cMaxModules; ++i) {
+            nn::diag::ModuleInfo& info = moduleInfos[i];
+
+            // insertion sort, there are only a handful of modules and they mostly come in address order
+            int pos = mCount;
+            while (pos > 0 && mModules[pos - 1].mStart > info.mBaseAddr) {
+                mModules[pos] = mModules[pos - 1];
+                pos--;
+            }
+
+            Module& module = mModules[pos];
+            module.mStart = info.mBaseAddr;
+            module.mEnd = info.mBaseAddr + info.mSize;
+            strncpy(module.mPath, info.mPath, sizeof(module.mPath) - 1);
+            module.mPath[sizeof(module.mPath) - 1] = '\0';
+
+            mCount++;
+        }
+    }
+
+    const ModuleTable::Module* ModuleTable::find(uintptr_t addr) const {
+        // last module starting at or before addr
+        int low = 0;
+        int high = mCount;
+        while (low < high) {
+            int mid = low + (high - low) / 2;
+            if (mModules[mid].mStart <= addr)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+
+        if (low == 0 || addr > mModules[low - 1].mEnd)
+            return nullptr;
+
+        return &mModules[low - 1];
+    }
+
+    const SymbolCache::Symbol& SymbolCache::resolve(uintptr_t addr) {
+        Symbol& symbol = mSymbols[(addr >> 2) & (cEntryCount - 1)];
+
+        // 0 is never looked up, so it doubles as the empty marker
+        if (symbol.mAddr == addr && addr != 0) {
+            mHitCount++;
+            return symbol;
+        }
+
+        mMissCount++;
+
+        std::free(symbol.mDemangled);
+        symbol.mAddr = addr;
+        symbol.mName[0] = '\0';
+        symbol.mDemangled = nullptr;
+        symbol.mSymAddr = addr != 0 ? nn::diag::GetSymbolName(symbol.mName, sizeof(symbol.mName), addr) : 0;
+
+        if (symbol.mSymAddr == 0 || (addr - symbol.mSymAddr) > nn::diag::GetSymbolSize(symbol.mSymAddr)) {
+            symbol.mSymAddr = 0;
+        } else {
+            int status = 0;
+            symbol.mDemangled = abi::__cxa_demangle(symbol.mName, nullptr, nullptr, &status);
+        }
+
+        return symbol;
+    }
+
+    void SymbolCache::clear() {
+        for (Symbol& symbol : mSymbols) {
+            std::free(symbol.mDemangled);
+            symbol = {};
+        }
+    }
+
+} // namespace handler
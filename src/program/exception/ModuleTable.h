@@ -0,0 +1,59 @@
+#pragma once
+
+#include "types.h"
+
+namespace handler {
+
+    // copy of every loaded module's address range, sorted by start so finding the module holding an address
+    // is a binary search instead of asking nn::diag for every module each time.
+    // has to be rebuilt whenever a module is loaded or unloaded.
+    class ModuleTable {
+    public:
+        static constexpr int cMaxModules = 64;
+
+        struct Module {
+            uintptr_t mStart;
+            uintptr_t mEnd; // inclusive, matches how nn::diag ranges were checked before
+            char mPath[0x100];
+        };
+
+        void build();
+
+        const Module* find(uintptr_t addr) const;
+
+        int getCount() const { return mCount; }
+        const Module& get(int idx) const { return mModules[idx]; }
+
+    private:
+        Module mModules[cMaxModules] = {};
+        int mCount = 0;
+    };
+
+    // symbol names and their demangled form by address, so a crash dump that keeps running into the same
+    // addresses (recursion, registers pointing at the same code) only looks each one up and demangles it once.
+    // entries come from the modules that were loaded when they were made, clear it along with the module table.
+    class SymbolCache {
+    public:
+        static constexpr int cEntryCount = 32; // must be a power of two
+
+        struct Symbol {
+            uintptr_t mAddr;
+            uintptr_t mSymAddr; // 0 if addr isn't inside a known symbol
+            char mName[0x200];
+            char* mDemangled; // null if the name couldn't be demangled
+        };
+
+        const Symbol& resolve(uintptr_t addr);
+
+        void clear();
+
+        u32 getHitCount() const { return mHitCount; }
+        u32 getMissCount() const { return mMissCount; }
+
+    private:
+        Symbol mSymbols[cEntryCount] = {};
+        u32 mHitCount = 0;
+        u32 mMissCount = 0;
+    };
+
+} // namespace handler
@@ -24,6 +24,7 @@ bool hasInitImGui = false;
 namespace nvnImGui {
     ProcDrawFunc drawQueue[100];
     size_t drawQueueCount = 0;
+    FrameStats frameStats = {};
 }
 
 #define IMGUI_USEEXAMPLE_DRAW false
@@ -175,24 +176,45 @@ void nvnImGui::addDrawFunc(ProcDrawFunc func) {
 
 void nvnImGui::procDraw() {
 
+    nn::os::Tick startTick = nn::os::GetSystemTick();
+
+    static bool isEnabled = false;
+
+    // while hidden, the toggle is all that's checked. no other input is read and imgui isn't touched at all
+    if(!isEnabled) {
+        InputHelper::updateControllerState();
+
+        if(!InputHelper::isPressPadLeft()) {
+            frameStats.idleFrames++;
+            frameStats.idleTicks += (nn::os::GetSystemTick() - startTick).GetInt64Value();
+            return;
+        }
+
+        isEnabled = true;
+    }
 
     ImguiNvnBackend::newFrame();
     ImGui::NewFrame();
 
-
-    static bool isEnabled = false;
     if(InputHelper::isPressPadLeft()) {
-        isEnabled = !isEnabled;
+        isEnabled = false;
+        ImGui::EndFrame();
+        return;
     }
-    // only use draw queue if enabled
-    if(isEnabled) {
-        for (size_t i = 0; i < drawQueueCount; i++) {
-            drawQueue[i]();
-        }
+
+    for (size_t i = 0; i < drawQueueCount; i++) {
+        drawQueue[i]();
     }
 
     ImGui::Render();
     ImguiNvnBackend::renderDrawData(ImGui::GetDrawData());
+
+    frameStats.activeFrames++;
+    frameStats.activeTicks += (nn::os::GetSystemTick() - startTick).GetInt64Value();
+}
+
+const nvnImGui::FrameStats &nvnImGui::getFrameStats() {
+    return frameStats;
 }
 
 void nvnImGui::InstallHooks() {
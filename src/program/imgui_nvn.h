@@ -10,6 +10,14 @@ namespace nvnImGui {
 
     typedef void (*ProcDrawFunc)();
 
+    // time spent in procDraw, split by whether the overlay was shown
+    struct FrameStats {
+        u32 idleFrames;
+        s64 idleTicks;
+        u32 activeFrames;
+        s64 activeTicks;
+    };
+
     void InstallHooks();
 
     bool InitImGui();
@@ -17,4 +25,6 @@ namespace nvnImGui {
     void procDraw();
 
     void addDrawFunc(ProcDrawFunc func);
+
+    const FrameStats &getFrameStats();
 }
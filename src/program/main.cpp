@@ -4,6 +4,7 @@
 #include "logger/Logger.hpp"
 #include "imgui_nvn.h"
 #include "helpers/PlayerHelper.h"
+#include "helpers/SdFileIndex.h"
 
 #include "exception/ExceptionHandler.h"
 #include "plugin/PluginLoader.h"
@@ -94,6 +95,16 @@ void drawHeapInfo(sead::Heap *heap) {
     drawSizeInfo(size - freeSize,  size, heap->getName().cstr());
 }
 
+void drawHookPoolInfo(const char* name, const exl::hook::PoolStats& stats) {
+    float progress = stats.m_TotalSlots ? (float)stats.m_UsedSlots / stats.m_TotalSlots : 0.f;
+
+    char buf[0x60];
+    sprintf(buf, "%s: %zu/%zu (%zu/%zu pages)", name, stats.m_UsedSlots, stats.m_TotalSlots, stats.m_PageCount, stats.m_MaxPages);
+    ImGui::PushStyleColor(ImGuiCol_PlotHistogram, IM_COL32(0,200,0,255));
+    ImGui::ProgressBar(progress, ImVec2(-FLT_MIN, 0.f), buf);
+    ImGui::PopStyleColor();
+}
+
 void drawHeapInfoRecursive(sead::Heap *heap) {
     if(!heap)
         return;
@@ -126,12 +137,78 @@ void drawPluginDebugWindow() {
 
     drawHeapInfo(PluginLoader::getHeap());
 
+    drawHookPoolInfo("Hooked Addresses", exl::hook::GetTrampolinePoolStats());
+    drawHookPoolInfo("Hooks", exl::hook::GetLinkPoolStats());
+    drawHookPoolInfo("Inline Hooks", exl::hook::GetInlinePoolStats());
+
+    const exl::reloc::Stats& relocStats = exl::reloc::GetStats();
+    ImGui::Text("Startup Relocation: %.3fms (%zu relative, %zu packed)",
+                nn::os::Tick(relocStats.m_Ticks).ToTimeSpan().GetNanoSeconds() / 1000000.f, relocStats.m_RelativeCount,
+                relocStats.m_RelrCount);
+
+    if(ImGui::TreeNode("Symbol Cache")) {
+        exl::util::symbols::Stats stats = exl::util::symbols::GetStats();
+        size_t lookupCount = stats.m_Hits + stats.m_Misses;
+        ImGui::Text("Lookups: %zu hits, %zu misses (%.1f%% hit rate)", stats.m_Hits, stats.m_Misses,
+                    lookupCount ? stats.m_Hits * 100.f / lookupCount : 0.f);
+        ImGui::Text("Slots: %zu/%zu", stats.m_UsedSlots, stats.m_TotalSlots);
+
+        if(ImGui::Button("Reset Stats"))
+            exl::util::symbols::ResetStats();
+
+        ImGui::TreePop();
+    }
+
     if(ImGui::Button("Toggle File Load Logging")) {
         isLogFileLoad = !isLogFileLoad;
     }
     ImGui::SameLine();
     ImGui::Text("%s", isLogFileLoad ? "Enabled" : "Disabled");
 
+    if(ImGui::TreeNode("SD Redirection")) {
+        if(SdFileIndex::isBuilt() && SdFileIndex::isFromManifest())
+            ImGui::Text("Index: %u files, %.2fMB from manifest (loaded in %.3fms)", SdFileIndex::getFileCount(),
+                        SdFileIndex::getManifestDataSize() / (1024.f * 1024.f), SdFileIndex::getBuildTime() / 1000.f);
+        else if(SdFileIndex::isBuilt())
+            ImGui::Text("Index: %u files (built in %.3fms)", SdFileIndex::getFileCount(), SdFileIndex::getBuildTime() / 1000.f);
+        else
+            ImGui::Text("Index: Not built, using SD lookups");
+        ImGui::Text("Lookups: %u redirected, %u not on SD, %u from SD", SdFileIndex::getHitCount(), SdFileIndex::getMissCount(),
+                    SdFileIndex::getFallbackCount());
+        ImGui::Text("Lookup Time: %.3fms", SdFileIndex::getLookupTime() / 1000.f);
+
+        if(ImGui::Button("Rebuild Index"))
+            SdFileIndex::build();
+        ImGui::SameLine();
+        if(ImGui::Button("Drop Index"))
+            SdFileIndex::invalidate();
+        ImGui::SameLine();
+        if(ImGui::Button("Reset Stats"))
+            SdFileIndex::resetStats();
+
+        ImGui::TreePop();
+    }
+
+    if(ImGui::TreeNode("ImGui Rendering")) {
+        const ImguiNvnBackend::RenderStats& stats = ImguiNvnBackend::getRenderStats();
+        ImGui::Text("Record Time: %ldus/frame", stats.recordTime);
+        ImGui::Text("Upload: %zu bytes/frame", stats.uploadBytes);
+        ImGui::Text("Frame Buffers: %d x %.1fKB avg", ImguiNvnBackend::FrameBufferCount,
+                    stats.bufferBytes / 1024.f / ImguiNvnBackend::FrameBufferCount);
+        ImGui::Text("Reallocations: %u (%u in the last minute)", stats.reallocCount, stats.reallocsLastMinute);
+
+        // average cost of the overlay per presented frame, hidden frames should be close to nothing
+        const nvnImGui::FrameStats& frameStats = nvnImGui::getFrameStats();
+        float idleTime = nn::os::Tick(frameStats.idleTicks).ToTimeSpan().GetNanoSeconds() / 1000.f;
+        float activeTime = nn::os::Tick(frameStats.activeTicks).ToTimeSpan().GetNanoSeconds() / 1000.f;
+        ImGui::Text("Hidden: %.2fus/frame over %u frames", frameStats.idleFrames ? idleTime / frameStats.idleFrames : 0.f,
+                    frameStats.idleFrames);
+        ImGui::Text("Shown: %.2fus/frame over %u frames", frameStats.activeFrames ? activeTime / frameStats.activeFrames : 0.f,
+                    frameStats.activeFrames);
+
+        ImGui::TreePop();
+    }
+
     if(!PluginLoader::isPluginsLoaded()) {
         if(ImGui::Button("Load Plugins")) {
             Logger::log("Loading Game Plugins.\n");
@@ -150,6 +227,24 @@ void drawPluginDebugWindow() {
 
     ImGui::Text("Plugin Count: %zu", pluginCount);
 
+    if(ImGui::TreeNode("Load Timings")) {
+        const PluginLoadTimings& timings = PluginLoader::getLoadTimings();
+        ImGui::Text("Directory Scan: %.3fms", timings.mScanTime / 1000.f);
+        ImGui::Text("Read: %.3fms (%.3fmb)", timings.mReadTime / 1000.f, BYTESTOMB((float)timings.mBytesRead));
+        ImGui::Text("Hash: %.3fms (Waited: %.3fms)", timings.mHashTime / 1000.f, timings.mHashWaitTime / 1000.f);
+        ImGui::Text("NRR Generation: %.3fms", timings.mNrrTime / 1000.f);
+        ImGui::Text("Register/Load Modules: %.3fms", timings.mLoadTime / 1000.f);
+        ImGui::Text("Plugin Main: %.3fms", timings.mMainTime / 1000.f);
+        ImGui::Text("Total: %.3fms", timings.mTotalTime / 1000.f);
+        const PluginHashCache& hashCache = PluginLoader::getHashCache();
+        ImGui::Text("Hash Cache: %u hits, %u misses", hashCache.getHitCount(), hashCache.getMissCount());
+        const PluginWatcher& watcher = PluginLoader::getWatcher();
+        ImGui::Text("Watcher: Last Poll: %.3fms (%u polls) Last Reload: %.3fms (Latency: %.3fms, %u reloads)",
+                    watcher.getLastPollTime() / 1000.f, watcher.getPollCount(), watcher.getLastReloadTime() / 1000.f,
+                    watcher.getLastReloadLatency() / 1000.f, watcher.getReloadCount());
+        ImGui::TreePop();
+    }
+
     const char* pluginNames[pluginCount];
     PluginLoader::getPluginNames(pluginNames);
 
@@ -160,14 +255,31 @@ void drawPluginDebugWindow() {
             if(ImGui::TreeNode(idBuf)) {
                 PluginData* plugin = PluginLoader::getPluginData(i);
                 ImGui::Text("Is Plugin Loaded?: %s", BTOC(plugin->mModuleLoaded));
-                if(!plugin->mModuleLoaded) {
-                    continue;
+
+                size_t boundCount = 0, pendingCount = 0;
+                plugin->getImportCounts(&boundCount, &pendingCount);
+                ImGui::Text("Binding: %s, %zu functions bound, %zu pending", plugin->mIsLazyBind ? "Lazy" : "Now", boundCount,
+                            pendingCount);
+
+                // drawing happens on the render thread, so the loader does these between frames
+                if(ImGui::Button("Reload")) {
+                    PluginLoader::requestReload(i);
                 }
-                char hashStr[65] = {};
-                plugin->mPluginHash.sprint(hashStr);
-                ImGui::Text("Plugin Hash: %s", hashStr);
 
-                drawHeapInfo(plugin->mHeap);
+                if(plugin->mModuleLoaded) {
+                    ImGui::SameLine();
+                    if(ImGui::Button("Unload")) {
+                        PluginLoader::requestUnload(i);
+                    }
+                }
+
+                if(plugin->mModuleLoaded) {
+                    char hashStr[65] = {};
+                    plugin->mPluginHash.sprint(hashStr);
+                    ImGui::Text("Plugin Hash: %s", hashStr);
+
+                    drawHeapInfo(plugin->mHeap);
+                }
 
                 ImGui::TreePop();
             }
@@ -294,17 +406,17 @@ HOOK_DEFINE_TRAMPOLINE(RedirectFileDevice) {
 
             device = thisPtr->findDevice("sd");
 
-            if (!(device && device->isExistFile(path))) {
+            if (!(device && SdFileIndex::isExistFile(device, path))) {
 
                 device = thisPtr->getDefaultFileDevice();
 
                 if (!device) {
-                    Logger::log("drive name not found and default file device is null\n");
+                    Logger::logDeferred("drive name not found and default file device is null\n");
                     return nullptr;
                 }
 
             } else {
-                Logger::log("Found File on SD! Path: %s\n", path.cstr());
+                Logger::logDeferred("Found File on SD! Path: %s\n", path.cstr());
             }
 
         } else
@@ -323,7 +435,7 @@ HOOK_DEFINE_TRAMPOLINE(RedirectFileDevice) {
 sead::FileDevice *tryFindNewDevice(sead::SafeString &path, sead::FileDevice *orig) {
     sead::FileDevice *sdFileDevice = sead::FileDeviceMgr::instance()->findDevice("sd");
 
-    if (sdFileDevice && sdFileDevice->isExistFile(path))
+    if (sdFileDevice && SdFileIndex::isExistFile(sdFileDevice, path))
         return sdFileDevice;
     return orig;
 }
@@ -351,7 +463,7 @@ HOOK_DEFINE_TRAMPOLINE(FileLoaderThreadLoadFileHook) {
     static void Callback(al::FileLoaderThread *thisPtr, al::FileEntryBase* fileEntry) {
 
         if(isLogFileLoad)
-            Logger::log("Loading File: %s\n", fileEntry->mFileName.cstr());
+            Logger::logDeferred("Loading File: %s\n", fileEntry->mFileName.cstr());
 
         Orig(thisPtr, fileEntry);
     }
@@ -365,21 +477,26 @@ HOOK_DEFINE_TRAMPOLINE(CheckPlayerDamageHook) {
     }
 };
 
-bool gameSystemInitPrefix(GameSystem*){
-    PluginLoader::createHeap();
+// plugins add event subscribers while loading, which can't happen from inside one of the Init event's own prefixes.
+// installed after every event, this hook runs before the Init event's hook, so plugins are loaded before any of
+// its subscribers run (including the ones the plugins just added).
+HOOK_DEFINE_TRAMPOLINE(GameSystemInitHook) {
+    static void Callback(GameSystem* thisPtr) {
+        PluginLoader::createHeap();
 
-    Logger::log("Loading Game Plugins.\n");
+        Logger::log("Loading Game Plugins.\n");
 
-    handler::tryCatch([]() {
-        PluginLoader::loadPlugins("sd:/smo/PluginData");
-    }, [](handler::ExceptionInfo& info) {
-        Logger::log("Exception caught while loading plugins. Unable to continue loading.\n");
-        handler::printStackTrace(info, 1, true);
-        return true;
-    });
+        handler::tryCatch([]() {
+            PluginLoader::loadPlugins("sd:/smo/PluginData");
+        }, [](handler::ExceptionInfo& info) {
+            Logger::log("Exception caught while loading plugins. Unable to continue loading.\n");
+            handler::printStackTrace(info, 1, true);
+            return true;
+        });
 
-    return true;
-}
+        Orig(thisPtr);
+    }
+};
 
 extern "C" void exl_main(void *x0, void *x1) {
     /* Setup hooking enviroment. */
@@ -402,47 +519,62 @@ extern "C" void exl_main(void *x0, void *x1) {
     Logger::setLogType(LoggerType::ImGui);
 #endif
 
-    // event system
+    // every hook installed below shares one cache flush at the end of the batch
+    nn::os::Tick hookStartTick = nn::os::GetSystemTick();
+    {
+        exl::hook::HookBatch hookBatch;
 
-    EventSystem::installAllEvents();
+        // event system
 
-    CheckPlayerDamageHook::InstallAtSymbol("_ZN16GameDataFunction12damagePlayerE20GameDataHolderWriter");
+        EventSystem::installAllEvents();
 
-    GameSystemEvent::Init::addEvent(&gameSystemInitPrefix, nullptr);
+        CheckPlayerDamageHook::InstallAtSymbol("_ZN16GameDataFunction12damagePlayerE20GameDataHolderWriter");
 
-    // sd mounting
+        GameSystemInitHook::InstallAtSymbol("_ZN10GameSystem4initEv");
 
-    if(nn::fs::MountSdCardForDebug("sd").isSuccess()) {
-        Logger::log("Mounted SD.\n");
-    }
+        // sd mounting
+
+        if(nn::fs::MountSdCardForDebug("sd").isSuccess()) {
+            Logger::log("Mounted SD.\n");
 
-    // SD File Redirection
+            // file redirection checks every path the game loads against the SD, so index it once up front
+            SdFileIndex::build();
+            Logger::log("Indexed %u SD files%s in %ld us.\n", SdFileIndex::getFileCount(),
+                        SdFileIndex::isFromManifest() ? " from manifest" : "", SdFileIndex::getBuildTime());
+        }
 
-    RedirectFileDevice::InstallAtSymbol("_ZNK4sead13FileDeviceMgr18findDeviceFromPathERKNS_14SafeStringBaseIcEEPNS_22BufferedSafeStringBaseIcEE");
-    FileLoaderLoadArc::InstallAtSymbol("_ZN2al10FileLoader16loadArchiveLocalERKN4sead14SafeStringBaseIcEEPKcPNS1_10FileDeviceE");
-    CreateFileDeviceMgr::InstallAtSymbol("_ZN4sead13FileDeviceMgrC2Ev");
-    FileLoaderIsExistFile::InstallAtSymbol("_ZNK2al10FileLoader11isExistFileERKN4sead14SafeStringBaseIcEEPNS1_10FileDeviceE");
-    FileLoaderIsExistArchive::InstallAtSymbol("_ZNK2al10FileLoader14isExistArchiveERKN4sead14SafeStringBaseIcEEPNS1_10FileDeviceE");
+        // SD File Redirection
 
-    // Sead Debugging Overriding
+        RedirectFileDevice::InstallAtSymbol("_ZNK4sead13FileDeviceMgr18findDeviceFromPathERKNS_14SafeStringBaseIcEEPNS_22BufferedSafeStringBaseIcEE");
+        FileLoaderLoadArc::InstallAtSymbol("_ZN2al10FileLoader16loadArchiveLocalERKN4sead14SafeStringBaseIcEEPKcPNS1_10FileDeviceE");
+        CreateFileDeviceMgr::InstallAtSymbol("_ZN4sead13FileDeviceMgrC2Ev");
+        FileLoaderIsExistFile::InstallAtSymbol("_ZNK2al10FileLoader11isExistFileERKN4sead14SafeStringBaseIcEEPNS1_10FileDeviceE");
+        FileLoaderIsExistArchive::InstallAtSymbol("_ZNK2al10FileLoader14isExistArchiveERKN4sead14SafeStringBaseIcEEPNS1_10FileDeviceE");
 
-    ReplaceSeadPrint::InstallAtSymbol("_ZN4sead6system5PrintEPKcz");
+        // Sead Debugging Overriding
 
-    // File Load Logging
+        ReplaceSeadPrint::InstallAtSymbol("_ZN4sead6system5PrintEPKcz");
 
-    FileLoaderThreadLoadFileHook::InstallAtSymbol("_ZN2al16FileLoaderThread15requestLoadFileEPNS_13FileEntryBaseE");
+        // File Load Logging
 
-    // ImGui Hooks
+        FileLoaderThreadLoadFileHook::InstallAtSymbol("_ZN2al16FileLoaderThread15requestLoadFileEPNS_13FileEntryBaseE");
+
+        // ImGui Hooks
 #if IMGUI_ENABLED
-    nvnImGui::InstallHooks();
+        nvnImGui::InstallHooks();
 
-    nvnImGui::addDrawFunc(drawPluginDebugWindow);
+        nvnImGui::addDrawFunc(drawPluginDebugWindow);
 
-    // TODO: add plugin window drawing visibility toggle
-    nvnImGui::addDrawFunc([]() {
-        ModEvent::ImguiDraw::RunEvents();
-    });
+        nvnImGui::addDrawFunc(EventProfiler::drawWindow);
+
+        // TODO: add plugin window drawing visibility toggle
+        nvnImGui::addDrawFunc([]() {
+            ModEvent::ImguiDraw::RunEvents();
+        });
 #endif
+    }
+
+    Logger::log("Installed hooks in %ld us.\n", (nn::os::GetSystemTick() - hookStartTick).ToTimeSpan().GetMicroSeconds());
 }
 
 extern "C" NORETURN void exl_exception_entry() {
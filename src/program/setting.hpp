@@ -22,7 +22,27 @@ namespace exl::setting {
     /* How large the area will be inline hook pool. */
     constexpr size_t InlinePoolSize = 0x4000;
 
+    /* How large the area will be for chaining multiple hooks onto the same address. */
+    constexpr size_t HookLinkPoolSize = 0x1000;
+
+    /* How much code memory is mapped each time a hook pool runs out of space. */
+    constexpr size_t JitGrowSize = 0x4000;
+
+    /* How many pages (including the static area) a hook pool can grow to. */
+    constexpr size_t JitMaxPages = 16;
+
+    /* How far past the static area pages are allowed to be mapped, hooks still have to reach them with a branch. */
+    constexpr size_t JitMaxDistance = 0x2000000;
+
+    /* How many removed hooks can wait for their trampolines to be freed, any past this are never reused. */
+    constexpr size_t HookRetireQueueSize = 0x100;
+
+    /* How many symbol names the lookup cache can hold, has to be a power of two. */
+    constexpr size_t SymbolCacheSize = 0x400;
+
     /* Sanity checks. */
     static_assert(ALIGN_UP(JitSize, PAGE_SIZE) == JitSize, "");
-    static_assert(ALIGN_UP(InlinePoolSize, PAGE_SIZE) == JitSize, "");
+    static_assert(ALIGN_UP(InlinePoolSize, PAGE_SIZE) == InlinePoolSize, "");
+    static_assert(ALIGN_UP(HookLinkPoolSize, PAGE_SIZE) == HookLinkPoolSize, "");
+    static_assert(ALIGN_UP(JitGrowSize, PAGE_SIZE) == JitGrowSize, "");
 }
\ No newline at end of file
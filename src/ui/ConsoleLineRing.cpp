@@ -0,0 +1,116 @@
+#include "ConsoleLineRing.h"
+
+#include "nn/init.h"
+#include <cstring>
+
+ConsoleLineRing::ConsoleLineRing(s32 textCapacity, s32 lineCapacity) {
+    clear(textCapacity, lineCapacity);
+}
+
+ConsoleLineRing::~ConsoleLineRing() {
+    freeBuffers();
+}
+
+void ConsoleLineRing::freeBuffers() {
+    if(mText)
+        nn::init::GetAllocator()->Free(mText);
+    if(mLines)
+        nn::init::GetAllocator()->Free(mLines);
+
+    mText = nullptr;
+    mLines = nullptr;
+}
+
+void ConsoleLineRing::clear(s32 textCapacity, s32 lineCapacity) {
+    bool isResized = (textCapacity > 0 && textCapacity != mTextCapacity) || (lineCapacity > 0 && lineCapacity != mLineCapacity);
+
+    if(isResized) {
+        freeBuffers(); // reallocated on the next line
+        if(textCapacity > 0)
+            mTextCapacity = textCapacity;
+        if(lineCapacity > 0)
+            mLineCapacity = lineCapacity;
+    }
+
+    mTextHead = 0;
+    mFirstLine = mEndLine;
+    mIsLastLineOpen = false;
+}
+
+char* ConsoleLineRing::reserveText(s32 size) {
+    if(!mText) {
+        mText = (char*)nn::init::GetAllocator()->Allocate(mTextCapacity);
+        mLines = (Line*)nn::init::GetAllocator()->Allocate(sizeof(Line) * mLineCapacity);
+    }
+
+    if(mTextHead + size > mTextCapacity) {
+        // the lines left between the head and the end are the oldest ones, they go before anything at the start
+        while (mFirstLine < mEndLine && getLine(mFirstLine).mOffset >= mTextHead)
+            mFirstLine++;
+        mTextHead = 0;
+    }
+
+    // the oldest lines come right after the head, drop them until the new text doesn't overlap any
+    while (mFirstLine < mEndLine) {
+        const Line& oldest = getLine(mFirstLine);
+        if(oldest.mOffset >= mTextHead + size || oldest.mOffset + oldest.mLength <= mTextHead)
+            break;
+        mFirstLine++;
+    }
+
+    char* out = mText + mTextHead;
+    mTextHead += size;
+    return out;
+}
+
+void ConsoleLineRing::addLine(u8 severity, const char* prefix, s32 prefixLen, const char* text, s32 textLen, bool isOpen) {
+    s32 size = prefixLen + textLen;
+    if(size > mTextCapacity) {
+        textLen = mTextCapacity - prefixLen;
+        size = mTextCapacity;
+    }
+
+    // continue the last line if its text can simply be extended in place
+    if(mIsLastLineOpen && mEndLine > mFirstLine) {
+        Line& last = getMutableLine(mEndLine - 1);
+        if(last.mOffset + last.mLength == mTextHead && mTextHead + textLen <= mTextCapacity && last.mLength + textLen <= mTextCapacity / 2) {
+            memcpy(reserveText(textLen), text, textLen);
+            // the text was reserved right after the line, so it can only have been dropped if the ring is tiny
+            if(mEndLine > mFirstLine) {
+                getMutableLine(mEndLine - 1).mLength += textLen;
+                mIsLastLineOpen = isOpen;
+                return;
+            }
+        }
+    }
+
+    char* out = reserveText(size);
+    memcpy(out, prefix, prefixLen);
+    memcpy(out + prefixLen, text, textLen);
+
+    if(mEndLine - mFirstLine >= (u64)mLineCapacity)
+        mFirstLine++;
+
+    getMutableLine(mEndLine) = { (s32)(out - mText), size, severity };
+    mEndLine++;
+    mIsLastLineOpen = isOpen;
+}
+
+ConsoleLineFilter::~ConsoleLineFilter() {
+    if(mLines)
+        nn::init::GetAllocator()->Free(mLines);
+}
+
+void ConsoleLineFilter::reset(const ConsoleLineRing& ring) {
+    if(mCapacity != ring.getLineCapacity()) {
+        if(mLines)
+            nn::init::GetAllocator()->Free(mLines);
+        mCapacity = ring.getLineCapacity();
+        mLines = (u64*)nn::init::GetAllocator()->Allocate(sizeof(u64) * mCapacity);
+    }
+
+    mHead = 0;
+    mCount = 0;
+    mCheckedEnd = ring.getFirstLine();
+    mIsDirty = false;
+}
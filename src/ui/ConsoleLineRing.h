@@ -0,0 +1,116 @@
+#pragma once
+
+#include "types.h"
+
+// lines of text kept in two fixed size rings, one for the text and one indexing it, so memory never grows.
+// once either ring is full the oldest lines are dropped. line numbers keep counting up across drops and clears,
+// so a line number never refers to a different line later on, it just stops being stored.
+class ConsoleLineRing {
+public:
+    struct Line {
+        s32 mOffset; // into the text ring, a line is never split around its end
+        s32 mLength;
+        u8 mSeverity;
+    };
+
+private:
+    s32 mTextCapacity = 0;
+    s32 mLineCapacity = 0;
+    char* mText = nullptr; // both allocated on the first line
+    Line* mLines = nullptr; // indexed by line number % mLineCapacity
+    s32 mTextHead = 0;      // where the next line's text is written
+    u64 mFirstLine = 0;     // number of the oldest line still stored
+    u64 mEndLine = 0;       // number of the next line to be added
+    bool mIsLastLineOpen = false; // the last line didn't end with a newline, the next text continues it
+
+    Line& getMutableLine(u64 lineNo) { return mLines[lineNo % mLineCapacity]; }
+
+    void freeBuffers();
+
+    char* reserveText(s32 size);
+
+public:
+    // textCapacity is the memory cap for the text of every line, in bytes
+    ConsoleLineRing(s32 textCapacity, s32 lineCapacity);
+
+    ~ConsoleLineRing();
+
+    ConsoleLineRing(const ConsoleLineRing&) = delete;
+    ConsoleLineRing& operator=(const ConsoleLineRing&) = delete;
+
+    // drops every line, and applies new capacities if they're non-zero
+    void clear(s32 textCapacity = 0, s32 lineCapacity = 0);
+
+    // adds prefix and text as a new line, or appends just the text to the last line if that one was left open.
+    // isOpen leaves this line open in turn. text past the text capacity is cut off.
+    void addLine(u8 severity, const char* prefix, s32 prefixLen, const char* text, s32 textLen, bool isOpen);
+
+    const Line& getLine(u64 lineNo) const { return mLines[lineNo % mLineCapacity]; }
+
+    const char* getLineText(u64 lineNo) const { return mText + getLine(lineNo).mOffset; }
+
+    u64 getFirstLine() const { return mFirstLine; }
+
+    u64 getEndLine() const { return mEndLine; }
+
+    // end of the lines that can't change anymore, the open line (if there is one) can still be appended to
+    u64 getCompleteEnd() const { return mIsLastLineOpen && mEndLine > mFirstLine ? mEndLine - 1 : mEndLine; }
+
+    bool isLastLineOpen() const { return mIsLastLineOpen; }
+
+    s32 getTextCapacity() const { return mTextCapacity; }
+
+    s32 getLineCapacity() const { return mLineCapacity; }
+};
+
+// numbers of the lines in a ConsoleLineRing passing a filter. only lines added since the last update are checked,
+// and since passing lines are a subset of the stored ones, the results fit in a ring of the same line capacity.
+class ConsoleLineFilter {
+    u64* mLines = nullptr;
+    s32 mCapacity = 0;
+    s32 mHead = 0;
+    s32 mCount = 0;
+    u64 mCheckedEnd = 0; // lines from here on haven't been checked yet
+    bool mIsDirty = true;
+
+    void reset(const ConsoleLineRing& ring);
+
+public:
+    ConsoleLineFilter() = default;
+
+    ~ConsoleLineFilter();
+
+    ConsoleLineFilter(const ConsoleLineFilter&) = delete;
+    ConsoleLineFilter& operator=(const ConsoleLineFilter&) = delete;
+
+    // the filter changed, every stored line is checked again on the next update
+    void markDirty() { mIsDirty = true; }
+
+    template <typename Pred>
+    void update(const ConsoleLineRing& ring, Pred&& isPassing) {
+        if(mIsDirty || mCapacity != ring.getLineCapacity())
+            reset(ring);
+
+        // forget results for lines the ring dropped
+        while (mCount != 0 && getLineNo(0) < ring.getFirstLine()) {
+            mHead = (mHead + 1) % mCapacity;
+            mCount--;
+        }
+
+        u64 end = ring.getCompleteEnd();
+        for (u64 lineNo = mCheckedEnd > ring.getFirstLine() ? mCheckedEnd : ring.getFirstLine(); lineNo < end; lineNo++) {
+            if(isPassing(lineNo)) {
+                mLines[(mHead + mCount) % mCapacity] = lineNo;
+                mCount++;
+            }
+        }
+
+        if(end > mCheckedEnd)
+            mCheckedEnd = end;
+    }
+
+    s32 getCount() const { return mCount; }
+
+    // idx counts from the oldest passing line
+    u64 getLineNo(s32 idx) const { return mLines[(mHead + idx) % mCapacity]; }
+};
@@ -1,97 +1,115 @@
 #include "ImGuiDebugConsole.h"
 #include <time/seadDateTime.h>
+#include <cstdio>
+#include <cstring>
 
 namespace ImGuiUI
 {
-    DebugConsole::DebugConsole()
+    static const ImU32 SeverityColors[] = {
+        IM_COL32(200, 200, 200, 255),
+        IM_COL32(220, 230, 0, 255),
+        IM_COL32(230, 20, 20, 255),
+    };
+
+    static const char* SeverityPrefixes[] = { "[Info] ", "[Warn] ", "[Error] " };
+
+    DebugConsole::DebugConsole(int textCapacity, int lineCapacity) : Lines(textCapacity, lineCapacity)
     {
         AutoScroll = true;
         Timestamped = true;
-        Clear();
-        LineColors.push_back(IM_COL32_WHITE); // add line color to list
+        SeverityFilter = 0;
     }
 
-    void DebugConsole::Clear()
+    void DebugConsole::Clear(int textCapacity, int lineCapacity)
     {
-        Buf.clear();
-        LineOffsets.clear();
-        LineOffsets.push_back(0);
-
-        LineColors.clear();
+        Lines.clear(textCapacity, lineCapacity);
     }
 
-    void DebugConsole::AddLog(const char* fmt, va_list args, ImU32 col)
+    void DebugConsole::LogText(Severity sev, const char* text, size_t len)
     {
-        int old_size = Buf.size(); // get previous buffer size
-        Buf.appendfv(fmt, args); // adds log message to text buffer
-        for (int new_size = Buf.size(); old_size < new_size; old_size++)
-            if (Buf[old_size] == '\n')
-                LineOffsets.push_back(old_size + 1); // once we get to the end of the new string, push the index to the list of offsets
+        char prefix[0x20];
+        int prefixLen = 0;
 
-        LineColors.push_back(col); // add line color to list
-
-    }
+        if (!Lines.isLastLineOpen())
+        {
+            if (Timestamped)
+            {
+                sead::DateTime curTime(0);
+                curTime.setNow();
+                sead::CalendarTime calTime;
+                curTime.getCalendarTime(&calTime);
 
-    void DebugConsole::AddLogTimeStamped(const char* fmt, va_list args, ImU32 col) {
+                prefixLen = snprintf(prefix, sizeof(prefix), "[%02u:%02u:%02u] %s", calTime.getHour(), calTime.getMinute(),
+                                     calTime.getSecond(), SeverityPrefixes[(int)sev]);
+            }
+            else
+            {
+                prefixLen = snprintf(prefix, sizeof(prefix), "%s", SeverityPrefixes[(int)sev]);
+            }
+        }
 
-        sead::DateTime curTime(0);
-        curTime.setNow();
-        sead::CalendarTime calTime;
-        curTime.getCalendarTime(&calTime);
+        const char* end = text + len;
+        while (text < end)
+        {
+            const char* lineEnd = (const char*)memchr(text, '\n', end - text);
+            bool isOpen = lineEnd == nullptr;
+            if (isOpen)
+                lineEnd = end;
 
-        char newFmt[18+strlen(fmt)];
-        sprintf(newFmt, "[%02u:%02u:%02u] %s", calTime.getHour(), calTime.getMinute(), calTime.getSecond(), fmt);
+            Lines.addLine((u8)sev, prefix, prefixLen, text, (int)(lineEnd - text), isOpen);
 
-        AddLog(newFmt, args, col);
+            text = isOpen ? end : lineEnd + 1;
+            prefixLen = 0; // only the first line of a log is prefixed
+        }
+    }
 
+    void DebugConsole::AddLog(Severity sev, const char* fmt, va_list args)
+    {
+        char buffer[0x500];
+        int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+        if (len > 0)
+            LogText(sev, buffer, ImMin(len, (int)sizeof(buffer) - 1));
     }
 
     void DebugConsole::LogInfo(const char* fmt, ...) {
         va_list args;
         va_start(args, fmt);
-        char newFmt[8+strlen(fmt)];
-        sprintf(newFmt, "[Info] %s", fmt);
-
-        ImU32 col = IM_COL32(200, 200, 200, 255);
-
-        if(Timestamped)
-            AddLogTimeStamped(newFmt, args, col);
-        else
-            AddLog(newFmt, args, col);
-
+        AddLog(Severity::Info, fmt, args);
         va_end(args);
     }
 
     void DebugConsole::LogError(const char* fmt, ...) {
         va_list args;
         va_start(args, fmt);
-        char newFmt[8+strlen(fmt)];
-        sprintf(newFmt, "[Error] %s", fmt);
-
-        ImU32 col = IM_COL32(230, 20, 20, 255);
-
-        if(Timestamped)
-            AddLogTimeStamped(newFmt, args, col);
-        else
-            AddLog(newFmt, args, col);
-
+        AddLog(Severity::Error, fmt, args);
         va_end(args);
     }
 
     void DebugConsole::LogWarn(const char* fmt, ...) {
         va_list args;
         va_start(args, fmt);
-        char newFmt[8+strlen(fmt)];
-        sprintf(newFmt, "[Warn] %s", fmt);
+        AddLog(Severity::Warn, fmt, args);
+        va_end(args);
+    }
 
-        ImU32 col = IM_COL32(220, 230, 0, 255);
+    bool DebugConsole::PassFilter(ImU64 lineNo) const
+    {
+        const ConsoleLineRing::Line& line = Lines.getLine(lineNo);
+        if (SeverityFilter != 0 && line.mSeverity != SeverityFilter - 1)
+            return false;
 
-        if(Timestamped)
-            AddLogTimeStamped(newFmt, args, col);
-        else
-            AddLog(newFmt, args, col);
+        const char* text = Lines.getLineText(lineNo);
+        return Filter.PassFilter(text, text + line.mLength);
+    }
 
-        va_end(args);
+    void DebugConsole::DrawLine(ImU64 lineNo) const
+    {
+        const ConsoleLineRing::Line& line = Lines.getLine(lineNo);
+        const char* text = Lines.getLineText(lineNo);
+
+        ImGui::PushStyleColor(ImGuiCol_Text, SeverityColors[line.mSeverity]);
+        ImGui::TextUnformatted(text, text + line.mLength);
+        ImGui::PopStyleColor();
     }
 
     void DebugConsole::Draw(const char* title, bool* p_open)
@@ -120,30 +138,12 @@ namespace ImGuiUI
         ImGui::SameLine();
         // Filter settings
         const char* filterLabels[] = { "None", "Info", "Warn", "Error" };
-        const char* filterValues[] = { "", "[Info]", "[Warn]", "[Error]" };
-        static int item_current_idx = 0; // Here we store our selection data as an index.
-        const char* curFilterLabel = filterLabels[item_current_idx];  // Pass in the preview value visible before opening the combo (it could be anything)
-        const char* curFilter = filterValues[item_current_idx];
-
-        if (ImGui::BeginCombo("Filter Type", curFilterLabel))
-        {
-            for (int n = 0; n < IM_ARRAYSIZE(filterLabels); n++)
-            {
-                const bool is_selected = (item_current_idx == n);
-                if (ImGui::Selectable(filterLabels[n], is_selected))
-                    item_current_idx = n;
-
-                // Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
-                if (is_selected)
-                    ImGui::SetItemDefaultFocus();
-            }
-            ImGui::EndCombo();
-        }
-
-        if(strcmp(Filter.InputBuf, curFilter) != 0) {
-            strncpy(Filter.InputBuf, curFilter, IM_ARRAYSIZE(Filter.InputBuf));
-            Filter.Build();
-        }
+        ImGui::SetNextItemWidth(100);
+        if (ImGui::Combo("Filter Type", &SeverityFilter, filterLabels, IM_ARRAYSIZE(filterLabels)))
+            FilteredLines.markDirty();
+        ImGui::SameLine();
+        if (Filter.Draw("Search", 200))
+            FilteredLines.markDirty();
 
         ImGui::Separator();
 
@@ -155,66 +155,23 @@ namespace ImGuiUI
                 ImGui::LogToClipboard();
 
             ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
-            const char* buf = Buf.begin();
-            const char* buf_end = Buf.end();
-            if (Filter.IsActive())
-            {
-                // In this example we don't use the clipper when Filter is enabled.
-                // This is because we don't have random access to the result of our filter.
-                // A real application processing logs with ten of thousands of entries may want to store the result of
-                // search/filter.. especially if the filtering function is not trivial (e.g. reg-exp).
-                for (int line_no = 0; line_no < LineOffsets.Size; line_no++)
-                {
-                    const char* line_start = buf + LineOffsets[line_no];
-                    const char* line_end = (line_no + 1 < LineOffsets.Size) ? (buf + LineOffsets[line_no + 1] - 1) : buf_end;
-                    if (Filter.PassFilter(line_start, line_end)) {
-                        if(LineColors.Size > line_no) {
-                            ImGui::PushStyleColor(ImGuiCol_Text, LineColors[line_no]);
-                            ImGui::TextUnformatted(line_start, line_end);
-                            ImGui::PopStyleColor();
-                        }else {
-                            ImGui::TextUnformatted(line_start, line_end);
-                        }
-                    }
-                }
-            }
-            else
+
+            // every line is the same height, so only the visible ones need to be touched, filtered or not
+            bool isFiltered = SeverityFilter != 0 || Filter.IsActive();
+            // only lines added since the last frame are run through the filter, an open line waits until it's complete
+            if (isFiltered)
+                FilteredLines.update(Lines, [this](ImU64 lineNo) { return PassFilter(lineNo); });
+
+            int lineCount = isFiltered ? FilteredLines.getCount() : (int)(Lines.getEndLine() - Lines.getFirstLine());
+
+            ImGuiListClipper clipper;
+            clipper.Begin(lineCount);
+            while (clipper.Step())
             {
-                // The simplest and easy way to display the entire buffer:
-                //   ImGui::TextUnformatted(buf_begin, buf_end);
-                // And it'll just work. TextUnformatted() has specialization for large blob of text and will fast-forward
-                // to skip non-visible lines. Here we instead demonstrate using the clipper to only process lines that are
-                // within the visible area.
-                // If you have tens of thousands of items and their processing cost is non-negligible, coarse clipping them
-                // on your side is recommended. Using ImGuiListClipper requires
-                // - A) random access into your data
-                // - B) items all being the  same height,
-                // both of which we can handle since we have an array pointing to the beginning of each line of text.
-                // When using the filter (in the block of code above) we don't have random access into the data to display
-                // anymore, which is why we don't use the clipper. Storing or skimming through the search result would make
-                // it possible (and would be recommended if you want to search through tens of thousands of entries).
-                ImGuiListClipper clipper;
-                clipper.Begin(LineOffsets.Size);
-                while (clipper.Step())
-                {
-                    for (int line_no = clipper.DisplayStart; line_no < clipper.DisplayEnd; line_no++)
-                    {
-
-                        const char* line_start = buf + LineOffsets[line_no];
-                        const char* line_end = (line_no + 1 < LineOffsets.Size) ? (buf + LineOffsets[line_no + 1] - 1) : buf_end;
-
-                        if(LineColors.Size > line_no) {
-                            ImGui::PushStyleColor(ImGuiCol_Text, LineColors[line_no]);
-                            ImGui::TextUnformatted(line_start, line_end);
-                            ImGui::PopStyleColor();
-                        }else {
-                            ImGui::TextUnformatted(line_start, line_end);
-                        }
-
-                    }
-                }
-                clipper.End();
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+                    DrawLine(isFiltered ? FilteredLines.getLineNo(i) : Lines.getFirstLine() + i);
             }
+            clipper.End();
             ImGui::PopStyleVar();
 
             // Keep up at the bottom of the scroll region if we were already at the bottom at the beginning of the frame.
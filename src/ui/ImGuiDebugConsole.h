@@ -1,27 +1,44 @@
 #pragma once
 
 #include <imgui.h>
+#include "ConsoleLineRing.h"
 
-// this struct is pretty much exactly ImGui's ExampleAppLog
+// started out as ImGui's ExampleAppLog, but keeps its lines in fixed size rings so long sessions don't grow memory.
+// once either ring is full the oldest lines are dropped.
 namespace ImGuiUI {
     class DebugConsole
     {
-        ImGuiTextBuffer     Buf;
+    public:
+        enum class Severity {
+            Info,
+            Warn,
+            Error
+        };
+
+    private:
+        ConsoleLineRing     Lines;
+
         ImGuiTextFilter     Filter;
-        ImVector<int>       LineOffsets; // Index to lines offset. We maintain this with AddLog() calls.
-        ImVector<ImU32>     LineColors;  // List of line colors (changes depending on log severity)
+        int                 SeverityFilter; // 0 for none, otherwise Severity + 1
+        ConsoleLineFilter   FilteredLines;
+
         bool                AutoScroll;  // Keep scrolling if already at the bottom.
         bool                Timestamped; // Adds the current system time to the log.
 
-        void AddLog(const char* fmt, va_list args, ImU32 col = IM_COL32_WHITE);
-
-        void AddLogTimeStamped(const char* fmt, va_list args, ImU32 col = IM_COL32_WHITE);
+        void AddLog(Severity sev, const char* fmt, va_list args);
+        bool PassFilter(ImU64 lineNo) const;
+        void DrawLine(ImU64 lineNo) const;
 
     public:
 
-        DebugConsole();
+        // textCapacity is the memory cap for the text of every line, in bytes
+        explicit DebugConsole(int textCapacity = 0x40000, int lineCapacity = 0x2000);
+
+        // drops every line, and applies new capacities if they're non-zero
+        void Clear(int textCapacity = 0, int lineCapacity = 0);
 
-        void Clear();
+        // adds text as is, may hold more than one line
+        void LogText(Severity sev, const char* text, size_t len);
 
         void LogWarn(const char *fmt, ...);
 
@@ -0,0 +1,247 @@
+#include "Test.h"
+#include "host/HostInit.h"
+#include "ui/ConsoleLineRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// checks the debug console's line ring against a plain list of every line ever added: what's still stored has to be
+// the newest lines, unchanged, within both capacities. the filter cache is checked against filtering from scratch.
+namespace {
+    std::string makeText(std::mt19937& rng, size_t maxSize) {
+        std::string text(rng() % (maxSize + 1), ' ');
+        for (char& c : text)
+            c = (char)('a' + rng() % 26);
+        return text;
+    }
+
+    std::string getText(const ConsoleLineRing& ring, u64 lineNo) {
+        return std::string(ring.getLineText(lineNo), ring.getLine(lineNo).mLength);
+    }
+
+    void checkRing(const ConsoleLineRing& ring, const std::vector<std::string>& added) {
+        CHECK(ring.getEndLine() == added.size());
+        CHECK(ring.getFirstLine() <= ring.getEndLine());
+        CHECK(ring.getEndLine() - ring.getFirstLine() <= (u64)ring.getLineCapacity());
+
+        std::vector<std::pair<s32, s32>> ranges;
+        for (u64 lineNo = ring.getFirstLine(); lineNo < ring.getEndLine(); lineNo++) {
+            const auto& line = ring.getLine(lineNo);
+            CHECK(line.mOffset >= 0 && line.mOffset + line.mLength <= ring.getTextCapacity());
+            CHECK(getText(ring, lineNo) == added[lineNo]);
+            ranges.push_back({ line.mOffset, line.mOffset + line.mLength });
+        }
+
+        // no two stored lines share any text
+        std::sort(ranges.begin(), ranges.end());
+        for (size_t i = 1; i < ranges.size(); ++i)
+            CHECK(ranges[i - 1].second <= ranges[i].first);
+    }
+
+    void testAppendAndDrop() {
+        std::mt19937 rng(1);
+
+        for (s32 lineCapacity : { 1, 7, 64, 1000 }) {
+            ConsoleLineRing ring(0x1000, lineCapacity);
+            std::vector<std::string> added;
+
+            for (int i = 0; i < 20000; ++i) {
+                // mostly short lines with the odd one close to the whole capacity
+                std::string prefix = i % 3 == 0 ? "[Info] " : "";
+                std::string text = makeText(rng, rng() % 50 == 0 ? 0xF00 : 0x60);
+                ring.addLine(0, prefix.c_str(), prefix.size(), text.c_str(), text.size(), false);
+                added.push_back(prefix + text);
+
+                CHECK(ring.getEndLine() - ring.getFirstLine() >= 1); // the newest line always fits
+                if(i % 97 == 0 || lineCapacity == 1)
+                    checkRing(ring, added);
+            }
+            checkRing(ring, added);
+        }
+    }
+
+    void testOpenLines() {
+        ConsoleLineRing ring(0x100, 0x10);
+        std::vector<std::string> added;
+
+        ring.addLine(0, "P ", 2, "ab", 2, true);
+        CHECK(ring.isLastLineOpen());
+        CHECK(ring.getCompleteEnd() == 0);
+
+        ring.addLine(0, "", 0, "cd", 2, true);
+        ring.addLine(0, "", 0, "ef", 2, false);
+        added.push_back("P abcdef");
+        CHECK(!ring.isLastLineOpen());
+        CHECK(ring.getCompleteEnd() == 1);
+        checkRing(ring, added);
+
+        // a line too long for the whole ring is cut off at its capacity
+        std::string longText(0x200, 'z');
+        ring.addLine(1, "P ", 2, longText.c_str(), longText.size(), false);
+        CHECK(ring.getEndLine() == 2 && ring.getFirstLine() == 1);
+        CHECK(getText(ring, 1) == "P " + std::string(0xFE, 'z'));
+        CHECK(ring.getLine(1).mSeverity == 1);
+
+        // an open line isn't grown past half the ring, the rest continues on a new line instead
+        ring.clear();
+        ring.addLine(0, "", 0, "x", 1, true);
+        for (int i = 0; i < 0x100; ++i)
+            ring.addLine(0, "", 0, "y", 1, true);
+        for (u64 lineNo = ring.getFirstLine(); lineNo < ring.getEndLine(); lineNo++)
+            CHECK(ring.getLine(lineNo).mLength <= 0x80);
+    }
+
+    void testClear() {
+        size_t baseBytes = host::getAllocatedBytes();
+        {
+            ConsoleLineRing ring(0x1000, 0x40);
+            CHECK(host::getAllocatedBytes() == baseBytes); // nothing is allocated until the first line
+
+            for (int i = 0; i < 10; ++i)
+                ring.addLine(0, "", 0, "line", 4, false);
+            size_t usedBytes = host::getAllocatedBytes();
+            CHECK(usedBytes >= baseBytes + 0x1000 + 0x40 * sizeof(ConsoleLineRing::Line));
+
+            // line numbers keep counting, so a stale number can't point at a newer line
+            ring.clear();
+            CHECK(ring.getFirstLine() == 10 && ring.getEndLine() == 10);
+            ring.addLine(0, "", 0, "new", 3, false);
+            CHECK(ring.getFirstLine() == 10 && getText(ring, 10) == "new");
+            CHECK(host::getAllocatedBytes() == usedBytes);
+
+            ring.clear(0x2000, 0);
+            CHECK(ring.getTextCapacity() == 0x2000 && ring.getLineCapacity() == 0x40);
+            CHECK(host::getAllocatedBytes() == baseBytes);
+            ring.addLine(0, "", 0, "again", 5, false);
+            CHECK(ring.getEndLine() == 12 && getText(ring, 11) == "again");
+        }
+        CHECK(host::getAllocatedBytes() == baseBytes);
+    }
+
+    void testFilter() {
+        std::mt19937 rng(2);
+        ConsoleLineRing ring(0x2000, 0x80);
+        ConsoleLineFilter filter;
+
+        char wanted = 'q';
+        size_t checkCount = 0;
+        auto isPassing = [&](u64 lineNo) {
+            checkCount++;
+            return ring.getLine(lineNo).mSeverity == 2 || memchr(ring.getLineText(lineNo), wanted, ring.getLine(lineNo).mLength) != nullptr;
+        };
+
+        for (int frame = 0; frame < 3000; ++frame) {
+            // a few lines between frames, the last one sometimes left open
+            int lineCount = rng() % 6;
+            for (int i = 0; i < lineCount; ++i) {
+                std::string text = makeText(rng, 0x40);
+                ring.addLine(rng() % 3, "", 0, text.c_str(), text.size(), i == lineCount - 1 && rng() % 4 == 0);
+            }
+
+            if(frame % 500 == 499) {
+                wanted = (char)('a' + rng() % 26);
+                filter.markDirty();
+            }
+            if(frame == 1500)
+                ring.clear();
+
+            size_t checksBefore = checkCount;
+            filter.update(ring, isPassing);
+            size_t checksDone = checkCount - checksBefore;
+
+            std::vector<u64> expected;
+            for (u64 lineNo = ring.getFirstLine(); lineNo < ring.getCompleteEnd(); lineNo++) {
+                if(isPassing(lineNo))
+                    expected.push_back(lineNo);
+            }
+
+            CHECK(filter.getCount() == (s32)expected.size());
+            for (s32 i = 0; i < filter.getCount() && i < (s32)expected.size(); ++i)
+                CHECK(filter.getLineNo(i) == expected[i]);
+
+            // only the new lines (and one finished open line) are checked, unless the filter changed
+            if(frame % 500 != 499 && frame != 0)
+                CHECK(checksDone <= (size_t)lineCount + 1);
+        }
+    }
+
+    void testMemoryFlat() {
+        ConsoleLineRing ring(0x40000, 0x2000);
+        ConsoleLineFilter filter;
+        std::mt19937 rng(3);
+
+        ring.addLine(0, "", 0, "first", 5, false);
+        filter.update(ring, [](u64) { return true; });
+        size_t startBytes = host::getAllocatedBytes();
+
+        for (int i = 0; i < 1000000; ++i) {
+            std::string text = makeText(rng, 0x80);
+            ring.addLine(rng() % 3, "[00:00:00] [Info] ", 18, text.c_str(), text.size(), false);
+            if(i % 60 == 0)
+                filter.update(ring, [](u64 lineNo) { return lineNo % 2 == 0; });
+        }
+
+        CHECK(host::getAllocatedBytes() == startBytes);
+        CHECK(ring.getEndLine() == 1000001);
+    }
+
+    void benchmark() {
+        // the console's defaults, filled with file load logging like lines
+        ConsoleLineRing ring(0x40000, 0x2000);
+        ConsoleLineFilter filter;
+        std::mt19937 rng(4);
+
+        std::vector<std::string> texts;
+        for (int i = 0; i < 0x1000; ++i)
+            texts.push_back("Loading File: romfs:/ObjectData/" + makeText(rng, 0x30) + ".szs");
+
+        constexpr int cLineCount = 2000000;
+        test::Timer appendTimer;
+        for (int i = 0; i < cLineCount; ++i) {
+            const std::string& text = texts[i % texts.size()];
+            ring.addLine(0, "[00:00:00] [Info] ", 18, text.c_str(), text.size(), false);
+        }
+        double appendNs = appendTimer.getSeconds() * 1e9 / cLineCount;
+
+        auto isPassing = [&](u64 lineNo) {
+            const auto& line = ring.getLine(lineNo);
+            return std::string_view(ring.getLineText(lineNo), line.mLength).find("Stage") != std::string_view::npos;
+        };
+
+        // a frame with 20 new lines, filtering just those vs every stored line like the old console did
+        constexpr int cFrames = 2000;
+        auto runFrames = [&](bool isFullRefilter) {
+            test::Timer timer;
+            for (int frame = 0; frame < cFrames; ++frame) {
+                for (int i = 0; i < 20; ++i) {
+                    const std::string& text = texts[(frame * 20 + i) % texts.size()];
+                    ring.addLine(0, "[00:00:00] [Info] ", 18, text.c_str(), text.size(), false);
+                }
+                if(isFullRefilter)
+                    filter.markDirty();
+                filter.update(ring, isPassing);
+                test::doNotOptimize(filter.getCount());
+            }
+            return timer.getSeconds() * 1e6 / cFrames;
+        };
+
+        double fullUs = runFrames(true);
+        double incrementalUs = runFrames(false);
+
+        printf("%llu lines stored, append: %.1f ns/line\n", (unsigned long long)(ring.getEndLine() - ring.getFirstLine()), appendNs);
+        printf("filter per frame, all lines: %.1f us  new lines only: %.2f us\n", fullUs, incrementalUs);
+    }
+}
+
+int main() {
+    testAppendAndDrop();
+    testOpenLines();
+    testClear();
+    testFilter();
+    testMemoryFlat();
+    benchmark();
+    return test::finish("ConsoleLineRingTest");
+}
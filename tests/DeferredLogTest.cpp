@@ -0,0 +1,142 @@
+#include "Test.h"
+#include "logger/DeferredLog.h"
+
+#include <cstring>
+#include <string>
+
+// deferred records have to format to exactly what printf would have made of the original call
+namespace {
+    template <typename... Args>
+    std::string formatDeferred(DeferredLog::Format fmt, Args... args) {
+        char record[0x500];
+        DeferredLog::ArgWriter writer(record, sizeof(record), fmt.mStr);
+        (writer.write(args), ...);
+
+        char out[0x500];
+        size_t len = DeferredLog::format(record, writer.getSize(), out, sizeof(out));
+        return std::string(out, len);
+    }
+
+    template <typename... Args>
+    std::string formatDirect(const char* fmt, Args... args) {
+        char out[0x500];
+        int len = snprintf(out, sizeof(out), fmt, args...);
+        return std::string(out, len);
+    }
+
+#define CHECK_ROUND_TRIP(fmt, ...) CHECK(formatDeferred(fmt, __VA_ARGS__) == formatDirect(fmt, __VA_ARGS__))
+
+    enum class Color : u8 { Red = 3 };
+
+    void testIntegers() {
+        CHECK_ROUND_TRIP("%d %i", -12345, 678);
+        CHECK_ROUND_TRIP("%u %x %X %o", 4000000000u, 0xDEADBEEFu, 0xABCDu, 0755u);
+        CHECK_ROUND_TRIP("%ld %lu", (long)-9000000000L, (unsigned long)18000000000UL);
+        CHECK_ROUND_TRIP("%lld %llx", -1LL, 0x123456789ABCDEFULL);
+        CHECK_ROUND_TRIP("%zu %zx", (size_t)0x100000000ULL, (size_t)0xFFFF);
+        CHECK_ROUND_TRIP("%hd %hu", (short)-2, (unsigned short)65535);
+        CHECK_ROUND_TRIP("%hhd %hhu", (signed char)-5, (unsigned char)250);
+        CHECK_ROUND_TRIP("%08d|%-6d|%+d|% d", 42, 7, 3, 9);
+        CHECK_ROUND_TRIP("%#x %#o", 255u, 8u);
+        CHECK_ROUND_TRIP("%c%c", 'o', 'k');
+        CHECK_ROUND_TRIP("%d", (s32)Color::Red);
+        CHECK(formatDeferred("%d", Color::Red) == "3");
+        CHECK_ROUND_TRIP("%d %d", true, false);
+    }
+
+    void testIntegerWidths() {
+        // arguments are stored as 64 bit, the length modifier decides how much of them printf would have seen
+        CHECK(formatDeferred("%d", (s64)0x1FFFFFFFF) == formatDirect("%d", (s32)0xFFFFFFFF));
+        CHECK(formatDeferred("%u", (u64)0x100000005) == "5");
+        CHECK(formatDeferred("%hhu", 0x1FF) == "255");
+        CHECK(formatDeferred("%hd", 0x18000) == formatDirect("%hd", (short)0x8000));
+    }
+
+    void testFloats() {
+        CHECK_ROUND_TRIP("%f %.2f %10.3f", 3.14159, 2.5f, -1.0 / 3.0);
+        CHECK_ROUND_TRIP("%e %g %G", 12345.678, 0.0001, 1e20);
+        CHECK_ROUND_TRIP("%a", 1.5);
+    }
+
+    void testStringsAndPointers() {
+        CHECK_ROUND_TRIP("[%s] [%10s] [%-10s] [%.3s]", "plain", "right", "left", "truncated");
+
+        int value = 0;
+        CHECK_ROUND_TRIP("%p", (void*)&value);
+        CHECK_ROUND_TRIP("%p", (void*)nullptr);
+
+        const char* nullStr = nullptr;
+        CHECK(formatDeferred("%s", nullStr) == "(null)");
+
+        // strings are copied into the record, so changing them after the call doesn't matter
+        char buffer[] = "before";
+        char record[0x100];
+        DeferredLog::ArgWriter writer(record, sizeof(record), "%s");
+        writer.write((const char*)buffer);
+        strcpy(buffer, "after!");
+        char out[0x100];
+        DeferredLog::format(record, writer.getSize(), out, sizeof(out));
+        CHECK(strcmp(out, "before") == 0);
+    }
+
+    void testSpecials() {
+        CHECK_ROUND_TRIP("100%% done, %d%%", 50);
+        CHECK_ROUND_TRIP("no arguments\n", 0);
+        CHECK_ROUND_TRIP("%*d|%-*d|%.*f", 6, 42, 4, 7, 2, 3.14159);
+        CHECK_ROUND_TRIP("Plugin Load Timings (us): Scan: %ld Read: %ld (%zu bytes) Total: %ld\n",
+                         (long)120, (long)4500, (size_t)1048576, (long)9999);
+    }
+
+    void testMissingArguments() {
+        // specifiers without an argument are output as they were written
+        CHECK(formatDeferred("%d and %d", 1) == "1 and %d");
+        CHECK(formatDeferred("%s %x", "only") == "only %x");
+        CHECK(formatDeferred("trailing %", 1) == "trailing %");
+    }
+
+    void testTruncation() {
+        char record[0x100];
+        DeferredLog::ArgWriter writer(record, sizeof(record), "%s=%d");
+        writer.write("value");
+        writer.write(12345);
+
+        // the output is cut off at the buffer size, and always terminated
+        char out[8];
+        memset(out, 'x', sizeof(out));
+        size_t len = DeferredLog::format(record, writer.getSize(), out, sizeof(out));
+        CHECK(len == sizeof(out) - 1);
+        CHECK(strcmp(out, "value=1") == 0);
+
+        // a record that ran out of room drops the arguments that didn't fit, instead of reading past its end
+        char smallRecord[24];
+        DeferredLog::ArgWriter smallWriter(smallRecord, sizeof(smallRecord), "%d %d %d");
+        smallWriter.write(1);
+        smallWriter.write(2);
+        smallWriter.write(3);
+        CHECK(smallWriter.getSize() == sizeof(smallRecord));
+
+        char smallOut[0x40];
+        DeferredLog::format(smallRecord, smallWriter.getSize(), smallOut, sizeof(smallOut));
+        CHECK(strcmp(smallOut, "1 %d %d") == 0);
+    }
+
+    void testFormatId() {
+        const char* fmt = "id check %d\n";
+        char record[0x40];
+        DeferredLog::ArgWriter writer(record, sizeof(record), fmt);
+        writer.write(1);
+        CHECK(DeferredLog::getFormatId(record) == (u64)(uintptr_t)fmt);
+    }
+}
+
+int main() {
+    testIntegers();
+    testIntegerWidths();
+    testFloats();
+    testStringsAndPointers();
+    testSpecials();
+    testMissingArguments();
+    testTruncation();
+    testFormatId();
+    return test::finish("DeferredLogTest");
+}
@@ -0,0 +1,278 @@
+#include "Test.h"
+#include "lib/hook/nx64/fix_instructions.hpp"
+
+#include <sys/mman.h>
+#include <initializer_list>
+#include <set>
+#include <string>
+#include <vector>
+
+// the hook relocator run on synthetic instructions: the relocated copy has to do exactly what the original did,
+// wherever the trampoline lands relative to the original code. both are run through a small interpreter that only
+// knows the pc relative instructions, everything else is recorded as executed.
+namespace {
+    using namespace exl::hook::nx64;
+
+    // encoders, offsets are in bytes from the instruction
+    u32 encodeB(s64 offset) { return 0x14000000u | ((offset >> 2) & 0x3ffffff); }
+    u32 encodeBl(s64 offset) { return 0x94000000u | ((offset >> 2) & 0x3ffffff); }
+    u32 encodeBCond(u32 cond, s64 offset) { return 0x54000000u | (((offset >> 2) & 0x7ffff) << 5) | cond; }
+    u32 encodeCbz(bool isNonZero, u32 rt, s64 offset) { return (isNonZero ? 0xb5000000u : 0xb4000000u) | (((offset >> 2) & 0x7ffff) << 5) | rt; }
+    u32 encodeTbz(bool isNonZero, u32 rt, u32 bit, s64 offset) {
+        return (isNonZero ? 0x37000000u : 0x36000000u) | ((bit >> 5) << 31) | ((bit & 0x1f) << 19) | (((offset >> 2) & 0x3fff) << 5) | rt;
+    }
+    // opc and v as in the encoding: W, X, LDRSW, PRFM for gp registers, S, D, Q for vector ones
+    u32 encodeLdrLiteral(u32 opc, bool isVector, u32 rt, s64 offset) {
+        return (opc << 30) | 0x18000000u | (isVector ? 1u << 26 : 0) | (((offset >> 2) & 0x7ffff) << 5) | rt;
+    }
+    u32 encodeAdr(bool isPage, u32 rd, s64 imm) {
+        return (isPage ? 0x90000000u : 0x10000000u) | ((imm & 3) << 29) | (((imm >> 2) & 0x7ffff) << 5) | rd;
+    }
+
+    constexpr u32 cStp = 0xa9bf7bfd; // stp x29, x30, [sp, #-16]!
+    constexpr u32 cMovFp = 0x910003fd; // mov x29, sp
+    constexpr u32 cSubSp = 0xd10103ff; // sub sp, sp, #0x40
+    constexpr u32 cAdd = 0x91000420; // add x0, x1, #1
+
+    struct Event {
+        enum Kind { Exec, SetReg, Call, Exit } mKind;
+        u64 mA;
+        u64 mB;
+
+        bool operator==(const Event&) const = default;
+    };
+
+    // runs from pc until it leaves [start, end), calls to a known callee return right away.
+    // the n'th conditional branch reached is taken if bit n of takenMask is set.
+    std::vector<Event> run(uintptr_t pc, uintptr_t start, uintptr_t end, const std::set<uintptr_t>& callees, u32 takenMask) {
+        std::vector<Event> events;
+        u64 regs[32] = {};
+        u32 conditionalCount = 0;
+        auto isTaken = [&]() { return conditionalCount < 32 && ((takenMask >> conditionalCount++) & 1) != 0; };
+
+        for (int steps = 0; steps < 64; ++steps) {
+            if(pc < start || pc >= end) {
+                if(callees.contains(pc)) {
+                    events.push_back({ Event::Call, pc, 0 });
+                    pc = regs[30];
+                    continue;
+                }
+                events.push_back({ Event::Exit, pc, 0 });
+                return events;
+            }
+
+            u32 ins = *(const u32*)pc;
+            uintptr_t next = pc + 4;
+            auto setReg = [&](u32 reg, u64 value, u64 high, bool isVector) {
+                if(!isVector)
+                    regs[reg] = value;
+                // x16, x17 and x30 are scratch for the relocated code
+                if(isVector || (reg != 16 && reg != 17 && reg != 30))
+                    events.push_back({ Event::SetReg, (isVector ? 0x100u : 0u) | reg, value ^ high });
+            };
+
+            if(ins == Aarch64Nop) {
+            } else if((ins & 0x7c000000u) == 0x14000000u) {
+                s64 offset = (s64)((s32)(ins << 6) >> 4);
+                if(ins & 0x80000000u)
+                    regs[30] = pc + 4;
+                next = pc + offset;
+            } else if((ins & 0xff000010u) == 0x54000000u || (ins & 0x7e000000u) == 0x34000000u) {
+                s64 offset = (s64)((s32)(ins << 8) >> 11) & ~3ll;
+                if(isTaken())
+                    next = pc + offset;
+            } else if((ins & 0x7e000000u) == 0x36000000u) {
+                s64 offset = (s64)((s32)(ins << 13) >> 16) & ~3ll;
+                if(isTaken())
+                    next = pc + offset;
+            } else if((ins & 0x3b000000u) == 0x18000000u) {
+                u32 opc = ins >> 30;
+                bool isVector = (ins >> 26) & 1;
+                u32 reg = ins & 0x1f;
+                uintptr_t address = pc + ((s64)((s32)(ins << 8) >> 11) & ~3ll);
+                if(!isVector && opc == 3) {
+                    // prfm, a hint the relocator drops
+                } else if(!isVector && opc == 2) {
+                    setReg(reg, (u64)(s64)*(const s32*)address, 0, false);
+                } else {
+                    size_t size = isVector ? 4u << opc : 4u << opc;
+                    u64 low = 0;
+                    u64 high = 0;
+                    memcpy(&low, (const void*)address, std::min<size_t>(size, 8));
+                    if(size == 16)
+                        memcpy(&high, (const void*)(address + 8), 8);
+                    setReg(reg, low, high, isVector);
+                }
+            } else if((ins & 0x1f000000u) == 0x10000000u) {
+                s64 imm = ((s64)((s32)(ins << 8) >> 11) & ~3ll) | ((ins >> 29) & 3);
+                u64 value = (ins & 0x80000000u) ? (pc & ~0xfffull) + (imm << 12) : pc + imm;
+                setReg(ins & 0x1f, value, 0, false);
+            } else if((ins & 0xfffffc1fu) == 0xd61f0000u) {
+                next = regs[(ins >> 5) & 0x1f];
+            } else {
+                events.push_back({ Event::Exec, ins, 0 });
+            }
+
+            pc = next;
+        }
+
+        events.push_back({ Event::Exit, 0, 0 });
+        return events;
+    }
+
+    struct Region {
+        u8* mBase = nullptr;
+        size_t mSize = 0;
+
+        Region(uintptr_t hint, size_t size) : mSize(size) {
+            void* base = mmap((void*)hint, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+            mBase = base == MAP_FAILED ? nullptr : (u8*)base;
+        }
+        ~Region() {
+            if(mBase)
+                munmap(mBase, mSize);
+        }
+    };
+
+    struct Case {
+        const char* mName;
+        std::vector<u32> mCode;
+        std::vector<uintptr_t> mCallees; // offsets from the code
+    };
+
+    // literals and out of range targets relative to where the code is put, all within reach of the original
+    constexpr s64 cLiteral = 0x400;
+    constexpr s64 cFarTarget = 0x80000;
+    constexpr size_t cCodeOffset = 0x1000;
+    constexpr size_t cTrampolineBytes = MaxInstructions * 10 * sizeof(u32); // HookSite::m_Trampoline
+
+    std::vector<Case> makeCases() {
+        std::vector<Case> cases;
+        cases.push_back({ "plain prologue", { cStp, cMovFp, cSubSp, cAdd }, {} });
+        cases.push_back({ "single b", { encodeB(cFarTarget) }, {} });
+        cases.push_back({ "bl", { cStp, encodeBl(cFarTarget), cAdd }, { (uintptr_t)(cFarTarget + 4) } });
+        cases.push_back({ "b.cond", { encodeBCond(0, 0x40), cAdd, cAdd }, {} });
+        cases.push_back({ "cbz, cbnz", { encodeCbz(false, 0, 0x80), encodeCbz(true, 1, -0x100), encodeBCond(11, -0x40000), cAdd }, {} });
+        cases.push_back({ "tbz, tbnz", { encodeTbz(false, 2, 3, 0x20), encodeTbz(true, 3, 40, -0x1000), encodeTbz(true, 4, 0, 0x1000), cAdd }, {} });
+        cases.push_back({ "adr, adrp", { encodeAdr(false, 0, 0x1235), encodeAdr(true, 1, 3), encodeAdr(false, 2, -0x20), encodeAdr(true, 3, -0x80000) }, {} });
+        cases.push_back({ "ldr literal", { encodeLdrLiteral(1, false, 2, cLiteral), encodeLdrLiteral(0, false, 3, cLiteral + 4),
+                                           encodeLdrLiteral(2, false, 4, cLiteral + 8), encodeLdrLiteral(1, false, 5, -0x400) }, {} });
+        cases.push_back({ "ldr vector literal", { encodeLdrLiteral(2, true, 0, cLiteral + 0x10), encodeLdrLiteral(1, true, 1, cLiteral),
+                                                  encodeLdrLiteral(0, true, 2, cLiteral + 4), encodeLdrLiteral(3, false, 0, cLiteral) }, {} });
+        // branches into the relocated instructions themselves, forwards and backwards
+        cases.push_back({ "internal branches", { cAdd, encodeCbz(false, 0, 12), encodeB(8), cStp, encodeBCond(1, -12) }, {} });
+        cases.push_back({ "five instructions", { cStp, encodeBl(cFarTarget), encodeAdr(true, 8, 1), encodeLdrLiteral(1, false, 9, cLiteral), encodeB(-0x800) },
+                          { (uintptr_t)(cFarTarget + 4) } });
+        return cases;
+    }
+
+    std::string describe(const std::vector<Event>& events) {
+        std::string out;
+        char buffer[0x40];
+        for (const auto& event : events) {
+            snprintf(buffer, sizeof(buffer), " %d:%lx:%lx", (int)event.mKind, event.mA, event.mB);
+            out += buffer;
+        }
+        return out;
+    }
+
+    void checkCase(const Case& c, u8* code, u8* trampoline, const char* placement) {
+        memcpy(code + cCodeOffset, c.mCode.data(), c.mCode.size() * sizeof(u32));
+        uintptr_t codeStart = (uintptr_t)(code + cCodeOffset);
+        uintptr_t codeEnd = codeStart + c.mCode.size() * sizeof(u32);
+
+        // on the console the rw and rx pointers are two mappings of the same memory. the relocator only reads and
+        // writes through the rw ones and uses the rx ones as addresses, so here the rw sides are separate buffers,
+        // and the output is put at the trampoline's address afterwards
+        std::vector<u32> source = c.mCode;
+        std::vector<u32> output(cTrampolineBytes / sizeof(u32), 0);
+        __fix_instructions(source.data(), (u32*)codeStart, source.size(), output.data(), (u32*)trampoline);
+        memcpy(trampoline, output.data(), cTrampolineBytes);
+
+        std::set<uintptr_t> callees;
+        for (uintptr_t offset : c.mCallees)
+            callees.insert(codeStart + offset - 4);
+
+        for (u32 takenMask = 0; takenMask < 16; ++takenMask) {
+            auto original = run(codeStart, codeStart, codeEnd, callees, takenMask);
+            auto relocated = run((uintptr_t)trampoline, (uintptr_t)trampoline, (uintptr_t)trampoline + cTrampolineBytes, callees, takenMask);
+
+            if(original != relocated) {
+                printf("%s, %s, taken mask %x:\n  original: %s\n  relocated:%s\n", c.mName, placement, takenMask,
+                       describe(original).c_str(), describe(relocated).c_str());
+                CHECK(original == relocated);
+            }
+            CHECK(!original.empty() && original.back().mKind == Event::Exit);
+        }
+    }
+
+    void fillLiterals(u8* code) {
+        for (size_t i = 0; i < 0x20; ++i)
+            code[cCodeOffset + cLiteral + i] = (u8)(0xA0 + i * 7);
+    }
+
+    void testRelocation() {
+        // the original code, and somewhere too far away for any pc relative instruction to reach
+        constexpr uintptr_t cCodeHint = 0x2000000000;
+        constexpr uintptr_t cFarHint = 0x3000000000;
+        constexpr size_t cRegionSize = 0x200000;
+
+        Region code(cCodeHint, cRegionSize);
+        Region far(cFarHint, cRegionSize);
+        CHECK(code.mBase && far.mBase);
+        if(!code.mBase || !far.mBase)
+            return;
+        fillLiterals(code.mBase);
+
+        struct Placement {
+            const char* mName;
+            u8* mTrampoline;
+        };
+        const Placement placements[] = {
+            { "near", code.mBase + 0x10000 },
+            { "near, misaligned", code.mBase + 0x10004 },
+            { "far", far.mBase + 0x100 },
+            { "far, misaligned", far.mBase + 0x104 },
+            // just below the original, inside the range the short branches reach
+            { "behind", code.mBase + 0x800 },
+        };
+
+        for (const auto& c : makeCases()) {
+            for (const auto& placement : placements)
+                checkCase(c, code.mBase, placement.mTrampoline, placement.mName);
+        }
+    }
+
+    void testFarBranchForm() {
+        Region code(0x2800000000, 0x10000);
+        Region far(0x3800000000, 0x10000);
+        if(!code.mBase || !far.mBase) {
+            CHECK(code.mBase && far.mBase);
+            return;
+        }
+
+        // a b the trampoline can't reach is turned into an absolute jump through x17
+        u32 b = encodeB(0x100);
+        memcpy(code.mBase, &b, sizeof(b));
+        alignas(8) u32 out[8] = {};
+        __fix_instructions(&b, (u32*)code.mBase, 1, out, (u32*)(far.mBase + 0x100));
+
+        CHECK(out[0] == 0x58000051u);
+        CHECK(out[1] == 0xd61f0220u);
+        u64 target;
+        memcpy(&target, &out[2], sizeof(target));
+        CHECK(target == (u64)code.mBase + 0x100);
+
+        // and the jump back to the rest of the function as well
+        CHECK(out[4] == 0x58000051u);
+        CHECK(out[5] == 0xd61f0220u);
+        memcpy(&target, &out[6], sizeof(target));
+        CHECK(target == (u64)code.mBase + 4);
+    }
+}
+
+int main() {
+    testRelocation();
+    testFarBranchForm();
+    return test::finish("FixInstructionsTest");
+}
@@ -0,0 +1,261 @@
+#include "Test.h"
+#include "lib/reloc/rtld.hpp"
+#include "lib/reloc/rtld/utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// symbol lookups through DT_GNU_HASH against the SysV DT_HASH walk they replaced, on synthetic modules built
+// the way the linker lays them out: dynsym sorted by gnu hash bucket, a bloom filter with the second hash shifted by 26
+namespace {
+    constexpr u32 cBloomShift = 26;
+
+    // one module image, looked up through two module objects: one only given DT_HASH, one only DT_GNU_HASH.
+    // the gnu one has no SysV table to fall back on, so every symbol it finds came from the gnu path.
+    class SyntheticModule {
+        std::vector<Elf_Addr> mImage; // 8 byte aligned
+        size_t mSysvDynamicOffset = 0;
+        size_t mGnuDynamicOffset = 0;
+        std::vector<std::string> mNames;
+
+        template <typename T>
+        static size_t append(std::vector<u8>& out, const T* data, size_t count) {
+            while (out.size() % 8 != 0)
+                out.push_back(0);
+            size_t offset = out.size();
+            out.insert(out.end(), (const u8*)data, (const u8*)(data + count));
+            return offset;
+        }
+
+    public:
+        ModuleObject mSysv = {};
+        ModuleObject mGnu = {};
+
+        explicit SyntheticModule(std::vector<std::string> names) {
+            size_t count = names.size();
+            u32 gnuBucketCount = std::max<u32>(count / 4, 1);
+
+            // the linker orders exported symbols by their gnu hash bucket, so every bucket is one run of the chain
+            std::stable_sort(names.begin(), names.end(), [&](const std::string& a, const std::string& b) {
+                return __rtld_gnu_hash(a.c_str()) % gnuBucketCount < __rtld_gnu_hash(b.c_str()) % gnuBucketCount;
+            });
+            mNames = names;
+
+            std::vector<char> dynstr(1, '\0');
+            std::vector<Elf_Sym> dynsym(count + 1);
+            for (size_t i = 0; i < count; ++i) {
+                Elf_Sym& sym = dynsym[i + 1];
+                sym.st_name = dynstr.size();
+                sym.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+                sym.st_shndx = 1;
+                sym.st_value = 0x1000 + i * 0x10;
+                dynstr.insert(dynstr.end(), names[i].begin(), names[i].end());
+                dynstr.push_back('\0');
+            }
+
+            // DT_HASH: nbucket, nchain, buckets, chains
+            u32 sysvBucketCount = count / 2 + 1;
+            std::vector<u32> sysvHash(2 + sysvBucketCount + count + 1);
+            sysvHash[0] = sysvBucketCount;
+            sysvHash[1] = count + 1;
+            u32* sysvBuckets = &sysvHash[2];
+            u32* sysvChains = &sysvHash[2 + sysvBucketCount];
+            for (u32 i = 1; i <= count; ++i) {
+                u32 bucket = __rtld_elf_hash(names[i - 1].c_str()) % sysvBucketCount;
+                sysvChains[i] = sysvBuckets[bucket];
+                sysvBuckets[bucket] = i;
+            }
+
+            // DT_GNU_HASH: nbucket, symoffset, bloom size, bloom shift, bloom words, buckets, chain hashes
+            u32 bloomSize = 1;
+            while (bloomSize * 64 < count * 12)
+                bloomSize *= 2;
+
+            std::vector<u32> gnuHash(4 + bloomSize * 2 + gnuBucketCount + count);
+            gnuHash[0] = gnuBucketCount;
+            gnuHash[1] = 1;
+            gnuHash[2] = bloomSize;
+            gnuHash[3] = cBloomShift;
+            Elf_Addr* bloom = (Elf_Addr*)&gnuHash[4];
+            u32* gnuBuckets = &gnuHash[4 + bloomSize * 2];
+            u32* gnuChain = &gnuBuckets[gnuBucketCount];
+            for (u32 i = 0; i < count; ++i) {
+                u32 hash = __rtld_gnu_hash(names[i].c_str());
+                u32 bucket = hash % gnuBucketCount;
+
+                Elf_Addr bits = ((Elf_Addr)1 << (hash % 64)) | ((Elf_Addr)1 << ((hash >> cBloomShift) % 64));
+                Elf_Addr word;
+                memcpy(&word, &bloom[(hash / 64) & (bloomSize - 1)], sizeof(word));
+                word |= bits;
+                memcpy(&bloom[(hash / 64) & (bloomSize - 1)], &word, sizeof(word));
+
+                if(gnuBuckets[bucket] == 0)
+                    gnuBuckets[bucket] = i + 1;
+                bool isLast = i + 1 == count || __rtld_gnu_hash(names[i + 1].c_str()) % gnuBucketCount != bucket;
+                gnuChain[i] = (hash & ~1u) | (isLast ? 1 : 0);
+            }
+
+            std::vector<u8> image;
+            size_t dynsymOffset = append(image, dynsym.data(), dynsym.size());
+            size_t dynstrOffset = append(image, dynstr.data(), dynstr.size());
+            size_t sysvOffset = append(image, sysvHash.data(), sysvHash.size());
+            size_t gnuOffset = append(image, gnuHash.data(), gnuHash.size());
+
+            Elf_Dyn sysvDynamic[] = { { DT_SYMTAB, { dynsymOffset } }, { DT_STRTAB, { dynstrOffset } },
+                                      { DT_STRSZ, { dynstr.size() } }, { DT_SYMENT, { sizeof(Elf_Sym) } },
+                                      { DT_HASH, { sysvOffset } }, { DT_NULL, { 0 } } };
+            Elf_Dyn gnuDynamic[] = { { DT_SYMTAB, { dynsymOffset } }, { DT_STRTAB, { dynstrOffset } },
+                                     { DT_STRSZ, { dynstr.size() } }, { DT_SYMENT, { sizeof(Elf_Sym) } },
+                                     { DT_GNU_HASH, { gnuOffset } }, { DT_NULL, { 0 } } };
+            mSysvDynamicOffset = append(image, sysvDynamic, std::size(sysvDynamic));
+            mGnuDynamicOffset = append(image, gnuDynamic, std::size(gnuDynamic));
+
+            mImage.resize((image.size() + 7) / 8);
+            memcpy(mImage.data(), image.data(), image.size());
+
+            char* base = (char*)mImage.data();
+            mSysv.Initialize(base, (Elf_Dyn*)(base + mSysvDynamicOffset));
+            mGnu.Initialize(base, (Elf_Dyn*)(base + mGnuDynamicOffset));
+        }
+
+        const std::vector<std::string>& getNames() const { return mNames; }
+    };
+
+    std::string makeName(u32 module, u32 idx) {
+        // mangled names sharing long prefixes, like a game's symbols do
+        static const char* const classes[] = { "al9LiveActor", "al11HitSensor", "game5Scene", "sead4Heap" };
+        char name[0x80];
+        snprintf(name, sizeof(name), "_ZN%s%uEv_m%u_%u", classes[idx % 4], idx, module, idx * 2654435761u % 1000);
+        return name;
+    }
+
+    constexpr u32 cModuleCount = 8;
+    constexpr u32 cSymbolsPerModule = 3000;
+
+    std::vector<std::unique_ptr<SyntheticModule>> makeModules() {
+        std::vector<std::unique_ptr<SyntheticModule>> modules;
+        for (u32 m = 0; m < cModuleCount; ++m) {
+            std::vector<std::string> names;
+            // the first one is tiny, all of its symbols share one bucket and one bloom word
+            u32 count = m == 0 ? 3 : cSymbolsPerModule;
+            for (u32 i = 0; i < count; ++i)
+                names.push_back(makeName(m, i));
+            modules.push_back(std::make_unique<SyntheticModule>(names));
+        }
+        return modules;
+    }
+
+    void testSameResults(std::vector<std::unique_ptr<SyntheticModule>>& modules) {
+        u32 mismatches = 0;
+        u32 hits = 0;
+
+        for (auto& module : modules) {
+            for (auto& other : modules) {
+                for (const auto& name : other->getNames()) {
+                    Elf_Sym* sysv = module->mSysv.GetSymbolByName(name.c_str());
+                    Elf_Sym* gnu = module->mGnu.GetSymbolByName(name.c_str(), SymbolNameHash(name.c_str()));
+                    if(sysv != gnu)
+                        mismatches++;
+                    if(gnu && strcmp(module->mGnu.dynstr + gnu->st_name, name.c_str()) == 0)
+                        hits++;
+                }
+            }
+
+            for (u32 i = 0; i < 2000; ++i) {
+                std::string name = makeName(100, i);
+                if(module->mSysv.GetSymbolByName(name.c_str()) || module->mGnu.GetSymbolByName(name.c_str()))
+                    mismatches++;
+            }
+        }
+
+        CHECK(mismatches == 0);
+        // every name is found in its own module, and only there
+        CHECK(hits == 3 + (cModuleCount - 1) * cSymbolsPerModule);
+    }
+
+    // a plugin hot reloaded over and over, each load a new module that is forgotten again when unloaded.
+    // the gnu module object can only find symbols through DT_GNU_HASH, so this fails once the tables run out of slots
+    void testReloads() {
+        for (u32 reload = 0; reload < 100; ++reload) {
+            std::vector<std::string> names;
+            for (u32 i = 0; i < 50; ++i)
+                names.push_back(makeName(300 + reload, i));
+            auto module = std::make_unique<SyntheticModule>(names);
+
+            u32 hits = 0;
+            for (const auto& name : names)
+                hits += module->mGnu.GetSymbolByName(name.c_str(), SymbolNameHash(name.c_str())) != nullptr;
+            CHECK(hits == names.size());
+            CHECK(!module->mGnu.GetSymbolByName(makeName(100, reload).c_str()));
+
+            rtld::forget_module(&module->mGnu);
+        }
+    }
+
+    // the walk lookup_global_auto does over every loaded module, before and after
+    void benchLookups(std::vector<std::unique_ptr<SyntheticModule>>& modules) {
+        std::mt19937 rng(5);
+        std::vector<std::string> hitNames;
+        std::vector<std::string> missNames;
+        for (u32 i = 0; i < 20000; ++i) {
+            u32 m = rng() % (cModuleCount - 1) + 1;
+            hitNames.push_back(makeName(m, rng() % cSymbolsPerModule));
+            missNames.push_back(makeName(200 + i % 7, rng() % cSymbolsPerModule));
+        }
+
+        auto walkSysv = [&](const std::string& name) -> Elf_Sym* {
+            for (auto& module : modules) {
+                // hashed again for every module, as it used to be
+                if(Elf_Sym* sym = module->mSysv.GetSymbolByName(name.c_str()))
+                    return sym;
+            }
+            return nullptr;
+        };
+
+        auto walkGnu = [&](const std::string& name) -> Elf_Sym* {
+            SymbolNameHash hash(name.c_str());
+            for (auto& module : modules) {
+                if(Elf_Sym* sym = module->mGnu.GetSymbolByName(name.c_str(), hash))
+                    return sym;
+            }
+            return nullptr;
+        };
+
+        auto time = [](const std::vector<std::string>& names, auto walk, u32* outFound) {
+            constexpr u32 cRounds = 10;
+            u32 found = 0;
+            test::Timer timer;
+            for (u32 r = 0; r < cRounds; ++r) {
+                for (const auto& name : names)
+                    found += walk(name) != nullptr;
+            }
+            *outFound = found / cRounds;
+            return timer.getSeconds() * 1e9 / ((double)cRounds * names.size());
+        };
+
+        u32 sysvHits, gnuHits, sysvMisses, gnuMisses;
+        double sysvHitNs = time(hitNames, walkSysv, &sysvHits);
+        double gnuHitNs = time(hitNames, walkGnu, &gnuHits);
+        double sysvMissNs = time(missNames, walkSysv, &sysvMisses);
+        double gnuMissNs = time(missNames, walkGnu, &gnuMisses);
+
+        CHECK(sysvHits == hitNames.size() && gnuHits == hitNames.size());
+        CHECK(sysvMisses == 0 && gnuMisses == 0);
+
+        printf("%u modules, %u symbols each\n", cModuleCount, cSymbolsPerModule);
+        printf("hits:   SysV %7.1f ns/lookup  GNU %7.1f ns/lookup\n", sysvHitNs, gnuHitNs);
+        printf("misses: SysV %7.1f ns/lookup  GNU %7.1f ns/lookup\n", sysvMissNs, gnuMissNs);
+    }
+}
+
+int main() {
+    auto modules = makeModules();
+    testSameResults(modules);
+    testReloads();
+    benchLookups(modules);
+    return test::finish("GnuHashTest");
+}
@@ -0,0 +1,241 @@
+#include "Test.h"
+#include "logger/LogRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// records written by the tests carry who wrote them, so the reader can check nothing was torn or reordered
+namespace {
+    struct RecordHeader {
+        u32 mProducer;
+        u32 mSeq;
+    };
+
+    char getPatternByte(u32 producer, u32 seq, size_t idx) {
+        return (char)(producer * 31 + seq * 7 + idx);
+    }
+
+    size_t getRecordSize(u32 seq) {
+        // cycle through sizes that take one to every slot a record can span
+        return sizeof(RecordHeader) + (seq * 37) % (LogRing::cMaxRecordSize - sizeof(RecordHeader) + 1);
+    }
+
+    size_t writeRecord(char* buffer, u32 producer, u32 seq) {
+        size_t size = getRecordSize(seq);
+        RecordHeader header = { producer, seq };
+        memcpy(buffer, &header, sizeof(header));
+        for (size_t i = sizeof(header); i < size; ++i)
+            buffer[i] = getPatternByte(producer, seq, i);
+        return size;
+    }
+
+    bool isRecordIntact(const char* buffer, size_t size, RecordHeader* outHeader) {
+        if(size < sizeof(RecordHeader))
+            return false;
+
+        memcpy(outHeader, buffer, sizeof(RecordHeader));
+        if(size != getRecordSize(outHeader->mSeq))
+            return false;
+
+        for (size_t i = sizeof(RecordHeader); i < size; ++i) {
+            if(buffer[i] != getPatternByte(outHeader->mProducer, outHeader->mSeq, i))
+                return false;
+        }
+        return true;
+    }
+
+    void testRoundTrip() {
+        auto ring = std::make_unique<LogRing>();
+        char in[LogRing::cMaxRecordSize + 0x100];
+        char out[LogRing::cMaxRecordSize];
+
+        const size_t sizes[] = { 0, 1, LogRing::cSlotDataSize - 1, LogRing::cSlotDataSize, LogRing::cSlotDataSize + 1,
+                                 LogRing::cMaxRecordSize, LogRing::cMaxRecordSize + 0x100 };
+
+        for (size_t size : sizes) {
+            for (size_t i = 0; i < size; ++i)
+                in[i] = (char)(i * 13 + size);
+
+            CHECK(ring->push(in, size, 2));
+
+            size_t outSize = 0;
+            u8 severity = 0;
+            CHECK(ring->pop(out, &outSize, &severity));
+            // anything past the max record size is cut off
+            CHECK(outSize == std::min(size, LogRing::cMaxRecordSize));
+            CHECK(memcmp(in, out, outSize) == 0);
+            CHECK(severity == 2);
+        }
+
+        size_t outSize = 0;
+        u8 severity = 0;
+        CHECK(!ring->pop(out, &outSize, &severity));
+        CHECK(ring->getDropCount() == 0);
+    }
+
+    void testOverflowDrops() {
+        auto ring = std::make_unique<LogRing>();
+        char buffer[LogRing::cMaxRecordSize];
+
+        // nothing is popped, so pushes have to start failing once the ring is full, and never block
+        u32 pushed = 0;
+        u32 failed = 0;
+        for (u32 seq = 0; seq < LogRing::cSlotCount * 2; ++seq) {
+            size_t size = writeRecord(buffer, 0, seq);
+            if(ring->push(buffer, size, 0))
+                pushed++;
+            else
+                failed++;
+        }
+
+        CHECK(pushed > 0);
+        CHECK(failed > 0);
+        CHECK(ring->getDropCount() == failed);
+
+        // every record that made it in comes back out intact and in order
+        u32 popped = 0;
+        s64 lastSeq = -1;
+        size_t size = 0;
+        u8 severity = 0;
+        while (ring->pop(buffer, &size, &severity)) {
+            RecordHeader header;
+            CHECK(isRecordIntact(buffer, size, &header));
+            CHECK((s64)header.mSeq > lastSeq);
+            lastSeq = header.mSeq;
+            popped++;
+        }
+        CHECK(popped == pushed);
+
+        // and once drained, the ring takes records again
+        size = writeRecord(buffer, 0, 1);
+        CHECK(ring->push(buffer, size, 0));
+    }
+
+    struct RunResult {
+        u64 mPushed;
+        u64 mDropped;
+        u64 mPopped;
+        u64 mBytes;
+        bool mIsIntact;
+        bool mIsOrdered;
+        double mProducerSeconds; // until every producer is done pushing
+        double mSeconds; // until every record is popped
+    };
+
+    RunResult runProducers(LogRing& ring, u32 producerCount, u32 recordsPerProducer) {
+        std::atomic<u32> finishedProducers = 0;
+        std::vector<u64> pushedCounts(producerCount);
+        std::vector<double> producerSeconds(producerCount);
+        std::vector<std::thread> producers;
+
+        RunResult result = {};
+        result.mIsIntact = true;
+        result.mIsOrdered = true;
+        std::vector<s64> lastSeqs(producerCount, -1);
+        u32 dropsBefore = ring.getDropCount();
+
+        test::Timer timer;
+
+        for (u32 p = 0; p < producerCount; ++p) {
+            producers.emplace_back([&, p]() {
+                char buffer[LogRing::cMaxRecordSize];
+                u64 pushed = 0;
+                test::Timer producerTimer;
+                for (u32 seq = 0; seq < recordsPerProducer; ++seq) {
+                    size_t size = writeRecord(buffer, p, seq);
+                    if(ring.push(buffer, size, 0))
+                        pushed++;
+                }
+                producerSeconds[p] = producerTimer.getSeconds();
+                pushedCounts[p] = pushed;
+                finishedProducers.fetch_add(1, std::memory_order_release);
+            });
+        }
+
+        // single consumer, like the drain thread
+        char buffer[LogRing::cMaxRecordSize];
+        while (true) {
+            bool isDone = finishedProducers.load(std::memory_order_acquire) == producerCount;
+
+            size_t size = 0;
+            u8 severity = 0;
+            bool isAny = false;
+            while (ring.pop(buffer, &size, &severity)) {
+                isAny = true;
+                RecordHeader header;
+                if(!isRecordIntact(buffer, size, &header) || header.mProducer >= producerCount) {
+                    result.mIsIntact = false;
+                    continue;
+                }
+                // a producer's own records can't overtake each other
+                if((s64)header.mSeq <= lastSeqs[header.mProducer])
+                    result.mIsOrdered = false;
+                lastSeqs[header.mProducer] = header.mSeq;
+                result.mPopped++;
+                result.mBytes += size;
+            }
+
+            if(isDone && !isAny)
+                break;
+            if(!isAny)
+                std::this_thread::yield();
+        }
+
+        result.mSeconds = timer.getSeconds();
+
+        for (auto& producer : producers)
+            producer.join();
+        for (u64 pushed : pushedCounts)
+            result.mPushed += pushed;
+        result.mProducerSeconds = *std::max_element(producerSeconds.begin(), producerSeconds.end());
+        result.mDropped = ring.getDropCount() - dropsBefore;
+        return result;
+    }
+
+    void testMultiProducer() {
+        auto ring = std::make_unique<LogRing>();
+
+        for (u32 producerCount : { 2u, 4u, 8u }) {
+            const u32 recordsPerProducer = 20000;
+            RunResult result = runProducers(*ring, producerCount, recordsPerProducer);
+
+            CHECK(result.mIsIntact);
+            CHECK(result.mIsOrdered);
+            CHECK(result.mPopped == result.mPushed);
+            // every attempt either made it in or was counted as a drop
+            CHECK(result.mPushed + result.mDropped == (u64)producerCount * recordsPerProducer);
+        }
+    }
+
+    // producers only pay for formatting their record and pushing it, how much gets through depends on how often the
+    // consumer gets to run, so with fewer cores than threads most records are expected to be dropped
+    void benchThroughput() {
+        auto ring = std::make_unique<LogRing>();
+        printf("%u hardware threads\n", std::thread::hardware_concurrency());
+        printf("%-10s %12s %14s %10s %10s\n", "producers", "ns/push", "delivered/s", "MB/s", "dropped");
+
+        for (u32 producerCount : { 1u, 2u, 4u, 8u }) {
+            const u32 recordsPerProducer = 200000 / producerCount;
+            RunResult result = runProducers(*ring, producerCount, recordsPerProducer);
+
+            CHECK(result.mIsIntact);
+            CHECK(result.mPushed + result.mDropped == (u64)producerCount * recordsPerProducer);
+
+            printf("%-10u %12.1f %14.0f %10.1f %9.2f%%\n", producerCount, result.mProducerSeconds * 1e9 / recordsPerProducer,
+                   result.mPopped / result.mSeconds, result.mBytes / result.mSeconds / (1024.0 * 1024.0),
+                   100.0 * result.mDropped / ((double)producerCount * recordsPerProducer));
+        }
+    }
+}
+
+int main() {
+    testRoundTrip();
+    testOverflowDrops();
+    testMultiProducer();
+    benchThroughput();
+    return test::finish("LogRingTest");
+}
@@ -0,0 +1,256 @@
+#include "Test.h"
+#include "plugin/events/ModEventTable.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// mod event tables against what they replaced: a tree of owner names to vectors of std::function,
+// walked with a capturing lambda on every run
+namespace {
+    using ArgsFunc = void(int value, float scale);
+    using ArgsRFunc = bool(int& result, int value);
+
+    int sCallSum = 0;
+
+    __attribute__((noinline)) void onEvent(int value, float scale) {
+        sCallSum += value + (int)scale;
+    }
+
+    __attribute__((noinline)) bool onEventR(int& result, int value) {
+        result += value;
+        return true;
+    }
+
+    // the old dispatch, minus the sead heap setter it also took on every call
+    template <typename FuncType>
+    struct LegacyEvents {
+        std::map<std::string, std::vector<std::function<FuncType>>> mMap;
+
+        void add(const char* owner, FuncType* func) { mMap[owner].emplace_back(func); }
+
+        template <typename Callback>
+        void forEach(Callback callback) {
+            for (auto& [key, value] : mMap)
+                callback(key, value);
+        }
+    };
+
+    void runLegacy(LegacyEvents<ArgsFunc>& events, int value, float scale) {
+        events.forEach([value, scale](auto& key, auto& value2) {
+            for (auto& eventFunc : value2) {
+                if(!eventFunc)
+                    continue;
+                eventFunc(value, scale);
+            }
+        });
+    }
+
+    int runLegacyR(LegacyEvents<ArgsRFunc>& events, int value) {
+        int result = {};
+        events.forEach([&result, value](auto& key, auto& funcs) {
+            for (auto& eventFunc : funcs) {
+                if(!eventFunc)
+                    continue;
+                if(!eventFunc(result, value))
+                    return;
+            }
+        });
+        return result;
+    }
+
+    // same loops as EventHolderModArgs and EventHolderModArgsR
+    void runTable(ModEventTable<ArgsFunc>& table, int value, float scale) {
+        table.run([&](ArgsFunc* eventFunc) {
+            eventFunc(value, scale);
+            return true;
+        });
+    }
+
+    int runTableR(ModEventTable<ArgsRFunc>& table, int value) {
+        int result = {};
+        table.run([&](ArgsRFunc* eventFunc) {
+            return eventFunc(result, value);
+        });
+        return result;
+    }
+
+    template <int N>
+    void countCall() {
+        sCallSum += N;
+    }
+
+    void testAddRemove() {
+        auto table = std::make_unique<ModEventTable<void()>>();
+        void (*funcs[])() = { countCall<1>, countCall<10>, countCall<100>, countCall<1000> };
+
+        u32 ownerA = EventOwners::getOrCreateId("PluginA.nro");
+        u32 ownerB = EventOwners::getOrCreateId("PluginB.nro");
+        CHECK(ownerA != EventOwners::cInvalidId);
+        CHECK(ownerB != ownerA);
+        CHECK(EventOwners::getOrCreateId("PluginA.nro") == ownerA);
+        CHECK(EventOwners::findId("Missing.nro") == EventOwners::cInvalidId);
+
+        CHECK(table->add(funcs[0], ownerA));
+        CHECK(table->add(funcs[1], ownerB));
+        CHECK(table->add(funcs[2], ownerA));
+        CHECK(table->add(funcs[3], ownerB));
+
+        auto runAll = [&]() {
+            sCallSum = 0;
+            table->run([](void (*eventFunc)()) {
+                eventFunc();
+                return true;
+            });
+            return sCallSum;
+        };
+
+        CHECK(runAll() == 1111);
+
+        // the owner's second event, counting only that owner's events
+        CHECK(table->removeOwnerAt(ownerB, 1));
+        CHECK(runAll() == 111);
+        CHECK(!table->removeOwnerAt(ownerB, 1));
+
+        CHECK(table->removeOwner(ownerA) == 2);
+        CHECK(runAll() == 10);
+        CHECK(table->removeOwner(ownerA) == 0);
+
+        // adding after removals goes to whichever table is active now
+        CHECK(table->add(funcs[3], ownerA));
+        CHECK(runAll() == 1010);
+
+        table->clear();
+        CHECK(runAll() == 0);
+
+        for (size_t i = 0; i < ModEventTable<void()>::cMaxSubscribers; ++i)
+            CHECK(table->add(funcs[0], ownerA));
+        CHECK(!table->add(funcs[0], ownerA));
+        CHECK(runAll() == (int)ModEventTable<void()>::cMaxSubscribers);
+    }
+
+    // a reader running events while the loader thread adds and removes never sees a subscriber that wasn't added
+    void testConcurrentDispatch() {
+        auto table = std::make_unique<ModEventTable<void()>>();
+        u32 owner = EventOwners::getOrCreateId("PluginC.nro");
+        std::atomic<bool> isDone = false;
+        std::atomic<bool> isBroken = false;
+
+        std::thread reader([&]() {
+            while (!isDone.load(std::memory_order_relaxed)) {
+                size_t count = 0;
+                table->run([&](void (*eventFunc)()) {
+                    if(eventFunc != countCall<1>)
+                        isBroken = true;
+                    count++;
+                    return true;
+                });
+                if(count > ModEventTable<void()>::cMaxSubscribers)
+                    isBroken = true;
+            }
+        });
+
+        for (u32 round = 0; round < 20000; ++round) {
+            for (u32 i = 0; i < round % 8 + 1; ++i)
+                table->add(countCall<1>, owner);
+            if(round % 3 == 0)
+                table->removeOwnerAt(owner, round % 4);
+            else
+                table->removeOwner(owner);
+        }
+
+        isDone = true;
+        reader.join();
+        CHECK(!isBroken);
+    }
+
+    std::atomic<bool> sIsInsideSlowEvent = false;
+    std::atomic<bool> sIsSlowEventDone = false;
+
+    void slowEvent() {
+        sIsInsideSlowEvent = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        sIsSlowEventDone = true;
+    }
+
+    // removing an owner only returns once a reader that's still running one of its events has left it,
+    // which is what lets the loader unload the module right after
+    void testRemoveWaitsForReaders() {
+        auto table = std::make_unique<ModEventTable<void()>>();
+        u32 owner = EventOwners::getOrCreateId("PluginD.nro");
+        CHECK(table->add(slowEvent, owner));
+
+        std::thread reader([&]() {
+            table->run([](void (*eventFunc)()) {
+                eventFunc();
+                return true;
+            });
+        });
+
+        while (!sIsInsideSlowEvent)
+            std::this_thread::yield();
+
+        CHECK(table->removeOwner(owner) == 1);
+        CHECK(sIsSlowEventDone);
+
+        reader.join();
+    }
+
+    void benchDispatch() {
+        constexpr u32 cRuns = 200000;
+        constexpr u32 cOwnerCount = 4;
+        printf("%-12s %14s %14s %14s %14s\n", "subscribers", "legacy ns", "table ns", "legacy R ns", "table R ns");
+
+        for (u32 subscriberCount : { 1u, 10u, 100u }) {
+            LegacyEvents<ArgsFunc> legacy;
+            LegacyEvents<ArgsRFunc> legacyR;
+            auto table = std::make_unique<ModEventTable<ArgsFunc>>();
+            auto tableR = std::make_unique<ModEventTable<ArgsRFunc>>();
+
+            for (u32 i = 0; i < subscriberCount; ++i) {
+                // spread over a few plugins, like the loader would register them
+                std::string owner = "BenchPlugin" + std::to_string(i % cOwnerCount) + ".nro";
+                u32 ownerId = EventOwners::getOrCreateId(owner.c_str());
+                legacy.add(owner.c_str(), onEvent);
+                legacyR.add(owner.c_str(), onEventR);
+                CHECK(table->add(onEvent, ownerId));
+                CHECK(tableR->add(onEventR, ownerId));
+            }
+
+            auto time = [&](auto run) {
+                test::Timer timer;
+                for (u32 i = 0; i < cRuns; ++i)
+                    run(i);
+                return timer.getSeconds() * 1e9 / cRuns;
+            };
+
+            sCallSum = 0;
+            double legacyNs = time([&](u32 i) { runLegacy(legacy, i, 2.0f); });
+            int legacySum = sCallSum;
+            sCallSum = 0;
+            double tableNs = time([&](u32 i) { runTable(*table, i, 2.0f); });
+            CHECK(sCallSum == legacySum);
+
+            int legacyResult = 0;
+            int tableResult = 0;
+            double legacyRNs = time([&](u32 i) { legacyResult += runLegacyR(legacyR, i & 0xFF); });
+            double tableRNs = time([&](u32 i) { tableResult += runTableR(*tableR, i & 0xFF); });
+            CHECK(legacyResult == tableResult);
+
+            printf("%-12u %14.1f %14.1f %14.1f %14.1f\n", subscriberCount, legacyNs, tableNs, legacyRNs, tableRNs);
+        }
+    }
+}
+
+int main() {
+    testAddRemove();
+    testConcurrentDispatch();
+    testRemoveWaitsForReaders();
+    benchDispatch();
+    return test::finish("ModEventTest");
+}
@@ -0,0 +1,192 @@
+#include "Test.h"
+#include "host/LoopbackServer.h"
+#include "logger/NetworkTransport.h"
+
+#include <memory>
+#include <thread>
+
+// runs the transport against a loopback server, the way the log drain thread uses it: write, then update, never blocking
+namespace {
+    static_assert(LoopbackServer::cPacketMagic == NetworkTransport::cPacketMagic);
+    static_assert(LoopbackServer::cPacketHeaderSize == NetworkTransport::cPacketHeaderSize);
+    static_assert(LoopbackServer::cMaxPacketSize == NetworkTransport::cMaxPacketSize);
+
+    constexpr u32 cMaxSeq = 1000000;
+
+    void writeMessage(NetworkTransport& transport, u32 seq) {
+        char msg[0x80];
+        int len = snprintf(msg, sizeof(msg), "msg %u [info] something happened in a module, value=%u\n", seq, seq * 7);
+        transport.write(msg, len);
+    }
+
+    // keeps updating until isDone is true, false if that took longer than timeoutSeconds
+    template <typename IsDone>
+    bool updateUntil(NetworkTransport& transport, double timeoutSeconds, IsDone isDone) {
+        test::Timer timer;
+        while (!isDone()) {
+            if(timer.getSeconds() > timeoutSeconds)
+                return false;
+            transport.update(true);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        return true;
+    }
+
+    bool hasLineStartingWith(LoopbackServer& server, const char* prefix) {
+        for (const auto& line : server.getOtherLines()) {
+            if(line.starts_with(prefix))
+                return true;
+        }
+        return false;
+    }
+
+    void testDelivery() {
+        LoopbackServer server;
+        CHECK(server.bind(cMaxSeq));
+        server.listen();
+
+        auto transport = std::make_unique<NetworkTransport>();
+        transport->init("127.0.0.1", server.getPort());
+
+        const u32 count = 5000;
+        for (u32 seq = 0; seq < count; ++seq) {
+            writeMessage(*transport, seq);
+            transport->update();
+        }
+
+        CHECK(updateUntil(*transport, 5.0, [&]() { return !transport->isBusy() && server.getDeliveredCount() == count; }));
+        CHECK(transport->getState() == NetworkTransport::State::Connected);
+        CHECK(server.getDuplicateCount() == 0);
+        CHECK(server.isFramingIntact());
+        CHECK(server.getConnectionCount() == 1);
+        CHECK(hasLineStartingWith(server, "Connected!"));
+        // messages are batched, not sent one packet each
+        CHECK(server.getPacketCount() < count / 10);
+    }
+
+    void testBacklogWhileDown() {
+        LoopbackServer server;
+        CHECK(server.bind(cMaxSeq));
+
+        auto transport = std::make_unique<NetworkTransport>();
+        transport->init("127.0.0.1", server.getPort());
+        CHECK(transport->getState() != NetworkTransport::State::Connected);
+
+        // several times what the backlog holds, the oldest packets have to go
+        const u32 count = 20000;
+        for (u32 seq = 0; seq < count; ++seq) {
+            writeMessage(*transport, seq);
+            transport->update();
+        }
+        CHECK(transport->getState() != NetworkTransport::State::Connected);
+
+        server.listen();
+        CHECK(updateUntil(*transport, 10.0, [&]() { return !transport->isBusy() && server.isSeen(count - 1) && hasLineStartingWith(server, "Connected!"); }));
+
+        u64 delivered = server.getDeliveredCount();
+        CHECK(delivered > 0);
+        CHECK(delivered < count);
+        // the backlog, plus the packet that was being filled when the connection came up
+        CHECK(server.getByteCount() <= NetworkTransport::cBacklogSize + NetworkTransport::cMaxPacketSize);
+
+        // what's left is the newest output, without gaps
+        u32 firstSeq = count - delivered;
+        CHECK(!server.isSeen(firstSeq - 1));
+        for (u32 seq = firstSeq; seq < count; ++seq) {
+            if(!server.isSeen(seq)) {
+                CHECK(server.isSeen(seq));
+                break;
+            }
+        }
+
+        CHECK(server.isFramingIntact());
+        CHECK(hasLineStartingWith(server, "Connected! "));
+    }
+
+    void testReconnect() {
+        LoopbackServer server;
+        CHECK(server.bind(cMaxSeq));
+        server.listen();
+
+        auto transport = std::make_unique<NetworkTransport>();
+        transport->init("127.0.0.1", server.getPort());
+
+        u32 seq = 0;
+        for (; seq < 1000; ++seq) {
+            writeMessage(*transport, seq);
+            transport->update();
+        }
+        CHECK(updateUntil(*transport, 5.0, [&]() { return server.getDeliveredCount() == 1000; }));
+        u32 streamId = transport->getStreamId();
+
+        // keep logging at a steady rate while the connection is gone, the transport notices and reconnects by itself
+        server.dropClient();
+        test::Timer timer;
+        // the server can accept before the transport has seen its connect finish
+        while ((server.getConnectionCount() < 2 || transport->getState() != NetworkTransport::State::Connected) &&
+               timer.getSeconds() < 10.0) {
+            writeMessage(*transport, seq++);
+            transport->update();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(server.getConnectionCount() == 2);
+        CHECK(transport->getState() == NetworkTransport::State::Connected);
+        CHECK(transport->getStreamId() != streamId);
+
+        // everything logged from now on arrives
+        u32 firstAfter = seq;
+        for (u32 i = 0; i < 1000; ++i) {
+            writeMessage(*transport, seq++);
+            transport->update();
+        }
+        CHECK(updateUntil(*transport, 5.0, [&]() { return !transport->isBusy() && server.isSeen(seq - 1); }));
+        for (u32 i = firstAfter; i < seq; ++i) {
+            if(!server.isSeen(i)) {
+                CHECK(server.isSeen(i));
+                break;
+            }
+        }
+        CHECK(server.isFramingIntact());
+    }
+
+    // how many messages a second make it to the other end, with the write+update cost on the logging side
+    void benchThroughput() {
+        LoopbackServer server;
+        CHECK(server.bind(cMaxSeq));
+        server.listen();
+
+        auto transport = std::make_unique<NetworkTransport>();
+        transport->init("127.0.0.1", server.getPort());
+        CHECK(updateUntil(*transport, 5.0, [&]() { return transport->getState() == NetworkTransport::State::Connected; }));
+
+        const u32 count = 500000;
+        test::Timer timer;
+        for (u32 seq = 0; seq < count; ++seq) {
+            writeMessage(*transport, seq);
+            transport->update();
+        }
+        double writeSeconds = timer.getSeconds();
+
+        // the last message has to be there, anything dropped before it was counted by the transport
+        CHECK(updateUntil(*transport, 10.0, [&]() { return !transport->isBusy() && server.isSeen(count - 1); }));
+        double seconds = timer.getSeconds();
+
+        u64 delivered = server.getDeliveredCount();
+        u64 packets = server.getPacketCount();
+        CHECK(server.isFramingIntact());
+        CHECK(server.getDuplicateCount() == 0);
+
+        printf("%u messages, %.1f ns per write+update\n", count, writeSeconds * 1e9 / count);
+        printf("delivered: %.0f msgs/s  %.1f MB/s  %.1f msgs/packet  dropped: %.2f%%\n", delivered / seconds,
+               server.getByteCount() / seconds / (1024.0 * 1024.0), (double)delivered / packets,
+               100.0 * (count - delivered) / count);
+    }
+}
+
+int main() {
+    testDelivery();
+    testBacklogWhileDown();
+    testReconnect();
+    benchThroughput();
+    return test::finish("NetworkTransportTest");
+}
@@ -0,0 +1,231 @@
+#include "Test.h"
+#include "types.h"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "nn/result.h"
+#include "nn/crypto.h"
+#include "nn/fs.h"
+#include "nn/ro.h"
+#include "plugin/NroHashThread.h"
+
+// feeds synthetic NROs through the same steps PluginLoader::preparePluginsForLoad takes for every plugin: read the file
+// straight into a 0x1000 aligned buffer, then hand it to the NroHashThread while the next one is read.
+// reads come from the page cache on the host, so a second run throttles them to an SD card like speed.
+namespace {
+    constexpr u32 cNroMagic = 0x304F524E; // NRO0
+    constexpr double cSdBytesPerSecond = 60.0 * 1024 * 1024;
+
+    using Hash = std::array<u8, 0x20>;
+
+    Hash sha256(const void* data, size_t size) {
+        Hash hash;
+        nn::crypto::GenerateSha256Hash(hash.data(), hash.size(), data, size);
+        return hash;
+    }
+
+    Hash fromHex(const char* hex) {
+        Hash hash;
+        for (size_t i = 0; i < hash.size(); ++i)
+            hash[i] = (u8)std::stoul(std::string(hex + i * 2, 2), nullptr, 16);
+        return hash;
+    }
+
+    struct SyntheticPlugin {
+        std::string mPath;
+        size_t mFileSize;
+        Hash mExpectedHash; // over NroHeader::size bytes, anything after that isn't part of the NRO
+    };
+
+    struct PluginDir {
+        std::string mPath;
+        std::vector<SyntheticPlugin> mPlugins;
+
+        PluginDir(size_t count, size_t minSize, size_t maxSize, u32 seed) {
+            char dirTemplate[] = "/tmp/nrohashtest.XXXXXX";
+            mPath = mkdtemp(dirTemplate);
+
+            std::mt19937 rng(seed);
+            for (size_t i = 0; i < count; ++i) {
+                size_t fileSize = ALIGN_UP(minSize + rng() % (maxSize - minSize), 0x1000);
+                std::vector<u8> file(fileSize);
+                for (auto& byte : file)
+                    byte = (u8)rng();
+
+                auto* header = (nn::ro::NroHeader*)file.data();
+                header->magic = cNroMagic;
+                header->size = (u32)(fileSize - (i % 2 == 0 ? 0 : 0x100));
+
+                SyntheticPlugin plugin = { mPath + "/plugin" + std::to_string(i) + ".nro", fileSize, sha256(file.data(), header->size) };
+                FILE* out = fopen(plugin.mPath.c_str(), "wb");
+                fwrite(file.data(), 1, file.size(), out);
+                fclose(out);
+
+                mPlugins.push_back(plugin);
+            }
+        }
+
+        ~PluginDir() {
+            for (const auto& plugin : mPlugins)
+                unlink(plugin.mPath.c_str());
+            rmdir(mPath.c_str());
+        }
+    };
+
+    struct PipelineResult {
+        std::vector<Hash> mHashes;
+        double mReadTime = 0;
+        double mHashTime = 0;
+        double mHashWaitTime = 0;
+        double mTotalTime = 0;
+        size_t mBytesRead = 0;
+    };
+
+    // what FsHelper::readFileToBuffer does, optionally held to bytesPerSecond
+    bool readFile(void* buffer, size_t size, const char* path, double bytesPerSecond) {
+        test::Timer timer;
+
+        nn::fs::FileHandle handle;
+        if(nn::fs::OpenFile(&handle, path, nn::fs::OpenMode_Read).isFailure())
+            return false;
+
+        nn::Result result = nn::fs::ReadFile(handle, 0, buffer, size);
+        nn::fs::CloseFile(handle);
+
+        if(bytesPerSecond != 0) {
+            double remaining = size / bytesPerSecond - timer.getSeconds();
+            if(remaining > 0)
+                std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+        }
+
+        return result.isSuccess();
+    }
+
+    PipelineResult runPipeline(const PluginDir& dir, bool isThreaded, double bytesPerSecond) {
+        alignas(nn::os::ThreadStackAlignment) static u8 sStack[0x4000];
+
+        PipelineResult result;
+        result.mHashes.resize(dir.mPlugins.size());
+
+        std::vector<NroHashJob> jobs(dir.mPlugins.size());
+        std::vector<u8*> buffers;
+
+        test::Timer totalTimer;
+
+        NroHashThread hashThread;
+        if(isThreaded)
+            CHECK(hashThread.start(sStack, sizeof(sStack), 1));
+
+        for (size_t i = 0; i < dir.mPlugins.size(); ++i) {
+            const auto& plugin = dir.mPlugins[i];
+
+            u8* fileData = (u8*)aligned_alloc(0x1000, plugin.mFileSize);
+            buffers.push_back(fileData);
+
+            test::Timer readTimer;
+            CHECK(readFile(fileData, plugin.mFileSize, plugin.mPath.c_str(), bytesPerSecond));
+            result.mReadTime += readTimer.getSeconds();
+            result.mBytesRead += plugin.mFileSize;
+
+            auto* nroHeader = (nn::ro::NroHeader*)fileData;
+            CHECK(nroHeader->magic == cNroMagic);
+            CHECK(nroHeader->size <= plugin.mFileSize);
+
+            jobs[i] = { fileData, nroHeader->size, result.mHashes[i].data() };
+            hashThread.push(jobs[i]);
+        }
+
+        test::Timer waitTimer;
+        hashThread.stop();
+        result.mHashWaitTime = waitTimer.getSeconds();
+        result.mHashTime = hashThread.getHashTime() / 1e6;
+        result.mTotalTime = totalTimer.getSeconds();
+
+        for (u8* buffer : buffers)
+            free(buffer);
+
+        return result;
+    }
+
+    void checkHashes(const PluginDir& dir, const PipelineResult& result) {
+        for (size_t i = 0; i < dir.mPlugins.size(); ++i)
+            CHECK(result.mHashes[i] == dir.mPlugins[i].mExpectedHash);
+    }
+
+    void testSha256() {
+        CHECK(sha256("", 0) == fromHex("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+        CHECK(sha256("abc", 3) == fromHex("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+
+        const char* twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+        CHECK(sha256(twoBlocks, strlen(twoBlocks)) == fromHex("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+
+        std::vector<u8> million(1000000, 'a');
+        CHECK(sha256(million.data(), million.size()) == fromHex("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"));
+    }
+
+    void testPipeline() {
+        // more plugins than the hash queue holds, so pushing has to wait on the hash thread at some point
+        PluginDir dir(48, 0x1000, 0x20000, 1);
+
+        checkHashes(dir, runPipeline(dir, true, 0));
+        checkHashes(dir, runPipeline(dir, false, 0));
+
+        // starting and stopping again reuses the same thread object
+        NroHashThread hashThread;
+        alignas(nn::os::ThreadStackAlignment) static u8 sStack[0x4000];
+        for (int i = 0; i < 3; ++i) {
+            Hash hash = {};
+            std::vector<u8> data(0x1000, (u8)i);
+            NroHashJob job = { data.data(), data.size(), hash.data() };
+
+            CHECK(hashThread.start(sStack, sizeof(sStack), 1));
+            CHECK(hashThread.isRunning());
+            hashThread.push(job);
+            hashThread.stop();
+            CHECK(!hashThread.isRunning());
+            CHECK(hash == sha256(data.data(), data.size()));
+        }
+    }
+
+    void printResult(const char* name, const PipelineResult& result) {
+        printf("%-22s total: %7.1f ms  read: %7.1f ms  hash: %7.1f ms  hash wait: %6.2f ms  %6.1f MB/s\n", name,
+               result.mTotalTime * 1e3, result.mReadTime * 1e3, result.mHashTime * 1e3, result.mHashWaitTime * 1e3,
+               result.mBytesRead / result.mTotalTime / (1024 * 1024));
+    }
+
+    void benchPipeline() {
+        // 24 plugins between 256KB and 1MB, about what a heavily modded setup loads
+        PluginDir dir(24, 0x40000, 0x100000, 2);
+
+        size_t totalSize = 0;
+        for (const auto& plugin : dir.mPlugins)
+            totalSize += plugin.mFileSize;
+        printf("%zu plugins, %.1f MB\n", dir.mPlugins.size(), totalSize / (1024.0 * 1024.0));
+
+        for (double bytesPerSecond : { 0.0, cSdBytesPerSecond }) {
+            PipelineResult serial = runPipeline(dir, false, bytesPerSecond);
+            PipelineResult threaded = runPipeline(dir, true, bytesPerSecond);
+            checkHashes(dir, serial);
+            checkHashes(dir, threaded);
+
+            printf("%s\n", bytesPerSecond == 0 ? "page cache reads:" : "reads at 60 MB/s:");
+            printResult("  hashed after read", serial);
+            printResult("  hash thread", threaded);
+        }
+    }
+}
+
+int main() {
+    testSha256();
+    testPipeline();
+    benchPipeline();
+    return test::finish("NroHashTest");
+}
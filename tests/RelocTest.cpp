@@ -0,0 +1,255 @@
+#include "Test.h"
+#include "types.h"
+#include "lib/reloc/relative.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// checks the bulk relative relocation paths against the per entry loop they replaced, and DT_RELR against
+// a reference encoder doing what the linker does with -z pack-relative-relocs
+namespace {
+    using namespace rtld;
+
+    constexpr Elf_Xword cOtherTypes[] = { ARCH_GLOB_DAT, ARCH_JUMP_SLOT, R_AARCH64_ABS64 };
+
+    // what ModuleObject::Relocate and exl_dynamic did for every entry before
+    size_t applyScalarRela(Elf_Addr base, const Elf_Rela* entries, size_t count) {
+        size_t applied = 0;
+        for (size_t i = 0; i < count; ++i) {
+            switch (ELF_R_TYPE(entries[i].r_info)) {
+                case ARCH_RELATIVE:
+                    *(Elf_Addr*)(base + entries[i].r_offset) = base + entries[i].r_addend;
+                    applied++;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return applied;
+    }
+
+    size_t applyScalarRel(Elf_Addr base, const Elf_Rel* entries, size_t count) {
+        size_t applied = 0;
+        for (size_t i = 0; i < count; ++i) {
+            switch (ELF_R_TYPE(entries[i].r_info)) {
+                case ARCH_RELATIVE:
+                    *(Elf_Addr*)(base + entries[i].r_offset) += base;
+                    applied++;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return applied;
+    }
+
+    // packs sorted, 8 byte aligned offsets the same way lld and bfd do
+    std::vector<Elf_Relr> encodeRelr(const std::vector<Elf_Addr>& offsets) {
+        constexpr size_t bitmapSlots = sizeof(Elf_Relr) * 8 - 1;
+        std::vector<Elf_Relr> out;
+
+        size_t i = 0;
+        while (i < offsets.size()) {
+            out.push_back(offsets[i]);
+            Elf_Addr base = offsets[i] + sizeof(Elf_Addr);
+            i++;
+
+            while (true) {
+                Elf_Relr bitmap = 0;
+                while (i < offsets.size()) {
+                    Elf_Addr delta = offsets[i] - base;
+                    if(delta >= bitmapSlots * sizeof(Elf_Addr))
+                        break;
+                    bitmap |= (Elf_Relr)1 << (delta / sizeof(Elf_Addr));
+                    i++;
+                }
+                if(bitmap == 0)
+                    break;
+                out.push_back((bitmap << 1) | 1);
+                base += bitmapSlots * sizeof(Elf_Addr);
+            }
+        }
+
+        return out;
+    }
+
+    // both paths are run on the same memory, so the results can be compared slot by slot
+    struct Image {
+        std::vector<Elf_Addr> mSlots;
+        std::vector<Elf_Addr> mInitial;
+
+        explicit Image(size_t slotCount, u32 seed) : mSlots(slotCount), mInitial(slotCount) {
+            std::mt19937_64 rng(seed);
+            for (auto& slot : mInitial)
+                slot = rng() & 0xFFFFFF;
+            reset();
+        }
+
+        void reset() { mSlots = mInitial; }
+        Elf_Addr getBase() const { return (Elf_Addr)mSlots.data(); }
+    };
+
+    template <typename Fast, typename Scalar>
+    void checkSameResult(Image& image, Fast applyFast, Scalar applyScalar) {
+        image.reset();
+        size_t fastCount = applyFast(image.getBase());
+        std::vector<Elf_Addr> fastSlots = image.mSlots;
+
+        image.reset();
+        size_t scalarCount = applyScalar(image.getBase());
+
+        CHECK(fastCount == scalarCount);
+        CHECK(fastSlots == image.mSlots);
+    }
+
+    // runs of RELATIVE entries broken up by other types, like a module's .rela.dyn
+    std::vector<Elf_Rela> makeRela(std::mt19937& rng, size_t count, size_t slotCount, u32 otherOneIn) {
+        std::vector<Elf_Rela> entries(count);
+        for (auto& entry : entries) {
+            entry.r_offset = (rng() % slotCount) * sizeof(Elf_Addr);
+            entry.r_addend = rng() % (slotCount * sizeof(Elf_Addr));
+            if(rng() % otherOneIn == 0)
+                entry.r_info = ELF64_R_INFO(rng() % 16 + 1, cOtherTypes[rng() % 3]);
+            else
+                entry.r_info = ARCH_RELATIVE;
+        }
+        return entries;
+    }
+
+    void testRela() {
+        std::mt19937 rng(1);
+
+        for (u32 iter = 0; iter < 2000; ++iter) {
+            size_t slotCount = rng() % 500 + 1;
+            size_t count = rng() % 40;
+            auto entries = makeRela(rng, count, slotCount, iter % 2 == 0 ? 3 : 50);
+
+            Image image(slotCount, iter);
+            checkSameResult(image, [&](Elf_Addr base) { return apply_all_relative_rela(base, entries.data(), entries.size()); },
+                            [&](Elf_Addr base) { return applyScalarRela(base, entries.data(), entries.size()); });
+        }
+    }
+
+    void testRel() {
+        std::mt19937 rng(2);
+
+        for (u32 iter = 0; iter < 2000; ++iter) {
+            size_t slotCount = rng() % 500 + 1;
+            auto rela = makeRela(rng, rng() % 40, slotCount, iter % 2 == 0 ? 3 : 50);
+
+            // REL has no addend, every offset is relocated at most once so the results don't depend on order
+            std::vector<Elf_Rel> entries;
+            std::vector<bool> isUsed(slotCount);
+            for (const auto& entry : rela) {
+                size_t slot = entry.r_offset / sizeof(Elf_Addr);
+                if(isUsed[slot])
+                    continue;
+                isUsed[slot] = true;
+                entries.push_back({ entry.r_offset, entry.r_info });
+            }
+
+            Image image(slotCount, iter);
+            checkSameResult(image, [&](Elf_Addr base) { return apply_all_relative_rel(base, entries.data(), entries.size()); },
+                            [&](Elf_Addr base) { return applyScalarRel(base, entries.data(), entries.size()); });
+        }
+    }
+
+    void testRunLength() {
+        // a run stops at the first other entry, wherever it lands in a group of four
+        for (size_t count = 0; count <= 9; ++count) {
+            for (size_t stop = 0; stop <= count; ++stop) {
+                std::vector<Elf_Rela> entries(count);
+                for (size_t i = 0; i < count; ++i)
+                    entries[i] = { i * sizeof(Elf_Addr), i == stop ? ELF64_R_INFO(1, ARCH_GLOB_DAT) : (Elf_Xword)ARCH_RELATIVE, 0 };
+
+                Image image(count + 1, 0);
+                CHECK(apply_relative_rela(image.getBase(), entries.data(), count) == std::min(stop, count));
+            }
+        }
+    }
+
+    void testRelr() {
+        std::mt19937 rng(3);
+
+        for (u32 iter = 0; iter < 2000; ++iter) {
+            size_t slotCount = rng() % 600 + 1;
+            u32 density = rng() % 4 + 1;
+
+            std::vector<Elf_Addr> offsets;
+            for (size_t slot = 0; slot < slotCount; ++slot) {
+                // mostly dense stretches with the odd gap past what a bitmap covers
+                if(rng() % density == 0)
+                    offsets.push_back(slot * sizeof(Elf_Addr));
+                else if(rng() % 50 == 0)
+                    slot += 63 + rng() % 70;
+            }
+
+            auto relr = encodeRelr(offsets);
+            std::vector<Elf_Rel> rel;
+            for (Elf_Addr offset : offsets)
+                rel.push_back({ offset, ARCH_RELATIVE });
+
+            Image image(slotCount + 200, iter);
+            checkSameResult(image, [&](Elf_Addr base) { return apply_relr(base, relr.data(), relr.size() * sizeof(Elf_Relr)); },
+                            [&](Elf_Addr base) { return applyScalarRel(base, rel.data(), rel.size()); });
+
+            image.reset();
+            CHECK(apply_relr(image.getBase(), relr.data(), relr.size() * sizeof(Elf_Relr)) == offsets.size());
+            CHECK(relr.size() <= offsets.size());
+        }
+
+        // an empty table relocates nothing
+        Image image(1, 0);
+        CHECK(apply_relr(image.getBase(), nullptr, 0) == 0);
+    }
+
+    void benchmark() {
+        // laid out like a real module: sorted offsets, nearly all RELATIVE, a few GLOB_DAT in between
+        constexpr size_t cSlotCount = 0x40000;
+        constexpr u32 cRounds = 20;
+        std::mt19937 rng(4);
+
+        std::vector<Elf_Rela> rela;
+        std::vector<Elf_Rel> rel;
+        std::vector<Elf_Addr> relativeOffsets;
+        for (size_t slot = 0; slot < cSlotCount; slot += rng() % 3 + 1) {
+            Elf_Xword info = rng() % 64 == 0 ? ELF64_R_INFO(1, ARCH_GLOB_DAT) : (Elf_Xword)ARCH_RELATIVE;
+            rela.push_back({ slot * sizeof(Elf_Addr), info, (Elf64_Sxword)(rng() % 0x100000) });
+            rel.push_back({ slot * sizeof(Elf_Addr), info });
+            if(info == ARCH_RELATIVE)
+                relativeOffsets.push_back(slot * sizeof(Elf_Addr));
+        }
+        auto relr = encodeRelr(relativeOffsets);
+
+        Image image(cSlotCount, 0);
+        auto run = [&](auto apply) {
+            test::Timer timer;
+            for (u32 i = 0; i < cRounds; ++i) {
+                test::doNotOptimize(apply());
+            }
+            return timer.getSeconds() * 1e9 / ((double)cRounds * relativeOffsets.size());
+        };
+
+        Elf_Addr base = image.getBase();
+        double scalarRela = run([&]() { return applyScalarRela(base, rela.data(), rela.size()); });
+        double fastRela = run([&]() { return apply_all_relative_rela(base, rela.data(), rela.size()); });
+        double scalarRel = run([&]() { return applyScalarRel(base, rel.data(), rel.size()); });
+        double fastRel = run([&]() { return apply_all_relative_rel(base, rel.data(), rel.size()); });
+        double packed = run([&]() { return apply_relr(base, relr.data(), relr.size() * sizeof(Elf_Relr)); });
+
+        printf("%zu relative relocations\n", relativeOffsets.size());
+        printf("RELA scalar: %6.2f ns/reloc  bulk: %6.2f ns/reloc  (%zu bytes)\n", scalarRela, fastRela, rela.size() * sizeof(Elf_Rela));
+        printf("REL  scalar: %6.2f ns/reloc  bulk: %6.2f ns/reloc  (%zu bytes)\n", scalarRel, fastRel, rel.size() * sizeof(Elf_Rel));
+        printf("RELR packed: %6.2f ns/reloc                      (%zu bytes)\n", packed, relr.size() * sizeof(Elf_Relr));
+    }
+}
+
+int main() {
+    testRela();
+    testRel();
+    testRunLength();
+    testRelr();
+    benchmark();
+    return test::finish("RelocTest");
+}
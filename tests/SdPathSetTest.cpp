@@ -0,0 +1,229 @@
+#include "Test.h"
+#include "host/HostInit.h"
+#include "helpers/SdPathSet.h"
+#include "nn/init.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/stat.h>
+
+// checks the SD redirection path set against std::unordered_set, including erasing from long probe chains and
+// manifests, then compares a stage load worth of lookups through the set with stat-ing every path.
+namespace {
+    // from scripts/genRedirectManifest.py's hash_path, manifests made with it have to match what the set looks up
+    void testHashPath() {
+        auto hash = [](const char* path) { return SdPathSet::hashPath(path, strlen(path)); };
+
+        CHECK(hash("") == 0xCBF29CE484222325);
+        CHECK(hash("a") == 0xAF63DC4C8601EC8C);
+        CHECK(hash("ObjectData/Mario.szs") == 0xA1D7731213B36549);
+        CHECK(hash("StageData\\CapWorldHomeStage.szs") == 0xD94E1F4319CEBF65);
+
+        // the SD is case insensitive and doesn't care about extra slashes
+        CHECK(hash("/objectdata//MARIO.szs") == hash("ObjectData/Mario.szs"));
+        CHECK(hash("ObjectData\\Mario.szs") == hash("ObjectData/Mario.szs"));
+        CHECK(hash("ObjectData/Mario.szs") != hash("ObjectData/Mario.sz"));
+        CHECK(hash("ObjectData/Mario.szs") != hash("ObjectDataMario.szs"));
+    }
+
+    void testAgainstReference() {
+        std::mt19937_64 rng(1);
+
+        // a small pool so inserts and erases keep hitting the same hashes, some sharing their low bits to make long chains
+        std::vector<u64> pool;
+        for (int i = 0; i < 6000; ++i)
+            pool.push_back(i % 3 == 0 ? (rng() << 20) | 0x5A5 : rng() | 1);
+
+        SdPathSet set;
+        std::unordered_set<u64> reference;
+
+        for (int op = 0; op < 300000; ++op) {
+            u64 hash = pool[rng() % pool.size()];
+            // grows for the first half, then shrinks
+            if(rng() % 100 < (op < 150000 ? 70u : 30u)) {
+                CHECK(set.insert(hash));
+                reference.insert(hash);
+            } else {
+                set.erase(hash);
+                reference.erase(hash);
+            }
+
+            if(op % 5000 == 0) {
+                CHECK(set.getCount() == reference.size());
+                for (u64 poolHash : pool)
+                    CHECK(set.contains(poolHash) == (reference.count(poolHash) != 0));
+            }
+        }
+
+        set.clear();
+        CHECK(set.getCount() == 0);
+        for (u64 poolHash : pool)
+            CHECK(!set.contains(poolHash));
+    }
+
+    void* makeManifest(const std::vector<u64>& hashes, size_t* outSize) {
+        *outSize = sizeof(SdPathSet::ManifestHeader) + hashes.size() * sizeof(SdPathSet::ManifestEntry);
+        auto* header = (SdPathSet::ManifestHeader*)nn::init::GetAllocator()->Allocate(*outSize);
+        *header = { 0x464D4452, 1, (u32)hashes.size(), 0 };
+
+        auto* entries = (SdPathSet::ManifestEntry*)(header + 1);
+        for (size_t i = 0; i < hashes.size(); ++i)
+            entries[i] = { hashes[i], 0x100 * (i + 1) };
+        return header;
+    }
+
+    void testManifest() {
+        size_t baseBytes = host::getAllocatedBytes();
+        {
+            std::mt19937_64 rng(2);
+            std::vector<u64> hashes;
+            for (int i = 0; i < 500; ++i)
+                hashes.push_back(rng() | 1);
+            std::sort(hashes.begin(), hashes.end());
+
+            SdPathSet set;
+            size_t size = 0;
+
+            // anything off about the file leaves the set as it was, and the buffer with the caller
+            auto checkRejected = [&](auto edit) {
+                void* buffer = makeManifest(hashes, &size);
+                edit((SdPathSet::ManifestHeader*)buffer, (SdPathSet::ManifestEntry*)((SdPathSet::ManifestHeader*)buffer + 1));
+                CHECK(!set.loadManifest(buffer, size));
+                CHECK(!set.isFromManifest());
+                nn::init::GetAllocator()->Free(buffer);
+            };
+            checkRejected([](auto* header, auto*) { header->mMagic = 0; });
+            checkRejected([](auto* header, auto*) { header->mVersion = 2; });
+            checkRejected([](auto* header, auto*) { header->mEntryCount++; });
+            checkRejected([](auto*, auto* entries) { std::swap(entries[10], entries[11]); });
+            checkRejected([](auto*, auto* entries) { entries[5].mHash = entries[4].mHash; });
+            checkRejected([](auto*, auto* entries) { entries[0].mHash = 0; });
+            void* shortBuffer = makeManifest(hashes, &size);
+            CHECK(!set.loadManifest(shortBuffer, sizeof(SdPathSet::ManifestHeader) - 1));
+            nn::init::GetAllocator()->Free(shortBuffer);
+
+            CHECK(set.insert(12345));
+            void* buffer = makeManifest(hashes, &size);
+            CHECK(set.loadManifest(buffer, size));
+            CHECK(set.isFromManifest());
+            CHECK(set.getCount() == hashes.size());
+            CHECK(!set.contains(12345)); // loading replaces whatever was there
+            CHECK(set.getManifestDataSize() == 0x100 * hashes.size() * (hashes.size() + 1) / 2);
+
+            for (u64 hash : hashes)
+                CHECK(set.contains(hash));
+            CHECK(!set.contains(hashes[0] + 1));
+
+            // files added later go into the table next to it, removed ones come out of either
+            CHECK(set.insert(hashes[3]));
+            CHECK(set.getCount() == hashes.size());
+            CHECK(set.insert(2));
+            CHECK(set.contains(2) && set.getCount() == hashes.size() + 1);
+
+            set.erase(hashes[100]);
+            set.erase(2);
+            CHECK(!set.contains(hashes[100]) && !set.contains(2));
+            CHECK(set.contains(hashes[99]) && set.contains(hashes[101]));
+            CHECK(set.getCount() == hashes.size() - 1);
+            CHECK(set.getManifestDataSize() == 0x100 * hashes.size() * (hashes.size() + 1) / 2 - 0x100 * 101);
+
+            set.clear();
+            CHECK(!set.isFromManifest() && set.getCount() == 0);
+        }
+        CHECK(host::getAllocatedBytes() == baseBytes);
+    }
+
+    // a mod folder: a few hundred replaced files spread over the game's usual folders
+    struct ModDir {
+        std::filesystem::path mRoot;
+        std::vector<std::string> mFiles;
+
+        ModDir(size_t fileCount, u32 seed) {
+            char dirTemplate[] = "/tmp/sdpathsettest.XXXXXX";
+            mRoot = mkdtemp(dirTemplate);
+
+            const char* folders[] = { "ObjectData", "StageData", "SoundData", "LayoutData", "SystemData" };
+            for (const char* folder : folders)
+                std::filesystem::create_directory(mRoot / folder);
+
+            std::mt19937 rng(seed);
+            for (size_t i = 0; i < fileCount; ++i) {
+                std::string path = std::string(folders[rng() % 5]) + "/File" + std::to_string(i) + ".szs";
+                FILE* file = fopen((mRoot / path).c_str(), "wb");
+                fclose(file);
+                mFiles.push_back(path);
+            }
+        }
+
+        ~ModDir() {
+            std::filesystem::remove_all(mRoot);
+        }
+    };
+
+    void benchmark() {
+        ModDir mod(400, 3);
+
+        // what SdFileIndex::build does when there's no manifest
+        test::Timer buildTimer;
+        SdPathSet set;
+        size_t rootLen = mod.mRoot.string().size() + 1;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(mod.mRoot)) {
+            if(entry.is_regular_file()) {
+                std::string path = entry.path().string();
+                CHECK(set.insert(SdPathSet::hashPath(path.c_str() + rootLen, path.size() - rootLen)));
+            }
+        }
+        double buildMs = buildTimer.getSeconds() * 1e3;
+        CHECK(set.getCount() == mod.mFiles.size());
+
+        // a large stage load looks up a few thousand files, only a handful of them replaced by the mod
+        std::mt19937 rng(4);
+        std::vector<std::string> lookups;
+        for (int i = 0; i < 4000; ++i) {
+            if(rng() % 50 == 0)
+                lookups.push_back(mod.mFiles[rng() % mod.mFiles.size()]);
+            else
+                lookups.push_back("ObjectData/GameFile" + std::to_string(rng() % 3000) + ".szs");
+        }
+
+        constexpr int cRounds = 20;
+        size_t statFound = 0;
+        test::Timer statTimer;
+        for (int round = 0; round < cRounds; ++round) {
+            for (const auto& path : lookups) {
+                struct stat info;
+                statFound += stat((mod.mRoot / path).c_str(), &info) == 0 && S_ISREG(info.st_mode);
+            }
+        }
+        double statUs = statTimer.getSeconds() * 1e6 / cRounds;
+
+        size_t setFound = 0;
+        test::Timer setTimer;
+        for (int round = 0; round < cRounds; ++round) {
+            for (const auto& path : lookups)
+                setFound += set.contains(SdPathSet::hashPath(path.c_str(), path.size()));
+        }
+        double setUs = setTimer.getSeconds() * 1e6 / cRounds;
+
+        CHECK(statFound == setFound);
+
+        printf("%zu indexed files, built in %.2f ms\n", mod.mFiles.size(), buildMs);
+        printf("stage load of %zu lookups (%zu redirected): stat: %.1f us (%.0f ns each)  index: %.1f us (%.0f ns each)\n",
+               lookups.size(), setFound / cRounds, statUs, statUs * 1e3 / lookups.size(), setUs, setUs * 1e3 / lookups.size());
+        printf("stat here hits the host's page cache, every one of them is an SD card access on the console\n");
+    }
+}
+
+int main() {
+    testHashPath();
+    testAgainstReference();
+    testManifest();
+    benchmark();
+    return test::finish("SdPathSetTest");
+}
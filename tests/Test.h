@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// minimal checks for the host tests, a failed check is reported and the test keeps going, then fails at the end
+namespace test {
+    inline int sFailCount = 0;
+
+    inline void fail(const char* file, int line, const char* expr) {
+        printf("%s:%d: check failed: %s\n", file, line, expr);
+        sFailCount++;
+    }
+
+    inline int finish(const char* name) {
+        if(sFailCount == 0) {
+            printf("%s: passed\n", name);
+            return 0;
+        }
+        printf("%s: %d check(s) failed\n", name, sFailCount);
+        return 1;
+    }
+
+    class Timer {
+        std::chrono::steady_clock::time_point mStart = std::chrono::steady_clock::now();
+    public:
+        double getSeconds() const {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+        }
+    };
+
+    // keeps the compiler from optimizing away work whose result isn't otherwise used
+    template <typename T>
+    inline void doNotOptimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+}
+
+#define CHECK(expr) do { if(!(expr)) test::fail(__FILE__, __LINE__, #expr); } while (0)
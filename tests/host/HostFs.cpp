@@ -0,0 +1,42 @@
+#include "nn/fs.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// files are plain host paths, the handle holds the file descriptor
+
+namespace nn::fs {
+    Result OpenFile(FileHandle* handleOut, char const* path, int mode) {
+        int flags = (mode & OpenMode_Write) ? ((mode & OpenMode_Read) ? O_RDWR : O_WRONLY) : O_RDONLY;
+        int fd = open(path, flags);
+        if(fd < 0)
+            return 1;
+
+        handleOut->_internal = fd;
+        return 0;
+    }
+
+    void CloseFile(FileHandle handle) {
+        close((int)handle._internal);
+    }
+
+    Result GetFileSize(long* size, FileHandle handle) {
+        struct stat info = {};
+        if(fstat((int)handle._internal, &info) != 0)
+            return 1;
+
+        *size = info.st_size;
+        return 0;
+    }
+
+    Result ReadFile(FileHandle handle, long position, void* buffer, ulong size) {
+        ulong done = 0;
+        while (done < size) {
+            ssize_t len = pread((int)handle._internal, (u8*)buffer + done, size - done, position + done);
+            if(len <= 0)
+                return 1;
+            done += len;
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,49 @@
+#include "HostInit.h"
+#include "nn/init.h"
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+
+// nn::init's allocator is malloc on the host
+
+namespace {
+    std::atomic<size_t> sAllocatedBytes = 0;
+}
+
+size_t host::getAllocatedBytes() {
+    return sAllocatedBytes;
+}
+
+namespace nn::mem {
+    StandardAllocator::StandardAllocator() : mIsInitialized(true), mIsEnabledThreadCache(false), _2(0), mAllocAddr(nullptr) {}
+
+    void* StandardAllocator::Allocate(u64 size) {
+        void* ptr = malloc(size);
+        if(ptr)
+            sAllocatedBytes += malloc_usable_size(ptr);
+        return ptr;
+    }
+
+    void StandardAllocator::Free(void* address) {
+        if(address)
+            sAllocatedBytes -= malloc_usable_size(address);
+        free(address);
+    }
+
+    void* StandardAllocator::Reallocate(void* address, u64 newSize) {
+        size_t oldSize = address ? malloc_usable_size(address) : 0;
+        void* ptr = realloc(address, newSize);
+        if(ptr) {
+            sAllocatedBytes -= oldSize;
+            sAllocatedBytes += malloc_usable_size(ptr);
+        }
+        return ptr;
+    }
+}
+
+namespace nn::init {
+    mem::StandardAllocator* GetAllocator() {
+        static mem::StandardAllocator sAllocator;
+        return &sAllocator;
+    }
+}
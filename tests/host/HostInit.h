@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+// the host nn::init allocator counts what it hands out, so tests can check memory stays flat
+namespace host {
+    size_t getAllocatedBytes();
+}
@@ -0,0 +1,107 @@
+#include "nn/os.h"
+#include "os/os_tick.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// ticks are steady clock nanoseconds on the host.
+// threads run on std::thread (the stack and core passed in are ignored), message queues share one lock.
+
+namespace {
+    struct HostThread {
+        nn::os::ThreadFunction mFunction;
+        void* mArg;
+        std::thread mThread;
+    };
+
+    std::mutex sQueueMutex;
+    std::condition_variable sQueueCondition;
+
+    HostThread*& getHostThread(nn::os::ThreadType* thread) {
+        static_assert(sizeof(HostThread*) <= sizeof(thread->field_8));
+        return *(HostThread**)&thread->field_8;
+    }
+}
+
+namespace nn::os {
+    Tick GetSystemTick() {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return Tick(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    }
+
+    s64 GetSystemTickFrequency() {
+        return 1000000000;
+    }
+
+    TimeSpan ConvertToTimeSpan(Tick tick) {
+        return TimeSpan::FromNanoSeconds(tick.GetInt64Value());
+    }
+
+    Tick ConvertToTick(TimeSpan ts) {
+        return Tick(ts.GetNanoSeconds());
+    }
+
+    Result CreateThread(ThreadType* thread, ThreadFunction function, void* argument, void* stack, size_t stack_size,
+                        s32 priority, s32 ideal_core) {
+        getHostThread(thread) = new HostThread{ function, argument, {} };
+        return 0;
+    }
+
+    void StartThread(ThreadType* thread) {
+        HostThread* hostThread = getHostThread(thread);
+        hostThread->mThread = std::thread(hostThread->mFunction, hostThread->mArg);
+    }
+
+    void WaitThread(ThreadType* thread) {
+        HostThread* hostThread = getHostThread(thread);
+        if(hostThread->mThread.joinable())
+            hostThread->mThread.join();
+    }
+
+    void DestroyThread(ThreadType* thread) {
+        delete getHostThread(thread);
+        getHostThread(thread) = nullptr;
+    }
+
+    void SetThreadName(ThreadType* thread, const char* name) {}
+
+    void SleepThread(TimeSpan time) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(time.GetNanoSeconds()));
+    }
+
+    s32 GetCurrentCoreNumber() {
+        return 0;
+    }
+
+    void InitializeMessageQueue(MessageQueueType* queue, u64* buf, u64 queueCount) {
+        queue->Buffer = buf;
+        queue->MaxCount = queueCount;
+        queue->Count = 0;
+        queue->Offset = 0;
+        queue->Initialized = true;
+    }
+
+    void FinalizeMessageQueue(MessageQueueType* queue) {
+        queue->Initialized = false;
+    }
+
+    void SendMessageQueue(MessageQueueType* queue, u64 msg) {
+        std::unique_lock lock(sQueueMutex);
+        sQueueCondition.wait(lock, [&]() { return queue->Count < queue->MaxCount; });
+
+        ((u64*)queue->Buffer)[(queue->Offset + queue->Count) % queue->MaxCount] = msg;
+        queue->Count++;
+        sQueueCondition.notify_all();
+    }
+
+    void ReceiveMessageQueue(u64* out, MessageQueueType* queue) {
+        std::unique_lock lock(sQueueMutex);
+        sQueueCondition.wait(lock, [&]() { return queue->Count != 0; });
+
+        *out = ((u64*)queue->Buffer)[queue->Offset];
+        queue->Offset = (queue->Offset + 1) % queue->MaxCount;
+        queue->Count--;
+        sQueueCondition.notify_all();
+    }
+}
@@ -0,0 +1,25 @@
+#include <cstdio>
+#include <cstdlib>
+#include "lib/reloc/rtld.hpp"
+
+// what ModuleObject.cpp links against besides itself, symbol lookups only ever need the module's own tables
+
+namespace exl::diag {
+    void AssertionFailureImpl(const char* file, int line, const char* func, const char* expr, u64 value) {
+        printf("%s:%d: %s: assertion failed: %s (0x%lx)\n", file, line, func, expr, value);
+        abort();
+    }
+}
+
+namespace nn::ro::detail {
+    bool g_RoDebugFlag = false;
+    lookup_global_t g_LookupGlobalManualFunctionPointer = nullptr;
+}
+
+Elf_Addr rtld::lookup_global_auto(const char* name, const SymbolNameHash& hash) {
+    return 0;
+}
+
+extern "C" void __rtld_runtime_resolve(void) {
+    abort();
+}
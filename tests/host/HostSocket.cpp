@@ -0,0 +1,88 @@
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdarg>
+#include <cstring>
+#include <nn/result.h>
+
+// the sdk's sockaddr and pollfd share their names with the host's, so the functions are defined against the host headers
+// and link to the sdk declarations. pollfd has the same layout on both, sockaddr is translated from the sdk's.
+
+namespace {
+    struct SdkSockAddr {
+        u8 _0;
+        u8 family;
+        u16 port;
+        u32 address;
+        u8 _8[8];
+    };
+
+    // the sdk uses the bsd values for these
+    constexpr int cSdkSolSocket = 0xFFFF;
+    constexpr int cSdkSoError = 0x1007;
+}
+
+namespace nn::socket {
+    s32 InetAton(const char* addressStr, in_addr* addressOut) {
+        return inet_aton(addressStr, addressOut);
+    }
+
+    u16 InetHtons(u16 val) {
+        return htons(val);
+    }
+
+    s32 Socket(s32 domain, s32 type, s32 protocol) {
+        return ::socket(domain, type, protocol);
+    }
+
+    s32 Fcntl(int fd, int cmd, ...) {
+        va_list args;
+        va_start(args, cmd);
+        int arg = va_arg(args, int);
+        va_end(args);
+        return ::fcntl(fd, cmd, arg);
+    }
+
+    nn::Result Connect(s32 socket, const sockaddr* address, u32 addressLen) {
+        SdkSockAddr sdkAddress;
+        memcpy(&sdkAddress, address, sizeof(sdkAddress));
+
+        sockaddr_in hostAddress = {};
+        hostAddress.sin_family = sdkAddress.family;
+        hostAddress.sin_port = sdkAddress.port;
+        hostAddress.sin_addr.s_addr = sdkAddress.address;
+
+        if(::connect(socket, (const ::sockaddr*)&hostAddress, sizeof(hostAddress)) < 0)
+            return 1;
+        return 0;
+    }
+
+    s32 GetLastErrno() {
+        return errno;
+    }
+
+    s32 Poll(pollfd* fds, unsigned long count, int timeout) {
+        return ::poll(fds, count, timeout);
+    }
+
+    s32 GetSockOpt(int socket, int level, int option, void* value, unsigned int* valueSize) {
+        if(level == cSdkSolSocket)
+            level = SOL_SOCKET;
+        if(option == cSdkSoError)
+            option = SO_ERROR;
+        return ::getsockopt(socket, level, option, value, valueSize);
+    }
+
+    s32 Send(s32 socket, const void* data, unsigned long dataLen, s32 flags) {
+        // a closed connection has to show up as an error, not kill the test
+        return ::send(socket, data, dataLen, flags | MSG_NOSIGNAL);
+    }
+
+    Result Close(s32 socket) {
+        return ::close(socket) < 0 ? 1 : 0;
+    }
+}
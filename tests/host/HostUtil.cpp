@@ -0,0 +1,19 @@
+#include <nn/util.h>
+#include <cstdarg>
+#include <cstdio>
+
+// nn::util's printf family behaves like the C library's for everything the subsdk formats
+
+namespace nn::util {
+    s32 SNPrintf(char* s, ulong n, const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        s32 len = vsnprintf(s, n, format, args);
+        va_end(args);
+        return len;
+    }
+
+    s32 VSNPrintf(char* s, ulong n, const char* format, va_list arg) {
+        return vsnprintf(s, n, format, arg);
+    }
+}
@@ -0,0 +1,176 @@
+#include "LoopbackServer.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+LoopbackServer::~LoopbackServer() {
+    stop();
+}
+
+bool LoopbackServer::bind(u32 maxSeq) {
+    mSeen.assign(maxSeq, 0);
+
+    mListenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(mListenFd < 0)
+        return false;
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    if(::bind(mListenFd, (sockaddr*)&address, sizeof(address)) < 0)
+        return false;
+
+    socklen_t size = sizeof(address);
+    if(getsockname(mListenFd, (sockaddr*)&address, &size) < 0)
+        return false;
+    mPort = ntohs(address.sin_port);
+    return true;
+}
+
+void LoopbackServer::listen() {
+    ::listen(mListenFd, 4);
+    mThread = std::thread([this]() { run(); });
+}
+
+void LoopbackServer::stop() {
+    mIsStopping = true;
+    if(mThread.joinable())
+        mThread.join();
+    if(mListenFd >= 0)
+        ::close(mListenFd);
+    mListenFd = -1;
+}
+
+void LoopbackServer::run() {
+    while (!mIsStopping) {
+        pollfd pollFd = { mListenFd, POLLIN, 0 };
+        if(poll(&pollFd, 1, 5) <= 0)
+            continue;
+
+        int fd = accept(mListenFd, nullptr, nullptr);
+        if(fd < 0)
+            continue;
+
+        {
+            std::lock_guard lock(mLock);
+            mConnectionCount++;
+        }
+        mIsDropRequested = false;
+        receive(fd);
+        ::close(fd);
+    }
+}
+
+void LoopbackServer::receive(int fd) {
+    // a packet cut off by a disconnect is sent again in full over the next connection, so parsing starts over
+    std::vector<char> pending;
+    char buffer[0x10000];
+
+    while (!mIsStopping && !mIsDropRequested) {
+        pollfd pollFd = { fd, POLLIN, 0 };
+        if(poll(&pollFd, 1, 5) <= 0)
+            continue;
+
+        ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+        if(size <= 0)
+            return;
+        pending.insert(pending.end(), buffer, buffer + size);
+
+        size_t offset = 0;
+        while (pending.size() - offset >= cPacketHeaderSize) {
+            u32 magic;
+            u32 payloadSize;
+            memcpy(&magic, pending.data() + offset, sizeof(magic));
+            memcpy(&payloadSize, pending.data() + offset + sizeof(magic), sizeof(payloadSize));
+
+            if(magic != cPacketMagic || payloadSize > cMaxPacketSize - cPacketHeaderSize) {
+                std::lock_guard lock(mLock);
+                mIsFramingIntact = false;
+                return;
+            }
+
+            if(pending.size() - offset < cPacketHeaderSize + payloadSize)
+                break;
+
+            onPayload(pending.data() + offset + cPacketHeaderSize, payloadSize);
+            offset += cPacketHeaderSize + payloadSize;
+        }
+        pending.erase(pending.begin(), pending.begin() + offset);
+    }
+}
+
+void LoopbackServer::onPayload(const char* data, size_t size) {
+    std::lock_guard lock(mLock);
+    mPacketCount++;
+    mByteCount += cPacketHeaderSize + size;
+
+    const char* end = data + size;
+    while (data < end) {
+        const char* lineEnd = (const char*)memchr(data, '\n', end - data);
+        if(lineEnd == nullptr) {
+            // messages are never split across packets
+            mIsFramingIntact = false;
+            return;
+        }
+
+        if(lineEnd - data > 4 && memcmp(data, "msg ", 4) == 0) {
+            u32 seq = strtoul(data + 4, nullptr, 10);
+            if(seq < mSeen.size()) {
+                if(mSeen[seq])
+                    mDuplicateCount++;
+                else
+                    mDeliveredCount++;
+                mSeen[seq] = 1;
+            }
+        } else {
+            mOtherLines.emplace_back(data, lineEnd);
+        }
+        data = lineEnd + 1;
+    }
+}
+
+u64 LoopbackServer::getDeliveredCount() {
+    std::lock_guard lock(mLock);
+    return mDeliveredCount;
+}
+
+u64 LoopbackServer::getDuplicateCount() {
+    std::lock_guard lock(mLock);
+    return mDuplicateCount;
+}
+
+u64 LoopbackServer::getPacketCount() {
+    std::lock_guard lock(mLock);
+    return mPacketCount;
+}
+
+u64 LoopbackServer::getByteCount() {
+    std::lock_guard lock(mLock);
+    return mByteCount;
+}
+
+u32 LoopbackServer::getConnectionCount() {
+    std::lock_guard lock(mLock);
+    return mConnectionCount;
+}
+
+bool LoopbackServer::isFramingIntact() {
+    std::lock_guard lock(mLock);
+    return mIsFramingIntact;
+}
+
+bool LoopbackServer::isSeen(u32 seq) {
+    std::lock_guard lock(mLock);
+    return seq < mSeen.size() && mSeen[seq];
+}
+
+std::vector<std::string> LoopbackServer::getOtherLines() {
+    std::lock_guard lock(mLock);
+    return mOtherLines;
+}
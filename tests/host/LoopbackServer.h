@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "types.h"
+
+// receiving end for NetworkTransport on 127.0.0.1, parses its packets and records which numbered messages arrived.
+// messages are lines, "msg <seq>" lines are counted, the rest are kept as text.
+// host socket headers are kept out of here, as they clash with the sdk's.
+class LoopbackServer {
+public:
+    // mirrors NetworkTransport, checked where both are visible
+    static constexpr u32 cPacketMagic = 0x474C5845;
+    static constexpr size_t cPacketHeaderSize = 8;
+    static constexpr size_t cMaxPacketSize = 0x1000;
+
+private:
+    int mListenFd = -1;
+    u16 mPort = 0;
+    std::thread mThread;
+    std::atomic<bool> mIsStopping = false;
+    std::atomic<bool> mIsDropRequested = false;
+
+    std::mutex mLock;
+    std::vector<u8> mSeen;
+    u64 mDeliveredCount = 0;
+    u64 mDuplicateCount = 0;
+    u64 mPacketCount = 0;
+    u64 mByteCount = 0;
+    u32 mConnectionCount = 0;
+    bool mIsFramingIntact = true;
+    std::vector<std::string> mOtherLines;
+
+    void run();
+    void receive(int fd);
+    void onPayload(const char* data, size_t size);
+
+public:
+    ~LoopbackServer();
+
+    /// Binds to a free port, connections are refused until listen
+    bool bind(u32 maxSeq);
+    void listen();
+    void stop();
+
+    /// Closes the current connection from the server side
+    void dropClient() { mIsDropRequested = true; }
+
+    u16 getPort() const { return mPort; }
+
+    u64 getDeliveredCount();
+    u64 getDuplicateCount();
+    u64 getPacketCount();
+    u64 getByteCount();
+    u32 getConnectionCount();
+    bool isFramingIntact();
+    bool isSeen(u32 seq);
+    std::vector<std::string> getOtherLines();
+};